@@ -18,9 +18,10 @@ namespace jimpilier
 	}
 	bool operator!=(CompileTimeType og, llvm::Type *t)
 	{
+		// Arguments arrive as wherever they're stored, so a pointer variable passed to a (non-reference) pointer parameter is a pointer to one
 		return ((og.ty->isPointerTy() &&
 				 og.ty->getNonOpaquePointerElementType() != t) &&
-				og.ty != t);
+				og.ty != t && (og.isRef || og.ty->getPointerTo() != t));
 	}
 	// class FunctionHeader
 	FunctionHeader::FunctionHeader(std::vector<Variable> &arglist, llvm::Function *func, bool returnsRefrence)
@@ -169,6 +170,26 @@ namespace jimpilier
 	{
 		constructors[type].push_back(FunctionHeader(args, func));
 	}
+	llvm::Function *ObjectAliasManager::getDestructor(llvm::Type *ty)
+	{
+		auto found = destructors.find(ty);
+		return found == destructors.end() ? NULL : found->second;
+	}
+
+	void ObjectAliasManager::addDestructor(llvm::Type *type, llvm::Function *func)
+	{
+		destructors[type] = func;
+	}
+	llvm::Function *ObjectAliasManager::getCopier(llvm::Type *ty)
+	{
+		auto found = copiers.find(ty);
+		return found == copiers.end() ? NULL : found->second;
+	}
+
+	void ObjectAliasManager::addCopier(llvm::Type *type, llvm::Function *func)
+	{
+		copiers[type] = func;
+	}
 	Object ObjectAliasManager::getObject(llvm::Type *ty)
 	{
 		for (auto &x : structTypes)
@@ -180,6 +201,13 @@ namespace jimpilier
 	}
 	std::string ObjectAliasManager::getObjectName(llvm::Type *ty)
 	{
+		// Aliases (like a generic function's T) can point at the same type; prefer the name it was declared with
+		if (ty->isStructTy() && ((llvm::StructType *)ty)->hasName())
+		{
+			auto declared = structTypes.find(((llvm::StructType *)ty)->getName().str());
+			if (declared != structTypes.end() && declared->second.ptr == ty)
+				return declared->first;
+		}
 		for (auto &x : structTypes)
 		{
 			if (x.second.ptr == ty)
@@ -203,10 +231,10 @@ namespace jimpilier
 		return true;
 	}
 
-	void ObjectAliasManager::addObjectMembers(std::string alias, std::vector<llvm::Type *> memberTypes, std::vector<std::string> memberNames)
+	void ObjectAliasManager::addObjectMembers(std::string alias, std::vector<llvm::Type *> memberTypes, std::vector<std::string> memberNames, std::vector<int> memberIndices)
 	{
 		for (int i = 0; i < memberTypes.size(); i++)
-			structTypes[alias].members.push_back({memberNames[i], memberTypes[i], i});
+			structTypes[alias].members.push_back({memberNames[i], memberTypes[i], memberIndices.empty() ? i : memberIndices[i]});
 	}
 
 	bool ObjectAliasManager::addObject(std::string alias, llvm::Type *objType)
@@ -219,6 +247,12 @@ namespace jimpilier
 		return true;
 	}
 
+	bool ObjectAliasManager::hasObject(const std::string &alias)
+	{
+		auto found = structTypes.find(alias);
+		return found != structTypes.end() && found->second.ptr != NULL;
+	}
+
 	void ObjectAliasManager::replaceObject(std::string alias, llvm::Type *objType)
 	{
 		structTypes[alias] = Object(objType);
@@ -263,6 +297,9 @@ namespace jimpilier
 		case llvm::Type::ArrayTyID:
 			size = llvm::ConstantInt::getIntegerValue(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, DataLayout->getTypeAllocSize(ty) * ty->getArrayNumElements()));
 			break;
+		case llvm::Type::FixedVectorTyID:
+			size = llvm::ConstantInt::getIntegerValue(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, DataLayout->getTypeAllocSize(ty)));
+			break;
 		case llvm::Type::StructTyID:
 			llvm::StructType *castedval = (llvm::StructType *)ty;
 			size = llvm::ConstantInt::getIntegerValue(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, DataLayout->getStructLayout(castedval)->getSizeInBytes()));
@@ -315,6 +352,13 @@ namespace jimpilier
 			ret += ft->isVarArg() ? ", and has at least 1 set of varadic arguments" : ".";
 			return ret;
 		}
+		case llvm::Type::FixedVectorTyID:
+		{
+			std::string width = std::to_string(((llvm::FixedVectorType *)ty)->getNumElements());
+			if (prettyname)
+				return "vector of " + width + " " + getTypeName(ty->getScalarType(), prettyname) + "s";
+			return getTypeName(ty->getScalarType(), prettyname) + " x" + width;
+		}
 		case llvm::Type::VoidTyID:
 			return "void";
 		default:
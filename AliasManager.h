@@ -79,7 +79,7 @@ namespace jimpilier
 	{
 	public:
 		FunctionAliasManager functions;
-		std::vector<ObjectMember> members;
+		std::vector<ObjectMember> members; // In the order they were declared; ObjectMember::index is where they are in the struct
 		llvm::Type *ptr;
 		Object();
 		Object(llvm::Type *ty);
@@ -93,15 +93,22 @@ namespace jimpilier
 	{
 		std::map<std::string, Object> structTypes;
 		std::map<llvm::Type *, std::vector<FunctionHeader>> constructors; // Rework this maybe?
+		std::map<llvm::Type *, llvm::Function *> destructors;
+		std::map<llvm::Type *, llvm::Function *> copiers;
 	public:
 		llvm::Function *getConstructor(llvm::Type *ty, std::vector<llvm::Type *> &args);
 		void addConstructor(llvm::Type *type, llvm::Function *func, std::vector<jimpilier::Variable> &args);
+		llvm::Function *getDestructor(llvm::Type *ty);
+		void addDestructor(llvm::Type *type, llvm::Function *func);
+		llvm::Function *getCopier(llvm::Type *ty);
+		void addCopier(llvm::Type *type, llvm::Function *func);
 		Object getObject(llvm::Type *ty);
 		std::string getObjectName(llvm::Type *ty);
 		Object &getObject(std::string alias);
 		bool addObject(std::string alias, llvm::Type *objType, std::vector<llvm::Type *> memberTypes, std::vector<std::string> memberNames);
-		void addObjectMembers(std::string alias, std::vector<llvm::Type *> memberTypes, std::vector<std::string> memberNames);
+		void addObjectMembers(std::string alias, std::vector<llvm::Type *> memberTypes, std::vector<std::string> memberNames, std::vector<int> memberIndices = {});
 		bool addObject(std::string alias, llvm::Type *objType);
+		bool hasObject(const std::string &alias);
 		void replaceObject(std::string alias, llvm::Type *objType); 
 		void addObjectFunction(std::string &objName, std::string &funcAlias, std::vector<Variable> &types, llvm::Function *func, bool returnsRef = false);
 		void removeObject(std::string name); 
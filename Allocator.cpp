@@ -0,0 +1,693 @@
+#pragma once
+#include <map>
+#include <set>
+#include <spdlog/spdlog.h>
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "globals.cpp"
+#include "TypeExpr.h"
+#include "AliasManager.h"
+namespace jimpilier
+{
+	/*
+	 * Every block handed out by `heap` starts with a 16 byte header holding an 8 byte tag, so `delete` knows where the memory came from:
+	 * 0 ... (poolClassCount - 1)	= a size class in the object pool; deleting pushes it onto that class's free list
+	 * heapTagMalloc				= a plain malloc() allocation (too big for the pools, or the size wasn't known at compile time)
+	 * heapTagArena					= owned by an arena; deleting it is a no-op, the arena frees it on `release()`
+	 * heapTagAligned				= an aligned_alloc() allocation for a type aligned to more than heapAlignment. The 8 bytes right
+	 *								  before the object (the rest of its header) point to the start of the block
+	 */
+	const int64_t heapTagMalloc = -1;
+	const int64_t heapTagArena = -2;
+	const int64_t heapTagAligned = -3;
+	/**
+	 * @brief Every object from `heap` starts on a heapAlignment byte boundary (the same as malloc()), so the header is that big too
+	 */
+	const uint64_t heapAlignment = 16, heapHeaderSize = heapAlignment;
+	/**
+	 * @brief Objects of up to poolClassCount * poolClassSize bytes are served from the object pool, rounded up to the next multiple of poolClassSize
+	 */
+	const uint64_t poolClassSize = 16, poolClassCount = 16;
+	/**
+	 * @brief Pool blocks are carved out of slabs this big, arenas grow by chunks this big (or bigger if one allocation needs it)
+	 */
+	const uint64_t poolSlabSize = 1 << 16, arenaChunkSize = 1 << 16;
+
+	llvm::FunctionCallee getMallocFunction()
+	{
+		return GlobalVarsAndFunctions->getOrInsertFunction("malloc", llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt64Ty()}, false));
+	}
+	llvm::FunctionCallee getFreeFunction()
+	{
+		return GlobalVarsAndFunctions->getOrInsertFunction("free", llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt8PtrTy()}, false));
+	}
+	/**
+	 * @brief Writes the allocation tag at the start of a raw block and returns a pointer to the object right after it
+	 */
+	llvm::Value *tagHeapBlock(llvm::Value *block, llvm::Value *tag)
+	{
+		builder->CreateStore(tag, builder->CreateBitCast(block, builder->getInt64Ty()->getPointerTo(), "tagptr"));
+		return builder->CreateGEP(builder->getInt8Ty(), block, builder->getInt64(heapHeaderSize), "objptr");
+	}
+	llvm::GlobalVariable *getInternalGlobal(const std::string &name, llvm::Type *ty)
+	{
+		llvm::GlobalVariable *global = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal(name, ty);
+		if (!global->hasInitializer())
+		{
+			global->setLinkage(llvm::GlobalValue::InternalLinkage);
+			global->setInitializer(llvm::Constant::getNullValue(ty));
+		}
+		return global;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `i8* heap.pool.alloc(i32 class)`.
+	 * Pops a block off the free list for that size class, or carves a new one out of the current slab, mallocing a new slab when it runs out.
+	 * Recycled blocks are NOT zeroed; ObjectConstructorCallExprAST handles that when the constructor doesn't initialize everything itself.
+	 * The free lists & slab are thread local, so `parallel for` bodies can allocate without locking (a block deleted on another thread joins that thread's list)
+	 */
+	llvm::Function *getPoolAllocFunction()
+	{
+		llvm::Function *allocfunc = GlobalVarsAndFunctions->getFunction("heap.pool.alloc");
+		if (allocfunc != NULL)
+			return allocfunc;
+		spdlog::debug("Creating object pool allocator");
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *bytePtrTy = builder->getInt8PtrTy();
+		llvm::Type *freelistTy = llvm::ArrayType::get(bytePtrTy, poolClassCount);
+		llvm::GlobalVariable *freelists = getInternalGlobal("heap.pool.freelists", freelistTy);
+		llvm::GlobalVariable *slabcursor = getInternalGlobal("heap.pool.cursor", bytePtrTy);
+		llvm::GlobalVariable *slabend = getInternalGlobal("heap.pool.end", bytePtrTy);
+		freelists->setThreadLocal(true);
+		slabcursor->setThreadLocal(true);
+		slabend->setThreadLocal(true);
+
+		allocfunc = llvm::Function::Create(llvm::FunctionType::get(bytePtrTy, {builder->getInt32Ty()}, false), llvm::Function::InternalLinkage, "heap.pool.alloc", GlobalVarsAndFunctions.get());
+		llvm::Value *sizeclass = allocfunc->getArg(0);
+		sizeclass->setName("sizeclass");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", allocfunc),
+						 *reuseblock = llvm::BasicBlock::Create(*ctxt, "reuse", allocfunc),
+						 *carveblock = llvm::BasicBlock::Create(*ctxt, "carve", allocfunc),
+						 *newslabblock = llvm::BasicBlock::Create(*ctxt, "newslab", allocfunc),
+						 *bumpblock = llvm::BasicBlock::Create(*ctxt, "bump", allocfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *listptr = builder->CreateGEP(freelistTy, freelists, {builder->getInt32(0), sizeclass}, "listptr");
+		llvm::Value *head = builder->CreateLoad(bytePtrTy, listptr, "head");
+		builder->CreateCondBr(builder->CreateIsNull(head, "cmptmp"), carveblock, reuseblock);
+
+		// The first 8 bytes of a free block point to the next free block of the same class
+		builder->SetInsertPoint(reuseblock);
+		llvm::Value *next = builder->CreateLoad(bytePtrTy, builder->CreateBitCast(head, bytePtrTy->getPointerTo()), "next");
+		builder->CreateStore(next, listptr);
+		builder->CreateRet(head);
+
+		builder->SetInsertPoint(carveblock);
+		llvm::Value *classbytes = builder->CreateMul(builder->CreateZExt(builder->CreateAdd(sizeclass, builder->getInt32(1)), builder->getInt64Ty()), builder->getInt64(poolClassSize), "classbytes");
+		llvm::Value *blocksize = builder->CreateAdd(classbytes, builder->getInt64(heapHeaderSize), "blocksize");
+		llvm::Value *cursor = builder->CreateLoad(bytePtrTy, slabcursor, "cursor");
+		llvm::Value *end = builder->CreateLoad(bytePtrTy, slabend, "end");
+		llvm::Value *newcursor = builder->CreateGEP(builder->getInt8Ty(), cursor, blocksize, "newcursor");
+		builder->CreateCondBr(builder->CreateICmpUGT(newcursor, end, "cmptmp"), newslabblock, bumpblock);
+
+		// The old slab's leftovers are abandoned; slabs are never handed back to the OS, they just get recycled through the free lists
+		builder->SetInsertPoint(newslabblock);
+		llvm::Value *slab = builder->CreateCall(getMallocFunction(), {builder->getInt64(poolSlabSize)}, "slab");
+		builder->CreateStore(builder->CreateGEP(builder->getInt8Ty(), slab, builder->getInt64(poolSlabSize)), slabend);
+		builder->CreateBr(bumpblock);
+
+		builder->SetInsertPoint(bumpblock);
+		llvm::PHINode *block = builder->CreatePHI(bytePtrTy, 2, "block");
+		block->addIncoming(cursor, carveblock);
+		block->addIncoming(slab, newslabblock);
+		builder->CreateStore(builder->CreateGEP(builder->getInt8Ty(), block, blocksize), slabcursor);
+		builder->CreateRet(tagHeapBlock(block, builder->CreateZExt(sizeclass, builder->getInt64Ty())));
+		llvm::verifyFunction(*allocfunc);
+		builder->SetInsertPoint(lastInsertPoint);
+		return allocfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `i8* heap.alloc(i64 size)`, the fallback for objects too big for the pools: a tagged malloc()
+	 */
+	llvm::Function *getMallocAllocFunction()
+	{
+		llvm::Function *allocfunc = GlobalVarsAndFunctions->getFunction("heap.alloc");
+		if (allocfunc != NULL)
+			return allocfunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		allocfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, "heap.alloc", GlobalVarsAndFunctions.get());
+		allocfunc->getArg(0)->setName("size");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", allocfunc));
+		llvm::Value *block = builder->CreateCall(getMallocFunction(), {builder->CreateAdd(allocfunc->getArg(0), builder->getInt64(heapHeaderSize))}, "block");
+		builder->CreateRet(tagHeapBlock(block, builder->getInt64(heapTagMalloc)));
+		llvm::verifyFunction(*allocfunc);
+		builder->SetInsertPoint(lastInsertPoint);
+		return allocfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `i8* heap.alloc.aligned(i64 size, i64 alignment)`, for types aligned to more than the
+	 * heapAlignment every other block gets. The header sits at the end of the object's first `alignment` bytes
+	 */
+	llvm::Function *getAlignedAllocFunction()
+	{
+		llvm::Function *allocfunc = GlobalVarsAndFunctions->getFunction("heap.alloc.aligned");
+		if (allocfunc != NULL)
+			return allocfunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *bytePtrTy = builder->getInt8PtrTy();
+		allocfunc = llvm::Function::Create(llvm::FunctionType::get(bytePtrTy, {builder->getInt64Ty(), builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, "heap.alloc.aligned", GlobalVarsAndFunctions.get());
+		llvm::Value *size = allocfunc->getArg(0), *alignment = allocfunc->getArg(1);
+		size->setName("size");
+		alignment->setName("alignment");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", allocfunc));
+		// aligned_alloc() wants a multiple of the alignment
+		llvm::Value *mask = builder->CreateSub(alignment, builder->getInt64(1), "mask");
+		llvm::Value *bytes = builder->CreateAnd(builder->CreateAdd(builder->CreateAdd(size, alignment), mask), builder->CreateNot(mask), "bytes");
+		llvm::FunctionCallee alignedAlloc = GlobalVarsAndFunctions->getOrInsertFunction("aligned_alloc", llvm::FunctionType::get(bytePtrTy, {builder->getInt64Ty(), builder->getInt64Ty()}, false));
+		llvm::Value *block = builder->CreateCall(alignedAlloc, {alignment, bytes}, "block");
+		llvm::Value *obj = builder->CreateGEP(builder->getInt8Ty(), block, alignment, "objptr");
+		llvm::Value *header = builder->CreateGEP(builder->getInt8Ty(), obj, builder->getInt64(-(int64_t)heapHeaderSize), "header");
+		tagHeapBlock(header, builder->getInt64(heapTagAligned));
+		builder->CreateStore(block, builder->CreateBitCast(builder->CreateGEP(builder->getInt8Ty(), obj, builder->getInt64(-8)), bytePtrTy->getPointerTo()));
+		builder->CreateRet(obj);
+		llvm::verifyFunction(*allocfunc);
+		builder->SetInsertPoint(lastInsertPoint);
+		return allocfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `i8* heap.alloc.sized(i64 size)`, which picks the pool or malloc() at runtime,
+	 * for allocations whose size isn't known until after code generation (coroutine frames)
+	 */
+	llvm::Function *getSizedAllocFunction()
+	{
+		llvm::Function *allocfunc = GlobalVarsAndFunctions->getFunction("heap.alloc.sized");
+		if (allocfunc != NULL)
+			return allocfunc;
+		llvm::Function *poolalloc = getPoolAllocFunction(), *mallocalloc = getMallocAllocFunction();
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		allocfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, "heap.alloc.sized", GlobalVarsAndFunctions.get());
+		llvm::Value *size = allocfunc->getArg(0);
+		size->setName("size");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", allocfunc),
+						 *poolblock = llvm::BasicBlock::Create(*ctxt, "pool", allocfunc),
+						 *mallocblock = llvm::BasicBlock::Create(*ctxt, "malloc", allocfunc);
+		builder->SetInsertPoint(entry);
+		builder->CreateCondBr(builder->CreateICmpULE(size, builder->getInt64(poolClassSize * poolClassCount), "cmptmp"), poolblock, mallocblock);
+		builder->SetInsertPoint(poolblock);
+		llvm::Value *bytes = builder->CreateSelect(builder->CreateICmpEQ(size, builder->getInt64(0), "cmptmp"), builder->getInt64(1), size, "bytes");
+		llvm::Value *sizeclass = builder->CreateSub(builder->CreateUDiv(builder->CreateAdd(bytes, builder->getInt64(poolClassSize - 1)), builder->getInt64(poolClassSize)), builder->getInt64(1), "sizeclass");
+		builder->CreateRet(builder->CreateCall(poolalloc, {builder->CreateTrunc(sizeclass, builder->getInt32Ty())}, "poolalloctmp"));
+		builder->SetInsertPoint(mallocblock);
+		builder->CreateRet(builder->CreateCall(mallocalloc, {size}, "mallocalloctmp"));
+		llvm::verifyFunction(*allocfunc);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return allocfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void heap.free(i8* obj)`, which `delete` calls. Reads the tag in front of the object
+	 * and hands the block back to wherever it came from. Deleting null does nothing.
+	 */
+	llvm::Function *getHeapFreeFunction()
+	{
+		llvm::Function *freefunc = GlobalVarsAndFunctions->getFunction("heap.free");
+		if (freefunc != NULL)
+			return freefunc;
+		spdlog::debug("Creating heap.free()");
+		getPoolAllocFunction();
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *bytePtrTy = builder->getInt8PtrTy();
+		llvm::Type *freelistTy = llvm::ArrayType::get(bytePtrTy, poolClassCount);
+		llvm::GlobalVariable *freelists = GlobalVarsAndFunctions->getNamedGlobal("heap.pool.freelists");
+
+		freefunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {bytePtrTy}, false), llvm::Function::InternalLinkage, "heap.free", GlobalVarsAndFunctions.get());
+		llvm::Value *obj = freefunc->getArg(0);
+		obj->setName("obj");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", freefunc),
+						 *readtagblock = llvm::BasicBlock::Create(*ctxt, "readtag", freefunc),
+						 *poolblock = llvm::BasicBlock::Create(*ctxt, "pool", freefunc),
+						 *notpoolblock = llvm::BasicBlock::Create(*ctxt, "notpool", freefunc),
+						 *mallocblock = llvm::BasicBlock::Create(*ctxt, "malloc", freefunc),
+						 *notmallocblock = llvm::BasicBlock::Create(*ctxt, "notmalloc", freefunc),
+						 *alignedblock = llvm::BasicBlock::Create(*ctxt, "aligned", freefunc),
+						 *done = llvm::BasicBlock::Create(*ctxt, "done", freefunc);
+		builder->SetInsertPoint(entry);
+		builder->CreateCondBr(builder->CreateIsNull(obj, "cmptmp"), done, readtagblock);
+
+		builder->SetInsertPoint(readtagblock);
+		llvm::Value *block = builder->CreateGEP(builder->getInt8Ty(), obj, builder->getInt64(-(int64_t)heapHeaderSize), "block");
+		llvm::Value *tag = builder->CreateLoad(builder->getInt64Ty(), builder->CreateBitCast(block, builder->getInt64Ty()->getPointerTo()), "tag");
+		builder->CreateCondBr(builder->CreateICmpSGE(tag, builder->getInt64(0), "cmptmp"), poolblock, notpoolblock);
+
+		builder->SetInsertPoint(poolblock);
+		llvm::Value *listptr = builder->CreateGEP(freelistTy, freelists, {builder->getInt64(0), tag}, "listptr");
+		builder->CreateStore(builder->CreateLoad(bytePtrTy, listptr, "head"), builder->CreateBitCast(obj, bytePtrTy->getPointerTo()));
+		builder->CreateStore(obj, listptr);
+		builder->CreateBr(done);
+
+		builder->SetInsertPoint(notpoolblock);
+		builder->CreateCondBr(builder->CreateICmpEQ(tag, builder->getInt64(heapTagMalloc), "cmptmp"), mallocblock, notmallocblock);
+
+		builder->SetInsertPoint(mallocblock);
+		builder->CreateCall(getFreeFunction(), {block});
+		builder->CreateBr(done);
+
+		builder->SetInsertPoint(notmallocblock);
+		builder->CreateCondBr(builder->CreateICmpEQ(tag, builder->getInt64(heapTagAligned), "cmptmp"), alignedblock, done);
+
+		builder->SetInsertPoint(alignedblock);
+		llvm::Value *start = builder->CreateLoad(bytePtrTy, builder->CreateBitCast(builder->CreateGEP(builder->getInt8Ty(), obj, builder->getInt64(-8)), bytePtrTy->getPointerTo()), "blockstart");
+		builder->CreateCall(getFreeFunction(), {start});
+		builder->CreateBr(done);
+
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*freefunc);
+		builder->SetInsertPoint(lastInsertPoint);
+		return freefunc;
+	}
+
+	/**
+	 * @brief Generates the built-in `arena` object the first time it's referenced, along with its allocator and `release()` method.
+	 * An arena is a chain of malloc()ed chunks that `heap(someArena) T(...)` bumps through; `someArena.release()` frees every chunk at once.
+	 * A zeroed arena is a valid, empty arena, so `arena a` is all it takes to make one, and it's released automatically at the end of its scope.
+	 *
+	 * @return llvm::StructType* - { i8* chunk, i8* cursor, i8* end }. The first 8 bytes of every chunk point to the previous chunk
+	 * (the first block starts heapAlignment bytes in, to keep it aligned).
+	 */
+	llvm::StructType *generateArenaObject()
+	{
+		spdlog::debug("Creating built-in arena object");
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *bytePtrTy = builder->getInt8PtrTy();
+		std::vector<llvm::Type *> memberTypes = {bytePtrTy, bytePtrTy, bytePtrTy};
+		std::vector<std::string> memberNames = {"chunk", "cursor", "end"};
+		llvm::StructType *arenaTy = llvm::StructType::create(*ctxt, memberTypes, "arena", false);
+		AliasMgr.objects.addObject("arena", arenaTy);
+		AliasMgr.objects.addObjectMembers("arena", memberTypes, memberNames);
+
+		// arena.alloc(arena*, i64 size): bump allocate, starting a new chunk when this one is full
+		llvm::Function *allocfunc = llvm::Function::Create(llvm::FunctionType::get(bytePtrTy, {arenaTy->getPointerTo(), builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, "arena.alloc", GlobalVarsAndFunctions.get());
+		llvm::Value *arenaptr = allocfunc->getArg(0), *size = allocfunc->getArg(1);
+		arenaptr->setName("arena");
+		size->setName("size");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", allocfunc),
+						 *growblock = llvm::BasicBlock::Create(*ctxt, "grow", allocfunc),
+						 *bumpblock = llvm::BasicBlock::Create(*ctxt, "bump", allocfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *chunkptr = builder->CreateStructGEP(arenaTy, arenaptr, 0, "chunkptr");
+		llvm::Value *cursorptr = builder->CreateStructGEP(arenaTy, arenaptr, 1, "cursorptr");
+		llvm::Value *endptr = builder->CreateStructGEP(arenaTy, arenaptr, 2, "endptr");
+		// header + object, rounded up to keep every object heapAlignment aligned
+		llvm::Value *needed = builder->CreateAnd(builder->CreateAdd(size, builder->getInt64(heapHeaderSize + heapAlignment - 1)), builder->getInt64(-(int64_t)heapAlignment), "needed");
+		llvm::Value *cursor = builder->CreateLoad(bytePtrTy, cursorptr, "cursor");
+		llvm::Value *end = builder->CreateLoad(bytePtrTy, endptr, "end");
+		llvm::Value *newcursor = builder->CreateGEP(builder->getInt8Ty(), cursor, needed, "newcursor");
+		builder->CreateCondBr(builder->CreateICmpUGT(newcursor, end, "cmptmp"), growblock, bumpblock);
+
+		builder->SetInsertPoint(growblock);
+		llvm::Value *minchunk = builder->CreateAdd(needed, builder->getInt64(heapAlignment), "minchunk");
+		llvm::Value *chunksize = builder->CreateSelect(builder->CreateICmpUGT(minchunk, builder->getInt64(arenaChunkSize)), minchunk, builder->getInt64(arenaChunkSize), "chunksize");
+		llvm::Value *chunk = builder->CreateCall(getMallocFunction(), {chunksize}, "chunk");
+		builder->CreateStore(builder->CreateLoad(bytePtrTy, chunkptr, "oldchunk"), builder->CreateBitCast(chunk, bytePtrTy->getPointerTo()));
+		builder->CreateStore(chunk, chunkptr);
+		builder->CreateStore(builder->CreateGEP(builder->getInt8Ty(), chunk, chunksize), endptr);
+		llvm::Value *firstblock = builder->CreateGEP(builder->getInt8Ty(), chunk, builder->getInt64(heapAlignment), "firstblock");
+		builder->CreateBr(bumpblock);
+
+		builder->SetInsertPoint(bumpblock);
+		llvm::PHINode *block = builder->CreatePHI(bytePtrTy, 2, "block");
+		block->addIncoming(cursor, entry);
+		block->addIncoming(firstblock, growblock);
+		builder->CreateStore(builder->CreateGEP(builder->getInt8Ty(), block, needed), cursorptr);
+		builder->CreateRet(tagHeapBlock(block, builder->getInt64(heapTagArena)));
+		llvm::verifyFunction(*allocfunc);
+
+		// arena::release(arena@): free every chunk, leaving an empty arena that can be reused
+		llvm::Function *releasefunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arenaTy->getPointerTo()}, false), llvm::Function::ExternalLinkage, "arena::release", GlobalVarsAndFunctions.get());
+		arenaptr = releasefunc->getArg(0);
+		arenaptr->setName("this");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", releasefunc);
+		llvm::BasicBlock *loopblock = llvm::BasicBlock::Create(*ctxt, "freechunk", releasefunc),
+						 *done = llvm::BasicBlock::Create(*ctxt, "done", releasefunc);
+		builder->SetInsertPoint(entry);
+		chunkptr = builder->CreateStructGEP(arenaTy, arenaptr, 0, "chunkptr");
+		llvm::Value *first = builder->CreateLoad(bytePtrTy, chunkptr, "chunk");
+		builder->CreateCondBr(builder->CreateIsNull(first, "cmptmp"), done, loopblock);
+
+		builder->SetInsertPoint(loopblock);
+		llvm::PHINode *current = builder->CreatePHI(bytePtrTy, 2, "current");
+		current->addIncoming(first, entry);
+		llvm::Value *previous = builder->CreateLoad(bytePtrTy, builder->CreateBitCast(current, bytePtrTy->getPointerTo()), "previous");
+		builder->CreateCall(getFreeFunction(), {current});
+		current->addIncoming(previous, loopblock);
+		builder->CreateCondBr(builder->CreateIsNull(previous, "cmptmp"), done, loopblock);
+
+		builder->SetInsertPoint(done);
+		builder->CreateStore(llvm::Constant::getNullValue(arenaTy), arenaptr);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*releasefunc);
+
+		std::vector<Variable> args;
+		std::unique_ptr<TypeExpr> t = std::make_unique<StructTypeExpr>("arena");
+		t = std::make_unique<ReferenceToTypeExpr>(t);
+		args.push_back(Variable("this", t));
+		AliasMgr.functions.addFunction("release", releasefunc, args, false);
+		// A local arena releases itself when it goes out of scope; releasing twice is harmless since release() leaves it empty
+		AliasMgr.objects.addDestructor(arenaTy, releasefunc);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return arenaTy;
+	}
+
+	/**
+	 * @brief Allocate the memory for one `heap` expression. The allocator is picked here, per call site:
+	 * an explicit arena if one was given, the object pool if the size is a small compile-time constant, and a tagged malloc() otherwise.
+	 * None of these zero the memory.
+	 *
+	 * Types aligned to more than heapAlignment always come from aligned_alloc(); arenas can't hold them.
+	 *
+	 * @param size - the size of the object, in bytes
+	 * @param arena - pointer to the arena to allocate from, or NULL
+	 * @param alignment - the object's alignment, in bytes (0 if it's no more than heapAlignment)
+	 * @return llvm::Value* - an i8* to the new object
+	 */
+	llvm::Value *createHeapAllocation(llvm::Value *size, llvm::Value *arena = NULL, uint64_t alignment = 0)
+	{
+		size = builder->CreateZExtOrTrunc(size, builder->getInt64Ty());
+		if (alignment > heapAlignment && arena != NULL)
+		{
+			logError("Arenas only align objects to " + std::to_string(heapAlignment) + " bytes, but this one needs " + std::to_string(alignment) + ". Allocate it with a plain `heap` instead");
+			return NULL;
+		}
+		if (alignment > heapAlignment)
+			return builder->CreateCall(getAlignedAllocFunction(), {size, builder->getInt64(alignment)}, "alignedalloctmp");
+		if (arena != NULL)
+			return builder->CreateCall(GlobalVarsAndFunctions->getFunction("arena.alloc"), {arena, size}, "arenaalloctmp");
+		llvm::ConstantInt *constsize = llvm::dyn_cast<llvm::ConstantInt>(size);
+		if (constsize != NULL && constsize->getZExtValue() <= poolClassSize * poolClassCount)
+		{
+			uint64_t bytes = std::max<uint64_t>(constsize->getZExtValue(), 1);
+			uint64_t sizeclass = (bytes + poolClassSize - 1) / poolClassSize - 1;
+			spdlog::debug("Allocating {} bytes from pool class {}", bytes, sizeclass);
+			return builder->CreateCall(getPoolAllocFunction(), {builder->getInt32(sizeclass)}, "poolalloctmp");
+		}
+		return builder->CreateCall(getMallocAllocFunction(), {size}, "mallocalloctmp");
+	}
+
+	/**
+	 * @brief Checks whether a constructor definitely stores to every field of `this` before anything could read them,
+	 * in which case a freshly allocated object doesn't need to be zeroed first.
+	 * This only looks at the constructor's entry block, so fields set inside an if/loop/try don't count.
+	 *
+	 * @param constructor - the constructor being called; its first argument is `this`
+	 * @param objTy - the type of object being constructed
+	 */
+	bool constructorInitializesAllFields(llvm::Function *constructor, llvm::StructType *objTy)
+	{
+		static std::map<llvm::Function *, bool> cache;
+		if (cache.count(constructor))
+			return cache[constructor];
+		bool &result = cache[constructor] = false;
+		if (constructor->isDeclaration() || constructor->arg_empty())
+			return result;
+		llvm::Value *thisArg = constructor->getArg(0);
+		std::set<llvm::Value *> thisSlots, thisPtrs = {thisArg};
+		std::set<unsigned> initialized;
+		// Returns the field index if `ptr` is &this.field, -1 otherwise
+		auto fieldOf = [&](llvm::Value *ptr) -> int
+		{
+			// Not stripPointerCasts(); that would also strip &this.firstField, which is an all-zero GEP
+			if (llvm::BitCastInst *cast = llvm::dyn_cast<llvm::BitCastInst>(ptr))
+				ptr = cast->getOperand(0);
+			llvm::GetElementPtrInst *gep = llvm::dyn_cast<llvm::GetElementPtrInst>(ptr);
+			if (gep == NULL || gep->getSourceElementType() != objTy || gep->getNumIndices() != 2 || !thisPtrs.count(gep->getPointerOperand()) || !gep->hasAllConstantIndices())
+				return -1;
+			return (int)llvm::cast<llvm::ConstantInt>(gep->getOperand(2))->getZExtValue();
+		};
+		for (llvm::Instruction &inst : constructor->getEntryBlock())
+		{
+			if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+			{
+				if (thisPtrs.count(store->getValueOperand()))
+				{
+					// Storing `this` into its local variable is fine, storing it anywhere else lets it escape
+					if (!llvm::isa<llvm::AllocaInst>(store->getPointerOperand()))
+						break;
+					thisSlots.insert(store->getPointerOperand());
+					continue;
+				}
+				int field = fieldOf(store->getPointerOperand());
+				if (field >= 0)
+					initialized.insert(field);
+			}
+			else if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+			{
+				if (thisSlots.count(load->getPointerOperand()))
+					thisPtrs.insert(load);
+				int field = fieldOf(load->getPointerOperand());
+				if (field >= 0 && !initialized.count(field))
+					break;
+			}
+			else if (llvm::isa<llvm::CallBase>(&inst))
+			{
+				// `this` being handed to another function means it could read any field
+				bool escapes = false;
+				for (llvm::Value *arg : llvm::cast<llvm::CallBase>(&inst)->args())
+					escapes |= thisPtrs.count(arg) || fieldOf(arg) >= 0 || (llvm::isa<llvm::BitCastInst>(arg) && thisPtrs.count(llvm::cast<llvm::BitCastInst>(arg)->getOperand(0)));
+				if (escapes || inst.isTerminator())
+					break;
+			}
+		}
+		// The zero length array an `align` object ends with has nothing to initialize
+		unsigned fields = objTy->getNumElements();
+		if (fields > 0 && DataLayout->getTypeAllocSize(objTy->getElementType(fields - 1)) == 0)
+			fields--;
+		result = initialized.size() == fields;
+		spdlog::debug("Constructor {} initializes {}/{} fields", constructor->getName().str(), initialized.size(), fields);
+		return result;
+	}
+
+	/**
+	 * @brief The biggest object escape analysis will move onto the stack, in bytes
+	 */
+	const uint64_t maxStackPromotionSize = 4096;
+
+	bool argumentEscapes(llvm::Function *func, unsigned argNo, bool &returned, int depth);
+
+	/**
+	 * @brief True if this use of a local only marks where its lifetime starts or ends (see trackLocal)
+	 */
+	bool isLifetimeMarker(llvm::User *user)
+	{
+		if (llvm::isa<llvm::BitCastInst>(user))
+			return llvm::all_of(user->users(), isLifetimeMarker);
+		llvm::IntrinsicInst *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(user);
+		return intrinsic != NULL && (intrinsic->getIntrinsicID() == llvm::Intrinsic::lifetime_start || intrinsic->getIntrinsicID() == llvm::Intrinsic::lifetime_end);
+	}
+
+	/**
+	 * @brief Follows every use of a pointer to a heap object (and anything derived from it) within one function, to check whether it escapes.
+	 * It may be read & written through, compared, stored in local variables, passed to functions whose matching argument doesn't escape either,
+	 * and deleted. Anything else (storing it in a global or another object, passing it to an unknown function, casting it to an int, etc.) is an escape.
+	 *
+	 * @param root - the pointer to follow
+	 * @param frees - if not NULL, filled with every `delete` (heap.free) call that could free `root`
+	 * @param returned - set to true if the pointer (or something derived from it) is returned
+	 * @param depth - how many calls deep we've followed the pointer
+	 * @return true if the pointer escapes
+	 */
+	bool pointerEscapes(llvm::Value *root, std::vector<llvm::CallBase *> *frees, bool &returned, int depth = 0)
+	{
+		std::set<llvm::Value *> ptrs = {root};
+		std::vector<llvm::Value *> worklist = {root};
+		std::set<llvm::AllocaInst *> slots;
+		while (!worklist.empty())
+		{
+			llvm::Value *ptr = worklist.back();
+			worklist.pop_back();
+			for (llvm::User *user : ptr->users())
+			{
+				llvm::Instruction *inst = llvm::dyn_cast<llvm::Instruction>(user);
+				if (inst == NULL)
+					return true;
+				if (llvm::isa<llvm::BitCastInst>(inst) || (llvm::isa<llvm::GetElementPtrInst>(inst) && inst->getOperand(0) == ptr))
+				{
+					if (ptrs.insert(inst).second)
+						worklist.push_back(inst);
+				}
+				else if (llvm::isa<llvm::LoadInst>(inst) || llvm::isa<llvm::ICmpInst>(inst))
+					continue;
+				else if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(inst))
+				{
+					if (store->getValueOperand() != ptr)
+						continue;
+					// Storing the pointer into a local variable is fine, as long as that variable only ever holds this object (see below)
+					llvm::AllocaInst *slot = llvm::dyn_cast<llvm::AllocaInst>(store->getPointerOperand());
+					if (slot == NULL)
+						return true;
+					if (!slots.insert(slot).second)
+						continue;
+					for (llvm::User *slotuser : slot->users())
+					{
+						if (llvm::isa<llvm::LoadInst>(slotuser))
+						{
+							if (ptrs.insert(slotuser).second)
+								worklist.push_back(slotuser);
+						}
+						else if (isLifetimeMarker(slotuser))
+							continue;
+						else if (!llvm::isa<llvm::StoreInst>(slotuser) || ((llvm::StoreInst *)slotuser)->getPointerOperand() != slot)
+							return true;
+					}
+				}
+				else if (llvm::isa<llvm::ReturnInst>(inst))
+					returned = true;
+				else if (llvm::CallBase *call = llvm::dyn_cast<llvm::CallBase>(inst))
+				{
+					llvm::Function *callee = call->getCalledFunction();
+					if (callee == NULL)
+						return true;
+					if (callee->getName() == "heap.free")
+					{
+						if (frees != NULL)
+							frees->push_back(call);
+						continue;
+					}
+					llvm::Intrinsic::ID id = callee->getIntrinsicID();
+					if (id == llvm::Intrinsic::memset || id == llvm::Intrinsic::memcpy || id == llvm::Intrinsic::memmove ||
+						id == llvm::Intrinsic::lifetime_start || id == llvm::Intrinsic::lifetime_end)
+						continue;
+					if (callee->isDeclaration() || depth >= 4)
+						return true;
+					for (unsigned i = 0; i < call->arg_size(); i++)
+					{
+						if (call->getArgOperand(i) != ptr)
+							continue;
+						bool argReturned = false;
+						if (argumentEscapes(callee, i, argReturned, depth + 1))
+							return true;
+						if (argReturned && ptrs.insert(call).second)
+							worklist.push_back(call);
+					}
+				}
+				else
+					return true;
+			}
+		}
+		// Every local variable the pointer went through must only ever hold this object (or null), otherwise we can't tell which object a delete frees
+		for (llvm::AllocaInst *slot : slots)
+			for (llvm::User *slotuser : slot->users())
+				if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(slotuser))
+					if (!ptrs.count(store->getValueOperand()) && !(llvm::isa<llvm::Constant>(store->getValueOperand()) && ((llvm::Constant *)store->getValueOperand())->isNullValue()))
+						return true;
+		return false;
+	}
+
+	/**
+	 * @brief Checks whether a function lets one of its pointer arguments escape. Results are cached per argument.
+	 * A function that deletes its argument counts as an escape too; the caller can't keep track of that delete.
+	 */
+	bool argumentEscapes(llvm::Function *func, unsigned argNo, bool &returned, int depth)
+	{
+		static std::map<std::pair<llvm::Function *, unsigned>, std::pair<bool, bool>> cache;
+		std::pair<llvm::Function *, unsigned> key(func, argNo);
+		if (cache.count(key))
+		{
+			returned = cache[key].second;
+			return cache[key].first;
+		}
+		// Assume the worst while we're working it out, so recursive calls terminate
+		cache[key] = {true, false};
+		std::vector<llvm::CallBase *> frees;
+		bool escapes = pointerEscapes(func->getArg(argNo), &frees, returned, depth) || !frees.empty();
+		cache[key] = {escapes, returned};
+		return escapes;
+	}
+
+	bool isInLoop(llvm::BasicBlock *block)
+	{
+		std::set<llvm::BasicBlock *> visited;
+		std::vector<llvm::BasicBlock *> worklist(llvm::succ_begin(block), llvm::succ_end(block));
+		while (!worklist.empty())
+		{
+			llvm::BasicBlock *current = worklist.back();
+			worklist.pop_back();
+			if (current == block)
+				return true;
+			if (!visited.insert(current).second)
+				continue;
+			worklist.insert(worklist.end(), llvm::succ_begin(current), llvm::succ_end(current));
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Escape analysis: moves `heap` objects that never outlive the function allocating them onto the stack, and removes their deletes.
+	 * Only pool & malloc allocations with a constant size are considered (never arenas), and only outside of loops,
+	 * since a single stack slot can't stand in for one object per iteration.
+	 *
+	 * @return int - the number of allocations moved onto the stack
+	 */
+	int promoteNonEscapingHeapObjects(llvm::Function &func)
+	{
+		if (func.isDeclaration())
+			return 0;
+		std::vector<std::pair<llvm::CallInst *, uint64_t>> candidates;
+		for (llvm::BasicBlock &block : func)
+			for (llvm::Instruction &inst : block)
+			{
+				llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst);
+				if (call == NULL || call->getCalledFunction() == NULL || call->arg_size() != 1)
+					continue;
+				llvm::ConstantInt *arg = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(0));
+				if (arg == NULL)
+					continue;
+				if (call->getCalledFunction()->getName() == "heap.pool.alloc")
+					candidates.push_back({call, (arg->getZExtValue() + 1) * poolClassSize});
+				else if (call->getCalledFunction()->getName() == "heap.alloc")
+					candidates.push_back({call, arg->getZExtValue()});
+			}
+		int promoted = 0;
+		for (auto &candidate : candidates)
+		{
+			llvm::CallInst *call = candidate.first;
+			uint64_t size = candidate.second;
+			std::vector<llvm::CallBase *> frees;
+			bool returned = false;
+			if (size > maxStackPromotionSize || isInLoop(call->getParent()) || pointerEscapes(call, &frees, returned) || returned)
+				continue;
+			spdlog::debug("Moving a {} byte heap object in {}() onto the stack", size, func.getName().str());
+			// Use the object's own type if we can see it, so SROA can split it up later
+			llvm::Type *objTy = NULL;
+			for (llvm::User *user : call->users())
+				if (llvm::isa<llvm::BitCastInst>(user) && objTy == NULL)
+					objTy = user->getType()->getNonOpaquePointerElementType();
+			if (objTy == NULL || !objTy->isSized() || DataLayout->getTypeAllocSize(objTy) > size)
+				objTy = llvm::ArrayType::get(builder->getInt8Ty(), size);
+			llvm::BasicBlock &entry = func.getEntryBlock();
+			// At least as aligned as the heap block it replaces, in case its type couldn't be seen
+			llvm::Align alignment = std::max(DataLayout->getPrefTypeAlign(objTy), llvm::Align(heapAlignment));
+			llvm::AllocaInst *slot = new llvm::AllocaInst(objTy, 0, NULL, alignment, "stackobj", &*entry.getFirstInsertionPt());
+			llvm::Value *bytes = new llvm::BitCastInst(slot, call->getType(), "stackobjptr", call);
+			for (llvm::CallBase *freecall : frees)
+				freecall->eraseFromParent();
+			call->replaceAllUsesWith(bytes);
+			call->eraseFromParent();
+			promoted++;
+		}
+		return promoted;
+	}
+}
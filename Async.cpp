@@ -0,0 +1,583 @@
+#pragma once
+#include <map>
+#include <set>
+#include <spdlog/spdlog.h>
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Coroutines/CoroCleanup.h"
+#include "llvm/Transforms/Coroutines/CoroEarly.h"
+#include "llvm/Transforms/Coroutines/CoroSplit.h"
+#include "globals.cpp"
+#include "Allocator.cpp"
+namespace jimpilier
+{
+	/*
+	 * `async` functions & `await`. An async function is a stackless coroutine (llvm.coro.*): calling one runs it up to its first `await`
+	 * that has to wait, then returns an `async T` task, which is a pointer to the coroutine's promise: { i8* waiter, i1 done, T result }.
+	 * The frame is allocated from the object pools (or malloc() if it's big), and freed by whoever awaits the task.
+	 *
+	 * Coroutines are resumed by a single threaded event loop, async.step(), which resumes everything on the ready queue, or (when that's
+	 * empty) sleeps in epoll_wait() until a file descriptor someone is waiting on is ready. Timers are timerfds, so they're just more
+	 * file descriptors. `await` outside of an async function has nothing to suspend, so it runs the event loop until what it's waiting for is done.
+	 *
+	 * A "waiter" is what gets put on the ready queue once something finishes: either a coroutine handle (which gets resumed),
+	 * or the address of a flag with the lowest bit set, for `await` outside of a coroutine (the flag gets set).
+	 */
+	const int asyncMaxEvents = 64;
+	const int asyncEpollIn = 0x1, asyncEpollOut = 0x4, asyncEpollOneShot = 1 << 30;
+	const int asyncEpollCtlAdd = 1, asyncEpollCtlDel = 2;
+	const int asyncClockMonotonic = 1, asyncCloseOnExec = 02000000;
+
+	/**
+	 * @brief The coroutine that's being generated right now: its promise, handle, and the blocks every `return` & suspension point jump to
+	 */
+	struct AsyncFunctionState
+	{
+		llvm::AllocaInst *promise;
+		llvm::Value *id, *handle;
+		llvm::BasicBlock *finalBlock, *cleanupBlock, *suspendBlock;
+	};
+	std::map<llvm::Function *, AsyncFunctionState> asyncFunctions;
+	std::map<llvm::Type *, llvm::StructType *> asyncPromiseTypes;
+
+	/**
+	 * @brief Get (creating it the first time) the promise of an `async T`: { i8* waiter, i1 done, T result }. `async void` has no result
+	 */
+	llvm::StructType *getAsyncPromiseType(llvm::Type *result)
+	{
+		if (asyncPromiseTypes.count(result))
+			return asyncPromiseTypes[result];
+		std::vector<llvm::Type *> fields = {builder->getInt8PtrTy(), builder->getInt1Ty()};
+		if (!result->isVoidTy())
+			fields.push_back(result);
+		llvm::StructType *promiseTy = llvm::StructType::create(*ctxt, fields, "async." + AliasMgr.getTypeName(result));
+		asyncPromiseTypes[result] = promiseTy;
+		return promiseTy;
+	}
+	/**
+	 * @brief If `ty` is an `async T` (a pointer to a promise), the promise type. NULL otherwise
+	 */
+	llvm::StructType *getAsyncPromiseOf(llvm::Type *ty)
+	{
+		if (ty == NULL || !ty->isPointerTy())
+			return NULL;
+		llvm::Type *pointee = ty->getNonOpaquePointerElementType();
+		for (auto &promiseTy : asyncPromiseTypes)
+			if (promiseTy.second == pointee)
+				return promiseTy.second;
+		return NULL;
+	}
+	/**
+	 * @brief The alignment promises are allocated with; llvm.coro.promise needs it to find the promise from a handle & vice versa
+	 */
+	llvm::Align getAsyncPromiseAlign()
+	{
+		return llvm::Align(16);
+	}
+	llvm::FunctionCallee getAsyncLibcFunction(const std::string &name, llvm::Type *ret, std::vector<llvm::Type *> args)
+	{
+		return GlobalVarsAndFunctions->getOrInsertFunction(name, llvm::FunctionType::get(ret, args, false));
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void async.schedule(i8* waiter)`, which puts a waiter on the back of the ready queue.
+	 * The queue is a ring buffer that doubles in size whenever it fills up
+	 */
+	llvm::Function *getAsyncScheduleFunction()
+	{
+		llvm::Function *schedulefunc = GlobalVarsAndFunctions->getFunction("async.schedule");
+		if (schedulefunc != NULL)
+			return schedulefunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *waiterTy = builder->getInt8PtrTy();
+		llvm::GlobalVariable *queue = getInternalGlobal("async.ready", waiterTy->getPointerTo()),
+							 *head = getInternalGlobal("async.ready.head", builder->getInt64Ty()),
+							 *count = getInternalGlobal("async.ready.count", builder->getInt64Ty()),
+							 *capacity = getInternalGlobal("async.ready.capacity", builder->getInt64Ty());
+		schedulefunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {waiterTy}, false), llvm::Function::InternalLinkage, "async.schedule", GlobalVarsAndFunctions.get());
+		llvm::Value *waiter = schedulefunc->getArg(0);
+		waiter->setName("waiter");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", schedulefunc),
+						 *grow = llvm::BasicBlock::Create(*ctxt, "grow", schedulefunc),
+						 *copy = llvm::BasicBlock::Create(*ctxt, "copy", schedulefunc),
+						 *copied = llvm::BasicBlock::Create(*ctxt, "copied", schedulefunc),
+						 *push = llvm::BasicBlock::Create(*ctxt, "push", schedulefunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *oldQueue = builder->CreateLoad(waiterTy->getPointerTo(), queue, "queue");
+		llvm::Value *first = builder->CreateLoad(builder->getInt64Ty(), head, "head");
+		llvm::Value *size = builder->CreateLoad(builder->getInt64Ty(), count, "count");
+		llvm::Value *cap = builder->CreateLoad(builder->getInt64Ty(), capacity, "capacity");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, cap, "full"), grow, push);
+
+		// Copy everything over to the front of a queue twice as big, in order
+		builder->SetInsertPoint(grow);
+		llvm::Value *doubled = builder->CreateMul(cap, builder->getInt64(2), "doubled");
+		llvm::Value *newCap = builder->CreateSelect(builder->CreateICmpULT(doubled, builder->getInt64(16), "toosmall"), builder->getInt64(16), doubled, "newcapacity");
+		llvm::Value *newBuffer = builder->CreateCall(getMallocFunction(), {builder->CreateMul(newCap, builder->getInt64(DataLayout->getPointerSize()), "bytes")}, "newbuffer");
+		llvm::Value *newQueue = builder->CreateBitCast(newBuffer, waiterTy->getPointerTo(), "newqueue");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "empty"), copied, copy);
+		builder->SetInsertPoint(copy);
+		llvm::PHINode *index = builder->CreatePHI(builder->getInt64Ty(), 2, "index");
+		index->addIncoming(builder->getInt64(0), grow);
+		llvm::Value *from = builder->CreateAnd(builder->CreateAdd(first, index), builder->CreateSub(cap, builder->getInt64(1)), "from");
+		llvm::Value *moved = builder->CreateLoad(waiterTy, builder->CreateGEP(waiterTy, oldQueue, from, "fromptr"), "moved");
+		builder->CreateStore(moved, builder->CreateGEP(waiterTy, newQueue, index, "toptr"));
+		llvm::Value *nextIndex = builder->CreateAdd(index, builder->getInt64(1), "nextindex");
+		index->addIncoming(nextIndex, copy);
+		builder->CreateCondBr(builder->CreateICmpULT(nextIndex, size, "morewaiters"), copy, copied);
+		builder->SetInsertPoint(copied);
+		builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(oldQueue, builder->getInt8PtrTy())});
+		builder->CreateStore(newQueue, queue);
+		builder->CreateStore(builder->getInt64(0), head);
+		builder->CreateStore(newCap, capacity);
+		builder->CreateBr(push);
+
+		builder->SetInsertPoint(push);
+		llvm::PHINode *currentQueue = builder->CreatePHI(waiterTy->getPointerTo(), 2, "currentqueue"),
+					  *currentHead = builder->CreatePHI(builder->getInt64Ty(), 2, "currenthead"),
+					  *currentCap = builder->CreatePHI(builder->getInt64Ty(), 2, "currentcapacity");
+		currentQueue->addIncoming(oldQueue, entry);
+		currentQueue->addIncoming(newQueue, copied);
+		currentHead->addIncoming(first, entry);
+		currentHead->addIncoming(builder->getInt64(0), copied);
+		currentCap->addIncoming(cap, entry);
+		currentCap->addIncoming(newCap, copied);
+		llvm::Value *slot = builder->CreateAnd(builder->CreateAdd(currentHead, size), builder->CreateSub(currentCap, builder->getInt64(1)), "slot");
+		builder->CreateStore(waiter, builder->CreateGEP(waiterTy, currentQueue, slot, "slotptr"));
+		builder->CreateStore(builder->CreateAdd(size, builder->getInt64(1)), count);
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return schedulefunc;
+	}
+
+	/**
+	 * @brief The epoll instance everything waits on; -1 until the first wait creates it
+	 */
+	llvm::GlobalVariable *getAsyncEpollGlobal()
+	{
+		llvm::GlobalVariable *epoll = getInternalGlobal("async.epoll", builder->getInt32Ty());
+		epoll->setInitializer(builder->getInt32(-1));
+		return epoll;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void async.watch(i32 fd, i32 events, i8* waiter)`, which schedules `waiter` once `fd` is ready.
+	 * Regular files can't be waited on (epoll refuses them), but they're always ready, so the waiter is scheduled right away instead
+	 */
+	llvm::Function *getAsyncWatchFunction()
+	{
+		llvm::Function *watchfunc = GlobalVarsAndFunctions->getFunction("async.watch");
+		if (watchfunc != NULL)
+			return watchfunc;
+		llvm::Function *schedulefunc = getAsyncScheduleFunction();
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::GlobalVariable *epoll = getAsyncEpollGlobal(), *waiting = getInternalGlobal("async.waiting", builder->getInt64Ty());
+		llvm::StructType *eventTy = llvm::StructType::get(*ctxt, {builder->getInt32Ty(), builder->getInt64Ty()}, true);
+		watchfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt32Ty(), builder->getInt32Ty(), builder->getInt8PtrTy()}, false), llvm::Function::InternalLinkage, "async.watch", GlobalVarsAndFunctions.get());
+		llvm::Value *fd = watchfunc->getArg(0), *events = watchfunc->getArg(1), *waiter = watchfunc->getArg(2);
+		fd->setName("fd");
+		events->setName("events");
+		waiter->setName("waiter");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", watchfunc),
+						 *create = llvm::BasicBlock::Create(*ctxt, "create", watchfunc),
+						 *watch = llvm::BasicBlock::Create(*ctxt, "watch", watchfunc),
+						 *watching = llvm::BasicBlock::Create(*ctxt, "watching", watchfunc),
+						 *alwaysReady = llvm::BasicBlock::Create(*ctxt, "alwaysready", watchfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *event = builder->CreateAlloca(eventTy, NULL, "event");
+		llvm::Value *existing = builder->CreateLoad(builder->getInt32Ty(), epoll, "epoll");
+		builder->CreateCondBr(builder->CreateICmpSLT(existing, builder->getInt32(0), "noepoll"), create, watch);
+		builder->SetInsertPoint(create);
+		llvm::Value *created = builder->CreateCall(getAsyncLibcFunction("epoll_create1", builder->getInt32Ty(), {builder->getInt32Ty()}), {builder->getInt32(asyncCloseOnExec)}, "newepoll");
+		builder->CreateStore(created, epoll);
+		builder->CreateBr(watch);
+		builder->SetInsertPoint(watch);
+		llvm::PHINode *epollfd = builder->CreatePHI(builder->getInt32Ty(), 2, "epollfd");
+		epollfd->addIncoming(existing, entry);
+		epollfd->addIncoming(created, create);
+		builder->CreateStore(builder->CreateOr(events, builder->getInt32(asyncEpollOneShot), "oneshot"), builder->CreateStructGEP(eventTy, event, 0, "eventflags"));
+		builder->CreateStore(builder->CreatePtrToInt(waiter, builder->getInt64Ty(), "waiterbits"), builder->CreateStructGEP(eventTy, event, 1, "eventdata"));
+		llvm::FunctionCallee ctl = getAsyncLibcFunction("epoll_ctl", builder->getInt32Ty(), {builder->getInt32Ty(), builder->getInt32Ty(), builder->getInt32Ty(), eventTy->getPointerTo()});
+		llvm::Value *added = builder->CreateCall(ctl, {epollfd, builder->getInt32(asyncEpollCtlAdd), fd, event}, "added");
+		builder->CreateCondBr(builder->CreateICmpEQ(added, builder->getInt32(0), "watched"), watching, alwaysReady);
+		builder->SetInsertPoint(watching);
+		builder->CreateStore(builder->CreateAdd(builder->CreateLoad(builder->getInt64Ty(), waiting, "waiting"), builder->getInt64(1)), waiting);
+		builder->CreateRetVoid();
+		builder->SetInsertPoint(alwaysReady);
+		builder->CreateCall(schedulefunc, {waiter});
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return watchfunc;
+	}
+	/**
+	 * @brief Stops watching a file descriptor once its waiter has been woken up, so it can be waited on again
+	 */
+	void createAsyncUnwatch(llvm::Value *fd)
+	{
+		llvm::StructType *eventTy = llvm::StructType::get(*ctxt, {builder->getInt32Ty(), builder->getInt64Ty()}, true);
+		llvm::FunctionCallee ctl = getAsyncLibcFunction("epoll_ctl", builder->getInt32Ty(), {builder->getInt32Ty(), builder->getInt32Ty(), builder->getInt32Ty(), eventTy->getPointerTo()});
+		llvm::Value *epollfd = builder->CreateLoad(builder->getInt32Ty(), getAsyncEpollGlobal(), "epoll");
+		builder->CreateCall(ctl, {epollfd, builder->getInt32(asyncEpollCtlDel), fd, llvm::ConstantPointerNull::get(eventTy->getPointerTo())}, "unwatched");
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void async.step()`, one turn of the event loop: wakes up every waiter that's on the ready queue right now.
+	 * If there aren't any, waits for at least one watched file descriptor to be ready, and schedules their waiters.
+	 * If there's nothing to wait for either, whatever called this is waiting on something that will never finish; that's an error
+	 */
+	llvm::Function *getAsyncStepFunction()
+	{
+		llvm::Function *stepfunc = GlobalVarsAndFunctions->getFunction("async.step");
+		if (stepfunc != NULL)
+			return stepfunc;
+		spdlog::debug("Creating async event loop");
+		llvm::Function *schedulefunc = getAsyncScheduleFunction();
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *waiterTy = builder->getInt8PtrTy();
+		llvm::GlobalVariable *queue = getInternalGlobal("async.ready", waiterTy->getPointerTo()),
+							 *head = getInternalGlobal("async.ready.head", builder->getInt64Ty()),
+							 *count = getInternalGlobal("async.ready.count", builder->getInt64Ty()),
+							 *capacity = getInternalGlobal("async.ready.capacity", builder->getInt64Ty()),
+							 *waiting = getInternalGlobal("async.waiting", builder->getInt64Ty()),
+							 *epoll = getAsyncEpollGlobal();
+		llvm::StructType *eventTy = llvm::StructType::get(*ctxt, {builder->getInt32Ty(), builder->getInt64Ty()}, true);
+		llvm::Type *eventsTy = llvm::ArrayType::get(eventTy, asyncMaxEvents);
+		stepfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), false), llvm::Function::InternalLinkage, "async.step", GlobalVarsAndFunctions.get());
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", stepfunc),
+						 *wake = llvm::BasicBlock::Create(*ctxt, "wake", stepfunc),
+						 *resume = llvm::BasicBlock::Create(*ctxt, "resume", stepfunc),
+						 *setFlag = llvm::BasicBlock::Create(*ctxt, "setflag", stepfunc),
+						 *woken = llvm::BasicBlock::Create(*ctxt, "woken", stepfunc),
+						 *checkWaiting = llvm::BasicBlock::Create(*ctxt, "checkwaiting", stepfunc),
+						 *poll = llvm::BasicBlock::Create(*ctxt, "poll", stepfunc),
+						 *ready = llvm::BasicBlock::Create(*ctxt, "ready", stepfunc),
+						 *stuck = llvm::BasicBlock::Create(*ctxt, "stuck", stepfunc),
+						 *done = llvm::BasicBlock::Create(*ctxt, "done", stepfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *events = builder->CreateAlloca(eventsTy, NULL, "events");
+		// Only wake up what's queued right now; anything those schedule waits for the next step
+		llvm::Value *queued = builder->CreateLoad(builder->getInt64Ty(), count, "queued");
+		builder->CreateCondBr(builder->CreateICmpEQ(queued, builder->getInt64(0), "nothingready"), checkWaiting, wake);
+
+		builder->SetInsertPoint(wake);
+		llvm::PHINode *remaining = builder->CreatePHI(builder->getInt64Ty(), 2, "remaining");
+		remaining->addIncoming(queued, entry);
+		llvm::Value *first = builder->CreateLoad(builder->getInt64Ty(), head, "head");
+		llvm::Value *waiter = builder->CreateLoad(waiterTy, builder->CreateGEP(waiterTy, builder->CreateLoad(waiterTy->getPointerTo(), queue, "queue"), first, "headptr"), "waiter");
+		llvm::Value *cap = builder->CreateLoad(builder->getInt64Ty(), capacity, "capacity");
+		builder->CreateStore(builder->CreateAnd(builder->CreateAdd(first, builder->getInt64(1)), builder->CreateSub(cap, builder->getInt64(1)), "nexthead"), head);
+		builder->CreateStore(builder->CreateSub(builder->CreateLoad(builder->getInt64Ty(), count, "count"), builder->getInt64(1)), count);
+		llvm::Value *waiterBits = builder->CreatePtrToInt(waiter, builder->getInt64Ty(), "waiterbits");
+		builder->CreateCondBr(builder->CreateTrunc(waiterBits, builder->getInt1Ty(), "isflag"), setFlag, resume);
+		builder->SetInsertPoint(resume);
+		builder->CreateIntrinsic(llvm::Intrinsic::coro_resume, {}, {waiter});
+		builder->CreateBr(woken);
+		builder->SetInsertPoint(setFlag);
+		llvm::Value *flag = builder->CreateIntToPtr(builder->CreateAnd(waiterBits, builder->getInt64(-2)), builder->getInt1Ty()->getPointerTo(), "flag");
+		builder->CreateStore(builder->getInt1(true), flag);
+		builder->CreateBr(woken);
+		builder->SetInsertPoint(woken);
+		llvm::Value *left = builder->CreateSub(remaining, builder->getInt64(1), "left");
+		remaining->addIncoming(left, woken);
+		builder->CreateCondBr(builder->CreateICmpEQ(left, builder->getInt64(0), "allwoken"), done, wake);
+
+		builder->SetInsertPoint(checkWaiting);
+		llvm::Value *watched = builder->CreateLoad(builder->getInt64Ty(), waiting, "waiting");
+		builder->CreateCondBr(builder->CreateICmpEQ(watched, builder->getInt64(0), "nothingwatched"), stuck, poll);
+		builder->SetInsertPoint(poll);
+		llvm::Value *eventsPtr = builder->CreateInBoundsGEP(eventsTy, events, {builder->getInt32(0), builder->getInt32(0)}, "eventsptr");
+		llvm::Value *readyCount = builder->CreateCall(getAsyncLibcFunction("epoll_wait", builder->getInt32Ty(), {builder->getInt32Ty(), eventTy->getPointerTo(), builder->getInt32Ty(), builder->getInt32Ty()}),
+													  {builder->CreateLoad(builder->getInt32Ty(), epoll, "epoll"), eventsPtr, builder->getInt32(asyncMaxEvents), builder->getInt32(-1)}, "readycount");
+		// Interrupted by a signal (or any other error): just try again next step
+		builder->CreateCondBr(builder->CreateICmpSGT(readyCount, builder->getInt32(0), "anyready"), ready, done);
+		builder->SetInsertPoint(ready);
+		llvm::PHINode *eventIndex = builder->CreatePHI(builder->getInt32Ty(), 2, "eventindex");
+		eventIndex->addIncoming(builder->getInt32(0), poll);
+		llvm::Value *data = builder->CreateLoad(builder->getInt64Ty(), builder->CreateInBoundsGEP(eventsTy, events, {builder->getInt32(0), eventIndex, builder->getInt32(1)}, "eventdata"), "data");
+		builder->CreateCall(schedulefunc, {builder->CreateIntToPtr(data, waiterTy, "readywaiter")});
+		builder->CreateStore(builder->CreateSub(builder->CreateLoad(builder->getInt64Ty(), waiting, "stillwaiting"), builder->getInt64(1)), waiting);
+		llvm::Value *nextEvent = builder->CreateAdd(eventIndex, builder->getInt32(1), "nextevent");
+		eventIndex->addIncoming(nextEvent, ready);
+		builder->CreateCondBr(builder->CreateICmpSLT(nextEvent, readyCount, "moreevents"), ready, done);
+
+		builder->SetInsertPoint(stuck);
+		llvm::FunctionCallee printfunc = GlobalVarsAndFunctions->getOrInsertFunction("printf", llvm::FunctionType::get(builder->getInt32Ty(), builder->getInt8PtrTy(), true));
+		builder->CreateCall(printfunc, {builder->CreateGlobalStringPtr("Deadlock: await is waiting on a task that has nothing left to wait for\n", "async.deadlockMsg")}, "printftemp");
+		builder->CreateCall(getAsyncLibcFunction("exit", builder->getVoidTy(), {builder->getInt32Ty()}), {builder->getInt32(1)});
+		builder->CreateUnreachable();
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return stepfunc;
+	}
+
+	/**
+	 * @brief Turns the function being generated into a coroutine. Called right after its arguments are stored: allocates the frame & sets up
+	 * the promise, and creates the blocks that returning (finalBlock), being destroyed (cleanupBlock) & suspending (suspendBlock) go to.
+	 * Everything after this is the coroutine's body; it starts running as soon as the function is called
+	 */
+	void beginAsyncFunction(llvm::StructType *promiseTy)
+	{
+		AsyncFunctionState state;
+		// CoroSplit only looks at functions marked as coroutines that haven't been split yet
+		currentFunction->addFnAttr("coroutine.presplit", "0");
+		state.promise = createEntryBlockAlloca(promiseTy, NULL, "promise");
+		state.promise->setAlignment(getAsyncPromiseAlign());
+		llvm::Value *promisePtr = builder->CreateBitCast(state.promise, builder->getInt8PtrTy(), "promiseptr");
+		llvm::Value *nullPtr = llvm::ConstantPointerNull::get(builder->getInt8PtrTy());
+		state.id = builder->CreateIntrinsic(llvm::Intrinsic::coro_id, {}, {builder->getInt32(0), promisePtr, nullPtr, nullPtr}, NULL, "coroid");
+		llvm::Value *size = builder->CreateIntrinsic(llvm::Intrinsic::coro_size, {builder->getInt64Ty()}, {}, NULL, "framesize");
+		llvm::Value *frame = builder->CreateCall(getSizedAllocFunction(), {size}, "frame");
+		state.handle = builder->CreateIntrinsic(llvm::Intrinsic::coro_begin, {}, {state.id, frame}, NULL, "handle");
+		builder->CreateStore(nullPtr, builder->CreateStructGEP(promiseTy, state.promise, 0, "waiterptr"));
+		builder->CreateStore(builder->getInt1(false), builder->CreateStructGEP(promiseTy, state.promise, 1, "doneptr"));
+		state.finalBlock = llvm::BasicBlock::Create(*ctxt, "coro.final");
+		state.cleanupBlock = llvm::BasicBlock::Create(*ctxt, "coro.cleanup");
+		state.suspendBlock = llvm::BasicBlock::Create(*ctxt, "coro.suspend");
+		asyncFunctions[currentFunction] = state;
+	}
+	/**
+	 * @brief `return` inside a coroutine: saves the result in the promise and jumps to the final suspension point
+	 *
+	 * @param result - what to return, or NULL for `async void`
+	 */
+	llvm::Value *createAsyncReturn(llvm::Value *result)
+	{
+		AsyncFunctionState &state = asyncFunctions[currentFunction];
+		llvm::StructType *promiseTy = (llvm::StructType *)state.promise->getAllocatedType();
+		if (result != NULL && promiseTy->getNumElements() > 2)
+		{
+			if (result->getType() != promiseTy->getElementType(2))
+			{
+				logError("Returning a(n) " + AliasMgr.getTypeName(result->getType()) + " from an async function that returns " + AliasMgr.getTypeName(promiseTy->getElementType(2)));
+				return NULL;
+			}
+			builder->CreateStore(result, builder->CreateStructGEP(promiseTy, state.promise, 2, "resultptr"));
+		}
+		return builder->CreateBr(state.finalBlock);
+	}
+	/**
+	 * @brief Suspends the coroutine being generated, and continues generating code where it's resumed
+	 */
+	void createAsyncSuspend()
+	{
+		AsyncFunctionState &state = asyncFunctions[currentFunction];
+		llvm::Value *suspended = builder->CreateIntrinsic(llvm::Intrinsic::coro_suspend, {}, {llvm::ConstantTokenNone::get(*ctxt), builder->getInt1(false)}, NULL, "suspended");
+		llvm::BasicBlock *resumed = llvm::BasicBlock::Create(*ctxt, "resumed", currentFunction);
+		llvm::SwitchInst *afterSuspend = builder->CreateSwitch(suspended, state.suspendBlock, 2);
+		afterSuspend->addCase(builder->getInt8(0), resumed);
+		afterSuspend->addCase(builder->getInt8(1), state.cleanupBlock);
+		builder->SetInsertPoint(resumed);
+	}
+	/**
+	 * @brief Finishes the coroutine being generated: marks the promise as done & schedules whoever's waiting on it at the final suspension point,
+	 * frees the frame when the coroutine is destroyed, and returns the task from the first suspension point the coroutine reaches
+	 */
+	void finishAsyncFunction()
+	{
+		AsyncFunctionState &state = asyncFunctions[currentFunction];
+		llvm::StructType *promiseTy = (llvm::StructType *)state.promise->getAllocatedType();
+		llvm::BasicBlock *wakeWaiter = llvm::BasicBlock::Create(*ctxt, "coro.wakewaiter", currentFunction),
+						 *finalSuspend = llvm::BasicBlock::Create(*ctxt, "coro.finalsuspend", currentFunction),
+						 *resumedFinal = llvm::BasicBlock::Create(*ctxt, "coro.resumedfinal", currentFunction);
+		state.finalBlock->insertInto(currentFunction, wakeWaiter);
+		builder->SetInsertPoint(state.finalBlock);
+		builder->CreateStore(builder->getInt1(true), builder->CreateStructGEP(promiseTy, state.promise, 1, "doneptr"));
+		llvm::Value *waiter = builder->CreateLoad(builder->getInt8PtrTy(), builder->CreateStructGEP(promiseTy, state.promise, 0, "waiterptr"), "waiter");
+		builder->CreateCondBr(builder->CreateIsNull(waiter, "nowaiter"), finalSuspend, wakeWaiter);
+		builder->SetInsertPoint(wakeWaiter);
+		builder->CreateCall(getAsyncScheduleFunction(), {waiter});
+		builder->CreateBr(finalSuspend);
+		builder->SetInsertPoint(finalSuspend);
+		llvm::Value *suspended = builder->CreateIntrinsic(llvm::Intrinsic::coro_suspend, {}, {llvm::ConstantTokenNone::get(*ctxt), builder->getInt1(true)}, NULL, "finalsuspended");
+		llvm::SwitchInst *afterSuspend = builder->CreateSwitch(suspended, state.suspendBlock, 2);
+		afterSuspend->addCase(builder->getInt8(0), resumedFinal);
+		afterSuspend->addCase(builder->getInt8(1), state.cleanupBlock);
+		// Nothing resumes a coroutine that's already finished
+		builder->SetInsertPoint(resumedFinal);
+		builder->CreateUnreachable();
+
+		state.cleanupBlock->insertInto(currentFunction);
+		builder->SetInsertPoint(state.cleanupBlock);
+		llvm::Value *frame = builder->CreateIntrinsic(llvm::Intrinsic::coro_free, {}, {state.id, state.handle}, NULL, "frame");
+		builder->CreateCall(getHeapFreeFunction(), {frame});
+		builder->CreateBr(state.suspendBlock);
+		state.suspendBlock->insertInto(currentFunction);
+		builder->SetInsertPoint(state.suspendBlock);
+		builder->CreateIntrinsic(llvm::Intrinsic::coro_end, {}, {state.handle, builder->getInt1(false)}, NULL, "ended");
+		builder->CreateRet(state.promise);
+	}
+
+	/**
+	 * @brief Something to hand to async.watch()/a promise that wakes up the code being generated: the coroutine's handle,
+	 * or outside of a coroutine, a new flag (returned through `flag`) with the lowest bit of its address set
+	 */
+	llvm::Value *createAsyncWaiter(llvm::Value *&flag)
+	{
+		if (asyncFunctions.count(currentFunction))
+		{
+			flag = NULL;
+			return asyncFunctions[currentFunction].handle;
+		}
+		flag = createEntryBlockAlloca(builder->getInt1Ty(), NULL, "awaitflag");
+		((llvm::AllocaInst *)flag)->setAlignment(llvm::Align(2));
+		builder->CreateStore(builder->getInt1(false), flag);
+		llvm::Value *flagBits = builder->CreateOr(builder->CreatePtrToInt(flag, builder->getInt64Ty(), "flagbits"), builder->getInt64(1), "taggedflag");
+		return builder->CreateIntToPtr(flagBits, builder->getInt8PtrTy(), "waiter");
+	}
+	/**
+	 * @brief Waits until `isDone` (which is generated at the top of every check) is true: by suspending the coroutine being generated,
+	 * or outside of a coroutine, by running the event loop until it is
+	 */
+	void createAsyncWait(std::function<llvm::Value *()> isDone)
+	{
+		if (asyncFunctions.count(currentFunction))
+		{
+			createAsyncSuspend();
+			return;
+		}
+		llvm::BasicBlock *check = llvm::BasicBlock::Create(*ctxt, "awaitcheck", currentFunction),
+						 *step = llvm::BasicBlock::Create(*ctxt, "awaitstep", currentFunction),
+						 *finished = llvm::BasicBlock::Create(*ctxt, "awaitdone", currentFunction);
+		builder->CreateBr(check);
+		builder->SetInsertPoint(check);
+		builder->CreateCondBr(isDone(), finished, step);
+		builder->SetInsertPoint(step);
+		builder->CreateCall(getAsyncStepFunction());
+		builder->CreateBr(check);
+		builder->SetInsertPoint(finished);
+	}
+
+	/**
+	 * @brief `await task`: waits for the task to finish (if it hasn't already), then takes its result and frees it.
+	 *
+	 * @return llvm::Value* - the result, or for `async void`, the call freeing the task
+	 */
+	llvm::Value *createAwaitTask(llvm::Value *task, llvm::StructType *promiseTy)
+	{
+		llvm::Value *doneptr = builder->CreateStructGEP(promiseTy, task, 1, "doneptr");
+		llvm::BasicBlock *wait = llvm::BasicBlock::Create(*ctxt, "awaitwait", currentFunction),
+						 *ready = llvm::BasicBlock::Create(*ctxt, "awaitready", currentFunction);
+		builder->CreateCondBr(builder->CreateLoad(builder->getInt1Ty(), doneptr, "done"), ready, wait);
+		builder->SetInsertPoint(wait);
+		llvm::Value *flag;
+		builder->CreateStore(createAsyncWaiter(flag), builder->CreateStructGEP(promiseTy, task, 0, "waiterptr"));
+		createAsyncWait([&]()
+						{ return builder->CreateLoad(builder->getInt1Ty(), doneptr, "done"); });
+		builder->CreateBr(ready);
+		builder->SetInsertPoint(ready);
+		llvm::Value *result = NULL;
+		if (promiseTy->getNumElements() > 2)
+			result = builder->CreateLoad(promiseTy->getElementType(2), builder->CreateStructGEP(promiseTy, task, 2, "resultptr"), "result");
+		llvm::Value *handle = builder->CreateIntrinsic(llvm::Intrinsic::coro_promise, {}, {builder->CreateBitCast(task, builder->getInt8PtrTy(), "promiseptr"), builder->getInt32(getAsyncPromiseAlign().value()), builder->getInt1(true)}, NULL, "taskhandle");
+		llvm::Value *destroyed = builder->CreateIntrinsic(llvm::Intrinsic::coro_destroy, {}, {handle});
+		return result == NULL ? destroyed : result;
+	}
+	/**
+	 * @brief `await readable(fd)`/`await writable(fd)`: waits for a file descriptor to be ready
+	 *
+	 * @return llvm::Value* - the file descriptor
+	 */
+	llvm::Value *createAwaitFd(llvm::Value *fd, int events)
+	{
+		llvm::Value *flag;
+		llvm::Value *waiter = createAsyncWaiter(flag);
+		builder->CreateCall(getAsyncWatchFunction(), {fd, builder->getInt32(events), waiter});
+		createAsyncWait([&]()
+						{ return builder->CreateLoad(builder->getInt1Ty(), flag, "ready"); });
+		createAsyncUnwatch(fd);
+		return fd;
+	}
+	/**
+	 * @brief `await sleep(ms)`: waits on a one-shot timerfd
+	 */
+	llvm::Value *createAwaitSleep(llvm::Value *ms)
+	{
+		llvm::Type *specTy = llvm::ArrayType::get(builder->getInt64Ty(), 4);
+		llvm::Value *spec = createEntryBlockAlloca(specTy, NULL, "timerspec");
+		llvm::Value *timer = builder->CreateCall(getAsyncLibcFunction("timerfd_create", builder->getInt32Ty(), {builder->getInt32Ty(), builder->getInt32Ty()}), {builder->getInt32(asyncClockMonotonic), builder->getInt32(asyncCloseOnExec)}, "timer");
+		llvm::Value *seconds = builder->CreateSDiv(ms, builder->getInt64(1000), "seconds");
+		llvm::Value *nanoseconds = builder->CreateMul(builder->CreateSRem(ms, builder->getInt64(1000)), builder->getInt64(1000000), "nanoseconds");
+		// A zero timer is a disarmed timer, so sleeping for 0ms (or less) waits a nanosecond instead
+		llvm::Value *nonpositive = builder->CreateICmpSLE(ms, builder->getInt64(0), "nonpositive");
+		seconds = builder->CreateSelect(nonpositive, builder->getInt64(0), seconds, "timerseconds");
+		nanoseconds = builder->CreateSelect(nonpositive, builder->getInt64(1), nanoseconds, "timernanoseconds");
+		builder->CreateStore(builder->getInt64(0), builder->CreateConstInBoundsGEP2_32(specTy, spec, 0, 0, "intervalsec"));
+		builder->CreateStore(builder->getInt64(0), builder->CreateConstInBoundsGEP2_32(specTy, spec, 0, 1, "intervalnsec"));
+		builder->CreateStore(seconds, builder->CreateConstInBoundsGEP2_32(specTy, spec, 0, 2, "valuesec"));
+		builder->CreateStore(nanoseconds, builder->CreateConstInBoundsGEP2_32(specTy, spec, 0, 3, "valuensec"));
+		builder->CreateCall(getAsyncLibcFunction("timerfd_settime", builder->getInt32Ty(), {builder->getInt32Ty(), builder->getInt32Ty(), specTy->getPointerTo(), specTy->getPointerTo()}),
+							{timer, builder->getInt32(0), spec, llvm::ConstantPointerNull::get(specTy->getPointerTo())}, "armed");
+		createAwaitFd(timer, asyncEpollIn);
+		return builder->CreateCall(getAsyncLibcFunction("close", builder->getInt32Ty(), {builder->getInt32Ty()}), {timer}, "closed");
+	}
+
+	/**
+	 * @brief Splits each coroutine into its ramp, resume & destroy functions (LLVM's CoroEarly, CoroSplit & CoroCleanup passes),
+	 * since lli & llc expect that to have already happened. Does nothing if there aren't any coroutines.
+	 * The coroutine frame's layout depends on the target, so the module gets the host's data layout first
+	 */
+	void lowerCoroutines(llvm::Module &module)
+	{
+		if (asyncFunctions.empty())
+			return;
+		spdlog::debug("Lowering {} coroutines", asyncFunctions.size());
+		// Code after a return/break is left in the same block as it, which the IR parser reads as an unreachable block of its own; do the same here
+		for (llvm::Function &func : module)
+			for (llvm::BasicBlock &block : func)
+			{
+				llvm::Instruction *terminator = NULL;
+				for (llvm::Instruction &inst : block)
+					if (inst.isTerminator())
+					{
+						terminator = &inst;
+						break;
+					}
+				if (terminator == NULL || terminator == &block.back())
+					continue;
+				llvm::BasicBlock *rest = llvm::BasicBlock::Create(*ctxt, "unreachable", &func, block.getNextNode());
+				rest->getInstList().splice(rest->end(), block.getInstList(), std::next(terminator->getIterator()), block.end());
+			}
+		llvm::InitializeNativeTarget();
+		std::string error, triple = llvm::sys::getProcessTriple();
+		const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+		if (target != NULL)
+		{
+			std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(triple, "generic", "", llvm::TargetOptions(), llvm::None));
+			module.setDataLayout(machine->createDataLayout());
+			module.setTargetTriple(triple);
+		}
+		else
+			spdlog::warn("Couldn't find the host target ({}); coroutine frames are laid out with the default data layout", error);
+
+		llvm::LoopAnalysisManager loops;
+		llvm::FunctionAnalysisManager functions;
+		llvm::CGSCCAnalysisManager cgsccs;
+		llvm::ModuleAnalysisManager modules;
+		llvm::PassBuilder passes;
+		passes.registerModuleAnalyses(modules);
+		passes.registerCGSCCAnalyses(cgsccs);
+		passes.registerFunctionAnalyses(functions);
+		passes.registerLoopAnalyses(loops);
+		passes.crossRegisterProxies(loops, functions, cgsccs, modules);
+		llvm::ModulePassManager pipeline;
+		pipeline.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::CoroEarlyPass()));
+		pipeline.addPass(llvm::createModuleToPostOrderCGSCCPassAdaptor(llvm::CoroSplitPass()));
+		pipeline.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::CoroCleanupPass()));
+		pipeline.run(module, modules);
+	}
+}
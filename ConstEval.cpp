@@ -0,0 +1,430 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <set>
+#include <spdlog/spdlog.h>
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "globals.cpp"
+namespace jimpilier
+{
+	/*
+	 * Compile time evaluation. Code that has to be run at compile time is generated like any other code, then interpreted
+	 * instruction by instruction, with every value (and every byte of memory) kept as an llvm::Constant so the results can be
+	 * put straight into the module:
+	 * - Global variables are initialized by a throwaway function that works out the value & stores it in the global,
+	 *   so their initial value can be any expression that doesn't need the outside world (calling C, allocating on the heap...)
+	 * - Calls to `const` functions whose arguments are all constants are replaced by what the function returns
+	 * Anything the interpreter can't run (or that runs for too long) is left alone, or for globals is an error,
+	 * so this never changes what a program does.
+	 */
+
+	/**
+	 * @brief The `const` functions that have been fully generated, and so can be run at compile time
+	 */
+	std::set<llvm::Function *> constFunctions;
+	/**
+	 * @brief How many instructions / nested calls one compile time evaluation can take before we give up & leave it to runtime
+	 */
+	const long constEvalStepLimit = 4000000;
+	const int constEvalDepthLimit = 512;
+
+	/**
+	 * @brief Whether `val` is a global variable declared `const`, whose value is fixed at compile time
+	 */
+	bool isConstGlobal(llvm::Value *val)
+	{
+		llvm::GlobalVariable *global = llvm::dyn_cast_or_null<llvm::GlobalVariable>(val);
+		return global != NULL && global->isConstant() && global->hasDefinitiveInitializer();
+	}
+
+	/**
+	 * @brief Runs generated functions at compile time. Locals live in stand-in global variables that never make it into the module,
+	 * and memory is read & written by taking apart / rebuilding the constant each one holds
+	 */
+	class ConstInterpreter
+	{
+		const llvm::DataLayout &layout;
+		llvm::GlobalVariable *writable;
+		std::map<llvm::GlobalVariable *, llvm::Constant *> memory;
+		std::vector<std::unique_ptr<llvm::GlobalVariable>> locals;
+		std::set<llvm::Constant *> localSet;
+		long steps = 0;
+		int depth = 0;
+
+		/**
+		 * @brief Finds which variable `ptr` points into, and how many bytes in; NULL if it isn't something we can read or write
+		 */
+		llvm::GlobalVariable *resolve(llvm::Constant *ptr, uint64_t &offset)
+		{
+			llvm::GlobalValue *base = NULL;
+			llvm::APInt bytes;
+			if (!llvm::IsConstantOffsetFromGlobal(ptr, base, bytes, layout) || !llvm::isa<llvm::GlobalVariable>(base) || bytes.isNegative())
+				return NULL;
+			offset = bytes.getZExtValue();
+			return (llvm::GlobalVariable *)base;
+		}
+		llvm::Constant *read(llvm::GlobalVariable *var)
+		{
+			auto found = memory.find(var);
+			if (found != memory.end())
+				return found->second;
+			return var->hasDefinitiveInitializer() ? var->getInitializer() : NULL;
+		}
+		/**
+		 * @brief `agg` with the value `offset` bytes in replaced by `val`, or NULL if `val` doesn't line up with one of its elements
+		 */
+		llvm::Constant *replaceAt(llvm::Constant *agg, uint64_t offset, llvm::Constant *val)
+		{
+			llvm::Type *ty = agg->getType();
+			if (offset == 0 && ty == val->getType())
+				return val;
+			std::vector<llvm::Constant *> elements;
+			uint64_t index, inner;
+			if (llvm::StructType *sty = llvm::dyn_cast<llvm::StructType>(ty))
+			{
+				const llvm::StructLayout *fields = layout.getStructLayout(sty);
+				if (offset >= fields->getSizeInBytes())
+					return NULL;
+				index = fields->getElementContainingOffset(offset);
+				inner = offset - fields->getElementOffset(index);
+			}
+			else if (ty->isArrayTy() || llvm::isa<llvm::FixedVectorType>(ty))
+			{
+				llvm::Type *elemTy = ty->isArrayTy() ? ty->getArrayElementType() : ((llvm::FixedVectorType *)ty)->getElementType();
+				uint64_t size = layout.getTypeAllocSize(elemTy).getFixedSize(), count = ty->isArrayTy() ? ty->getArrayNumElements() : ((llvm::FixedVectorType *)ty)->getNumElements();
+				if (size == 0 || offset / size >= count)
+					return NULL;
+				index = offset / size;
+				inner = offset % size;
+			}
+			else
+				return NULL;
+			for (unsigned i = 0; llvm::Constant *element = agg->getAggregateElement(i); i++)
+				elements.push_back(element);
+			if (index >= elements.size() || (elements[index] = replaceAt(elements[index], inner, val)) == NULL)
+				return NULL;
+			if (llvm::StructType *sty = llvm::dyn_cast<llvm::StructType>(ty))
+				return llvm::ConstantStruct::get(sty, elements);
+			if (llvm::ArrayType *aty = llvm::dyn_cast<llvm::ArrayType>(ty))
+				return llvm::ConstantArray::get(aty, elements);
+			return llvm::ConstantVector::get(elements);
+		}
+		/**
+		 * @brief Whether `val` points at one of the interpreter's locals, which stop existing once it's done
+		 */
+		bool refersToLocal(llvm::Constant *val)
+		{
+			if (llvm::isa<llvm::GlobalValue>(val))
+				return localSet.count(val);
+			for (llvm::Value *operand : val->operands())
+				if (refersToLocal((llvm::Constant *)operand))
+					return true;
+			return false;
+		}
+		bool execute(llvm::Function *func, llvm::ArrayRef<llvm::Constant *> args, llvm::Constant *&result)
+		{
+			std::map<llvm::Value *, llvm::Constant *> values;
+			for (llvm::Argument &arg : func->args())
+				values[&arg] = args[arg.getArgNo()];
+			auto get = [&](llvm::Value *val) -> llvm::Constant *
+			{
+				// Generated code zeroes numbers with zeroinitializer too, which constant folding doesn't expect outside of aggregates
+				if (llvm::isa<llvm::ConstantAggregateZero>(val) && !val->getType()->isAggregateType() && !val->getType()->isVectorTy())
+					return llvm::Constant::getNullValue(val->getType());
+				if (llvm::Constant *c = llvm::dyn_cast<llvm::Constant>(val))
+					return c;
+				auto found = values.find(val);
+				return found == values.end() ? NULL : found->second;
+			};
+			llvm::BasicBlock *block = &func->getEntryBlock(), *prev = NULL;
+			while (block != NULL)
+			{
+				llvm::BasicBlock *next = NULL;
+				for (llvm::Instruction &inst : *block)
+				{
+					if (++steps > constEvalStepLimit)
+						return false;
+					llvm::Constant *val = NULL;
+					if (llvm::PHINode *phi = llvm::dyn_cast<llvm::PHINode>(&inst))
+						val = prev == NULL || phi->getBasicBlockIndex(prev) < 0 ? NULL : get(phi->getIncomingValueForBlock(prev));
+					else if (llvm::AllocaInst *alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+					{
+						llvm::ConstantInt *count = llvm::dyn_cast_or_null<llvm::ConstantInt>(get(alloca->getArraySize()));
+						if (count == NULL)
+							return false;
+						llvm::Type *ty = alloca->isArrayAllocation() ? (llvm::Type *)llvm::ArrayType::get(alloca->getAllocatedType(), count->getZExtValue()) : alloca->getAllocatedType();
+						locals.push_back(std::make_unique<llvm::GlobalVariable>(ty, false, llvm::GlobalValue::InternalLinkage, llvm::UndefValue::get(ty), alloca->getName()));
+						localSet.insert(locals.back().get());
+						memory[locals.back().get()] = locals.back()->getInitializer();
+						val = llvm::ConstantExpr::getPointerBitCastOrAddrSpaceCast(locals.back().get(), alloca->getType());
+					}
+					else if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+					{
+						uint64_t offset;
+						llvm::Constant *ptr = get(load->getPointerOperand());
+						llvm::GlobalVariable *var = ptr == NULL ? NULL : resolve(ptr, offset);
+						llvm::Constant *contents = var == NULL || load->isVolatile() ? NULL : read(var);
+						val = contents == NULL ? NULL : llvm::ConstantFoldLoadFromConst(contents, load->getType(), llvm::APInt(64, offset), layout);
+					}
+					else if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+					{
+						uint64_t offset;
+						llvm::Constant *ptr = get(store->getPointerOperand()), *stored = get(store->getValueOperand());
+						llvm::GlobalVariable *var = ptr == NULL || stored == NULL ? NULL : resolve(ptr, offset);
+						if (var == NULL || store->isVolatile() || (!localSet.count(var) && var != writable) || read(var) == NULL)
+							return false;
+						llvm::Constant *updated = replaceAt(read(var), offset, stored);
+						if (updated == NULL)
+							return false;
+						memory[var] = updated;
+						continue;
+					}
+					else if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst))
+					{
+						llvm::Function *callee = call->getCalledFunction();
+						if (callee == NULL)
+							return false;
+						if (callee->isIntrinsic() && (callee->getIntrinsicID() == llvm::Intrinsic::lifetime_start || callee->getIntrinsicID() == llvm::Intrinsic::lifetime_end || llvm::isa<llvm::DbgInfoIntrinsic>(call)))
+							continue;
+						std::vector<llvm::Constant *> callArgs;
+						for (llvm::Value *arg : call->args())
+						{
+							callArgs.push_back(get(arg));
+							if (callArgs.back() == NULL)
+								return false;
+						}
+						if (callee->isDeclaration())
+							val = llvm::canConstantFoldCallTo(call, callee) ? llvm::ConstantFoldCall(call, callee, callArgs) : NULL;
+						else if (!run(callee, callArgs, val))
+							return false;
+						if (call->getType()->isVoidTy())
+							continue;
+					}
+					else if (llvm::ReturnInst *ret = llvm::dyn_cast<llvm::ReturnInst>(&inst))
+					{
+						result = ret->getReturnValue() == NULL ? NULL : get(ret->getReturnValue());
+						return ret->getReturnValue() == NULL || result != NULL;
+					}
+					else if (llvm::BranchInst *br = llvm::dyn_cast<llvm::BranchInst>(&inst))
+					{
+						llvm::ConstantInt *cond = br->isConditional() ? llvm::dyn_cast_or_null<llvm::ConstantInt>(get(br->getCondition())) : NULL;
+						if (br->isConditional() && cond == NULL)
+							return false;
+						next = br->getSuccessor(br->isConditional() && cond->isZero() ? 1 : 0);
+						break;
+					}
+					else if (llvm::SwitchInst *sw = llvm::dyn_cast<llvm::SwitchInst>(&inst))
+					{
+						llvm::ConstantInt *cond = llvm::dyn_cast_or_null<llvm::ConstantInt>(get(sw->getCondition()));
+						if (cond == NULL)
+							return false;
+						next = sw->findCaseValue(cond)->getCaseSuccessor();
+						break;
+					}
+					else if (inst.isTerminator() || inst.mayHaveSideEffects())
+						return false;
+					else
+					{
+						std::vector<llvm::Constant *> operands;
+						for (llvm::Value *operand : inst.operands())
+						{
+							operands.push_back(get(operand));
+							if (operands.back() == NULL)
+								return false;
+						}
+						if (llvm::CmpInst *cmp = llvm::dyn_cast<llvm::CmpInst>(&inst))
+							val = llvm::ConstantFoldCompareInstOperands(cmp->getPredicate(), operands[0], operands[1], layout);
+						else if (llvm::ExtractValueInst *extract = llvm::dyn_cast<llvm::ExtractValueInst>(&inst))
+							val = llvm::ConstantFoldExtractValueInstruction(operands[0], extract->getIndices());
+						else if (llvm::InsertValueInst *insert = llvm::dyn_cast<llvm::InsertValueInst>(&inst))
+							val = llvm::ConstantFoldInsertValueInstruction(operands[0], operands[1], insert->getIndices());
+						else
+							val = llvm::ConstantFoldInstOperands(&inst, operands, layout);
+					}
+					// Division by zero & the like fold to poison: that's a runtime error, so leave it for runtime
+					if (val == NULL || llvm::isa<llvm::PoisonValue>(val))
+						return false;
+					values[&inst] = val;
+				}
+				prev = block;
+				block = next;
+			}
+			return false;
+		}
+
+	public:
+		/**
+		 * @param writable - the one global variable the code being run may change
+		 */
+		ConstInterpreter(const llvm::DataLayout &layout, llvm::GlobalVariable *writable = NULL) : layout(layout), writable(writable) {}
+		~ConstInterpreter()
+		{
+			for (auto &local : locals)
+				if (!local->use_empty())
+					local->replaceAllUsesWith(llvm::Constant::getNullValue(local->getType()));
+		}
+		/**
+		 * @brief Runs `func` with `args`, putting what it returns in `result` (NULL for void functions)
+		 *
+		 * @return false if the function can't be run at compile time
+		 */
+		bool run(llvm::Function *func, llvm::ArrayRef<llvm::Constant *> args, llvm::Constant *&result)
+		{
+			if (func->isDeclaration() || func->isVarArg() || args.size() != func->arg_size() || depth >= constEvalDepthLimit)
+				return false;
+			depth++;
+			bool ran = execute(func, args, result);
+			depth--;
+			// Pointers to locals can be passed around while running, just not kept afterwards
+			return ran && (depth > 0 || result == NULL || !refersToLocal(result));
+		}
+		/**
+		 * @brief What `var` holds after running, or NULL if it ended up pointing at a local
+		 */
+		llvm::Constant *valueOf(llvm::GlobalVariable *var)
+		{
+			llvm::Constant *val = read(var);
+			return val == NULL || refersToLocal(val) ? NULL : val;
+		}
+	};
+
+	/**
+	 * @brief The first non-constant global variable `func` (or anything it calls) reads or writes, or NULL if there isn't one.
+	 * A const function's result has to depend only on its arguments, since it's worked out before the program runs
+	 */
+	llvm::GlobalVariable *findMutableGlobalUse(llvm::Function *func, std::set<llvm::Function *> &visited)
+	{
+		if (!visited.insert(func).second || func->isDeclaration())
+			return NULL;
+		for (llvm::BasicBlock &block : *func)
+			for (llvm::Instruction &inst : block)
+			{
+				for (llvm::Value *operand : inst.operands())
+				{
+					llvm::GlobalVariable *global = llvm::dyn_cast<llvm::GlobalVariable>(operand->stripPointerCasts());
+					if (llvm::GEPOperator *gep = llvm::dyn_cast<llvm::GEPOperator>(operand))
+						global = llvm::dyn_cast<llvm::GlobalVariable>(gep->getPointerOperand()->stripPointerCasts());
+					if (global != NULL && !global->isConstant())
+						return global;
+				}
+				if (llvm::CallBase *call = llvm::dyn_cast<llvm::CallBase>(&inst))
+					if (llvm::Function *callee = call->getCalledFunction())
+						if (llvm::GlobalVariable *global = findMutableGlobalUse(callee, visited))
+							return global;
+			}
+		return NULL;
+	}
+	/**
+	 * @brief Called once a `const` function's body has been generated: checks it can be run at compile time, and lets calls to it be folded
+	 */
+	void registerConstFunction(llvm::Function *func, bool throws)
+	{
+		if (throws)
+		{
+			logError("const functions can't throw: " + func->getName().str());
+			return;
+		}
+		std::set<llvm::Function *> visited;
+		if (llvm::GlobalVariable *global = findMutableGlobalUse(func, visited))
+		{
+			logError("const functions can only use their arguments & other constants, but " + func->getName().str() + " uses the global variable " + global->getName().str());
+			return;
+		}
+		constFunctions.insert(func);
+	}
+
+	/**
+	 * @brief If `call` calls a const function with nothing but constants, run it now and return what it returns instead of calling it at runtime.
+	 * Otherwise (or if the function does something that can't be done at compile time, like printing), `call` is returned as is
+	 */
+	llvm::Value *foldConstCall(llvm::Value *call)
+	{
+		llvm::CallInst *inst = llvm::dyn_cast_or_null<llvm::CallInst>(call);
+		if (inst == NULL || inst->getType()->isVoidTy() || inst->getCalledFunction() == NULL || !constFunctions.count(inst->getCalledFunction()))
+			return call;
+		std::vector<llvm::Constant *> args;
+		for (llvm::Value *arg : inst->args())
+		{
+			// Reading a const global is as good as using its value
+			if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(arg))
+				if (isConstGlobal(load->getPointerOperand()) && load->getType() == ((llvm::GlobalVariable *)load->getPointerOperand())->getValueType())
+					arg = ((llvm::GlobalVariable *)load->getPointerOperand())->getInitializer();
+			if (!llvm::isa<llvm::Constant>(arg))
+				return call;
+			args.push_back((llvm::Constant *)arg);
+		}
+		ConstInterpreter interpreter(*DataLayout);
+		llvm::Constant *result = NULL;
+		if (!interpreter.run(inst->getCalledFunction(), args, result))
+		{
+			spdlog::debug("Couldn't run {}() at compile time; calling it at runtime instead", inst->getCalledFunction()->getName().str());
+			return call;
+		}
+		spdlog::debug("Ran {}() at compile time", inst->getCalledFunction()->getName().str());
+		inst->replaceAllUsesWith(result);
+		inst->eraseFromParent();
+		return result;
+	}
+
+	/**
+	 * @brief The throwaway function a global variable's initial value is worked out in
+	 */
+	struct GlobalInitializer
+	{
+		llvm::Function *func, *prevFunction;
+		llvm::BasicBlock *prevBlock;
+		FunctionScopeState outerScopes;
+	};
+	/**
+	 * @brief Starts generating code that works out a global variable's initial value at compile time.
+	 * Until finishGlobalInitializer() is called, code is generated into a throwaway function instead of wherever it was going before
+	 */
+	GlobalInitializer beginGlobalInitializer()
+	{
+		GlobalInitializer init = {NULL, currentFunction, builder->GetInsertBlock(), enterFunctionScope()};
+		init.func = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), false), llvm::Function::InternalLinkage, "global.init", GlobalVarsAndFunctions.get());
+		currentFunction = init.func;
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", init.func));
+		return init;
+	}
+	/**
+	 * @brief Stores `value` (generated since beginGlobalInitializer()) in `global`, runs all of that at compile time, and deletes it again.
+	 * `value` is NULL when the code already put the value in `global` itself, like constructors do
+	 *
+	 * @return llvm::Constant* - the global's initial value, or NULL if it couldn't be worked out at compile time
+	 */
+	llvm::Constant *finishGlobalInitializer(GlobalInitializer &init, llvm::GlobalVariable *global, llvm::Value *value)
+	{
+		llvm::Constant *result = NULL;
+		exitFunctionScope(init.outerScopes);
+		std::set<llvm::Function *> visited;
+		if (llvm::isa_and_nonnull<llvm::Constant>(value))
+			result = (llvm::Constant *)value;
+		// Other globals only get their values once the static function runs, so at compile time they'd all still read as zero
+		else if (init.prevFunction != STATIC || STATIC == NULL || findMutableGlobalUse(init.func, visited) == NULL)
+		{
+			if (value != NULL)
+				builder->CreateStore(value, global);
+			builder->CreateRetVoid();
+			ConstInterpreter interpreter(*DataLayout, global);
+			llvm::Constant *unused = NULL;
+			if (interpreter.run(init.func, {}, unused))
+				result = interpreter.valueOf(global);
+		}
+		init.func->eraseFromParent();
+		currentFunction = init.prevFunction;
+		if (init.prevBlock != NULL)
+			builder->SetInsertPoint(init.prevBlock);
+		else
+			builder->ClearInsertionPoint();
+		return result;
+	}
+}
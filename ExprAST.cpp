@@ -8,10 +8,12 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/FileCheck/FileCheck.h"
 
@@ -42,7 +44,7 @@ namespace jimpilier
 	llvm::Value *VariableExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("getting variable: {0}; other val: {1:x}", Name, (long)other); 
-		llvm::Value *V = AliasMgr[Name].val;
+		llvm::Value *V = shareStaticLocal(AliasMgr[Name]);
 		if (V && AliasMgr[Name].isRef && currentFunction != NULL)
 		{
 			V = builder->CreateLoad(V->getType()->getNonOpaquePointerElementType(), V, "loadtmp");
@@ -52,6 +54,8 @@ namespace jimpilier
 			spdlog::error("Unknown Variable name: {}", Name);
 			return nullptr;
 		}
+		if (autoDeref && currentFunction != NULL && atomicSlots.count(V))
+			return createAtomicLoad(V);
 		if (autoDeref && currentFunction != NULL)
 			return builder->CreateLoad(V->getType()->getNonOpaquePointerElementType(), V, "loadtmp");
 		return V;
@@ -67,17 +71,30 @@ namespace jimpilier
 			spdlog::warn("Warning: The variable '{}' was already defined. Overwriting the previous value...", name);
 			spdlog::warn("If this was not intentional, please make use of semicolons to better denote the end of each statement");
 		}
-		if (currentFunction == NULL || currentFunction == STATIC)
+		// Top-level variables in -edu/-rp mode start out as locals of the static function, unless they're const
+		if (currentFunction == NULL || (currentFunction == STATIC && constant))
 		{
 			GlobalVarsAndFunctions->getOrInsertGlobal(name, ty);
 			AliasMgr[name] = {(llvm::Value *)GlobalVarsAndFunctions->getNamedGlobal(name), this->type->isReference()};
 			GlobalVarsAndFunctions->getNamedGlobal(name)->setInitializer(llvm::ConstantAggregateZero::get(ty));
+			GlobalVarsAndFunctions->getNamedGlobal(name)->setConstant(constant);
 		}
 		else
 		{
-			AliasMgr[name] = {(llvm::Value *)builder->CreateAlloca(ty, sizeval, name), this->type->isReference()};
+			llvm::AllocaInst *slot = createEntryBlockAlloca(ty, size == 1 ? NULL : sizeval, name);
+			AliasMgr[name] = {(llvm::Value *)slot, this->type->isReference()};
+			trackLocal(slot, size == 1 && !this->type->isReference() ? getObjectDestructor(ty) : NULL);
 		}
-		if (!lateinit && currentFunction != NULL)
+		if (atomic)
+		{
+			if (size != 1 || this->type->isReference() || !isAtomicType(ty))
+			{
+				logError("Only numbers, bools & pointers can be atomic: " + name);
+				return NULL;
+			}
+			atomicSlots.insert(AliasMgr[name].val);
+		}
+		if (!lateinit && currentFunction != NULL && !isConstGlobal(AliasMgr[name].val))
 			builder->CreateStore(llvm::ConstantAggregateZero::get(ty), AliasMgr[name].val);
 		return AliasMgr[name].val;
 	}
@@ -92,13 +109,11 @@ namespace jimpilier
 	// TODO: Add non-null dot operator using a question mark; "objptr?func()" == "if objptr ! (@objptr).func()"
 	// TODO: Add implicit type casting (maybe)
 	// TODO: Completely revamp data type system to be almost exclusively front-end
-	// TODO: Find a better way to differentiate between char* and string (use structs maybe?)
 	// TODO: Add Template objects (God help me)
 	// TODO: Add arrays (God help me)
 	// TODO: Add other modifier keywords (volatile, extern, etc...)
 	// TODO: Make "auto" keyword work like C/C++
 	// TODO: Add pointer arithmatic
-	// TODO: Make strings safer
 
 	llvm::Value *IncDecExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
@@ -111,6 +126,26 @@ namespace jimpilier
 			args.push_back(v);
 			return makeCallWithReferences(args, op);
 		}
+		if (isConstGlobal(v))
+		{
+			logError("Const global variables can't be changed: " + v->getName().str());
+			return NULL;
+		}
+		if (atomicSlots.count(v))
+		{
+			llvm::Type *ty = v->getType()->getNonOpaquePointerElementType();
+			if (!ty->isIntegerTy() || ty->isIntegerTy(1))
+			{
+				logError("Only atomic integers can be incremented or decremented");
+				return NULL;
+			}
+			llvm::Value *one = llvm::ConstantInt::get(ty, 1);
+			llvm::Value *oldval = builder->CreateAtomicRMW(decrement ? llvm::AtomicRMWInst::Sub : llvm::AtomicRMWInst::Add, v, one, getAtomicAlign(ty), llvm::AtomicOrdering::SequentiallyConsistent);
+			oldval->setName("incOrDecOldTemp");
+			if (!prefix)
+				return oldval;
+			return decrement ? builder->CreateSub(oldval, one, "incdectemp") : builder->CreateAdd(oldval, one, "incdectemp");
+		}
 		if (prefix)
 		{
 			llvm::Value *tmpval = builder->CreateLoad(v->getType()->getContainedType(0), v, "incOrDecDerefTemp");
@@ -175,10 +210,301 @@ namespace jimpilier
 		}
 	}
 
+	/**
+	 * @brief Converts a number (or every element of a vector) to another numeric type (or vector of them) the way `as` would:
+	 * integers are sign extended/truncated, and integers & floating point numbers convert into each other
+	 */
+	llvm::Value *convertElements(llvm::Value *val, llvm::Type *to)
+	{
+		llvm::Type *from = val->getType();
+		if (from == to)
+			return val;
+		if (from->isIntOrIntVectorTy() && to->isIntOrIntVectorTy())
+			return builder->CreateSExtOrTrunc(val, to, "convtmp");
+		if (from->isIntOrIntVectorTy() && to->isFPOrFPVectorTy())
+			return builder->CreateSIToFP(val, to, "convtmp");
+		if (from->isFPOrFPVectorTy() && to->isIntOrIntVectorTy())
+			return builder->CreateFPToSI(val, to, "convtmp");
+		if (from->isFPOrFPVectorTy() && to->isFPOrFPVectorTy())
+			return builder->CreateFPCast(val, to, "convtmp");
+		logError("No known conversion when converting " + AliasMgr.getTypeName(from) + " to a(n) " + AliasMgr.getTypeName(to));
+		return NULL;
+	}
+
+	/**
+	 * @brief Gets two operands ready for an element-wise operation. A number next to a vector is converted to the vector's element type
+	 * and copied into every element; two vectors have to have the same type.
+	 *
+	 * @return true if either operand is a vector
+	 */
+	bool matchVectorOperands(llvm::Value *&lhs, llvm::Value *&rhs)
+	{
+		llvm::Type *lty = lhs->getType(), *rty = rhs->getType();
+		if (!lty->isVectorTy() && !rty->isVectorTy())
+			return false;
+		if (lty->isVectorTy() && rty->isVectorTy())
+		{
+			if (lty != rty)
+				logError("Vectors have to have the same type to be combined (cast one of them with 'as'): " + AliasMgr.getTypeName(lty) + " and " + AliasMgr.getTypeName(rty));
+			return true;
+		}
+		llvm::Value *&scalar = lty->isVectorTy() ? rhs : lhs;
+		llvm::FixedVectorType *vecTy = (llvm::FixedVectorType *)(lty->isVectorTy() ? lty : rty);
+		scalar = builder->CreateVectorSplat(vecTy->getNumElements(), convertElements(scalar, vecTy->getElementType()), "splattmp");
+		return true;
+	}
+
+	/**
+	 * @brief Reads (or gets a pointer to, if autoDeref is false) one element of a vector.
+	 * Constant indexes are checked while compiling; variable ones wrap around, so they can never read outside the vector
+	 */
+	llvm::Value *createVectorIndex(llvm::Value *vec, llvm::Value *index, bool autoDeref)
+	{
+		llvm::FixedVectorType *vecTy = (llvm::FixedVectorType *)vec->getType();
+		if (!index->getType()->isIntegerTy())
+		{
+			logError("Error when trying to index a vector: The index must be an integer. Cast it to an int if possible");
+			return NULL;
+		}
+		index = builder->CreateSExtOrTrunc(index, builder->getInt32Ty(), "indextmp");
+		if (llvm::ConstantInt *constIndex = llvm::dyn_cast<llvm::ConstantInt>(index))
+		{
+			if (constIndex->getSExtValue() < 0 || constIndex->getSExtValue() >= vecTy->getNumElements())
+				logError("Index " + std::to_string(constIndex->getSExtValue()) + " is out of bounds for a vector of " + std::to_string(vecTy->getNumElements()) + " elements");
+		}
+		else
+			index = builder->CreateAnd(index, builder->getInt32(vecTy->getNumElements() - 1), "wrappedindex");
+		if (autoDeref)
+			return builder->CreateExtractElement(vec, index, "elementtmp");
+		// Writing to an element needs the variable the vector was loaded from
+		llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(vec);
+		if (load == NULL)
+		{
+			logError("Only the elements of vector variables can be assigned to");
+			return NULL;
+		}
+		llvm::Value *slot = load->getPointerOperand();
+		if (load->use_empty())
+			load->eraseFromParent();
+		return builder->CreateInBoundsGEP(vecTy, slot, {builder->getInt32(0), index}, "elementptr");
+	}
+
+	/**
+	 * @brief Checks an index into a `T[]` or `T[soa]` against the array's size (unless compiling with --release), and returns it as an i64.
+	 * Checks on an index & array read straight from local variables are remembered, so the loop they're in can remove them if it proves them redundant
+	 *
+	 * @param sizeField - where the array keeps its size
+	 */
+	llvm::Value *createArrayBoundsCheck(llvm::Value *array, llvm::Value *index, unsigned sizeField)
+	{
+		llvm::Value *offset = builder->CreateSExtOrTrunc(index, builder->getInt64Ty(), "indextmp");
+		if (!releaseMode)
+		{
+			llvm::Value *size = builder->CreateExtractValue(array, {sizeField}, "arraysize");
+			llvm::BasicBlock *inBounds = llvm::BasicBlock::Create(*ctxt, "inbounds", currentFunction),
+							 *outOfBounds = llvm::BasicBlock::Create(*ctxt, "outofbounds", currentFunction);
+			// Unsigned, so negative indexes fail too
+			llvm::BranchInst *check = builder->CreateCondBr(builder->CreateICmpULT(offset, size, "boundscheck"), inBounds, outOfBounds, llvm::MDBuilder(*ctxt).createBranchWeights(2000, 1));
+			builder->SetInsertPoint(outOfBounds);
+			builder->CreateCall(getArrayIndexErrorFunction(), {offset, size});
+			builder->CreateUnreachable();
+			builder->SetInsertPoint(inBounds);
+			llvm::LoadInst *indexLoad = llvm::dyn_cast<llvm::LoadInst>(index), *arrayLoad = llvm::dyn_cast<llvm::LoadInst>(array);
+			if (indexLoad != NULL && arrayLoad != NULL && llvm::isa<llvm::AllocaInst>(indexLoad->getPointerOperand()) && llvm::isa<llvm::AllocaInst>(arrayLoad->getPointerOperand()))
+				pendingBoundsChecks.push_back({check, (llvm::AllocaInst *)indexLoad->getPointerOperand(), (llvm::AllocaInst *)arrayLoad->getPointerOperand()});
+		}
+		return offset;
+	}
+
+	/**
+	 * @brief Index into a `T[]` array or `T[...]` slice inline: offset its data pointer, after checking the index against its size
+	 */
+	llvm::Value *createArrayIndex(llvm::Value *array, llvm::Value *index, bool autoDeref)
+	{
+		if (!index->getType()->isIntegerTy())
+		{
+			logError("Error when trying to index an array: The index must be an integer. Cast it to an int if possible");
+			return NULL;
+		}
+		llvm::Type *elementTy = array->getType()->getStructElementType(0)->getNonOpaquePointerElementType();
+		llvm::Value *offset = createArrayBoundsCheck(array, index, 1);
+		llvm::Value *data = builder->CreateExtractValue(array, {0u}, "arraydata");
+		llvm::Value *elementPtr = builder->CreateInBoundsGEP(elementTy, data, offset, "elementptr");
+		if (autoDeref)
+			return builder->CreateLoad(elementTy, elementPtr, "loadtmp");
+		return elementPtr;
+	}
+
+	/**
+	 * @brief `base[begin ... end]`: a `T[...]` view of elements begin up to (but not including) end of a `T[]` array, slice or pointer,
+	 * which shares their storage. Arrays & slices check the bounds first (unless compiling with --release); pointers have none to check
+	 */
+	llvm::Value *createSlice(llvm::Value *base, llvm::Value *begin, llvm::Value *end)
+	{
+		if (!begin->getType()->isIntegerTy() || !end->getType()->isIntegerTy())
+		{
+			logError("Error when trying to slice an array: Both ends of the range must be integers. Cast them to ints if possible");
+			return NULL;
+		}
+		begin = builder->CreateSExtOrTrunc(begin, builder->getInt64Ty(), "slicebegin");
+		end = builder->CreateSExtOrTrunc(end, builder->getInt64Ty(), "sliceend");
+		llvm::Value *data = base;
+		if (isArrayType(base->getType()) || isSliceType(base->getType()))
+		{
+			data = builder->CreateExtractValue(base, {0u}, "arraydata");
+			if (!releaseMode)
+			{
+				llvm::Value *size = builder->CreateExtractValue(base, {1u}, "arraysize");
+				llvm::BasicBlock *inBounds = llvm::BasicBlock::Create(*ctxt, "inbounds", currentFunction),
+								 *outOfBounds = llvm::BasicBlock::Create(*ctxt, "outofbounds", currentFunction);
+				// Unsigned, so a negative beginning fails too
+				llvm::Value *fits = builder->CreateAnd(builder->CreateICmpULE(begin, end, "slicecheck"), builder->CreateICmpULE(end, size, "slicecheck"), "slicecheck");
+				builder->CreateCondBr(fits, inBounds, outOfBounds, llvm::MDBuilder(*ctxt).createBranchWeights(2000, 1));
+				builder->SetInsertPoint(outOfBounds);
+				builder->CreateCall(getSliceBoundsErrorFunction(), {begin, end, size});
+				builder->CreateUnreachable();
+				builder->SetInsertPoint(inBounds);
+			}
+		}
+		else if (!base->getType()->isPointerTy())
+		{
+			logError("Only arrays, slices & pointers can be sliced, not a(n) " + AliasMgr.getTypeName(base->getType(), true));
+			return NULL;
+		}
+		llvm::Type *elementTy = data->getType()->getNonOpaquePointerElementType();
+		llvm::Value *slice = builder->CreateInsertValue(llvm::UndefValue::get(getSliceType(elementTy)), builder->CreateInBoundsGEP(elementTy, data, begin, "slicedata"), {0u}, "slicetmp");
+		return builder->CreateInsertValue(slice, builder->CreateSub(end, begin, "slicesize"), {1u}, "slicetmp");
+	}
+
+	/**
+	 * @brief Read one character of a string, after checking the index against its size. Strings can't be changed a character at a time,
+	 * since that would go behind the back of their cached hash
+	 */
+	llvm::Value *createStringIndex(llvm::Value *str, llvm::Value *index, bool autoDeref)
+	{
+		if (!autoDeref)
+		{
+			logError("The characters of a string can be read, but not assigned to or referenced. Build a new string with + or append() instead");
+			return NULL;
+		}
+		if (!index->getType()->isIntegerTy())
+		{
+			logError("Error when trying to index a string: The index must be an integer. Cast it to an int if possible");
+			return NULL;
+		}
+		llvm::Value *offset = createArrayBoundsCheck(str, index, stringSize);
+		llvm::Value *chars = createStringData(getStringPointer(str));
+		return builder->CreateLoad(builder->getInt8Ty(), builder->CreateInBoundsGEP(builder->getInt8Ty(), chars, offset, "charptr"), "chartmp");
+	}
+
+	/**
+	 * @brief Index into a `T[soa]` array. With a member, only that member's own array is indexed (`particles[i].x`);
+	 * without one, the whole element is gathered up from every member's array, so it can be read but not written to
+	 */
+	llvm::Value *createSoaArrayIndex(llvm::Value *array, llvm::Value *index, const std::string &member, bool autoDeref)
+	{
+		if (!index->getType()->isIntegerTy())
+		{
+			logError("Error when trying to index an array: The index must be an integer. Cast it to an int if possible");
+			return NULL;
+		}
+		llvm::StructType *elementTy = getSoaElementType(array->getType());
+		if (member.empty() && !autoDeref)
+		{
+			logError("The elements of soa arrays aren't stored in one place, so a whole element can only be read, not assigned to or referenced. Set its members one at a time instead (array[i].member)");
+			return NULL;
+		}
+		ObjectMember field = member.empty() ? ObjectMember("", NULL, -1) : AliasMgr(elementTy, member);
+		if (!member.empty() && field.index == -1)
+		{
+			logError("No object member with name '" + member + "' found in object of type: " + AliasMgr.getTypeName(elementTy));
+			return NULL;
+		}
+		llvm::Value *offset = createArrayBoundsCheck(array, index, 0);
+		if (member.empty())
+		{
+			llvm::Value *element = llvm::UndefValue::get(elementTy);
+			for (unsigned i = 0; i < elementTy->getNumElements(); i++)
+			{
+				llvm::Type *memberTy = elementTy->getElementType(i);
+				llvm::Value *memberPtr = builder->CreateInBoundsGEP(memberTy, builder->CreateExtractValue(array, {i + 2}, "column"), offset, "elementptr");
+				element = builder->CreateInsertValue(element, builder->CreateLoad(memberTy, memberPtr, "loadtmp"), {i}, "gathertmp");
+			}
+			if (getObjectCopier(elementTy) == NULL)
+				return element;
+			// The gathered element shares its strings (& arrays...) with the array, so it's read from somewhere like any other stored
+			// value: anything that keeps it makes a copy of its own (see ownValue)
+			llvm::AllocaInst *gathered = createEntryBlockAlloca(elementTy, NULL, "gathered");
+			gatheredElements.insert(gathered);
+			builder->CreateStore(element, gathered);
+			return builder->CreateLoad(elementTy, gathered, "gathertmp");
+		}
+		llvm::Value *memberPtr = builder->CreateInBoundsGEP(field.type, builder->CreateExtractValue(array, {(unsigned)field.index + 2}, "column"), offset, "elementptr");
+		if (autoDeref)
+			return builder->CreateLoad(field.type, memberPtr, "loadtmp");
+		return memberPtr;
+	}
+
+	/**
+	 * @brief Whether an expression reads something that's stored somewhere (a variable, member, element or dereferenced pointer)
+	 * rather than making a new value
+	 */
+	bool isStoredValue(ExprAST *expr)
+	{
+		return dynamic_cast<VariableExprAST *>(expr) != NULL || dynamic_cast<MemberAccessExprAST *>(expr) != NULL ||
+			   dynamic_cast<IndexExprAST *>(expr) != NULL || dynamic_cast<DeRefrenceExprAST *>(expr) != NULL;
+	}
+	/**
+	 * @brief Destroy a string (or array, or anything else that owns memory) that was only made to be passed to something, like the result
+	 * of `a + b` in `f(a + b)`, once it's done with it. Anything that keeps one makes its own copy, so this never frees memory that's still in use
+	 */
+	void destroyIfTemporary(ExprAST *source, llvm::Value *val)
+	{
+		if (val != NULL && getObjectCopier(val->getType()) != NULL && !isStoredValue(source) && !llvm::isa<llvm::Constant>(val))
+			builder->CreateCall(getObjectDestructor(val->getType()), {getStringPointer(val)});
+	}
+
 	llvm::Value *IndexExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("getting index; other val: {0:x}", (long)other); 
-		llvm::Value *bsval = bas->codegen(), *offv = offs->codegen();
+		bool indexedMember;
+		return codegenMember(autoDeref, "", indexedMember);
+	}
+	/**
+	 * @brief Generates `base[index]`, or for soa arrays, `base[index].member` if a member is given (in which case indexedMember is set).
+	 * Anything else ignores the member; it's up to the caller to access it in the element
+	 */
+	llvm::Value *IndexExprAST::codegenMember(bool autoDeref, const std::string &member, bool &indexedMember)
+	{
+		llvm::Value *bsval = bas->codegen();
+		indexedMember = false;
+		// `base[a ... b]` doesn't index base; it views part of it
+		RangeExprAST *range = dynamic_cast<RangeExprAST *>(offs.get());
+		if (range != NULL && (isArrayType(bsval->getType()) || isSliceType(bsval->getType()) || bsval->getType()->isPointerTy()))
+		{
+			llvm::Value *slice = range->codegenSlice(bsval);
+			for (auto &x : range->throwables)
+				this->throwables.insert(x);
+			return slice;
+		}
+		llvm::Value *offv = offs->codegen();
+		if (isSoaArrayType(bsval->getType()))
+		{
+			indexedMember = !member.empty();
+			return createSoaArrayIndex(bsval, offv, member, autoDeref);
+		}
+		if (isArrayType(bsval->getType()) || isSliceType(bsval->getType()))
+			return createArrayIndex(bsval, offv, autoDeref);
+		if (isStringType(bsval->getType()))
+			return createStringIndex(bsval, offv, autoDeref);
+		if (isHashTableType(bsval->getType()))
+		{
+			llvm::Value *ret = createHashMapIndex(bsval, offv, autoDeref);
+			destroyIfTemporary(offs.get(), offv);
+			return ret;
+		}
+		if (bsval->getType()->isVectorTy())
+			return createVectorIndex(bsval, offv, autoDeref);
 		FunctionHeader op = getOperatorFromVals(bsval, "[", offv);
 		if (op.func != NULL)
 		{
@@ -219,6 +545,18 @@ namespace jimpilier
 			args.push_back(init);
 			return makeCallWithReferences(args, fh);
 		}
+		// Casting a number to a vector copies it into every element; casting between vectors converts each element
+		if (to->isVectorTy() || init->getType()->isVectorTy())
+		{
+			if (!to->isVectorTy() || (init->getType()->isVectorTy() && ((llvm::FixedVectorType *)to)->getNumElements() != ((llvm::FixedVectorType *)init->getType())->getNumElements()))
+			{
+				logError("No known conversion when converting " + AliasMgr.getTypeName(init->getType()) + " to a(n) " + AliasMgr.getTypeName(to) + " (vectors can only be cast to vectors of the same width)");
+				return NULL;
+			}
+			if (!init->getType()->isVectorTy())
+				return builder->CreateVectorSplat(((llvm::FixedVectorType *)to)->getNumElements(), convertElements(init, to->getScalarType()), "splattmp");
+			return convertElements(init, to);
+		}
 
 		switch (init->getType()->getTypeID())
 		{
@@ -352,6 +690,14 @@ namespace jimpilier
 		return !isLabel ? phi : (llvm::Value *)glblend;
 	}
 
+	/**
+	 * @brief Whether two values can be compared without an operator overload: both numbers, or both vectors of numbers
+	 */
+	bool hasBuiltinComparison(llvm::Value *LHS, llvm::Value *RHS)
+	{
+		return (LHS->getType()->isIntOrIntVectorTy() || LHS->getType()->isFPOrFPVectorTy()) && (RHS->getType()->isIntOrIntVectorTy() || RHS->getType()->isFPOrFPVectorTy());
+	}
+
 	llvm::Value *ComparisonStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("comparisonStmt; other val: {0:x}", (long)other); 
@@ -392,11 +738,22 @@ namespace jimpilier
 				for (int RHSIndex = 0; RHSIndex < items[i + 1].size(); RHSIndex++)
 				{
 					RHS = getCachedResult(i + 1, RHSIndex);
+					// Integers of different sizes are compared the same way arithmetic combines them: the smaller one is sign extended
+					if (LHS->getType()->isIntegerTy() && RHS->getType()->isIntegerTy() && LHS->getType() != RHS->getType())
+					{
+						llvm::Type *larger = LHS->getType()->getIntegerBitWidth() >= RHS->getType()->getIntegerBitWidth() ? LHS->getType() : RHS->getType();
+						LHS = builder->CreateSExtOrBitCast(LHS, larger, "signExtendTmp");
+						RHS = builder->CreateSExtOrBitCast(RHS, larger, "signExtendTmp");
+					}
+					matchVectorOperands(LHS, RHS);
 					FunctionHeader fh;
+					std::string symbol;
+					comparison = NULL;
 					switch (operations[i])
 					{
 					case EQUALCMP:
 					{
+						symbol = "==";
 						fh = getOperatorFromVals(LHS, "==", RHS);
 						if (fh.func != NULL)
 						{
@@ -405,12 +762,13 @@ namespace jimpilier
 							args.push_back(RHS);
 							comparison = makeCallWithReferences(args, fh);
 						}
-						else
-							comparison = LHS->getType()->isIntegerTy() ? builder->CreateICmpEQ(LHS, RHS, "cmptmp") : builder->CreateFCmpOEQ(LHS, RHS, "cmptmp");
+						else if (hasBuiltinComparison(LHS, RHS))
+							comparison = LHS->getType()->isIntOrIntVectorTy() ? builder->CreateICmpEQ(LHS, RHS, "cmptmp") : builder->CreateFCmpOEQ(LHS, RHS, "cmptmp");
 						break;
 					}
 					case NOTEQUAL:
 					{
+						symbol = "!=";
 						fh = getOperatorFromVals(LHS, "!=", RHS);
 						if (fh.func != NULL)
 						{
@@ -419,12 +777,13 @@ namespace jimpilier
 							args.push_back(RHS);
 							comparison = makeCallWithReferences(args, fh);
 						}
-						else
-							comparison = LHS->getType()->isIntegerTy() ? builder->CreateICmpNE(LHS, RHS, "cmptmp") : builder->CreateFCmpONE(LHS, RHS, "cmptmp");
+						else if (hasBuiltinComparison(LHS, RHS))
+							comparison = LHS->getType()->isIntOrIntVectorTy() ? builder->CreateICmpNE(LHS, RHS, "cmptmp") : builder->CreateFCmpONE(LHS, RHS, "cmptmp");
 						break;
 					}
 					case GREATER:
 					{
+						symbol = ">";
 						fh = getOperatorFromVals(LHS, ">", RHS);
 						if (fh.func != NULL)
 						{
@@ -433,12 +792,13 @@ namespace jimpilier
 							args.push_back(RHS);
 							comparison = makeCallWithReferences(args, fh);
 						}
-						else
-							comparison = LHS->getType()->isIntegerTy() ? builder->CreateICmpSGT(LHS, RHS, "cmptmp") : builder->CreateFCmpOGT(LHS, RHS, "cmptmp");
+						else if (hasBuiltinComparison(LHS, RHS))
+							comparison = LHS->getType()->isIntOrIntVectorTy() ? builder->CreateICmpSGT(LHS, RHS, "cmptmp") : builder->CreateFCmpOGT(LHS, RHS, "cmptmp");
 						break;
 					}
 					case GREATEREQUALS:
 					{
+						symbol = ">=";
 						fh = getOperatorFromVals(LHS, ">=", RHS);
 						if (fh.func != NULL)
 						{
@@ -447,12 +807,13 @@ namespace jimpilier
 							args.push_back(RHS);
 							comparison = makeCallWithReferences(args, fh);
 						}
-						else
-							comparison = LHS->getType()->isIntegerTy() ? builder->CreateICmpSGE(LHS, RHS, "cmptmp") : builder->CreateFCmpOGE(LHS, RHS, "cmptmp");
+						else if (hasBuiltinComparison(LHS, RHS))
+							comparison = LHS->getType()->isIntOrIntVectorTy() ? builder->CreateICmpSGE(LHS, RHS, "cmptmp") : builder->CreateFCmpOGE(LHS, RHS, "cmptmp");
 						break;
 					}
 					case LESS:
 					{
+						symbol = "<";
 						fh = getOperatorFromVals(LHS, "<", RHS);
 						if (fh.func != NULL)
 						{
@@ -461,11 +822,12 @@ namespace jimpilier
 							args.push_back(RHS);
 							comparison = makeCallWithReferences(args, fh);
 						}
-						else
-							comparison = LHS->getType()->isIntegerTy() ? builder->CreateICmpSLT(LHS, RHS, "cmptmp") : builder->CreateFCmpOLT(LHS, RHS, "cmptmp");
+						else if (hasBuiltinComparison(LHS, RHS))
+							comparison = LHS->getType()->isIntOrIntVectorTy() ? builder->CreateICmpSLT(LHS, RHS, "cmptmp") : builder->CreateFCmpOLT(LHS, RHS, "cmptmp");
 						break;
 					}
 					case LESSEQUALS:
+						symbol = "<=";
 						fh = getOperatorFromVals(LHS, "<=", RHS);
 						if (fh.func != NULL)
 						{
@@ -474,12 +836,41 @@ namespace jimpilier
 							args.push_back(RHS);
 							comparison = makeCallWithReferences(args, fh);
 						}
-						else
-							comparison = LHS->getType()->isIntegerTy() ? builder->CreateICmpSLE(LHS, RHS, "cmptmp") : builder->CreateFCmpOLE(LHS, RHS, "cmptmp");
+						else if (hasBuiltinComparison(LHS, RHS))
+							comparison = LHS->getType()->isIntOrIntVectorTy() ? builder->CreateICmpSLE(LHS, RHS, "cmptmp") : builder->CreateFCmpOLE(LHS, RHS, "cmptmp");
 						break;
 					default:
 						logError("Unknown comparision operator: " + keytokens[operations[i]]);
 					}
+					if (comparison == NULL)
+					{
+						// e.g. a generic function instantiated for a type that never overloaded the operator it uses
+						logError("Values of type " + AliasMgr.getTypeName(LHS->getType()) + " and " + AliasMgr.getTypeName(RHS->getType()) + " can't be compared with " + symbol + ": no operator overload takes them");
+						return NULL;
+					}
+					// Operands of a lone comparison are only used once, so temporary strings can go right away
+					if (operations.size() == 1 && items[0].size() == 1 && items[1].size() == 1)
+					{
+						destroyIfTemporary(items[0][0].get(), LHS);
+						destroyIfTemporary(items[1][0].get(), RHS);
+					}
+					if (comparison->getType()->isVectorTy())
+					{
+						// A lone vector comparison gives back the mask, one bool per element
+						if (!isLabel && operations.size() == 1 && items[0].size() == 1 && items[1].size() == 1)
+						{
+							phi->eraseFromParent();
+							ANDConditional->eraseFromParent();
+							shortCircuitEvalEnd->eraseFromParent();
+							if (other != NULL)
+								builder->CreateStore(comparison, other);
+							cache.clear();
+							return comparison;
+						}
+						// Anywhere else (if statements, chains), a vector comparison holds if it holds for every element
+						comparison = builder->CreateAndReduce(comparison);
+						comparison->setName("allelements");
+					}
 					if ((RHSIndex < items[i + 1].size() - 1) || LHSIndex < items[i].size() - 1)
 					{
 						if (phi != NULL && (ANDConditional == shortCircuitEvalEnd || ORConditional == shortCircuitEvalEnd))
@@ -565,8 +956,25 @@ namespace jimpilier
 		spdlog::debug("SwitchExprAST; other val: {0:x}", (long)other); 
 		std::vector<llvm::BasicBlock *> bodBlocks;
 		llvm::BasicBlock *glblend = llvm::BasicBlock::Create(*ctxt, "glblswitchend", currentFunction), *lastbody = glblend;
-		llvm::SwitchInst *val = builder->CreateSwitch(comp->codegen(), glblend, cases.size());
+		llvm::Value *compared = comp->codegen();
+		// Strings (and C strings) are switched on by their hash; see createStringSwitchDispatch
+		llvm::Value *str = NULL;
+		bool temporary = false;
+		std::map<std::string, llvm::BasicBlock *> stringCases;
+		if (compared != NULL && (isStringType(compared->getType()) || compared->getType() == builder->getInt8PtrTy()))
+		{
+			temporary = !isStoredValue(comp.get()) && !llvm::isa<llvm::Constant>(compared);
+			if (!isStringType(compared->getType()))
+			{
+				compared = convertToString(compared);
+				temporary = !llvm::isa<llvm::Constant>(compared);
+			}
+			str = getStringPointer(compared);
+			compared = builder->CreateCall(getStringFunction("hash"), {str}, "hash");
+		}
+		llvm::SwitchInst *val = builder->CreateSwitch(compared, glblend, cases.size());
 		escapeBlock.push(std::pair<llvm::BasicBlock *, llvm::BasicBlock *>(glblend, lastbody));
+		escapeScopeDepth.push(localScopes.size());
 
 		for (auto caseExpr = cases.rbegin(); caseExpr != cases.rend(); caseExpr++)
 		{
@@ -576,15 +984,33 @@ namespace jimpilier
 			caseExpr->second->codegen();
 			builder->CreateBr(autoBr ? glblend : lastbody);
 			for (auto &x : caseExpr->first)
-				val->addCase((llvm::ConstantInt *)x->codegen(), currentbody);
+			{
+				llvm::Value *caseVal = x->codegen();
+				if (str == NULL)
+				{
+					val->addCase((llvm::ConstantInt *)caseVal, currentbody);
+					continue;
+				}
+				llvm::StringRef literal;
+				if (caseVal == NULL || !llvm::isa<llvm::Constant>(caseVal) || !llvm::getConstantStringInfo(caseVal, literal))
+				{
+					logError("Only string literals can be the cases of a switch over a string");
+					return NULL;
+				}
+				// Cases are generated last to first, so a string listed in more than one case goes to the first
+				stringCases[literal.str()] = currentbody;
+			}
 			if (caseExpr->first.empty())
 				val->setDefaultDest(currentbody);
 			lastbody = currentbody;
 			escapeBlock.pop();
 			escapeBlock.push(std::pair<llvm::BasicBlock *, llvm::BasicBlock *>(glblend, lastbody));
 		}
+		if (str != NULL)
+			createStringSwitchDispatch(val, str, stringCases, temporary);
 		builder->SetInsertPoint(glblend);
 		escapeBlock.pop();
+		escapeScopeDepth.pop();
 		return val;
 	}
 
@@ -593,6 +1019,7 @@ namespace jimpilier
 		spdlog::debug("BreakExprAST; other val: {0:x}", (long)other); 
 		if (escapeBlock.empty())
 			return llvm::ConstantInt::get(*ctxt, llvm::APInt(32, 0, true));
+		emitScopeExitsFrom(escapeScopeDepth.top());
 		// if (labelVal != "")
 		return builder->CreateBr(escapeBlock.top().first);
 	}
@@ -601,6 +1028,7 @@ namespace jimpilier
 		spdlog::debug("ContinueExprAST; other val: {0:x}", (long)other); 
 		if (escapeBlock.empty())
 			return llvm::ConstantInt::get(*ctxt, llvm::APInt(32, 0, true));
+		emitScopeExitsFrom(escapeScopeDepth.top());
 		// if (labelVal != "")
 		return builder->CreateBr(escapeBlock.top().second);
 	}
@@ -623,6 +1051,8 @@ namespace jimpilier
 			return llvm::ConstantInt::getIntegerValue(llvm::Type::getInt32Ty(*ctxt), llvm::APInt(32, 8));
 		case llvm::Type::ArrayTyID:
 			return llvm::ConstantInt::getIntegerValue(llvm::Type::getInt32Ty(*ctxt), llvm::APInt(32, DataLayout->getTypeAllocSize(ty) * ty->getArrayNumElements()));
+		case llvm::Type::FixedVectorTyID:
+			return llvm::ConstantInt::getIntegerValue(llvm::Type::getInt32Ty(*ctxt), llvm::APInt(32, DataLayout->getTypeAllocSize(ty)));
 		case llvm::Type::StructTyID:
 			llvm::StructType *castedval = (llvm::StructType *)ty;
 			return llvm::ConstantInt::getIntegerValue(llvm::Type::getInt32Ty(*ctxt), llvm::APInt(32, DataLayout->getStructLayout(castedval)->getSizeInBytes()));
@@ -632,19 +1062,63 @@ namespace jimpilier
 	llvm::Value *HeapExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("HeapExprAST; other val: {0:x}", (long)other); 
-		// initalize calloc(i64, i64) as the primary ways to allocate heap memory
-		GlobalVarsAndFunctions->getOrInsertFunction("calloc", llvm::FunctionType::get(
-																  llvm::Type::getInt8Ty(*ctxt)->getPointerTo(),
-																  {llvm::Type::getInt64Ty(*ctxt), llvm::Type::getInt64Ty(*ctxt)},
-																  false));
-
-		llvm::Value *alloc = builder->CreateCall(GlobalVarsAndFunctions->getFunction("calloc"), {other, llvm::ConstantInt::getIntegerValue(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, 1))}, "clearalloctmp");
-		return alloc;
+		// other = the size of the object being allocated. The memory is NOT zeroed; see ObjectConstructorCallExprAST
+		if (arena == NULL)
+			return createHeapAllocation(other, NULL, alignment);
+		llvm::Value *arenaptr = arena->codegen(false);
+		for (auto &x : arena->throwables)
+			this->throwables.insert(x);
+		llvm::Type *arenaTy = AliasMgr("arena");
+		// Arenas may be passed around by pointer; walk down to the arena itself
+		while (arenaptr->getType()->isPointerTy() && arenaptr->getType()->getNonOpaquePointerElementType()->isPointerTy())
+			arenaptr = builder->CreateLoad(arenaptr->getType()->getNonOpaquePointerElementType(), arenaptr, "loadtmp");
+		if (arenaTy == NULL || arenaptr->getType() != arenaTy->getPointerTo())
+		{
+			logError("heap(...) expects an arena, but was given a value of type: " + AliasMgr.getTypeName(arenaptr->getType()));
+			return NULL;
+		}
+		return createHeapAllocation(other, arenaptr, alignment);
+	}
+	llvm::Value *AwaitExprAST::codegen(bool autoDeref, llvm::Value *other)
+	{
+		spdlog::debug("AwaitExprAST; other val: {0:x}", (long)other); 
+		if (builtin != "" && AliasMgr.functions.hasAlias(builtin))
+			task = std::make_unique<CallExprAST>(builtin, args);
+		if (task == NULL)
+		{
+			if (args.size() != 1)
+			{
+				logError("await " + builtin + "(...) takes exactly one argument");
+				return NULL;
+			}
+			llvm::Value *arg = args[0]->codegen();
+			if (arg == NULL)
+				return NULL;
+			if (!arg->getType()->isIntegerTy())
+			{
+				logError("await " + builtin + "(...) expects an integer, not a(n) " + AliasMgr.getTypeName(arg->getType()));
+				return NULL;
+			}
+			if (builtin == "sleep")
+				return createAwaitSleep(builder->CreateSExtOrTrunc(arg, builder->getInt64Ty(), "ms"));
+			return createAwaitFd(builder->CreateSExtOrTrunc(arg, builder->getInt32Ty(), "fd"), builtin == "readable" ? asyncEpollIn : asyncEpollOut);
+		}
+		llvm::Value *awaited = task->codegen();
+		if (awaited == NULL)
+			return NULL;
+		for (auto &x : task->throwables)
+			this->throwables.insert(x);
+		llvm::StructType *promiseTy = getAsyncPromiseOf(awaited->getType());
+		if (promiseTy == NULL)
+		{
+			logError("Only the tasks async functions return can be awaited, not a(n) " + AliasMgr.getTypeName(awaited->getType()));
+			return NULL;
+		}
+		return createAwaitTask(awaited, promiseTy);
 	}
 	llvm::Value *DeleteExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("DeleteExprAST; other val: {0:x}", (long)other); 
-		llvm::Value *freefunc = GlobalVarsAndFunctions->getOrInsertFunction("free", {llvm::Type::getInt8PtrTy(*ctxt)}, llvm::Type::getInt8PtrTy(*ctxt)).getCallee();
 		llvm::Value *deletedthing = val->codegen(true);
 		FunctionHeader op = getOperatorFromVals(NULL, "DELETE", deletedthing);
 		if (op.func != NULL)
@@ -658,25 +1132,157 @@ namespace jimpilier
 			logError("Remember: Objects on the stack are accessed directly, you only need to delete pointers that point to the heap\nYou might've tried to delete an object (directly) by mistake rather than a pointer to that object");
 			return NULL;
 		}
-		std::vector<llvm::Type *> argstmp;
-		argstmp.push_back(deletedthing->getType());
-		std::string nametmp = "destructor@" + AliasMgr.objects.getObjectName(deletedthing->getType()->getContainedType(0));
-		spdlog::debug("Typename of the thing we're deleting: {}", AliasMgr.getTypeName(AliasMgr.objects.getObject(deletedthing->getType()->getContainedType(0)).ptr));
+		if (llvm::Function *dtor = getObjectDestructor(deletedthing->getType()->getNonOpaquePointerElementType()))
+		{
+			// Deleting null is allowed, so only destroy the object if there is one
+			llvm::BasicBlock *destroy = llvm::BasicBlock::Create(*ctxt, "destroy", currentFunction), *destroyed = llvm::BasicBlock::Create(*ctxt, "destroyed", currentFunction);
+			builder->CreateCondBr(builder->CreateIsNotNull(deletedthing, "notnull"), destroy, destroyed);
+			builder->SetInsertPoint(destroy);
+			builder->CreateCall(dtor, {deletedthing});
+			builder->CreateBr(destroyed);
+			builder->SetInsertPoint(destroyed);
+		}
 		deletedthing = builder->CreateBitCast(deletedthing, llvm::Type::getInt8PtrTy(*ctxt), "bitcasttmp");
-		builder->CreateCall((llvm::Function *)freefunc, deletedthing, "freedValue");
+		// heap.free() works out which allocator the object came from, and ignores null pointers
+		builder->CreateCall(getHeapFreeFunction(), deletedthing);
 		return NULL;
 	}
 	// I have a feeling this function needs to be revamped.
+	/**
+	 * @brief Whether something other than a load was made of a local since `before`. Arrays may also be read through (`x.size`),
+	 * appended to (or otherwise grown), and destroyed on the way out of their scope, none of which can make an index that was in bounds go out of bounds
+	 */
+	bool slotWasWritten(llvm::AllocaInst *slot, std::set<llvm::User *> &before)
+	{
+		for (llvm::User *user : slot->users())
+		{
+			if (before.count(user) || llvm::isa<llvm::LoadInst>(user))
+				continue;
+			if (!isArrayType(slot->getAllocatedType()) && !isSoaArrayType(slot->getAllocatedType()) && !isSliceType(slot->getAllocatedType()))
+				return true;
+			if (llvm::isa<llvm::GetElementPtrInst>(user) && llvm::all_of(user->users(), [](llvm::User *u)
+																		  { return llvm::isa<llvm::LoadInst>(u); }))
+				continue;
+			llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(user);
+			if (call == NULL || (!arrayFunctionsThatNeverShrink.count(call->getCalledFunction()) && call->getCalledFunction() != getObjectDestructor(slot->getAllocatedType())))
+				return true;
+		}
+		return false;
+	}
+	/**
+	 * @brief Whether a local can only be changed by code in this function we can see: its address is never stored or passed anywhere
+	 * (except to the array functions, for arrays)
+	 */
+	bool slotIsOnlyAccessedDirectly(llvm::AllocaInst *slot)
+	{
+		for (llvm::User *user : slot->users())
+		{
+			if (llvm::isa<llvm::LoadInst>(user) || isLifetimeMarker(user))
+				continue;
+			if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(user))
+			{
+				if (store->getValueOperand() == slot)
+					return false;
+				continue;
+			}
+			if (llvm::isa<llvm::GetElementPtrInst>(user))
+			{
+				for (llvm::User *fieldUser : user->users())
+					if (!llvm::isa<llvm::LoadInst>(fieldUser) && !(llvm::isa<llvm::StoreInst>(fieldUser) && ((llvm::StoreInst *)fieldUser)->getPointerOperand() == user))
+						return false;
+				continue;
+			}
+			llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(user);
+			if (call == NULL || (!isArrayType(slot->getAllocatedType()) && !isSoaArrayType(slot->getAllocatedType())) ||
+				(!arrayFunctionsThatNeverShrink.count(call->getCalledFunction()) && call->getCalledFunction() != getObjectDestructor(slot->getAllocatedType())))
+				return false;
+		}
+		return true;
+	}
+	/**
+	 * @brief Replace a bounds check with a jump straight to the in-bounds path
+	 */
+	void removeBoundsCheck(BoundsCheck &bc)
+	{
+		llvm::BasicBlock *outOfBounds = bc.check->getSuccessor(1);
+		llvm::Instruction *cond = (llvm::Instruction *)bc.check->getCondition();
+		llvm::BranchInst::Create(bc.check->getSuccessor(0), bc.check);
+		bc.check->eraseFromParent();
+		outOfBounds->eraseFromParent();
+		llvm::Instruction *size = (llvm::Instruction *)cond->getOperand(1);
+		cond->eraseFromParent();
+		if (size->use_empty())
+			size->eraseFromParent();
+	}
+	/**
+	 * @brief Works out whether a loop is `for (i = <constant >= 0>; i < array.size; i += <constant > 0>)`, where i is 64 bits wide
+	 * (so it can't overflow before reaching the array's size). Afterwards, only `indexSlot` & `arraySlot` need checking.
+	 */
+	bool matchArrayLoop(ExprAST *condition, llvm::AllocaInst *&indexSlot, llvm::AllocaInst *&arraySlot)
+	{
+		ComparisonStmtAST *cmp = dynamic_cast<ComparisonStmtAST *>(condition);
+		ExprAST *lhs, *rhs;
+		if (cmp == NULL || !cmp->getLessThan(lhs, rhs))
+			return false;
+		VariableExprAST *index = dynamic_cast<VariableExprAST *>(lhs);
+		MemberAccessExprAST *size = dynamic_cast<MemberAccessExprAST *>(rhs);
+		if (index == NULL || size == NULL || size->getMember() != "size")
+			return false;
+		VariableExprAST *array = dynamic_cast<VariableExprAST *>(size->getBase());
+		if (array == NULL || AliasMgr[index->getName()].isRef || AliasMgr[array->getName()].isRef)
+			return false;
+		indexSlot = llvm::dyn_cast_or_null<llvm::AllocaInst>(AliasMgr[index->getName()].val);
+		arraySlot = llvm::dyn_cast_or_null<llvm::AllocaInst>(AliasMgr[array->getName()].val);
+		if (indexSlot == NULL || arraySlot == NULL || !indexSlot->getAllocatedType()->isIntegerTy(64) || (!isArrayType(arraySlot->getAllocatedType()) && !isSoaArrayType(arraySlot->getAllocatedType()) && !isSliceType(arraySlot->getAllocatedType())))
+			return false;
+		// The last thing the loop's prefix stored in the index must be a non-negative constant
+		for (auto inst = builder->GetInsertBlock()->rbegin(); inst != builder->GetInsertBlock()->rend(); inst++)
+		{
+			llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&*inst);
+			if (store == NULL || store->getPointerOperand() != indexSlot)
+				continue;
+			llvm::ConstantInt *start = llvm::dyn_cast<llvm::ConstantInt>(store->getValueOperand());
+			return start != NULL && !start->isNegative();
+		}
+		return false;
+	}
+	/**
+	 * @brief Whether the only thing a loop's postfix stores in its index is the index plus a positive constant
+	 */
+	bool onlyIncrements(llvm::AllocaInst *indexSlot, std::set<llvm::User *> &before)
+	{
+		for (llvm::User *user : indexSlot->users())
+		{
+			if (before.count(user) || llvm::isa<llvm::LoadInst>(user))
+				continue;
+			llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(user);
+			llvm::BinaryOperator *add = store == NULL ? NULL : llvm::dyn_cast<llvm::BinaryOperator>(store->getValueOperand());
+			if (add == NULL || store->getPointerOperand() != indexSlot || add->getOpcode() != llvm::Instruction::Add)
+				return false;
+			llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(add->getOperand(0));
+			llvm::ConstantInt *step = llvm::dyn_cast<llvm::ConstantInt>(add->getOperand(1));
+			if (load == NULL || load->getPointerOperand() != indexSlot || step == NULL || step->isNegative() || step->isZero())
+				return false;
+		}
+		return true;
+	}
+
 	llvm::Value *ForExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("ForExprAST; other val: {0:x}", (long)other); 
 		llvm::Value *retval;
 		llvm::BasicBlock *start = llvm::BasicBlock::Create(*ctxt, "loopstart", currentFunction), *end = llvm::BasicBlock::Create(*ctxt, "loopend", currentFunction);
 		escapeBlock.push(std::pair<llvm::BasicBlock *, llvm::BasicBlock *>(end, start));
+		escapeScopeDepth.push(localScopes.size());
 		for (int i = 0; i < prefix.size(); i++)
 		{
 			llvm::Value *startval = prefix[i]->codegen();
 		}
+		// Bounds checks on `array[i]` are redundant in the body of `for (i = 0; i < array.size; i++)`, as long as the body can't change i or shrink the array
+		llvm::AllocaInst *indexSlot = NULL, *arraySlot = NULL;
+		bool arrayLoop = !dowhile && !releaseMode && matchArrayLoop(condition.get(), indexSlot, arraySlot);
+		size_t firstCheck = pendingBoundsChecks.size();
+		loopDepth++;
 		if (!dowhile)
 		{
 
@@ -686,8 +1292,17 @@ namespace jimpilier
 		{
 			builder->CreateBr(start);
 		}
+		std::set<llvm::User *> indexUsers, arrayUsers;
+		if (arrayLoop)
+		{
+			indexUsers.insert(indexSlot->user_begin(), indexSlot->user_end());
+			arrayUsers.insert(arraySlot->user_begin(), arraySlot->user_end());
+		}
 		builder->SetInsertPoint(start);
 		body->codegen();
+		arrayLoop = arrayLoop && !slotWasWritten(indexSlot, indexUsers) && !slotWasWritten(arraySlot, arrayUsers);
+		if (arrayLoop)
+			indexUsers.insert(indexSlot->user_begin(), indexSlot->user_end());
 		for (int i = 0; i < postfix.size(); i++)
 		{
 			retval = postfix[i]->codegen();
@@ -695,8 +1310,233 @@ namespace jimpilier
 		builder->CreateCondBr(condition->codegen(), start, end);
 		builder->SetInsertPoint(end);
 		escapeBlock.pop();
+		escapeScopeDepth.pop();
+		loopDepth--;
+		if (arrayLoop && onlyIncrements(indexSlot, indexUsers))
+			for (size_t i = firstCheck; i < pendingBoundsChecks.size(); i++)
+				if (pendingBoundsChecks[i].indexSlot == indexSlot && pendingBoundsChecks[i].arraySlot == arraySlot)
+				{
+					provenBoundsChecks.push_back(pendingBoundsChecks[i]);
+					pendingBoundsChecks.erase(pendingBoundsChecks.begin() + i--);
+				}
+		// Once the outermost loop is done, nothing can take the address of the index or array and change them while a loop runs
+		if (loopDepth == 0)
+		{
+			for (BoundsCheck &bc : provenBoundsChecks)
+				if (slotIsOnlyAccessedDirectly(bc.indexSlot) && slotIsOnlyAccessedDirectly(bc.arraySlot))
+				{
+					spdlog::debug("Removing bounds check proven by the loop on {}", bc.indexSlot->getName().str());
+					removeBoundsCheck(bc);
+				}
+			provenBoundsChecks.clear();
+			pendingBoundsChecks.clear();
+		}
 		return retval;
 	}
+	/**
+	 * @brief The value a reduction variable's private copy starts out as: whatever combining with it doesn't change
+	 */
+	llvm::Constant *getReductionIdentity(llvm::Type *ty, const std::string &op)
+	{
+		bool isFloat = ty->isFloatingPointTy();
+		if (op == "+")
+			return isFloat ? llvm::ConstantFP::get(ty, 0.0) : llvm::ConstantInt::get(ty, 0);
+		if (op == "*")
+			return isFloat ? llvm::ConstantFP::get(ty, 1.0) : llvm::ConstantInt::get(ty, 1);
+		if (isFloat)
+			return llvm::ConstantFP::getInfinity(ty, op == "max");
+		unsigned bits = ty->getIntegerBitWidth();
+		return llvm::ConstantInt::get(ty, op == "min" ? llvm::APInt::getSignedMaxValue(bits) : llvm::APInt::getSignedMinValue(bits));
+	}
+	llvm::Value *combineReduction(llvm::Value *lhs, llvm::Value *rhs, const std::string &op)
+	{
+		bool isFloat = lhs->getType()->isFloatingPointTy();
+		if (op == "+")
+			return isFloat ? builder->CreateFAdd(lhs, rhs, "reduced") : builder->CreateAdd(lhs, rhs, "reduced");
+		if (op == "*")
+			return isFloat ? builder->CreateFMul(lhs, rhs, "reduced") : builder->CreateMul(lhs, rhs, "reduced");
+		llvm::Value *lhsFirst = isFloat ? (op == "min" ? builder->CreateFCmpOLT(lhs, rhs, "cmptmp") : builder->CreateFCmpOGT(lhs, rhs, "cmptmp"))
+										: (op == "min" ? builder->CreateICmpSLT(lhs, rhs, "cmptmp") : builder->CreateICmpSGT(lhs, rhs, "cmptmp"));
+		return builder->CreateSelect(lhsFirst, lhs, rhs, "reduced");
+	}
+	/**
+	 * @brief Atomically combine a thread's part of a reduction into the shared variable, with a compare & swap loop (so it works for floats too)
+	 */
+	void createAtomicReduction(llvm::Value *shared, llvm::Value *part, const std::string &op)
+	{
+		llvm::Type *ty = part->getType();
+		llvm::Type *intTy = builder->getIntNTy(DataLayout->getTypeSizeInBits(ty).getFixedSize());
+		llvm::Align align(DataLayout->getTypeStoreSize(ty).getFixedSize());
+		llvm::Value *sharedInt = builder->CreateBitCast(shared, intTy->getPointerTo(), "sharedbits");
+		llvm::LoadInst *initial = builder->CreateAlignedLoad(intTy, sharedInt, align, "initial");
+		initial->setAtomic(llvm::AtomicOrdering::Monotonic);
+		llvm::BasicBlock *before = builder->GetInsertBlock(),
+						 *retry = llvm::BasicBlock::Create(*ctxt, "reduceretry", currentFunction),
+						 *done = llvm::BasicBlock::Create(*ctxt, "reducedone", currentFunction);
+		builder->CreateBr(retry);
+		builder->SetInsertPoint(retry);
+		llvm::PHINode *expected = builder->CreatePHI(intTy, 2, "expected");
+		expected->addIncoming(initial, before);
+		llvm::Value *merged = combineReduction(builder->CreateBitCast(expected, ty, "current"), part, op);
+		llvm::Value *swap = builder->CreateAtomicCmpXchg(sharedInt, expected, builder->CreateBitCast(merged, intTy, "mergedbits"), align, llvm::AtomicOrdering::SequentiallyConsistent, llvm::AtomicOrdering::SequentiallyConsistent);
+		swap->setName("swap");
+		expected->addIncoming(builder->CreateExtractValue(swap, {0u}, "seen"), retry);
+		builder->CreateCondBr(builder->CreateExtractValue(swap, {1u}, "swapped"), done, retry);
+		builder->SetInsertPoint(done);
+	}
+
+	llvm::Value *ParallelForExprAST::codegen(bool autoDeref, llvm::Value *other)
+	{
+		spdlog::debug("ParallelForExprAST; other val: {0:x}", (long)other);
+		llvm::Type *indexTy = indexType->codegen();
+		if (indexTy == NULL || !indexTy->isIntegerTy())
+		{
+			logError("The counter of a parallel for loop has to be an integer");
+			return NULL;
+		}
+		llvm::Value *first = start->codegen(), *last = end->codegen();
+		if (!first->getType()->isIntegerTy() || !last->getType()->isIntegerTy())
+		{
+			logError("The range of a parallel for loop has to be made of integers");
+			return NULL;
+		}
+		first = builder->CreateSExtOrTrunc(first, builder->getInt64Ty(), "rangestart");
+		last = builder->CreateSExtOrTrunc(last, builder->getInt64Ty(), "rangeend");
+		if (inclusive)
+			last = builder->CreateAdd(last, builder->getInt64(1), "rangeend");
+		for (auto &reduction : reductions)
+		{
+			auto var = AliasMgr.variables.find(reduction.second);
+			llvm::Type *ty = var == AliasMgr.variables.end() || var->second.val == NULL ? NULL : var->second.val->getType()->getNonOpaquePointerElementType();
+			if (ty == NULL || var->second.isRef || !(ty->isFloatingPointTy() || (ty->isIntegerTy() && ty->getIntegerBitWidth() >= 8)))
+			{
+				logError("Only number variables can be reduced in a parallel for loop: " + reduction.second);
+				return NULL;
+			}
+		}
+
+		// The body gets the address of every local it could refer to by name
+		std::vector<std::pair<std::string, CompileTimeVariable>> captures;
+		std::vector<llvm::Type *> captureTypes;
+		for (auto &var : AliasMgr.variables)
+		{
+			llvm::AllocaInst *slot = llvm::dyn_cast_or_null<llvm::AllocaInst>(var.second.val);
+			if (slot != NULL && slot->getFunction() == currentFunction)
+			{
+				captures.push_back(var);
+				captureTypes.push_back(slot->getType());
+			}
+		}
+		llvm::StructType *captureTy = llvm::StructType::get(*ctxt, captureTypes);
+		llvm::AllocaInst *captureSlot = createEntryBlockAlloca(captureTy, NULL, "parallel.captures");
+		for (int i = 0; i < captures.size(); i++)
+			builder->CreateStore(captures[i].second.val, builder->CreateStructGEP(captureTy, captureSlot, i, "capture"));
+
+		llvm::Function *outerFunction = currentFunction;
+		llvm::BasicBlock *outerBlock = builder->GetInsertBlock();
+		std::map<std::string, CompileTimeVariable> outerVariables = AliasMgr.variables;
+		std::vector<BoundsCheck> outerPending = std::move(pendingBoundsChecks), outerProven = std::move(provenBoundsChecks);
+		int outerLoopDepth = loopDepth;
+		// A try block around the loop can't catch anything thrown on a worker thread; its handler is in another function
+		llvm::BasicBlock *outerUnwindBlock = currentUnwindBlock;
+		pendingBoundsChecks.clear();
+		provenBoundsChecks.clear();
+		loopDepth = 0;
+		currentUnwindBlock = NULL;
+		llvm::Function *bodyFunc = llvm::Function::Create(getParallelBodyType(), llvm::Function::InternalLinkage, outerFunction->getName() + ".parallel", GlobalVarsAndFunctions.get());
+		parallelBodies.insert(bodyFunc);
+		llvm::Value *captureArg = bodyFunc->getArg(0), *begin = bodyFunc->getArg(1), *stop = bodyFunc->getArg(2);
+		captureArg->setName("captures");
+		begin->setName("begin");
+		stop->setName("end");
+		currentFunction = bodyFunc;
+		FunctionScopeState outerScopes = enterFunctionScope();
+		pushLocalScope();
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", bodyFunc),
+						 *cond = llvm::BasicBlock::Create(*ctxt, "loopcond", bodyFunc),
+						 *loop = llvm::BasicBlock::Create(*ctxt, "loopstart", bodyFunc),
+						 *next = llvm::BasicBlock::Create(*ctxt, "loopnext", bodyFunc),
+						 *brk = llvm::BasicBlock::Create(*ctxt, "loopbreak", bodyFunc),
+						 *exit = llvm::BasicBlock::Create(*ctxt, "loopend", bodyFunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *captured = builder->CreateBitCast(captureArg, captureTy->getPointerTo(), "captured");
+		for (int i = 0; i < captures.size(); i++)
+		{
+			llvm::Value *ptr = builder->CreateLoad(captureTypes[i], builder->CreateStructGEP(captureTy, captured, i, "capture"), captures[i].first);
+			AliasMgr[captures[i].first] = {ptr, captures[i].second.isRef};
+			if (atomicSlots.count(captures[i].second.val))
+				atomicSlots.insert(ptr);
+		}
+		// Each call works on a private copy of the reduction variables, starting from the operator's identity
+		std::vector<llvm::Value *> shared;
+		std::vector<llvm::AllocaInst *> parts;
+		for (auto &reduction : reductions)
+		{
+			shared.push_back(AliasMgr[reduction.second].val);
+			llvm::Type *ty = shared.back()->getType()->getNonOpaquePointerElementType();
+			parts.push_back(createEntryBlockAlloca(ty, NULL, reduction.second + ".part"));
+			builder->CreateStore(getReductionIdentity(ty, reduction.first), parts.back());
+			AliasMgr[reduction.second] = {parts.back(), false};
+		}
+		llvm::AllocaInst *counter = createEntryBlockAlloca(builder->getInt64Ty(), NULL, indexName + ".counter");
+		llvm::AllocaInst *indexSlot = createEntryBlockAlloca(indexTy, NULL, indexName);
+		AliasMgr[indexName] = {indexSlot, false};
+		builder->CreateStore(begin, counter);
+		builder->CreateBr(cond);
+		builder->SetInsertPoint(cond);
+		llvm::Value *current = builder->CreateLoad(builder->getInt64Ty(), counter, "current");
+		builder->CreateCondBr(builder->CreateICmpSLT(current, stop, "inrange"), loop, exit);
+		builder->SetInsertPoint(loop);
+		builder->CreateStore(builder->CreateSExtOrTrunc(current, indexTy, "index"), indexSlot);
+		escapeBlock.push(std::pair<llvm::BasicBlock *, llvm::BasicBlock *>(brk, next));
+		escapeScopeDepth.push(localScopes.size());
+		body->codegen();
+		escapeBlock.pop();
+		escapeScopeDepth.pop();
+		if (builder->GetInsertBlock()->getTerminator() == NULL)
+			builder->CreateBr(next);
+		builder->SetInsertPoint(next);
+		builder->CreateStore(builder->CreateAdd(builder->CreateLoad(builder->getInt64Ty(), counter, "current"), builder->getInt64(1), "nextindex"), counter);
+		builder->CreateBr(cond);
+		builder->SetInsertPoint(brk);
+		builder->CreateBr(exit);
+		builder->SetInsertPoint(exit);
+		llvm::PHINode *broke = builder->CreatePHI(builder->getInt1Ty(), 2, "broke");
+		broke->addIncoming(builder->getFalse(), cond);
+		broke->addIncoming(builder->getTrue(), brk);
+		for (int i = 0; i < reductions.size(); i++)
+			createAtomicReduction(shared[i], builder->CreateLoad(parts[i]->getAllocatedType(), parts[i], reductions[i].second + ".value"), reductions[i].first);
+		builder->CreateRet(broke);
+		exitFunctionScope(outerScopes);
+		verifyFunction(*bodyFunc);
+
+		AliasMgr.variables = outerVariables;
+		pendingBoundsChecks = std::move(outerPending);
+		provenBoundsChecks = std::move(outerProven);
+		loopDepth = outerLoopDepth;
+		currentUnwindBlock = outerUnwindBlock;
+		currentFunction = outerFunction;
+		builder->SetInsertPoint(outerBlock);
+		return builder->CreateCall(getParallelForFunction(), {bodyFunc, builder->CreateBitCast(captureSlot, builder->getInt8PtrTy(), "captureptr"), first, last});
+	}
+	/**
+	 * @brief The range as the bounds of a slice of `base` (`base[start ... end]`), rather than as an array of its values
+	 */
+	llvm::Value *RangeExprAST::codegenSlice(llvm::Value *base)
+	{
+		spdlog::debug("RangeExprAST as a slice");
+		if (step != NULL)
+		{
+			logError("Slices can't skip elements, since they're one run of the array they're a part of. Leave out the ': step'");
+			return NULL;
+		}
+		llvm::Value *begin = start->codegen(), *fin = end->codegen();
+		for (auto &x : start->throwables)
+			this->throwables.insert(x);
+		for (auto &x : end->throwables)
+			this->throwables.insert(x);
+		return createSlice(base, begin, fin);
+	}
 	llvm::Value *RangeExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("RangeExprAST; other val: {0:x}", (long)other); 
@@ -777,9 +1617,10 @@ namespace jimpilier
 			arrsize = builder->CreateFDiv(arrsize, builder->CreateCast(llvm::Instruction::CastOps::SIToFP, delta, llvm::Type::getDoubleTy(*ctxt), "divtmp"), "divtmp");
 			arrsize = builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("round", llvm::Type::getDoubleTy(*ctxt), llvm::Type::getDoubleTy(*ctxt)), {arrsize}, "calltmp");
 			llvm::Value *arrsizeval = builder->CreateCast(llvm::Instruction::CastOps::FPToUI, arrsize, llvm::Type::getInt32Ty(*ctxt), "typecasttmp");
+			// The array's length isn't known until now, so unlike other locals it can't be moved into the entry block
 			llvm::Value *arrlocation = builder->CreateAlloca(begin->getType(), arrsizeval, "rangeallocation");
 			llvm::BasicBlock *loopstart = llvm::BasicBlock::Create(*ctxt, "loopstart", currentFunction), *loopend = llvm::BasicBlock::Create(*ctxt, "loopend", currentFunction);
-			llvm::Value *accum = builder->CreateAlloca(llvm::Type::getInt32Ty(*ctxt), NULL, "accumtmp");
+			llvm::Value *accum = createEntryBlockAlloca(llvm::Type::getInt32Ty(*ctxt), NULL, "accumtmp");
 			builder->CreateStore(llvm::ConstantAggregateZero::get(llvm::Type::getInt32Ty(*ctxt)), accum);
 			llvm::Value *brcond = builder->CreateFCmp(llvm::CmpInst::Predicate::FCMP_OEQ, arrsize, llvm::ConstantAggregateZero::get(arrsize->getType()), "cmptmp");
 			builder->CreateCondBr(brcond, loopend, loopstart);
@@ -813,7 +1654,14 @@ namespace jimpilier
 	{
 		spdlog::debug("Creating debug print stmt; other val: {0:x}", (long)other); 
 		llvm::Value *data = val->codegen();
+		for (auto &x : val->throwables)
+			this->throwables.insert(x);
+		if (releaseMode)
+			return data;
 		std::string placeholder = "Debug value (Line " + std::to_string(ln) + "): ";
+		llvm::Value *result = data;
+		if (isStringType(data->getType()))
+			data = createStringData(getStringPointer(data));
 
 		switch (data->getType()->getTypeID())
 		{
@@ -850,26 +1698,237 @@ namespace jimpilier
 			placeholder += "%p\n";
 		}
 		llvm::Constant *globalString = builder->CreateGlobalStringPtr(placeholder);
+		if (!debugPrintFile.empty())
+		{
+			llvm::FunctionCallee fprintfunc = GlobalVarsAndFunctions->getOrInsertFunction("fprintf",
+																						 llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*ctxt), {llvm::Type::getInt8PtrTy(*ctxt), llvm::Type::getInt8PtrTy(*ctxt)}, true));
+			builder->CreateCall(fprintfunc, {getDebugPrintSink(), globalString, data}, "fprintftemp");
+			return result;
+		}
 		// Initialize a function with no body to refrence C std libraries
 		llvm::FunctionCallee printfunc = GlobalVarsAndFunctions->getOrInsertFunction("printf",
 																					 llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*ctxt), llvm::PointerType::get(llvm::Type::getInt8Ty(*ctxt), false), true));
 		builder->CreateCall(printfunc, {globalString, data}, "printftemp");
-		return data;
+		return result;
+	}
+	/**
+	 * @brief Whether an object passed by value goes in as a pointer to a copy (`byval`) rather than in registers.
+	 * Arrays are left as they are, since their bounds checks are proven on the local they're copied into
+	 */
+	bool passedInMemory(llvm::Type *ty)
+	{
+		return returnsInMemory(ty) && !isArrayType(ty) && !isSoaArrayType(ty);
+	}
+	/**
+	 * @brief For functions returning through an `sret` slot, the local each return statement moved out of (NULL if it returned anything else)
+	 */
+	std::map<llvm::Function *, std::set<llvm::Value *>> namedReturns;
+	/**
+	 * @brief Named return value optimization: if every return in a function returns the same local object, that local can live in the
+	 * caller's return slot the whole time instead of being copied there on the way out. Objects with destructors (and arrays) are left alone,
+	 * since the slot has to stay untouched if the function unwinds.
+	 */
+	void elideNamedReturn(llvm::Function *func)
+	{
+		llvm::Argument *slot = getReturnSlot(func);
+		std::set<llvm::Value *> returned = namedReturns[func];
+		namedReturns.erase(func);
+		if (slot == NULL || returned.size() != 1)
+			return;
+		llvm::AllocaInst *local = llvm::dyn_cast_or_null<llvm::AllocaInst>(*returned.begin());
+		if (local == NULL || local->isArrayAllocation() || local->getType() != slot->getType() || getObjectDestructor(local->getAllocatedType()) != NULL ||
+			isArrayType(local->getAllocatedType()) || isSoaArrayType(local->getAllocatedType()))
+			return;
+		spdlog::debug("Constructing {} straight into {}()'s return slot", local->getName().str(), func->getName().str());
+		// The slot outlives the function, so the local's lifetime markers can't come along
+		std::vector<llvm::Instruction *> dead;
+		for (llvm::User *user : local->users())
+			if (llvm::BitCastInst *cast = llvm::dyn_cast<llvm::BitCastInst>(user))
+			{
+				for (llvm::User *castUser : cast->users())
+					if (llvm::IntrinsicInst *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(castUser))
+						if (intrinsic->isLifetimeStartOrEnd())
+							dead.push_back(intrinsic);
+				dead.push_back(cast);
+			}
+		for (llvm::Instruction *inst : dead)
+			if (inst->use_empty())
+				inst->eraseFromParent();
+		local->replaceAllUsesWith(slot);
+		local->eraseFromParent();
+		// What's left of the copies into the slot are copies of the slot into itself
+		dead.clear();
+		for (llvm::User *user : slot->users())
+			if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(user))
+				if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(store->getValueOperand()))
+					if (load->getPointerOperand() == slot && store->getPointerOperand() == slot)
+						dead.push_back(store);
+		for (llvm::Instruction *inst : dead)
+		{
+			llvm::LoadInst *load = (llvm::LoadInst *)((llvm::StoreInst *)inst)->getValueOperand();
+			inst->eraseFromParent();
+			if (load->use_empty())
+				load->eraseFromParent();
+		}
+	}
+	/**
+	 * @brief The value to store somewhere new, given the value of `source`: C strings become string objects, and anything that owns memory
+	 * (strings, arrays & objects holding them) that's still stored somewhere else is copied, so every variable owns its own.
+	 * New values (like the result of `a + b`) are moved in
+	 */
+	llvm::Value *ownValue(ExprAST *source, llvm::Value *val)
+	{
+		if (val->getType() == builder->getInt8PtrTy())
+			return convertToString(val);
+		llvm::Function *copier = getObjectCopier(val->getType());
+		if (copier != NULL && isStoredValue(source) && llvm::isa<llvm::LoadInst>(val))
+			return builder->CreateCall(copier, {((llvm::LoadInst *)val)->getPointerOperand()}, "copytmp");
+		return val;
+	}
+	/**
+	 * @brief Report an error if the value of `source` would have to be copied, but its type can't be (see isCopyable()).
+	 * New values are moved rather than copied, so they're always fine
+	 */
+	bool checkCopyable(ExprAST *source, llvm::Value *val)
+	{
+		if (val == NULL || !isStoredValue(source) || isCopyable(val->getType()))
+			return true;
+		logError("Objects of type " + AliasMgr.getTypeName(val->getType()) + " can't be copied, since both copies would be destroyed; use a reference or pointer to it instead");
+		return false;
+	}
+	/**
+	 * @brief Where a returned value can be moved out of: the local it was loaded from, or NULL if it has to be copied (or is new anyway).
+	 * Values that own memory but are stored anywhere else (members, globals, elements...) are copied into `retval`
+	 */
+	llvm::Value *getMovedReturnValue(ExprAST *source, llvm::Value *&retval)
+	{
+		llvm::Value *moved = llvm::isa_and_nonnull<llvm::LoadInst>(retval) ? ((llvm::LoadInst *)retval)->getPointerOperand() : NULL;
+		if (gatheredElements.count(moved))
+			moved = NULL;
+		if (!llvm::isa_and_nonnull<llvm::AllocaInst>(moved) && !checkCopyable(source, retval))
+			return NULL;
+		if (retval != NULL && getObjectCopier(retval->getType()) != NULL && !llvm::isa_and_nonnull<llvm::AllocaInst>(moved))
+		{
+			retval = ownValue(source, retval);
+			return NULL;
+		}
+		return moved;
+	}
+	/**
+	 * @brief `str += val` for strings: val is appended in place (the buffer only grows when it runs out of room), then destroyed if it was a temporary
+	 *
+	 * @param str - the string* being appended to
+	 * @param source - the expression val came from
+	 */
+	llvm::Value *appendString(llvm::Value *str, ExprAST *source, llvm::Value *val)
+	{
+		if (val->getType() == builder->getInt8PtrTy())
+			val = convertToString(val);
+		if (!isStringType(val->getType()))
+		{
+			logError("Only strings & char*s can be appended to a string, not a(n) " + AliasMgr.getTypeName(val->getType()));
+			return NULL;
+		}
+		llvm::Value *call = builder->CreateCall(getStringFunction("append"), {str, getStringPointer(val)});
+		destroyIfTemporary(source, val);
+		return call;
 	}
 	llvm::Value *RetStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("RetStmtAST; other val: {0:x}", (long)other); 
+		if (parallelBodies.count(currentFunction))
+		{
+			logError("Can't return from inside a parallel for loop; use break to stop it early");
+			return NULL;
+		}
+		if (asyncFunctions.count(currentFunction))
+		{
+			llvm::Value *result = ret == NULL ? NULL : ret->codegen();
+			if (ret != NULL && result == NULL)
+				return NULL;
+			// The result is moved into the promise, so a local being returned isn't destroyed on the way out
+			llvm::Value *moved = ret == NULL ? NULL : getMovedReturnValue(ret.get(), result);
+			emitScopeExitsFrom(0, moved);
+			return createAsyncReturn(result);
+		}
 		if (ret == NULL)
+		{
+			emitScopeExitsFrom(0);
+			return builder->CreateRetVoid();
+		}
+		llvm::Argument *slot = getReturnSlot(currentFunction);
+		if (slot != NULL)
+		{
+			// Constructors & calls build the object right in the slot; anything else is moved into it
+			llvm::Value *retval = ret->codegen(true, slot);
+			// Only locals can be moved out of; anything else that owns memory is copied
+			llvm::Value *moved = getMovedReturnValue(ret.get(), retval);
+			namedReturns[currentFunction].insert(moved);
+			if (retval != NULL)
+				builder->CreateStore(retval, slot);
+			emitScopeExitsFrom(0, moved);
 			return builder->CreateRetVoid();
+		}
 		llvm::Value *retval = ret->codegen();
 		// if (retval->getType() != currentFunction->getReturnType())
 		//{
 		//  builder->CreateCast() //Add type casting here
 		// }
-
+		// Returning a local object by value moves it out, so it's the caller's job to destroy it
+		llvm::Value *moved = retval == NULL ? NULL : getMovedReturnValue(ret.get(), retval);
+		emitScopeExitsFrom(0, moved);
 		return builder->CreateRet(retval);
 	}
 
+	/**
+	 * @brief lhs + rhs (or lhs - rhs): an overloaded operator if there is one, otherwise built-in arithmetic. Also used by `+=`
+	 */
+	llvm::Value *createAddSub(llvm::Value *lhs, llvm::Value *rhs, bool sub)
+	{
+		FunctionHeader op = getOperatorFromVals(lhs, sub ? "-" : "+", rhs);
+		if (op.func != NULL)
+		{
+			std::vector<llvm::Value *> args;
+			args.push_back(lhs);
+			args.push_back(rhs);
+			return makeCallWithReferences(args, op);
+		}
+		if (matchVectorOperands(lhs, rhs))
+		{
+			if (lhs->getType()->isIntOrIntVectorTy())
+				return sub ? builder->CreateSub(lhs, rhs, "subtmp") : builder->CreateAdd(lhs, rhs, "addtmp");
+			return sub ? builder->CreateFSub(lhs, rhs, "subtmp") : builder->CreateFAdd(lhs, rhs, "addtmp");
+		}
+		switch (lhs->getType()->getTypeID())
+		{
+		case llvm::Type::IntegerTyID:
+		{
+			llvm::Value *larger = lhs->getType()->getIntegerBitWidth() >= rhs->getType()->getIntegerBitWidth() ? lhs : rhs;
+			lhs = builder->CreateSExtOrBitCast(lhs, larger->getType(), "signExtendTmp");
+			rhs = builder->CreateSExtOrBitCast(rhs, larger->getType(), "signExtendTmp");
+			return sub ? builder->CreateSub(lhs, rhs, "subtmp") : builder->CreateAdd(lhs, rhs, "addtemp");
+		}
+		case llvm::Type::PointerTyID:
+		{
+			lhs = builder->CreatePtrToInt(lhs, llvm::Type::getInt64Ty(*ctxt), "ptrcasttmp");
+			rhs = builder->CreatePtrToInt(rhs, llvm::Type::getInt64Ty(*ctxt), "ptrcasttmp");
+			return sub ? builder->CreateSub(lhs, rhs, "subtmp") : builder->CreateAdd(lhs, rhs, "addtmp");
+		}
+		case llvm::Type::FloatTyID:
+		case llvm::Type::DoubleTyID:
+		case llvm::Type::HalfTyID:
+		{
+			llvm::Type *larger = DataLayout->getTypeSizeInBits(lhs->getType()).getFixedSize() > DataLayout->getTypeSizeInBits(rhs->getType()).getFixedSize() ? lhs->getType() : rhs->getType();
+			lhs = builder->CreateFPExt(lhs, larger, "floatExtendTmp");
+			rhs = builder->CreateFPExt(rhs, larger, "floatExtendTmp");
+			return sub ? builder->CreateFSub(lhs, rhs, "subtmp") : builder->CreateFAdd(lhs, rhs, "addtmp");
+		}
+		default:
+			std::string s = sub ? "-" : "+";
+			logError("Operator " + s + " never overloaded to support " + AliasMgr.getTypeName(lhs->getType()) + " and " + AliasMgr.getTypeName(rhs->getType()));
+			return NULL;
+		}
+	}
 	llvm::Value *AssignStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("AssignStmtAST; other val: {0:x}", (long)other); 
@@ -877,26 +1936,52 @@ namespace jimpilier
 		lval = lhs->codegen(false);
 		for (auto &x : lhs->throwables)
 			this->throwables.insert(x);
-		rval = rhs->codegen(true, lval);
+		// Globals get their value at compile time: always at the top level, and for const globals even in the static function
+		llvm::GlobalVariable *global = llvm::dyn_cast_or_null<llvm::GlobalVariable>(lval);
+		bool initializing = global != NULL && (currentFunction == NULL || (currentFunction == STATIC && isConstGlobal(global)));
+		GlobalInitializer init;
+		if (initializing)
+			init = beginGlobalInitializer();
+		// Calls only return straight into a variable that's being declared; any other destination could be read by the call while it's being written
+		bool isCall = dynamic_cast<CallExprAST *>(rhs.get()) != NULL || dynamic_cast<ObjectFunctionCallExprAST *>(rhs.get()) != NULL;
+		bool declaring = dynamic_cast<DeclareExprAST *>(lhs.get()) != NULL && llvm::isa_and_nonnull<llvm::AllocaInst>(lval);
+		rval = rhs->codegen(true, add || (isCall && !declaring) ? NULL : lval);
 		for (auto &x : rhs->throwables)
 			this->throwables.insert(x);
 		spdlog::debug("LHS == null?  {0}", lhs == NULL ? "True":"False"); 
 		spdlog::debug("RHS == null?  {0}", rhs == NULL ? "True":"False"); 
+		if (initializing)
+		{
+			if (rval != NULL && isStringType(global->getValueType()) && rval->getType() == builder->getInt8PtrTy())
+				rval = convertToString(rval);
+			if (rval != NULL && rval->getType()->isIntegerTy() && global->getValueType()->isIntegerTy() && rval->getType() != global->getValueType() && rval->getType()->getIntegerBitWidth() > 1)
+				rval = builder->CreateSExtOrTrunc(rval, global->getValueType(), "signExtendTmp");
+			if (rval != NULL && rval->getType() != global->getValueType())
+			{
+				finishGlobalInitializer(init, global, NULL);
+				logError("Error: Global variable " + global->getName().str() + " is not being set to a value of its type");
+				return NULL;
+			}
+			llvm::Constant *value = finishGlobalInitializer(init, global, rval);
+			if (value == NULL)
+			{
+				logError("Error: Global variable " + global->getName().str() + " is not being set to a value that's known at compile time");
+				return NULL;
+			}
+			global->setInitializer(value);
+			return value;
+		}
 		if (lval != NULL && rval != NULL)
 		{
 			if (currentFunction == NULL)
 			{
-				if (!llvm::isa<llvm::GlobalVariable>(lval))
-				{
-					logError("Error: Global variable not found " + lval->getName().str());
-					return NULL;
-				}
-				else if (!llvm::isa<llvm::Constant>(rval) || lval->getType() != rval->getType()->getPointerTo())
-				{
-					logError("Error: Global variable " + lval->getName().str() + " is not being set to a constant value");
-					return NULL;
-				}
-				llvm::dyn_cast<llvm::GlobalVariable>(lval)->setInitializer(llvm::dyn_cast<llvm::Constant>(rval));
+				logError("Error: Global variable not found " + lval->getName().str());
+				return NULL;
+			}
+			else if (isConstGlobal(lval))
+			{
+				logError("Const global variables can't be changed: " + lval->getName().str());
+				return NULL;
 			}
 			else
 			{
@@ -905,7 +1990,42 @@ namespace jimpilier
 				// 	logError("Error when attempting to assign a value: The type of the right side (" + AliasMgr.getTypeName(lval->getType()) + ") does not match the left side (" + AliasMgr.getTypeName(rval->getType()) + ").");
 				// 	return NULL;
 				// }
-				builder->CreateStore(rval, lval);
+				if (!lval->getType()->isPointerTy())
+				{
+					logError("Error: Only variables, object members, array elements and dereferenced pointers can be assigned to");
+					return NULL;
+				}
+				llvm::Type *slotTy = lval->getType()->getNonOpaquePointerElementType();
+				if (add)
+				{
+					if (isStringType(slotTy))
+						return appendString(lval, rhs.get(), rval);
+					if (atomicSlots.count(lval) && slotTy->isIntegerTy() && !slotTy->isIntegerTy(1) && rval->getType()->isIntegerTy())
+					{
+						rval = builder->CreateSExtOrTrunc(rval, slotTy, "signExtendTmp");
+						llvm::Value *oldval = builder->CreateAtomicRMW(llvm::AtomicRMWInst::Add, lval, rval, getAtomicAlign(slotTy), llvm::AtomicOrdering::SequentiallyConsistent);
+						return builder->CreateAdd(oldval, rval, "addtmp");
+					}
+					rval = createAddSub(atomicSlots.count(lval) ? createAtomicLoad(lval) : builder->CreateLoad(slotTy, lval, "loadtmp"), rval, false);
+					if (rval == NULL)
+						return NULL;
+				}
+				else if (!checkCopyable(rhs.get(), rval))
+					return NULL;
+				else if (getObjectCopier(slotTy) != NULL)
+				{
+					// The value that was there is replaced, so whatever it owned is freed (a variable being declared doesn't own anything yet)
+					rval = ownValue(rhs.get(), rval);
+					if (!declaring)
+						builder->CreateCall(getObjectDestructor(slotTy), {lval});
+				}
+				// Store integers of a different size the way C does: sign extended or truncated to fit
+				if (rval->getType()->isIntegerTy() && slotTy->isIntegerTy() && rval->getType() != slotTy && rval->getType()->getIntegerBitWidth() > 1)
+					rval = builder->CreateSExtOrTrunc(rval, slotTy, "signExtendTmp");
+				if (atomicSlots.count(lval))
+					createAtomicStore(rval, lval);
+				else
+					builder->CreateStore(rval, lval);
 			}
 		}
 		return rval;
@@ -924,6 +2044,12 @@ namespace jimpilier
 			args.push_back(rhs);
 			return makeCallWithReferences(args, op);
 		}
+		if (matchVectorOperands(lhs, rhs))
+		{
+			if (lhs->getType()->isIntOrIntVectorTy())
+				return div ? builder->CreateSDiv(lhs, rhs, "divtmp") : builder->CreateMul(lhs, rhs, "multmp");
+			return div ? builder->CreateFDiv(lhs, rhs, "divtmp") : builder->CreateFMul(lhs, rhs, "multmp");
+		}
 		if (lhs->getType()->getTypeID() == rhs->getType()->getTypeID())
 		{
 			switch (lhs->getType()->getTypeID())
@@ -968,50 +2094,95 @@ namespace jimpilier
 		spdlog::debug("AddSubStmtAST; other val: {0:x}", (long)other); 
 		llvm::Value *lhs = LHS->codegen();
 		llvm::Value *rhs = RHS->codegen();
+		llvm::Value *result = createAddSub(lhs, rhs, sub);
+		destroyIfTemporary(LHS.get(), lhs);
+		destroyIfTemporary(RHS.get(), rhs);
+		return result;
+	}
+	/**
+	 * @brief Get (or generate, the first time it's needed) the exponentiation-by-squaring helper for an integer type.
+	 * Negative exponents follow integer division rules: 1^n == 1, (-1)^n == +/-1, and everything else truncates to 0
+	 *
+	 * @param ty - the integer type of both the base and the exponent
+	 * @return llvm::Function* - `ty pow.iN(ty base, ty exponent)`
+	 */
+	llvm::Function *getIntegerPowFunction(llvm::IntegerType *ty)
+	{
+		std::string name = "pow.i" + std::to_string(ty->getBitWidth());
+		llvm::Function *powfunc = GlobalVarsAndFunctions->getFunction(name);
+		if (powfunc != NULL)
+			return powfunc;
+		spdlog::debug("Creating integer power helper: {}", name);
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		powfunc = llvm::Function::Create(llvm::FunctionType::get(ty, {ty, ty}, false), llvm::Function::InternalLinkage, name, GlobalVarsAndFunctions.get());
+		llvm::Value *base = powfunc->getArg(0), *exponent = powfunc->getArg(1);
+		base->setName("base");
+		exponent->setName("exponent");
+		llvm::Constant *zero = llvm::ConstantInt::get(ty, 0), *one = llvm::ConstantInt::get(ty, 1), *negone = llvm::ConstantInt::get(ty, -1, true);
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", powfunc),
+						 *negblock = llvm::BasicBlock::Create(*ctxt, "negativeexp", powfunc),
+						 *loopcond = llvm::BasicBlock::Create(*ctxt, "loopcond", powfunc),
+						 *loopbody = llvm::BasicBlock::Create(*ctxt, "loopbody", powfunc),
+						 *loopend = llvm::BasicBlock::Create(*ctxt, "loopend", powfunc);
+		builder->SetInsertPoint(entry);
+		builder->CreateCondBr(builder->CreateICmpSLT(exponent, zero, "cmptmp"), negblock, loopcond);
+
+		builder->SetInsertPoint(negblock);
+		llvm::Value *isodd = builder->CreateICmpNE(builder->CreateAnd(exponent, one, "andtmp"), zero, "cmptmp");
+		llvm::Value *negresult = builder->CreateSelect(builder->CreateICmpEQ(base, negone, "cmptmp"), builder->CreateSelect(isodd, negone, one), zero);
+		negresult = builder->CreateSelect(builder->CreateICmpEQ(base, one, "cmptmp"), one, negresult);
+		builder->CreateRet(negresult);
+
+		builder->SetInsertPoint(loopcond);
+		llvm::PHINode *result = builder->CreatePHI(ty, 2, "result"), *square = builder->CreatePHI(ty, 2, "square"), *remaining = builder->CreatePHI(ty, 2, "remaining");
+		builder->CreateCondBr(builder->CreateICmpEQ(remaining, zero, "cmptmp"), loopend, loopbody);
+
+		builder->SetInsertPoint(loopbody);
+		isodd = builder->CreateICmpNE(builder->CreateAnd(remaining, one, "andtmp"), zero, "cmptmp");
+		llvm::Value *nextresult = builder->CreateSelect(isodd, builder->CreateMul(result, square, "multmp"), result);
+		llvm::Value *nextsquare = builder->CreateMul(square, square, "multmp");
+		llvm::Value *nextremaining = builder->CreateLShr(remaining, one, "shifttmp");
+		builder->CreateBr(loopcond);
+
+		result->addIncoming(one, entry);
+		result->addIncoming(nextresult, loopbody);
+		square->addIncoming(base, entry);
+		square->addIncoming(nextsquare, loopbody);
+		remaining->addIncoming(exponent, entry);
+		remaining->addIncoming(nextremaining, loopbody);
+
+		builder->SetInsertPoint(loopend);
+		builder->CreateRet(result);
+		llvm::verifyFunction(*powfunc);
+		builder->SetInsertPoint(lastInsertPoint);
+		return powfunc;
+	}
 
-		FunctionHeader op = getOperatorFromVals(lhs, sub ? "-" : "+", rhs);
-		if (op.func != NULL)
-		{
-			std::vector<llvm::Value *> args;
-			args.push_back(lhs);
-			args.push_back(rhs);
-			return makeCallWithReferences(args, op);
-		}
-		switch (lhs->getType()->getTypeID())
-		{
-		case llvm::Type::IntegerTyID:
-		{
-			llvm::Value *larger = lhs->getType()->getIntegerBitWidth() >= rhs->getType()->getIntegerBitWidth() ? lhs : rhs;
-			lhs = builder->CreateSExtOrBitCast(lhs, larger->getType(), "signExtendTmp");
-			rhs = builder->CreateSExtOrBitCast(rhs, larger->getType(), "signExtendTmp");
-			return sub ? builder->CreateSub(lhs, rhs, "subtmp") : builder->CreateAdd(lhs, rhs, "addtemp");
-		}
-		case llvm::Type::PointerTyID:
-		{
-			lhs = builder->CreatePtrToInt(lhs, llvm::Type::getInt64Ty(*ctxt), "ptrcasttmp");
-			rhs = builder->CreatePtrToInt(rhs, llvm::Type::getInt64Ty(*ctxt), "ptrcasttmp");
-			return sub ? builder->CreateSub(lhs, rhs, "subtmp") : builder->CreateAdd(lhs, rhs, "addtmp");
-		}
-		case llvm::Type::FloatTyID:
-		case llvm::Type::DoubleTyID:
-		case llvm::Type::HalfTyID:
-		{
-			llvm::Type *larger = DataLayout->getTypeSizeInBits(lhs->getType()).getFixedSize() > DataLayout->getTypeSizeInBits(rhs->getType()).getFixedSize() ? lhs->getType() : rhs->getType();
-			lhs = builder->CreateFPExt(lhs, larger, "floatExtendTmp");
-			rhs = builder->CreateFPExt(rhs, larger, "floatExtendTmp");
-			return sub ? builder->CreateFSub(lhs, rhs, "subtmp") : builder->CreateFAdd(lhs, rhs, "addtmp");
-		}
-		default:
-			std::string s = sub ? "-" : "+";
-			logError("Operator " + s + " never overloaded to support " + AliasMgr.getTypeName(lhs->getType()) + " and " + AliasMgr.getTypeName(rhs->getType()));
-			return NULL;
-		}
+	/**
+	 * @brief Raises a value to a small, non-negative constant power by emitting the square-and-multiply chain inline (x^5 = x*x*x*x*x, in 3 multiplications)
+	 */
+	llvm::Value *createPowChain(llvm::Value *base, uint64_t exponent)
+	{
+		bool isfloat = base->getType()->isFloatingPointTy();
+		llvm::Value *result = NULL;
+		while (exponent > 0)
+		{
+			if (exponent & 1)
+				result = result == NULL ? base : (isfloat ? builder->CreateFMul(result, base, "powtmp") : builder->CreateMul(result, base, "powtmp"));
+			exponent >>= 1;
+			if (exponent > 0)
+				base = isfloat ? builder->CreateFMul(base, base, "squaretmp") : builder->CreateMul(base, base, "squaretmp");
+		}
+		if (result != NULL)
+			return result;
+		return isfloat ? llvm::ConstantFP::get(base->getType(), 1.0) : llvm::ConstantInt::get(base->getType(), 1);
 	}
+
 	llvm::Value *PowModStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("PowModStmtAST; other val: {0:x}", (long)other); 
-		llvm::Type *longty = llvm::IntegerType::getInt32Ty(*ctxt);
-		llvm::Type *doublety = llvm::Type::getDoubleTy(*ctxt);
+		// Constant exponents up to this size are turned into multiplication chains instead of calls
+		const uint64_t maxInlineExponent = 64;
 		llvm::Value *lhs = LHS->codegen();
 		llvm::Value *rhs = RHS->codegen();
 
@@ -1023,53 +2194,46 @@ namespace jimpilier
 			args.push_back(rhs);
 			return makeCallWithReferences(args, op);
 		}
-		if (!mod && (rhs->getType()->isFloatingPointTy() || rhs->getType()->isIntegerTy()))
+		if (!(rhs->getType()->isFloatingPointTy() || rhs->getType()->isIntegerTy()) || !(lhs->getType()->isFloatingPointTy() || lhs->getType()->isIntegerTy()))
 		{
-			GlobalVarsAndFunctions->getOrInsertFunction("pow",
-														llvm::FunctionType::get(doublety, {doublety, doublety}, false));
+			std::string s = mod ? "%" : "^";
+			logError("Operator " + s + " never overloaded to support " + AliasMgr.getTypeName(lhs->getType()) + " and " + AliasMgr.getTypeName(rhs->getType()));
+			return NULL;
 		}
-		llvm::Function *powfunc = GlobalVarsAndFunctions->getFunction("pow");
 
-		switch (lhs->getType()->getTypeID())
+		if (lhs->getType()->isIntegerTy() && rhs->getType()->isIntegerTy())
 		{
-		case llvm::Type::IntegerTyID:
-			// TODO: Create type alignment system
+			llvm::Value *larger = lhs->getType()->getIntegerBitWidth() >= rhs->getType()->getIntegerBitWidth() ? lhs : rhs;
+			lhs = builder->CreateSExtOrBitCast(lhs, larger->getType(), "signExtendTmp");
+			rhs = builder->CreateSExtOrBitCast(rhs, larger->getType(), "signExtendTmp");
 			if (mod)
 				return builder->CreateSRem(lhs, rhs, "modtmp");
-			lhs = builder->CreateCast(llvm::Instruction::CastOps::SIToFP, lhs, llvm::Type::getDoubleTy(*ctxt), "floatConversionTmp");
-			if (rhs->getType()->isIntegerTy())
-			{
-				rhs = builder->CreateCast(llvm::Instruction::CastOps::SIToFP, rhs, llvm::Type::getDoubleTy(*ctxt), "floatConversionTmp");
-			}
-		case llvm::Type::FloatTyID:
-		case llvm::Type::DoubleTyID:
-		case llvm::Type::HalfTyID:
+			llvm::ConstantInt *constexp = llvm::dyn_cast<llvm::ConstantInt>(rhs);
+			if (constexp != NULL && !constexp->isNegative() && constexp->getZExtValue() <= maxInlineExponent)
+				return createPowChain(lhs, constexp->getZExtValue());
+			return builder->CreateCall(getIntegerPowFunction((llvm::IntegerType *)lhs->getType()), {lhs, rhs}, "powtmp");
+		}
+
+		// At least one side is a float from here on; work in the wider of the two float types
+		llvm::Type *floatty = lhs->getType()->isFloatingPointTy() ? lhs->getType() : rhs->getType();
+		if (rhs->getType()->isFloatingPointTy() && DataLayout->getTypeSizeInBits(rhs->getType()).getFixedSize() > DataLayout->getTypeSizeInBits(floatty).getFixedSize())
+			floatty = rhs->getType();
+		lhs = lhs->getType()->isIntegerTy() ? builder->CreateSIToFP(lhs, floatty, "floatConversionTmp") : builder->CreateFPExt(lhs, floatty, "floatExtendTmp");
+		if (mod)
 		{
-			if (!lhs->getType()->isDoubleTy())
-			{
-				lhs = builder->CreateFPExt(lhs, doublety, "floatExtendTmp");
-			}
-			if (!(rhs->getType()->isFloatingPointTy() || rhs->getType()->isIntegerTy()))
-			{
-				logError("Error when attempting to raise a number to a power: the right-hand-side is not an integer or float");
-				return NULL;
-			}
-			if (rhs->getType()->isIntegerTy())
-			{
-				int bitWidth = rhs->getType()->getIntegerBitWidth();
-				rhs = bitWidth != 32 ? builder->CreateSExtOrTrunc(rhs, longty, "IntBitWidthModifierTmp") : rhs;
-			}
-			else if (rhs->getType()->getTypeID() != llvm::Type::DoubleTyID)
-			{
-				rhs = builder->CreateFPExt(rhs, doublety, "floatExtendTmp");
-			}
-			return mod ? builder->CreateFRem(lhs, rhs) : builder->CreateCall(powfunc, {lhs, rhs}, "powtmp");
+			rhs = rhs->getType()->isIntegerTy() ? builder->CreateSIToFP(rhs, floatty, "floatConversionTmp") : builder->CreateFPExt(rhs, floatty, "floatExtendTmp");
+			return builder->CreateFRem(lhs, rhs, "modtmp");
 		}
-		default:
-			std::string s = mod ? "%" : "^";
-			logError("Operator " + s + " never overloaded to support " + AliasMgr.getTypeName(lhs->getType()) + " and " + AliasMgr.getTypeName(rhs->getType()));
-			return NULL;
+		if (rhs->getType()->isIntegerTy())
+		{
+			llvm::ConstantInt *constexp = llvm::dyn_cast<llvm::ConstantInt>(rhs);
+			if (constexp != NULL && !constexp->isNegative() && constexp->getZExtValue() <= maxInlineExponent)
+				return createPowChain(lhs, constexp->getZExtValue());
+			rhs = builder->CreateSExtOrTrunc(rhs, builder->getInt32Ty(), "IntBitWidthModifierTmp");
+			return builder->CreateIntrinsic(llvm::Intrinsic::powi, {floatty, builder->getInt32Ty()}, {lhs, rhs}, NULL, "powtmp");
 		}
+		rhs = builder->CreateFPExt(rhs, floatty, "floatExtendTmp");
+		return builder->CreateBinaryIntrinsic(llvm::Intrinsic::pow, lhs, rhs, NULL, "powtmp");
 	}
 	llvm::Value *BinaryStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
@@ -1138,121 +2302,216 @@ namespace jimpilier
 			return NULL;
 		}
 	}
+	/**
+	 * @brief The layout of an `_error@` type info: a C++ `__class_type_info` (vtable & name, so the unwinder can use it as-is),
+	 * followed by the type's ID, which is what try blocks switch on to pick a catch
+	 */
+	llvm::StructType *getErrorTypeInfoType()
+	{
+		return llvm::StructType::get(builder->getInt8PtrTy(), builder->getInt8PtrTy(), builder->getInt32Ty());
+	}
+	/**
+	 * @brief Gets the `_error@` type info for a thrown type, creating it the first time the type is thrown or caught
+	 */
+	llvm::Value *getErrorTypeInfo(llvm::Type *ty)
+	{
+		if (classInfoVals[ty] != NULL)
+			return classInfoVals[ty];
+		std::string typeName = AliasMgr.getTypeName(ty, false);
+		spdlog::debug("Creating type info for error type: {}", AliasMgr.getTypeName(ty, true));
+		llvm::Constant *classinfo = GlobalVarsAndFunctions->getOrInsertGlobal("_ZTVN10__cxxabiv117__class_type_infoE", builder->getInt8PtrTy());
+		classinfo = llvm::ConstantExpr::getBitCast(llvm::ConstantExpr::getInBoundsGetElementPtr(builder->getInt8PtrTy(), classinfo, builder->getInt64(2)), builder->getInt8PtrTy());
+		llvm::Constant *typeNameStr = builder->CreateGlobalStringPtr(typeName, typeName, 0, GlobalVarsAndFunctions.get());
+		int id = errorTypeIDs.size();
+		errorTypeIDs[ty] = id;
+		llvm::GlobalVariable *typeinfo = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal("_error@" + typeName, getErrorTypeInfoType());
+		typeinfo->setConstant(true);
+		typeinfo->setInitializer(llvm::ConstantStruct::get(getErrorTypeInfoType(), classinfo, typeNameStr, builder->getInt32(id)));
+		classInfoVals[ty] = typeinfo;
+		return typeinfo;
+	}
+	llvm::ConstantInt *getErrorTypeID(llvm::Type *ty)
+	{
+		getErrorTypeInfo(ty);
+		return builder->getInt32(errorTypeIDs[ty]);
+	}
+	/**
+	 * @brief Throw an error in error code mode: copy the thrown value to the heap, fill in the error slot,
+	 * then jump to the enclosing try block's handler, or return with the error pending if there isn't one
+	 */
+	llvm::Value *createErrorCodeThrow(llvm::Value *ballval, llvm::Value *typeinfo)
+	{
+		llvm::Value *payload = createHeapAllocation(AliasMgr.getTypeSize(ballval->getType(), ctxt, DataLayout));
+		builder->CreateStore(ballval, builder->CreateBitCast(payload, ballval->getType()->getPointerTo(), "bitcasttmp"));
+		builder->CreateStore(payload, getErrorPayloadSlot());
+		builder->CreateStore(builder->CreateBitCast(typeinfo, builder->getInt8PtrTy()), getErrorTagSlot());
+		llvm::Value *ret;
+		if (currentUnwindBlock != NULL)
+			ret = builder->CreateBr(currentUnwindBlock);
+		else
+		{
+			emitErrorReturn();
+			ret = &builder->GetInsertBlock()->back();
+		}
+		// Anything after the throw is unreachable, but still needs somewhere to go
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "afterthrow", currentFunction));
+		return ret;
+	}
+	/**
+	 * @brief The block a try block's handler goes to in error code mode when none of its catches match the error:
+	 * the error is put back and passed on to the next try block out, or to our caller. If neither can take it, it's dropped
+	 */
+	llvm::BasicBlock *createUncaughtErrorBlock(llvm::Value *tag, llvm::Value *payload, llvm::BasicBlock *outerHandler, llvm::BasicBlock *tryEnd)
+	{
+		llvm::BasicBlock *lastBlock = builder->GetInsertBlock();
+		llvm::BasicBlock *uncaught = llvm::BasicBlock::Create(*ctxt, "uncaughterror", currentFunction, tryEnd);
+		builder->SetInsertPoint(uncaught);
+		if (outerHandler != NULL || throwingFunctions.count(currentFunction))
+		{
+			builder->CreateStore(tag, getErrorTagSlot());
+			if (outerHandler != NULL)
+				builder->CreateBr(outerHandler);
+			else
+				emitErrorReturn();
+		}
+		else
+		{
+			builder->CreateCall(getHeapFreeFunction(), {payload});
+			builder->CreateBr(tryEnd);
+		}
+		builder->SetInsertPoint(lastBlock);
+		return uncaught;
+	}
 	llvm::Value *TryStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("TryStmtAST; other val: {0:x}", (long)other); 
-		llvm::FunctionCallee typeidfor = GlobalVarsAndFunctions->getOrInsertFunction("llvm.eh.typeid.for", llvm::FunctionType::get(llvm::Type::getInt32Ty(*ctxt), {llvm::Type::getInt8PtrTy(*ctxt)}, false));
+		llvm::FunctionCallee current_exception_type = GlobalVarsAndFunctions->getOrInsertFunction("__cxa_current_exception_type", llvm::FunctionType::get(llvm::Type::getInt8PtrTy(*ctxt), false));
 		llvm::FunctionCallee personalityfunc = GlobalVarsAndFunctions->getOrInsertFunction("__gxx_personality_v0", llvm::FunctionType::get(llvm::Type::getInt32Ty(*ctxt), {llvm::Type::getInt8PtrTy(*ctxt)}, false));
 		llvm::FunctionCallee begin_catch = GlobalVarsAndFunctions->getOrInsertFunction("__cxa_begin_catch", llvm::FunctionType::get(llvm::Type::getInt8PtrTy(*ctxt), {llvm::Type::getInt8PtrTy(*ctxt)}, false));
 		llvm::FunctionCallee end_catch = GlobalVarsAndFunctions->getOrInsertFunction("__cxa_end_catch", llvm::FunctionType::get(llvm::Type::getVoidTy(*ctxt), false));
-		currentFunction->setPersonalityFn((llvm::Constant *)personalityfunc.getCallee());
-		std::vector<llvm::BasicBlock *> catchBlocks;
+		if (!errorCodeMode)
+			currentFunction->setPersonalityFn((llvm::Constant *)personalityfunc.getCallee());
 		llvm::BasicBlock *tryBlock = llvm::BasicBlock::Create(*ctxt, "tryentry", currentFunction), *tryEnd = llvm::BasicBlock::Create(*ctxt, "tryend", currentFunction);
 		llvm::BasicBlock *landingpad = llvm::BasicBlock::Create(*ctxt, "landingpad", currentFunction, tryEnd), *oldLP = currentUnwindBlock;
 		builder->CreateBr(tryBlock);
 		builder->SetInsertPoint(tryBlock);
 		currentUnwindBlock = landingpad;
+		tryCleanups.push_back({});
 		llvm::Value *ballval = body->codegen();
+		std::vector<ScopedLocal> cleanups = std::move(tryCleanups.back());
+		tryCleanups.pop_back();
 		currentUnwindBlock = oldLP; 
 		builder->CreateBr(tryEnd);
+		// Nothing declared in the try block is alive yet when we enter it (this matters in loops)
+		llvm::IRBuilder<> tryEntryBuilder(tryBlock, tryBlock->begin());
+		for (auto &obj : cleanups)
+			tryEntryBuilder.CreateStore(builder->getFalse(), obj.liveFlag);
 		builder->SetInsertPoint(landingpad);
 
 		llvm::Type *errorMetadata = llvm::StructType::get(*ctxt, {llvm::Type::getInt8PtrTy(*ctxt), llvm::Type::getInt32Ty(*ctxt)});
-		llvm::LandingPadInst *lpval = builder->CreateLandingPad(errorMetadata, 1, "catchBlockLP");
-		llvm::Value *extractedval = builder->CreateExtractValue(lpval, {0u}, "extractedval"),
-					*extractedint = builder->CreateExtractValue(lpval, {1u}, "typeIDcode");
-		llvm::BasicBlock *catchCheckBlock = llvm::BasicBlock::Create(*ctxt, "catchcheck", currentFunction, tryEnd);
-		builder->CreateBr(catchCheckBlock);
-		llvm::BasicBlock *nextblock = tryEnd;
-		llvm::StructType *errorMetadataType = llvm::StructType::get(llvm::Type::getInt8PtrTy(*ctxt), llvm::Type::getInt8PtrTy(*ctxt));
-
-		if (!catchStmts.empty())
+		llvm::LandingPadInst *lpval = NULL;
+		llvm::Value *extractedval, *extractedint;
+		if (errorCodeMode)
 		{
-			for (auto x = catchStmts.rbegin(); x != catchStmts.rend(); ++x)
-			{
-				assert(x->first != NULL && x->first->codegen() != NULL && "Unable to generate class for object");
-
-				if (classInfoVals[x->first->codegen()] == NULL)
-				{
-					std::string thrownerrorname = "_error@" + AliasMgr.getTypeName(x->first->codegen(), false);
-					llvm::GlobalVariable *thrownerror = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal(thrownerrorname, errorMetadataType);
-					classInfoVals[x->first->codegen()] = thrownerror;
-					llvm::Value *classinfo = GlobalVarsAndFunctions->getOrInsertGlobal("_ZTVN10__cxxabiv117__class_type_infoE", llvm::Type::getInt8PtrTy(*ctxt));
-					classinfo = builder->CreateGEP(llvm::Type::getInt8PtrTy(*ctxt), classinfo, llvm::ConstantInt::get(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, 2)));
-					classinfo = builder->CreateBitCast(classinfo, llvm::Type::getInt8PtrTy(*ctxt));
-					thrownerror->setInitializer(llvm::ConstantStruct::get(errorMetadataType, (llvm::Constant *)classinfo, builder->CreateGlobalStringPtr(AliasMgr.getTypeName(x->first->codegen(), false), AliasMgr.getTypeName(x->first->codegen(), false))));
-					// logError(classinfo == NULL ? "true" : "false");
-				}
-
-				assert(classInfoVals[x->first->codegen()] != NULL && "Unable to find class info for object; make sure your code throws an instance of each type it tries to catch. This error happens whenever you try to catch an error that cannot be thrown at this point in the code");
-				lpval->addClause((llvm::Constant *)builder->CreateBitCast(classInfoVals[x->first->codegen()], llvm::Type::getInt8PtrTy(*ctxt)));
-				if (nextblock != tryEnd)
-					catchCheckBlock = llvm::BasicBlock::Create(*ctxt, "catchcheck", currentFunction, tryEnd);
-				llvm::BasicBlock *catchBlock = llvm::BasicBlock::Create(*ctxt, "catchblock", currentFunction, tryEnd);
-				builder->SetInsertPoint(catchCheckBlock);
-				llvm::Value *objTypeID = builder->CreateCall(typeidfor, {builder->CreateBitCast(classInfoVals[x->first->codegen()], llvm::Type::getInt8PtrTy(*ctxt))}, "getTypeID");
-				llvm::Value *condition = builder->CreateICmpEQ(extractedint, objTypeID, "cmptmp");
-				builder->CreateCondBr(condition, catchBlock, nextblock);
-				nextblock = catchCheckBlock;
-
-				builder->SetInsertPoint(catchBlock);
-				AliasMgr[x->second.second] = {(llvm::Value *)builder->CreateBitCast(builder->CreateCall(begin_catch, {extractedval}, "catchtmp"), x->first->codegen()->getPointerTo(), "errorptr"), false};
-				llvm::Value *caughtError = AliasMgr[x->second.second].val; 
-				FunctionHeader fh = getOperatorFromTypes(NULL, "CATCH", x->first->codegen());
-				if (fh.func != NULL)
-				{
-					std::vector<llvm::Value *> args;
-					args.push_back(caughtError);
-					makeCallWithReferences(args, fh);
-				}
-				x->second.first->codegen();
-				builder->CreateCall(end_catch, {});
-				builder->CreateBr(tryEnd);
-				AliasMgr[x->second.second] = {NULL, false};
-				catchBlocks.push_back(catchBlock);
-			}
+			// No unwinding here: failed calls & throws branch to this block with the error waiting in the error slot.
+			// extractedval is the thrown object, extractedint the tag of its type
+			extractedval = builder->CreateLoad(builder->getInt8PtrTy(), getErrorPayloadSlot(), "errorpayload");
+			extractedint = builder->CreateLoad(builder->getInt8PtrTy(), getErrorTagSlot(), "errortag");
+			// Clear the error right away so the catch blocks can throw again
+			builder->CreateStore(llvm::Constant::getNullValue(builder->getInt8PtrTy()), getErrorTagSlot());
 		}
 		else
 		{
+			lpval = builder->CreateLandingPad(errorMetadata, 1, "catchBlockLP");
+			extractedval = builder->CreateExtractValue(lpval, {0u}, "extractedval");
+			extractedint = builder->CreateExtractValue(lpval, {1u}, "typeIDcode");
+		}
+		// Destroy whatever was still alive in the try block when the error was thrown, newest first
+		for (auto obj = cleanups.rbegin(); obj != cleanups.rend(); obj++)
+		{
+			llvm::BasicBlock *destroy = llvm::BasicBlock::Create(*ctxt, "unwinddestroy", currentFunction, tryEnd), *next = llvm::BasicBlock::Create(*ctxt, "unwindnext", currentFunction, tryEnd);
+			builder->CreateCondBr(builder->CreateLoad(builder->getInt1Ty(), obj->liveFlag, "alive"), destroy, next);
+			builder->SetInsertPoint(destroy);
+			builder->CreateCall(obj->destructor, {obj->slot});
+			builder->CreateStore(builder->getFalse(), obj->liveFlag);
+			builder->CreateBr(next);
+			builder->SetInsertPoint(next);
+		}
+		// Every type this try block catches, and the catch clause that handles it (NULL for implicit catches, which only call `operator catch`)
+		std::vector<std::pair<llvm::Type *, std::pair<std::unique_ptr<ExprAST>, std::string> *>> handlers;
+		if (!catchStmts.empty())
+			for (auto &x : catchStmts)
+			{
+				assert(x.first != NULL && x.first->codegen() != NULL && "Unable to generate class for object");
+				handlers.push_back({x.first->codegen(), &x.second});
+			}
+		else
 			for (auto &x : body->throwables)
 			{
 				assert(x != NULL && "Unable to generate class for object");
-				// TODO: Remove this assertion, generate the error metadata here instead
+				handlers.push_back({x, NULL});
+			}
+		if (lpval != NULL)
+		{
+			for (auto &handler : handlers)
+				lpval->addClause(llvm::ConstantExpr::getBitCast((llvm::Constant *)getErrorTypeInfo(handler.first), builder->getInt8PtrTy()));
+			// Nothing to catch; just run the cleanups above and keep unwinding
+			if (handlers.empty())
+			{
+				lpval->setCleanup(true);
+				builder->CreateResume(lpval);
+				builder->SetInsertPoint(tryEnd);
+				return tryBlock;
+			}
+		}
 
-				if (classInfoVals[x] == NULL)
-				{
-					std::string thrownerrorname = "_error@" + AliasMgr.getTypeName(x, false);
-					llvm::GlobalVariable *thrownerror = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal(thrownerrorname, errorMetadataType);
-					llvm::Value *classinfo = GlobalVarsAndFunctions->getOrInsertGlobal("_ZTVN10__cxxabiv117__class_type_infoE", llvm::Type::getInt8PtrTy(*ctxt));
-					classinfo = builder->CreateGEP(llvm::Type::getInt8PtrTy(*ctxt), classinfo, llvm::ConstantInt::get(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, 2)));
-					classinfo = builder->CreateBitCast(classinfo, llvm::Type::getInt8PtrTy(*ctxt));
-					thrownerror->setInitializer(llvm::ConstantStruct::get(errorMetadataType, (llvm::Constant *)classinfo, builder->CreateGlobalStringPtr(AliasMgr.getTypeName(x, false))));
-					classInfoVals[x] = thrownerror;
-				}
+		// One switch over the thrown type's ID picks the catch, however many there are.
+		// The unwinder only lands here for types listed above, so the error is always caught by the time we get the type
+		llvm::Value *caught = errorCodeMode ? extractedval : builder->CreateCall(begin_catch, {extractedval}, "catchtmp");
+		llvm::Value *typeinfo = errorCodeMode ? extractedint : builder->CreateCall(current_exception_type, {}, "errortype");
+		llvm::Value *typeID = builder->CreateLoad(builder->getInt32Ty(), builder->CreateStructGEP(getErrorTypeInfoType(), builder->CreateBitCast(typeinfo, getErrorTypeInfoType()->getPointerTo(), "typeinfo"), 2, "typeidptr"), "typeid");
+		llvm::BasicBlock *uncaught;
+		if (errorCodeMode)
+			uncaught = createUncaughtErrorBlock(extractedint, extractedval, oldLP, tryEnd);
+		else
+		{
+			uncaught = llvm::BasicBlock::Create(*ctxt, "uncaughterror", currentFunction, tryEnd);
+			llvm::IRBuilder<> uncaughtBuilder(uncaught);
+			uncaughtBuilder.CreateCall(end_catch, {});
+			uncaughtBuilder.CreateBr(tryEnd);
+		}
+		llvm::SwitchInst *dispatch = builder->CreateSwitch(typeID, uncaught, handlers.size());
 
-				lpval->addClause((llvm::Constant *)builder->CreateBitCast(classInfoVals[x], llvm::Type::getInt8PtrTy(*ctxt)));
-				if (nextblock != tryEnd)
-					catchCheckBlock = llvm::BasicBlock::Create(*ctxt, "catchcheck", currentFunction, tryEnd);
-				llvm::BasicBlock *catchBlock = llvm::BasicBlock::Create(*ctxt, "catchblock", currentFunction, tryEnd);
-				builder->SetInsertPoint(catchCheckBlock);
-				llvm::Value *objTypeID = builder->CreateCall(typeidfor, {builder->CreateBitCast(classInfoVals[x], llvm::Type::getInt8PtrTy(*ctxt))}, "getTypeID");
-				llvm::Value *condition = builder->CreateICmpEQ(extractedint, objTypeID, "cmptmp");
-				builder->CreateCondBr(condition, catchBlock, nextblock);
-				nextblock = catchCheckBlock;
-
-				builder->SetInsertPoint(catchBlock);
-				llvm::Value *errorval = builder->CreateCall(begin_catch, {extractedval}, "error");
-				FunctionHeader fh = getOperatorFromTypes(NULL, "CATCH", x);
-				if (fh.func != NULL)
-				{
-					std::vector<llvm::Value *> args;
-					args.push_back(builder->CreateBitCast(errorval, x->getPointerTo()));
-					makeCallWithReferences(args, fh);
-				}
-				builder->CreateCall(end_catch);
-				builder->CreateBr(tryEnd);
-				catchBlocks.push_back(catchBlock);
+		for (auto &handler : handlers)
+		{
+			llvm::Type *errorTy = handler.first;
+			std::pair<std::unique_ptr<ExprAST>, std::string> *clause = handler.second;
+			llvm::ConstantInt *caseID = getErrorTypeID(errorTy);
+			// If two catches take the same type, the first one wins
+			if (dispatch->findCaseValue(caseID) != dispatch->case_default())
+				continue;
+			llvm::BasicBlock *catchBlock = llvm::BasicBlock::Create(*ctxt, "catchblock", currentFunction, tryEnd);
+			dispatch->addCase(caseID, catchBlock);
+			builder->SetInsertPoint(catchBlock);
+			llvm::Value *caughtError = builder->CreateBitCast(caught, errorTy->getPointerTo(), "errorptr");
+			if (clause != NULL)
+				AliasMgr[clause->second] = {caughtError, false};
+			FunctionHeader fh = getOperatorFromTypes(NULL, "CATCH", errorTy);
+			if (fh.func != NULL)
+			{
+				std::vector<llvm::Value *> args;
+				args.push_back(caughtError);
+				makeCallWithReferences(args, fh);
 			}
+			if (clause != NULL)
+				clause->first->codegen();
+			if (errorCodeMode)
+				builder->CreateCall(getHeapFreeFunction(), {extractedval});
+			else
+				builder->CreateCall(end_catch, {});
+			builder->CreateBr(tryEnd);
+			if (clause != NULL)
+				AliasMgr[clause->second] = {NULL, false};
 		}
 		builder->SetInsertPoint(tryEnd);
 		currentUnwindBlock = oldLP;
@@ -1264,100 +2523,100 @@ namespace jimpilier
 		spdlog::debug("ThrowStmtAST; other val: {0:x}", (long)other); 
 		GlobalVarsAndFunctions->getOrInsertFunction("__cxa_allocate_exception", llvm::FunctionType::get(llvm::Type::getInt8PtrTy(*ctxt), {llvm::Type::getInt64Ty(*ctxt)}, false));
 		GlobalVarsAndFunctions->getOrInsertFunction("__cxa_throw", llvm::FunctionType::get(llvm::Type::getVoidTy(*ctxt), {llvm::Type::getInt8PtrTy(*ctxt), llvm::Type::getInt8PtrTy(*ctxt), llvm::Type::getInt8PtrTy(*ctxt)}, false));
-		llvm::StructType *errorMetadataType = llvm::StructType::get(llvm::Type::getInt8PtrTy(*ctxt), llvm::Type::getInt8PtrTy(*ctxt));
+		if (!canThrowFromHere())
+			return NULL;
 		llvm::Value *ballval = ball->codegen();
 		this->throwables.insert(ballval->getType());
 		assert(ballval != NULL && "Fatal error when trying to throw an error: Object provided failed to return a useful value");
-		llvm::Value *classinfo = GlobalVarsAndFunctions->getOrInsertGlobal("_ZTVN10__cxxabiv117__class_type_infoE", llvm::Type::getInt8PtrTy(*ctxt));
-		assert(classinfo != NULL && "Fatal error trying to generate throw statement");
+		llvm::Value *typeinfo = builder->CreateBitCast(getErrorTypeInfo(ballval->getType()), llvm::Type::getInt8PtrTy(*ctxt));
+		// With error codes, a throw is just a store & a jump to the try block's handler (or a return, if nothing here catches it).
+		// Throws that nothing catches and that the function doesn't declare still go through the unwinder, same as without error codes
+		if (errorCodeMode && (currentUnwindBlock != NULL || throwingFunctions.count(currentFunction)))
+			return createErrorCodeThrow(ballval, typeinfo);
 		llvm::Value *error = builder->CreateCall(GlobalVarsAndFunctions->getFunction("__cxa_allocate_exception"), {AliasMgr.getTypeSize(ballval->getType(), ctxt, DataLayout)}, "errorAllocatmp");
 		llvm::Value *error2 = builder->CreateBitCast(error, ballval->getType()->getPointerTo(), "bitcasttmp");
 		builder->CreateStore(ballval, error2);
 		assert(error != NULL && "Fatal error creating space for the error you're trying to throw");
-		llvm::Constant *typeStringVal = NULL;
-		if (classInfoVals[ballval->getType()] == NULL)
-		{
-			typeStringVal = builder->CreateGlobalStringPtr(AliasMgr.getTypeName(ballval->getType(), false), AliasMgr.getTypeName(ballval->getType(), false));
-		}
-		else
-			typeStringVal = GlobalVarsAndFunctions->getGlobalVariable(AliasMgr.getTypeName(ballval->getType(), false), true);
-		assert(typeStringVal != NULL && "Fatal error trying to generate throw statement");
-		std::string thrownerrorname = "_error@" + AliasMgr.getTypeName(ballval->getType(), false);
-		if (classInfoVals[ballval->getType()] == NULL)
-		{
-			llvm::GlobalVariable *thrownerror = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal(thrownerrorname, errorMetadataType);
-			spdlog::debug("Typename of the thrown object: {}", AliasMgr.getTypeName(ballval->getType(), true));
-			classInfoVals[ballval->getType()] = thrownerror;
-			assert(thrownerror != NULL && "Fatal error trying to generate throw statement");
-			// initialize the globals:
-			classinfo = builder->CreateGEP(llvm::Type::getInt8PtrTy(*ctxt), classinfo, llvm::ConstantInt::get(llvm::Type::getInt64Ty(*ctxt), llvm::APInt(64, 2)));
-			classinfo = builder->CreateBitCast(classinfo, llvm::Type::getInt8PtrTy(*ctxt));
-			thrownerror->setInitializer(llvm::ConstantStruct::get(errorMetadataType, (llvm::Constant *)classinfo, typeStringVal));
-			// builder->CreateStore(ballval, error, "storetmp");
-		}
 		llvm::Value *deleter = getOperatorFromVals(NULL, "DELETE", ballval).func;
 		// assert(deleter ! && "Fatal error: You tried to throw an object that has no deletion operator");
 		if (currentUnwindBlock != NULL)
 		{
 			llvm::BasicBlock *continueblock = llvm::BasicBlock::Create(*ctxt, "normalExecblock", currentFunction);
 			llvm::Value *ret = builder->CreateInvoke(GlobalVarsAndFunctions->getFunction("__cxa_throw"), continueblock,
-													 currentUnwindBlock, {error, builder->CreateBitCast(classInfoVals[ballval->getType()], llvm::Type::getInt8PtrTy(*ctxt)), deleter == NULL ? llvm::ConstantAggregateZero::get(llvm::Type::getInt8PtrTy(*ctxt)) : builder->CreateBitCast(deleter, llvm::Type::getInt8PtrTy(*ctxt))});
+													 currentUnwindBlock, {error, typeinfo, deleter == NULL ? llvm::ConstantAggregateZero::get(llvm::Type::getInt8PtrTy(*ctxt)) : builder->CreateBitCast(deleter, llvm::Type::getInt8PtrTy(*ctxt))});
 			builder->SetInsertPoint(continueblock);
 			return ret;
 		}
 		return builder->CreateCall(GlobalVarsAndFunctions->getFunction("__cxa_throw"),
 								   {error,
-									builder->CreateBitCast(classInfoVals[ballval->getType()], llvm::Type::getInt8PtrTy(*ctxt)),
+									typeinfo,
 									deleter == NULL ? llvm::ConstantAggregateZero::get(llvm::Type::getInt8PtrTy(*ctxt)) : builder->CreateBitCast(deleter, llvm::Type::getInt8PtrTy(*ctxt))});
 	}
+	/**
+	 * @brief Get the printf placeholder for a value, widening it first if printf needs it wider (floats are passed as doubles)
+	 */
+	std::string getPrintPlaceholder(llvm::Value *&data)
+	{
+		switch (data->getType()->getTypeID())
+		{
+		case (llvm::PointerType::PointerTyID):
+			if (data->getType() == llvm::Type::getInt8PtrTy(*ctxt))
+				return "%s";
+			return "%p";
+		case (llvm::Type::TypeID::FloatTyID):
+			data = builder->CreateCast(llvm::Instruction::CastOps::FPExt, data, llvm::Type::getDoubleTy(*ctxt));
+		case (llvm::Type::DoubleTyID):
+			return "%f";
+		case (llvm::Type::TypeID::IntegerTyID):
+			if (data->getType()->getIntegerBitWidth() == 64)
+				return "%p";
+			else if (data->getType()->getIntegerBitWidth() == 16)
+				return "%hu";
+			else if (data->getType() == llvm::Type::getInt8Ty(*ctxt))
+				return "%c";
+			else if (data->getType()->getIntegerBitWidth() == 1)
+			{
+				data = builder->CreateZExt(data, builder->getInt32Ty(), "zexttmp");
+				return "%d";
+			}
+			return "%d";
+		default:
+			return "%p";
+		}
+	}
 	llvm::Value *PrintStmtAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("PrintStmtAST; other val: {0:x}", (long)other); 
 		// Initialize values for the arguments and the types for the arguments
 		std::vector<llvm::Value *> vals;
+		std::vector<std::pair<ExprAST *, llvm::Value *>> strings;
 		std::string placeholder = "";
 		for (auto &x : Contents)
 		{
 			llvm::Value *data = x->codegen();
-
-			switch (data->getType()->getTypeID())
+			if (data == NULL)
+				continue;
+			// Strings print their characters. Temporary ones (like the result of `a + b`) are destroyed once they've been printed
+			if (isStringType(data->getType()))
 			{
-			case (llvm::PointerType::PointerTyID):
-				if (data->getType() == llvm::Type::getInt8PtrTy(*ctxt))
-					placeholder += "%s ";
-				else
-					placeholder += "%p ";
-				break;
-			case (llvm::Type::TypeID::FloatTyID):
-				data = builder->CreateCast(llvm::Instruction::CastOps::FPExt, data, llvm::Type::getDoubleTy(*ctxt));
-			case (llvm::Type::DoubleTyID):
-				placeholder += "%f ";
-				break;
-			case (llvm::Type::TypeID::IntegerTyID):
-				if (data->getType()->getIntegerBitWidth() == 64)
-				{
-					placeholder += "%p ";
-				}
-				else if (data->getType()->getIntegerBitWidth() == 16)
-				{
-					placeholder += "%hu ";
-				}
-				else if (data->getType() == llvm::Type::getInt8Ty(*ctxt))
-				{
-					placeholder += "%c ";
-				}
-				else
-				{
-					placeholder += "%d ";
-				}
-				break;
-			default:
-				placeholder += "%p ";
+				strings.push_back({x.get(), data});
+				data = createStringData(getStringPointer(data));
 			}
-			if (data != NULL)
+			// Vectors print every element: <1.000000, 2.000000>
+			if (llvm::FixedVectorType *vecTy = llvm::dyn_cast<llvm::FixedVectorType>(data->getType()))
 			{
-				vals.push_back(data);
+				placeholder += '<';
+				for (unsigned i = 0; i < vecTy->getNumElements(); i++)
+				{
+					llvm::Value *element = builder->CreateExtractElement(data, builder->getInt32(i), "elementtmp");
+					placeholder += (i == 0 ? "" : ", ") + getPrintPlaceholder(element);
+					vals.push_back(element);
+				}
+				placeholder += "> ";
+				continue;
 			}
+			placeholder += getPrintPlaceholder(data) + ' ';
+			vals.push_back(data);
 		}
 		// Create global string constant(s) for newline characters and the placeholder constant where needed.
 		if (isLine)
@@ -1367,26 +2626,51 @@ namespace jimpilier
 		// Initialize a function with no body to refrence C std libraries
 		llvm::FunctionCallee printfunc = GlobalVarsAndFunctions->getOrInsertFunction("printf",
 																					 llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*ctxt), llvm::PointerType::get(llvm::Type::getInt8Ty(*ctxt), false), true));
-		return builder->CreateCall(printfunc, vals, "printftemp");
+		llvm::Value *printed = builder->CreateCall(printfunc, vals, "printftemp");
+		for (auto &str : strings)
+			destroyIfTemporary(str.first, str.second);
+		return printed;
 	}
 
 	llvm::Value *CodeBlockAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("CodeBlockAST; other val: {0:x}", (long)other); 
 		llvm::Value *ret;
+		if (isScope)
+			pushLocalScope();
 		for (int i = 0; i < Contents.size(); i++)
 		{
 			ret = Contents[i]->codegen();
 			for (auto &x : Contents[i]->throwables)
 				this->throwables.insert(x);
 		};
+		if (isScope)
+			popLocalScope();
 		return ret;
 	}
 	llvm::Value *MemberAccessExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("MemberAccessExprAST; other val: {0:x}", (long)other); 
 		// return NULL;
-		llvm::Value *lhs = base->codegen(dereferenceParent);
+		llvm::Value *lhs;
+		IndexExprAST *element = dereferenceParent ? NULL : dynamic_cast<IndexExprAST *>(base.get());
+		if (element != NULL)
+		{
+			bool indexedMember;
+			lhs = element->codegenMember(false, member, indexedMember);
+			// Elements of soa arrays aren't stored anywhere whole, so `array[i].member` went straight to the member's own array
+			if (indexedMember)
+				return lhs == NULL || !autoDeref ? lhs : builder->CreateLoad(lhs->getType()->getNonOpaquePointerElementType(), lhs, "LoadTmp");
+		}
+		else
+			lhs = base->codegen(dereferenceParent);
+		// An object returned by value needs somewhere to live before its members can be read
+		if (lhs != NULL && lhs->getType()->isStructTy())
+		{
+			llvm::AllocaInst *tmp = createEntryBlockAlloca(lhs->getType(), NULL, "memberBaseTmp");
+			builder->CreateStore(lhs, tmp);
+			lhs = tmp;
+		}
 		auto returnTy = AliasMgr(lhs->getType()->getContainedType(0), member);
 		if (returnTy.index == -1)
 		{
@@ -1398,9 +2682,384 @@ namespace jimpilier
 		llvm::Value *gep = builder->CreateInBoundsGEP(lhs->getType()->getContainedType(0), lhs, llvm::ArrayRef<llvm::Value *>({objIndex, offset}), "memberaccess");
 		return autoDeref ? builder->CreateLoad(returnTy.type, gep, "LoadTmp") : gep;
 	}
+	bool isVectorBuiltin(const std::string &name)
+	{
+		return name == "shuffle" || name == "vload" || name == "vstore" || name == "reduce_add" || name == "reduce_mul" ||
+			   name == "reduce_min" || name == "reduce_max" || name == "reduce_and" || name == "reduce_or";
+	}
+
+	/**
+	 * @brief Gets a pointer to `width` elements in a row, starting at `index`, in a pointer, `T[]` array or `T[...]` slice.
+	 * For arrays & slices, the last element is bounds checked like any other array index
+	 */
+	llvm::Value *getVectorAccessPointer(llvm::Value *src, llvm::Value *index, unsigned width)
+	{
+		if (isArrayType(src->getType()) || isSliceType(src->getType()))
+		{
+			llvm::Value *last = builder->CreateAdd(builder->CreateSExtOrTrunc(index, builder->getInt64Ty(), "indextmp"), builder->getInt64(width - 1), "lastindex");
+			llvm::Value *lastPtr = createArrayIndex(src, last, false);
+			return builder->CreateInBoundsGEP(lastPtr->getType()->getNonOpaquePointerElementType(), lastPtr, builder->getInt64(-(int64_t)(width - 1)), "firstelement");
+		}
+		if (!src->getType()->isPointerTy())
+		{
+			logError("Vectors can only be loaded from & stored to pointers and arrays, not a(n) " + AliasMgr.getTypeName(src->getType(), true));
+			return NULL;
+		}
+		return builder->CreateGEP(src->getType()->getNonOpaquePointerElementType(), src, index, "offsetval");
+	}
+
+	llvm::Value *CallExprAST::vectorBuiltinCodegen()
+	{
+		spdlog::debug("Vector builtin: {}", Callee);
+		std::vector<llvm::Value *> args;
+		for (auto &arg : Args)
+			args.push_back(arg->codegen());
+		if (Callee == "vload" || Callee == "vstore")
+		{
+			// vload(source, width[, index]) & vstore(destination, vector[, index])
+			bool load = Callee == "vload";
+			llvm::ConstantInt *width = load && args.size() >= 2 ? llvm::dyn_cast<llvm::ConstantInt>(args[1]) : NULL;
+			if (args.size() < 2 || args.size() > 3 || (load && width == NULL) || (!load && !args[1]->getType()->isVectorTy()))
+			{
+				logError(load ? "vload() takes a pointer or array, a constant width, and optionally the index to start at" : "vstore() takes a pointer or array, a vector, and optionally the index to start at");
+				return NULL;
+			}
+			llvm::Value *index = args.size() == 3 ? args[2] : builder->getInt64(0);
+			unsigned count = load ? width->getZExtValue() : ((llvm::FixedVectorType *)args[1]->getType())->getNumElements();
+			llvm::Value *ptr = getVectorAccessPointer(args[0], index, count);
+			if (ptr == NULL)
+				return NULL;
+			llvm::Type *elementTy = ptr->getType()->getNonOpaquePointerElementType();
+			llvm::FixedVectorType *vecTy = llvm::FixedVectorType::get(elementTy, count);
+			llvm::Align align = DataLayout->getABITypeAlign(elementTy);
+			ptr = builder->CreateBitCast(ptr, vecTy->getPointerTo(), "vectorptr");
+			if (load)
+				return builder->CreateAlignedLoad(vecTy, ptr, align, "vloadtmp");
+			builder->CreateAlignedStore(convertElements(args[1], vecTy), ptr, align);
+			return args[1];
+		}
+		if (args.empty() || !args[0]->getType()->isVectorTy())
+		{
+			logError(Callee + "() needs a vector as its first argument");
+			return NULL;
+		}
+		llvm::Value *vec = args[0];
+		llvm::Type *elementTy = vec->getType()->getScalarType();
+		if (Callee == "shuffle")
+		{
+			// shuffle(a, [b,] indexes...); indexes past the end of a pick from b
+			llvm::Value *second = args.size() > 1 && args[1]->getType() == vec->getType() ? args[1] : llvm::PoisonValue::get(vec->getType());
+			unsigned available = ((llvm::FixedVectorType *)vec->getType())->getNumElements() * (llvm::isa<llvm::PoisonValue>(second) ? 1 : 2);
+			std::vector<int> mask;
+			for (int i = llvm::isa<llvm::PoisonValue>(second) ? 1 : 2; i < args.size(); i++)
+			{
+				llvm::ConstantInt *index = llvm::dyn_cast<llvm::ConstantInt>(args[i]);
+				if (index == NULL || index->getSExtValue() < 0 || index->getSExtValue() >= available)
+				{
+					logError("shuffle() indexes have to be constants between 0 and " + std::to_string(available - 1));
+					return NULL;
+				}
+				mask.push_back(index->getSExtValue());
+			}
+			return builder->CreateShuffleVector(vec, second, mask, "shuffletmp");
+		}
+		bool isFloat = elementTy->isFloatingPointTy();
+		llvm::Value *result = NULL;
+		if (Callee == "reduce_add")
+			result = isFloat ? builder->CreateFAddReduce(llvm::ConstantFP::get(elementTy, -0.0), vec) : builder->CreateAddReduce(vec);
+		else if (Callee == "reduce_mul")
+			result = isFloat ? builder->CreateFMulReduce(llvm::ConstantFP::get(elementTy, 1.0), vec) : builder->CreateMulReduce(vec);
+		else if (Callee == "reduce_min")
+			result = isFloat ? builder->CreateFPMinReduce(vec) : builder->CreateIntMinReduce(vec, true);
+		else if (Callee == "reduce_max")
+			result = isFloat ? builder->CreateFPMaxReduce(vec) : builder->CreateIntMaxReduce(vec, true);
+		else if (!isFloat && Callee == "reduce_and")
+			result = builder->CreateAndReduce(vec);
+		else if (!isFloat && Callee == "reduce_or")
+			result = builder->CreateOrReduce(vec);
+		else
+		{
+			logError(Callee + "() doesn't work on a(n) " + AliasMgr.getTypeName(vec->getType(), true));
+			return NULL;
+		}
+		// Floating point sums & products are added up in whatever order is fastest, not strictly left to right
+		if (isFloat && (Callee == "reduce_add" || Callee == "reduce_mul"))
+			((llvm::Instruction *)result)->setHasAllowReassoc(true);
+		result->setName("reducetmp");
+		return result;
+	}
+
+	bool isAtomicBuiltin(const std::string &name)
+	{
+		return name == "atomic_load" || name == "atomic_store" || name == "atomic_swap" || name == "compare_exchange" ||
+			   name == "fetch_add" || name == "fetch_sub" || name == "fetch_and" || name == "fetch_or" || name == "fetch_xor";
+	}
+	/**
+	 * @brief If `arg` names a memory ordering (`relaxed`, `acquire`, `release`, `acq_rel` or `seq_cst`) rather than a variable, that ordering
+	 */
+	llvm::Optional<llvm::AtomicOrdering> getAtomicOrdering(std::unique_ptr<ExprAST> &arg)
+	{
+		static const std::map<std::string, llvm::AtomicOrdering> orderings = {
+			{"relaxed", llvm::AtomicOrdering::Monotonic},
+			{"acquire", llvm::AtomicOrdering::Acquire},
+			{"release", llvm::AtomicOrdering::Release},
+			{"acq_rel", llvm::AtomicOrdering::AcquireRelease},
+			{"seq_cst", llvm::AtomicOrdering::SequentiallyConsistent}};
+		VariableExprAST *var = dynamic_cast<VariableExprAST *>(arg.get());
+		if (var == NULL || !orderings.count(var->getName()))
+			return llvm::None;
+		auto declared = AliasMgr.variables.find(var->getName());
+		if (declared != AliasMgr.variables.end() && declared->second.val != NULL)
+			return llvm::None;
+		return orderings.at(var->getName());
+	}
+
+	llvm::Value *CallExprAST::atomicBuiltinCodegen()
+	{
+		spdlog::debug("Atomic builtin: {}", Callee);
+		// The memory orderings come last, and default to sequentially consistent
+		std::vector<llvm::AtomicOrdering> orders;
+		while (!Args.empty() && getAtomicOrdering(Args.back()))
+		{
+			orders.insert(orders.begin(), *getAtomicOrdering(Args.back()));
+			Args.pop_back();
+		}
+		unsigned valueCount = Callee == "atomic_load" ? 1 : Callee == "compare_exchange" ? 3 : 2;
+		unsigned orderCount = Callee == "compare_exchange" ? 2 : 1;
+		if (Args.size() != valueCount || orders.size() > orderCount)
+		{
+			logError(Callee + "() takes " + std::to_string(valueCount) + " argument(s), optionally followed by " + (orderCount == 2 ? "the orderings for success & failure" : "a memory ordering"));
+			return NULL;
+		}
+		llvm::AtomicOrdering order = orders.empty() ? llvm::AtomicOrdering::SequentiallyConsistent : orders[0];
+		// The first argument is whatever's being worked on (a variable, an array element, `@pointer`...), so it's used as an address
+		llvm::Value *ptr = Args[0]->codegen(false);
+		if (ptr == NULL)
+			return NULL;
+		llvm::Type *ty = ptr->getType()->isPointerTy() ? ptr->getType()->getNonOpaquePointerElementType() : NULL;
+		if (ty == NULL || !isAtomicType(ty))
+		{
+			logError(Callee + "() works on a number, bool or pointer variable, not a(n) " + AliasMgr.getTypeName(ptr->getType()));
+			return NULL;
+		}
+		std::vector<llvm::Value *> values;
+		for (int i = 1; i < Args.size(); i++)
+		{
+			values.push_back(Args[i]->codegen(Callee != "compare_exchange" || i != 1));
+			if (values.back() == NULL)
+				return NULL;
+		}
+		for (llvm::Value *&val : values)
+			if (val->getType()->isIntegerTy() && ty->isIntegerTy() && val->getType() != ty && !ty->isIntegerTy(1))
+				val = builder->CreateSExtOrTrunc(val, ty, "signExtendTmp");
+
+		if (Callee == "atomic_load")
+		{
+			if (order == llvm::AtomicOrdering::Release || order == llvm::AtomicOrdering::AcquireRelease)
+			{
+				logError("atomic_load() can't use release ordering");
+				return NULL;
+			}
+			return createAtomicLoad(ptr, order);
+		}
+		if (values[0]->getType() != ty && Callee != "compare_exchange")
+		{
+			logError(Callee + "() was given a(n) " + AliasMgr.getTypeName(values[0]->getType()) + " for a variable that holds a(n) " + AliasMgr.getTypeName(ty));
+			return NULL;
+		}
+		if (Callee == "atomic_store")
+		{
+			if (order == llvm::AtomicOrdering::Acquire || order == llvm::AtomicOrdering::AcquireRelease)
+			{
+				logError("atomic_store() can't use acquire ordering");
+				return NULL;
+			}
+			createAtomicStore(values[0], ptr, order);
+			return values[0];
+		}
+		if (Callee == "compare_exchange")
+			return createCompareExchange(ptr, values[0], values[1], order, orders.size() == 2 ? orders[1] : llvm::AtomicCmpXchgInst::getStrongestFailureOrdering(order));
+
+		// The read-modify-writes: atomic_swap & fetch_*, which all return the old value
+		llvm::AtomicRMWInst::BinOp op = llvm::AtomicRMWInst::Xchg;
+		if (Callee == "fetch_add")
+			op = ty->isFloatingPointTy() ? llvm::AtomicRMWInst::FAdd : llvm::AtomicRMWInst::Add;
+		else if (Callee == "fetch_sub")
+			op = ty->isFloatingPointTy() ? llvm::AtomicRMWInst::FSub : llvm::AtomicRMWInst::Sub;
+		else if (Callee == "fetch_and")
+			op = llvm::AtomicRMWInst::And;
+		else if (Callee == "fetch_or")
+			op = llvm::AtomicRMWInst::Or;
+		else if (Callee == "fetch_xor")
+			op = llvm::AtomicRMWInst::Xor;
+		if (op != llvm::AtomicRMWInst::Xchg && op != llvm::AtomicRMWInst::FAdd && op != llvm::AtomicRMWInst::FSub && (!ty->isIntegerTy() || ty->isIntegerTy(1)))
+		{
+			logError(Callee + "() only works on integers");
+			return NULL;
+		}
+		// Bools are swapped as a byte, and pointers as an integer
+		llvm::Type *atomicTy = ty->isIntegerTy(1) ? builder->getInt8Ty() : ty->isPointerTy() ? builder->getInt64Ty() : ty;
+		llvm::Value *atomicPtr = atomicTy == ty ? ptr : builder->CreateBitCast(ptr, atomicTy->getPointerTo(), "atomicbitsptr"), *val = values[0];
+		if (ty->isIntegerTy(1))
+			val = builder->CreateZExt(val, atomicTy, "atomicbyte");
+		else if (ty->isPointerTy())
+			val = builder->CreatePtrToInt(val, atomicTy, "atomicbits");
+		llvm::Value *old = builder->CreateAtomicRMW(op, atomicPtr, val, getAtomicAlign(atomicTy), order);
+		old->setName("atomicold");
+		if (ty->isIntegerTy(1))
+			return builder->CreateTrunc(old, ty, "atomicbool");
+		return ty->isPointerTy() ? builder->CreateIntToPtr(old, ty, "atomicptr") : old;
+	}
+
+	/**
+	 * @brief The type an argument has once it's loaded: variables, members & elements are passed around as pointers to where they're stored
+	 */
+	llvm::Type *getArgumentValueType(ExprAST *arg, llvm::Value *val)
+	{
+		if (isStoredValue(arg) && val->getType()->isPointerTy())
+			return val->getType()->getNonOpaquePointerElementType();
+		return val->getType();
+	}
+	/**
+	 * @brief Whether a function takes exactly the types of the given arguments (as opposed to ones they'd be converted to)
+	 */
+	bool takesExactly(FunctionHeader &func, std::vector<std::unique_ptr<ExprAST>> &args, std::vector<llvm::Value *> &vals)
+	{
+		if (func.args.size() != args.size())
+			return false;
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			llvm::Type *param = func.args[i].isRef ? func.args[i].ty->getNonOpaquePointerElementType() : func.args[i].ty;
+			if (param != getArgumentValueType(args[i].get(), vals[i]))
+				return false;
+		}
+		return true;
+	}
+	/**
+	 * @brief Work out what each typename of a generic function stands for from the arguments it's called with,
+	 * by matching each parameter's type (`T`, `T*`, `T[]`, `T[...]`, `T@`...) against its argument's. Empty if they don't fit
+	 */
+	std::vector<llvm::Type *> deduceTemplateTypes(std::vector<std::string> &templates, PrototypeAST &proto, std::vector<std::unique_ptr<ExprAST>> &args, std::vector<llvm::Value *> &vals)
+	{
+		if (proto.Args.size() != args.size())
+			return {};
+		std::map<std::string, llvm::Type *> deduced;
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			std::string spelling = proto.Args[i].ty->getName();
+			llvm::Type *ty = getArgumentValueType(args[i].get(), vals[i]);
+			if (!spelling.empty() && spelling.back() == '&')
+				spelling.pop_back();
+			while (ty != NULL && std::find(templates.begin(), templates.end(), spelling) == templates.end())
+			{
+				if (spelling.size() > 1 && spelling.back() == '*' && ty->isPointerTy())
+				{
+					spelling.pop_back();
+					ty = ty->getNonOpaquePointerElementType();
+				}
+				else if (spelling.size() > 2 && spelling.substr(spelling.size() - 2) == "[]" && isArrayType(ty))
+				{
+					spelling.resize(spelling.size() - 2);
+					ty = ty->getStructElementType(0)->getNonOpaquePointerElementType();
+				}
+				else if (spelling.size() > 5 && spelling.substr(spelling.size() - 5) == "[...]" && (isSliceType(ty) || isArrayType(ty)))
+				{
+					spelling.resize(spelling.size() - 5);
+					ty = ty->getStructElementType(0)->getNonOpaquePointerElementType();
+				}
+				else
+					ty = NULL;
+			}
+			if (ty == NULL)
+				continue;
+			llvm::Type *&found = deduced[spelling];
+			// Numbers of different sizes (`max(someLong, 1)`) settle on the biggest
+			bool sameKind = found != NULL && ((found->isIntegerTy() && ty->isIntegerTy()) || (found->isFloatingPointTy() && ty->isFloatingPointTy()));
+			if (found == NULL || (sameKind && ty->getPrimitiveSizeInBits() > found->getPrimitiveSizeInBits()))
+				found = ty;
+			else if (found != ty && !sameKind)
+				return {};
+		}
+		std::vector<llvm::Type *> ret;
+		for (auto &x : templates)
+		{
+			if (deduced[x] == NULL)
+				return {};
+			ret.push_back(deduced[x]);
+		}
+		return ret;
+	}
+	/**
+	 * @brief The copy of a generic function for the types of the given arguments, generated the first time it's called with them
+	 * (so each copy is an ordinary function, which can be inlined & optimized for its types). NULL if no generic function
+	 * with that name can take the arguments
+	 */
+	llvm::Function *getTemplateFunctionInstance(const std::string &name, std::vector<std::unique_ptr<ExprAST>> &args, std::vector<llvm::Value *> &vals)
+	{
+		if (!TemplateMgr.hasTemplateFunction(name))
+			return NULL;
+		// Typenames only mean something inside their own template, so any the caller is in the middle of are set aside
+		std::map<std::string, std::string> outerNames = std::move(TemplateMgr.boundTypeNames);
+		TemplateMgr.boundTypeNames.clear();
+		llvm::Function *ret = NULL;
+		for (auto &templ : TemplateMgr.getTemplateFunctions(name))
+		{
+			std::vector<llvm::Type *> types = deduceTemplateTypes(templ.templates, templ.function->getProto(), args, vals);
+			if (types.empty())
+				continue;
+			std::string &instanceName = templ.instances[types];
+			if (instanceName.empty())
+			{
+				std::string spellings;
+				for (auto &ty : types)
+					spellings += getTypeSpelling(ty) + ',';
+				instanceName = name + '<' + spellings.substr(0, spellings.size() - 1) + '>';
+				spdlog::debug("Generating template function {}", instanceName);
+				std::vector<llvm::Type *> outerTypes;
+				for (size_t i = 0; i < types.size(); i++)
+				{
+					outerTypes.push_back(AliasMgr(templ.templates[i]));
+					AliasMgr.objects.replaceObject(templ.templates[i], types[i]);
+					TemplateMgr.boundTypeNames[templ.templates[i]] = getTypeSpelling(types[i]);
+				}
+				// The copy is generated in the middle of the caller, whose variables have to survive it
+				std::map<std::string, CompileTimeVariable> callerVariables = AliasMgr.variables;
+				for (auto it = AliasMgr.variables.begin(); it != AliasMgr.variables.end();)
+					it = it->second.val != NULL && !llvm::isa<llvm::GlobalValue>(it->second.val) ? AliasMgr.variables.erase(it) : std::next(it);
+				PrototypeAST &proto = templ.function->getProto();
+				proto.Name = instanceName;
+				templ.function->codegen();
+				proto.Name = name;
+				AliasMgr.variables = std::move(callerVariables);
+				for (size_t i = 0; i < types.size(); i++)
+				{
+					if (outerTypes[i] != NULL)
+						AliasMgr.objects.replaceObject(templ.templates[i], outerTypes[i]);
+					else
+						AliasMgr.objects.removeObject(templ.templates[i]);
+				}
+				TemplateMgr.boundTypeNames.clear();
+			}
+			ret = GlobalVarsAndFunctions->getFunction(instanceName);
+			break;
+		}
+		TemplateMgr.boundTypeNames = std::move(outerNames);
+		return ret;
+	}
+	llvm::Value *TemplateFunctionAST::codegen(bool autoDeref, llvm::Value *other)
+	{
+		spdlog::debug("TemplateFunctionAST; other val: {0:x}", (long)other);
+		TemplateMgr.insertTemplateFunction(name, templates, function);
+		return NULL;
+	}
+
 	llvm::Value *CallExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
-		if (!AliasMgr.functions.hasAlias(Callee))
+		if (!AliasMgr.functions.hasAlias(Callee) && isVectorBuiltin(Callee))
+			return vectorBuiltinCodegen();
+		if (!AliasMgr.functions.hasAlias(Callee) && isAtomicBuiltin(Callee))
+			return atomicBuiltinCodegen();
+		if (!AliasMgr.functions.hasAlias(Callee) && !TemplateMgr.hasTemplateFunction(Callee))
 		{
 			logError("A function with name was never declared: " + Callee);
 		}
@@ -1419,11 +3078,23 @@ namespace jimpilier
 			ArgsT.push_back(ArgsV.back()->getType());
 		}
 
-		// Look up the name in the global module table.
-		FunctionHeader CalleeF = AliasMgr.functions.getFunctionObject(Callee, ArgsT);
+		// Look up the name in the global module table. A function that takes exactly these types beats a generic one, which beats one that needs conversions
+		llvm::Function *plain = AliasMgr.functions.hasAlias(Callee) ? AliasMgr.functions.getFunction(Callee, ArgsT) : NULL;
+		llvm::Function *generic = plain != NULL && takesExactly(AliasMgr.functions.getFunction(plain), Args, ArgsV) ? NULL : getTemplateFunctionInstance(Callee, Args, ArgsV);
+		if (generic == NULL && !AliasMgr.functions.hasAlias(Callee))
+		{
+			logError("The types of generic function " + Callee + " couldn't be worked out from its arguments; every typename has to be the type of (or in the type of) a parameter");
+			return NULL;
+		}
+		FunctionHeader CalleeF = generic != NULL ? AliasMgr.functions.getFunction(generic) : AliasMgr.functions.getFunctionObject(Callee, ArgsT);
 		for (auto &x : CalleeF.throwableTypes)
 			this->throwables.insert(x);
-		return makeCallWithReferences(ArgsV, CalleeF);
+		std::vector<llvm::Value *> passed = ArgsV;
+		llvm::Value *result = foldConstCall(makeCallWithReferences(ArgsV, CalleeF, false, other));
+		// An async function can still be reading its arguments after it suspends, so those are left alone
+		for (unsigned i = 0; i < Args.size() && !asyncFunctions.count(CalleeF.func); i++)
+			destroyIfTemporary(Args[i].get(), passed[i]);
+		return result;
 	}
 
 	llvm::Value *ObjectFunctionCallExprAST::codegen(bool autoDeref, llvm::Value *other)
@@ -1450,7 +3121,11 @@ namespace jimpilier
 			this->throwables.insert(x);
 		for (auto &x : parent->throwables)
 			this->throwables.insert(x);
-		return makeCallWithReferences(ArgsV, CalleeF, true);
+		std::vector<llvm::Value *> passed = ArgsV;
+		llvm::Value *result = makeCallWithReferences(ArgsV, CalleeF, true, other);
+		for (unsigned i = 0; i < Args.size(); i++)
+			destroyIfTemporary(Args[i].get(), passed[i + 1]);
+		return result;
 	}
 
 	llvm::Value *ObjectConstructorCallExprAST::codegen(bool autoDeref, llvm::Value *other)
@@ -1462,17 +3137,38 @@ namespace jimpilier
 
 		// target = void* where the object will be initialized, usually a heap allocation
 		// other = type* stack local variable
+		// With neither, the object is built in a temporary and its value (or address, if !autoDeref) is the result
+		llvm::Value *result = NULL;
+		bool temporary = target == NULL && other == NULL;
 		if (target != NULL)
 		{
-			// call calloc() passing the size as a Value*
+			// allocate the object, passing the size as a Value*
+			if (HeapExprAST *heap = dynamic_cast<HeapExprAST *>(target.get()))
+				heap->alignment = DataLayout->getABITypeAlign(TargetType).value();
 			llvm::Value *heapalloc = target->codegen(false, AliasMgr.getTypeSize(TargetType, ctxt, DataLayout));
+			for (auto &x : target->throwables)
+				this->throwables.insert(x);
+			if (heapalloc == NULL)
+				return NULL;
 			heapalloc = builder->CreateBitCast(heapalloc, TargetType->getPointerTo(), "bitcasttmp");
-			// store pointer to calloc() allocation on stack
-			builder->CreateStore(heapalloc, other);
-			other = builder->CreateLoad(other->getType()->getNonOpaquePointerElementType(), other, "loadtmp");
+			if (other == NULL)
+				result = heapalloc;
+			else
+				// store pointer to calloc() allocation on stack
+				builder->CreateStore(heapalloc, other);
+			other = heapalloc;
+		}
+		else if (other == NULL)
+		{
+			llvm::AllocaInst *tmp = createEntryBlockAlloca(TargetType, NULL, "objConstructorTmp");
+			// A temporary that owns memory is destroyed with the scope it's made in (anything that keeps it makes a copy);
+			// it starts out zeroed, like a variable, since the constructor frees whatever its members held before
+			llvm::Function *dtor = getObjectCopier(TargetType) != NULL ? getObjectDestructor(TargetType) : NULL;
+			trackLocal(tmp, dtor);
+			if (dtor != NULL)
+				builder->CreateStore(llvm::Constant::getNullValue(TargetType), tmp);
+			other = tmp;
 		}
-		if (other == NULL)
-			other = builder->CreateAlloca(TargetType, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*ctxt), llvm::APInt(1, 32)), "objConstructorTmp");
 		if (other->getType() != TargetType->getPointerTo())
 		{
 			logError("Error when attempting to assign a constructor value: The type of the left side (" + AliasMgr.getTypeName(other->getType()) + ") does not match the right side (" + AliasMgr.getTypeName(target == NULL ? TargetType : TargetType->getPointerTo()) + ").");
@@ -1482,7 +3178,11 @@ namespace jimpilier
 		{
 			if (!Args.empty())
 				builder->CreateStore(Args[0]->codegen(), other);
-			return NULL;
+			else if (target != NULL || temporary)
+				builder->CreateStore(llvm::Constant::getNullValue(TargetType), other);
+			if (temporary)
+				return autoDeref ? builder->CreateLoad(TargetType, other, "objConstructorVal") : other;
+			return result;
 		}
 		std::vector<llvm::Value *> ArgsV;
 		std::vector<llvm::Type *> ArgsT;
@@ -1502,14 +3202,18 @@ namespace jimpilier
 
 		FunctionHeader CalleeF = (Callee == "") ? AliasMgr(TargetType, ArgsT) : AliasMgr.functions.getFunctionObject(Callee, ArgsT);
 
-		for (int i = 0; i < CalleeF.args.size(); i++)
-		{
-			if (!CalleeF.args[i].isRef && ArgsT[i]->isPointerTy() && ArgsT[i] != CalleeF.args[i].ty)
-				ArgsV[i] = builder->CreateLoad(ArgsT[i]->getNonOpaquePointerElementType(), ArgsV[i], "dereftmp");
-		}
-
-		builder->CreateCall(CalleeF.func, ArgsV, "calltmp");
-		return NULL;
+		// Heap memory comes back uninitialized; only zero it if the constructor might leave a field unset
+		if (target != NULL && !constructorInitializesAllFields(CalleeF.func, (llvm::StructType *)TargetType))
+			builder->CreateMemSet(other, builder->getInt8(0), DataLayout->getTypeAllocSize(TargetType), llvm::MaybeAlign(8));
+
+		// The arguments get the same conversions (C strings to strings, arrays to slices...) as any other call's
+		std::vector<llvm::Value *> passed = ArgsV;
+		makeCallWithReferences(ArgsV, CalleeF, true);
+		for (unsigned i = 0; i < Args.size(); i++)
+			destroyIfTemporary(Args[i].get(), passed[i + 1]);
+		if (temporary)
+			return autoDeref ? builder->CreateLoad(TargetType, other, "objConstructorVal") : other;
+		return result;
 	}
 
 	llvm::Value *ConstructorExprAST::codegen(bool autoderef, llvm::Value *other)
@@ -1528,6 +3232,7 @@ namespace jimpilier
 		llvm::FunctionType *FT =
 			llvm::FunctionType::get(argtypes[0], argtypes, false);
 		llvm::Function *lastfunc = currentFunction;
+		FunctionScopeState outerScopes = enterFunctionScope();
 		currentFunction =
 			llvm::Function::Create(FT, llvm::Function::ExternalLinkage, objName + ".constructor", GlobalVarsAndFunctions.get());
 		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", currentFunction);
@@ -1544,6 +3249,7 @@ namespace jimpilier
 		}
 
 		llvm::Value *RetVal = bod->codegen();
+		exitFunctionScope(outerScopes);
 		builder->CreateRet(builder->CreateLoad(AliasMgr["this"].val->getType()->getNonOpaquePointerElementType(), AliasMgr["this"].val));
 		// Validate the generated code, checking for consistency.
 		verifyFunction(*currentFunction);
@@ -1567,6 +3273,47 @@ namespace jimpilier
 		return thisfunc;
 	}
 
+	llvm::Value *DestructorExprAST::codegen(bool autoderef, llvm::Value *other)
+	{
+		spdlog::debug("DestructorExprAST; other val: {0:x}", (long)other); 
+		llvm::Type *objTy = AliasMgr(objName);
+		std::unique_ptr<TypeExpr> thisType = std::make_unique<StructTypeExpr>(objName);
+		thisType = std::make_unique<ReferenceToTypeExpr>(thisType);
+		llvm::FunctionType *FT = llvm::FunctionType::get(builder->getVoidTy(), {thisType->codegen()}, false);
+		llvm::Function *lastfunc = currentFunction;
+		FunctionScopeState outerScopes = enterFunctionScope();
+		currentFunction =
+			llvm::Function::Create(FT, llvm::Function::ExternalLinkage, objName + ".destructor", GlobalVarsAndFunctions.get());
+		// Registered before the body is generated so `delete` & nested objects in the body can find it
+		AliasMgr.objects.addDestructor(objTy, currentFunction);
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", currentFunction));
+		llvm::Argument *thisArg = currentFunction->getArg(0);
+		thisArg->setName("this");
+		llvm::Value *storedvar = builder->CreateAlloca(thisArg->getType(), NULL, "this");
+		builder->CreateStore(thisArg, storedvar);
+		AliasMgr["this"] = {storedvar, true};
+
+		bod->codegen();
+		exitFunctionScope(outerScopes);
+		if (builder->GetInsertBlock()->getTerminator() == NULL)
+		{
+			// Once the body's done, destroy the members, last declared first
+			llvm::StructType *structTy = (llvm::StructType *)objTy;
+			std::vector<unsigned> order = getFieldDeclarationOrder(structTy);
+			for (auto field = order.rbegin(); field != order.rend(); field++)
+				if (llvm::Function *memberDtor = getObjectDestructor(structTy->getElementType(*field)))
+					builder->CreateCall(memberDtor, {builder->CreateStructGEP(objTy, thisArg, *field, "memberaccess")});
+			builder->CreateRetVoid();
+		}
+		verifyFunction(*currentFunction);
+		AliasMgr["this"] = {NULL, false};
+		llvm::Function *thisfunc = currentFunction;
+		currentFunction = lastfunc;
+		if (currentFunction != NULL)
+			builder->SetInsertPoint(&currentFunction->getBasicBlockList().back());
+		return thisfunc;
+	}
+
 	llvm::StructType *ObjectHeaderExpr::codegen(bool autoderef, llvm::Value *other)
 	{
 
@@ -1576,6 +3323,47 @@ namespace jimpilier
 		AliasMgr.objects.addObject(name, ty);
 		return ty;
 	}
+	/**
+	 * @brief The alignment a field is sorted by in a `packed` object. Scalars go by their preferred alignment, since the
+	 * default data layout only 4-byte aligns a long when every target Jimbo runs on 8-byte aligns it
+	 */
+	uint64_t getFieldAlignment(llvm::Type *ty)
+	{
+		if (llvm::StructType *structTy = llvm::dyn_cast<llvm::StructType>(ty))
+		{
+			uint64_t align = 1;
+			for (llvm::Type *member : structTy->elements())
+				align = std::max(align, getFieldAlignment(member));
+			return align;
+		}
+		if (ty->isArrayTy())
+			return getFieldAlignment(ty->getArrayElementType());
+		return DataLayout->getPrefTypeAlign(ty).value();
+	}
+	/**
+	 * @brief Works out the order an object's fields are stored in: hot fields first and cold fields last, and if the object is `packed`,
+	 * the most aligned (then biggest) fields first within each of those, so padding is only ever needed at the end.
+	 * Fields that compare equal keep the order they were declared in.
+	 *
+	 * @return std::vector<unsigned> - the declared index of each field, in the order they're laid out
+	 */
+	std::vector<unsigned> getObjectFieldOrder(std::vector<llvm::Type *> &types, ObjectLayout &layout)
+	{
+		std::vector<unsigned> order(types.size());
+		for (unsigned i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b)
+						 {
+			if (layout.heat[a] != layout.heat[b])
+				return layout.heat[a] < layout.heat[b];
+			if (!layout.packed)
+				return false;
+			uint64_t alignA = getFieldAlignment(types[a]), alignB = getFieldAlignment(types[b]);
+			if (alignA != alignB)
+				return alignA > alignB;
+			return DataLayout->getTypeAllocSize(types[a]).getFixedSize() > DataLayout->getTypeAllocSize(types[b]).getFixedSize(); });
+		return order;
+	}
 	llvm::Value *ObjectExprAST::codegen(bool autoDeref, llvm::Value *other)
 	{
 		spdlog::debug("ObjectExprAST; other val: {0:x}", (long)other); 
@@ -1599,11 +3387,24 @@ namespace jimpilier
 			types.push_back(var.ty->codegen());
 		}
 
-		if (!types.empty())
-			ty->setBody(types);
+		layout.heat.resize(vars.size(), normalField);
+		std::vector<unsigned> order = getObjectFieldOrder(types, layout);
+		std::vector<llvm::Type *> fields;
+		std::vector<int> indices(types.size());
+		for (unsigned i = 0; i < order.size(); i++)
+		{
+			fields.push_back(types[order[i]]);
+			indices[order[i]] = i;
+		}
+		// A zero length array of `align` byte vectors takes up no space, but makes the whole object that aligned, which rounds its size up to match
+		if (layout.align > 1)
+			fields.push_back(llvm::ArrayType::get(llvm::FixedVectorType::get(builder->getInt8Ty(), layout.align), 0));
+
+		if (!fields.empty())
+			ty->setBody(fields);
 
 		if (base.templates.empty())
-			AliasMgr.objects.addObjectMembers(base.name, types, names);
+			AliasMgr.objects.addObjectMembers(base.name, types, names, indices);
 		else
 		{
 		}
@@ -1659,23 +3460,54 @@ namespace jimpilier
 		{
 			Errt.push_back(x->codegen());
 		}
+		llvm::Type *retTy = retType->codegen();
+		// Big objects are constructed straight into a slot the caller passes in, and passed in by pointer (`byval`; the callee still gets its own copy).
+		// Const functions keep using values so they can be run at compile time
+		bool inMemory = !isConst && !retType->isAsync();
+		bool sret = inMemory && returnsInMemory(retTy);
+		std::vector<llvm::Type *> byValue(Argt.size(), NULL);
+		for (size_t i = 0; i < Args.size(); i++)
+			if (inMemory && !Args[i].ty->isReference() && passedInMemory(Argt[i]))
+			{
+				byValue[i] = Argt[i];
+				Argt[i] = Argt[i]->getPointerTo();
+			}
+		if (sret)
+			Argt.insert(Argt.begin(), retTy->getPointerTo());
 		llvm::FunctionType *FT =
-			llvm::FunctionType::get(retType->codegen(), Argt, false);
-		int ctr = 1;
-		std::string internalName = Name;
-		while (GlobalVarsAndFunctions->getFunction(internalName) != NULL)
+			llvm::FunctionType::get(sret ? builder->getVoidTy() : retTy, Argt, false);
+		// A C function the compiler already declared for itself (like strlen for strings) is reused, so it keeps the name it links by
+		llvm::Function *F = GlobalVarsAndFunctions->getFunction(Name);
+		if (F == NULL || !F->isDeclaration() || F->getFunctionType() != FT || parent != "")
+		{
+			int ctr = 1;
+			std::string internalName = Name;
+			while (GlobalVarsAndFunctions->getFunction(internalName) != NULL)
+			{
+				ctr++;
+				internalName = Name + (std::to_string(ctr));
+			}
+			F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, internalName, GlobalVarsAndFunctions.get());
+		}
+		if (sret)
 		{
-			ctr++;
-			internalName = Name + (std::to_string(ctr));
+			F->getArg(0)->setName("return.slot");
+			F->addParamAttr(0, llvm::Attribute::getWithStructRetType(*ctxt, retTy));
+			F->addParamAttr(0, llvm::Attribute::NoAlias);
 		}
-		llvm::Function *F =
-			llvm::Function::Create(FT, llvm::Function::ExternalLinkage, internalName, GlobalVarsAndFunctions.get());
+		for (size_t i = 0; i < byValue.size(); i++)
+			if (byValue[i] != NULL)
+				F->addParamAttr(i + sret, llvm::Attribute::getWithByValType(*ctxt, byValue[i]));
 		unsigned Idx = 0;
 		for (auto &Arg : F->args())
 		{
+			if (Arg.hasStructRetAttr())
+				continue;
 			Arg.setName(Argnames[Idx++]);
 		}
 		AliasMgr.functions.addFunction(Name, F, Args, Errt, retType->isReference());
+		if (!Errt.empty())
+			throwingFunctions.insert(F);
 		if(parent != ""){
 			Args.erase(Args.begin()); 
 		}
@@ -1686,6 +3518,7 @@ namespace jimpilier
 	{
 		spdlog::debug("FunctionAST; other val: {0:x}", (long)other); 
 		llvm::Function *prevFunction = currentFunction;
+		llvm::BasicBlock *prevBlock = builder->GetInsertBlock();
 		std::vector<llvm::Type *> argtypes = (Proto->getArgTypes());
 		currentFunction = AliasMgr.functions.getFunction(Proto->Name, argtypes);
 		if (!currentFunction)
@@ -1712,11 +3545,19 @@ namespace jimpilier
 		for (auto &arg : Proto->Args)
 			areReferences.push_back(arg.ty->isReference());
 		std::string debugnames;  
+		llvm::Argument *returnSlot = getReturnSlot(currentFunction);
 		for (auto &Arg : currentFunction->args())
 		{
-			int argno = Arg.getArgNo();
-			llvm::Value *storedvar = builder->CreateAlloca(Arg.getType(), NULL, Arg.getName());
-			builder->CreateStore(&Arg, storedvar);
+			if (&Arg == returnSlot)
+				continue;
+			int argno = Arg.getArgNo() - (returnSlot != NULL);
+			// Objects passed in by pointer are already the function's own copy
+			llvm::Value *storedvar = &Arg;
+			if (!Arg.hasByValAttr())
+			{
+				storedvar = builder->CreateAlloca(Arg.getType(), NULL, Arg.getName());
+				builder->CreateStore(&Arg, storedvar);
+			}
 			std::string name = std::string(Arg.getName());
 			spdlog::debug("creating prototype args: {0}(argc={1};proto.argc={3}) current arg no{2}", Proto->Name, Proto->Args.size(), Arg.getArgNo(), currentFunction->arg_size());
 			AliasMgr[name] = {storedvar, areReferences[argno]};
@@ -1724,17 +3565,59 @@ namespace jimpilier
 		}
 		spdlog::debug("Set argument names for {0}({1})", Proto->getName(), debugnames); 
 		llvm::Instruction *currentEntry = &BB->getIterator()->back();
+		llvm::StructType *promiseTy = Proto->retType->isAsync() ? getAsyncPromiseOf(currentFunction->getReturnType()) : NULL;
+		if (promiseTy != NULL && !Proto->throwableTypes.empty())
+		{
+			logError("Async functions can't throw: " + Proto->Name);
+			currentFunction = prevFunction;
+			return NULL;
+		}
+		if (promiseTy != NULL)
+			beginAsyncFunction(promiseTy);
+		FunctionScopeState outerScopes = enterFunctionScope();
+		// Anything that owns memory (strings, arrays...) passed by value is the function's own copy, so it can change it, and it's destroyed on the way out
+		bool hasOwnedArgs = false;
+		for (auto &arg : Proto->Args)
+		{
+			llvm::Value *param = AliasMgr[arg.name].val;
+			llvm::Function *copier = param == NULL ? NULL : getObjectCopier(param->getType()->getNonOpaquePointerElementType());
+			if (Body == NULL || promiseTy != NULL || arg.ty->isReference() || copier == NULL)
+				continue;
+			if (!hasOwnedArgs)
+				pushLocalScope();
+			hasOwnedArgs = true;
+			llvm::Type *paramTy = param->getType()->getNonOpaquePointerElementType();
+			llvm::AllocaInst *slot = createEntryBlockAlloca(paramTy, NULL, arg.name + ".owned");
+			trackLocal(slot, getObjectDestructor(paramTy));
+			builder->CreateStore(builder->CreateCall(copier, {param}, "paramcopy"), slot);
+			AliasMgr[arg.name] = {slot, false};
+		}
 		llvm::Value *RetVal = Body == NULL ? NULL : Body->codegen();
+		exitFunctionScope(outerScopes);
 
-		if (RetVal != NULL && (!RetVal->getType()->isPointerTy() || !RetVal->getType()->getNonOpaquePointerElementType()->isFunctionTy()))
+		if (RetVal != NULL && promiseTy != NULL)
+		{
+			// Falling off the end of an async function finishes it with a zeroed result
+			createAsyncReturn(promiseTy->getNumElements() > 2 ? llvm::Constant::getNullValue(promiseTy->getElementType(2)) : NULL);
+			finishAsyncFunction();
+			verifyFunction(*currentFunction);
+			if (Proto->isConst)
+				logError("Async functions can't be const: " + Proto->Name);
+		}
+		else if (RetVal != NULL && (!RetVal->getType()->isPointerTy() || !RetVal->getType()->getNonOpaquePointerElementType()->isFunctionTy()))
 		{
+			if (returnSlot != NULL)
+				builder->CreateStore(llvm::ConstantAggregateZero::get(returnSlot->getType()->getNonOpaquePointerElementType()), returnSlot);
 			if (currentFunction->getReturnType()->isVoidTy())
 				builder->CreateRetVoid();
 			else
 				builder->CreateRet(llvm::ConstantAggregateZero::get(currentFunction->getReturnType()));
+			elideNamedReturn(currentFunction);
 			// Validate the generated code, checking for consistency.
 			verifyFunction(*currentFunction);
 			// remove the arguments now that they're out of scope
+			if (Proto->isConst)
+				registerConstFunction(currentFunction, !Proto->throwableTypes.empty());
 		}
 		else
 		{
@@ -1742,11 +3625,15 @@ namespace jimpilier
 		}
 		for (auto &Arg : currentFunction->args())
 		{
-			AliasMgr[std::string(Arg.getName())] = {NULL, false};
+			if (&Arg != returnSlot)
+				AliasMgr[std::string(Arg.getName())] = {NULL, false};
 			// dtypes[std::string(Arg.getName())] ;
 		}
 		currentFunction = prevFunction;
-		if (currentFunction != NULL)
+		// Top-level code carries on where it left off, which isn't always the last block (loops put their end block before their condition blocks)
+		if (currentFunction != NULL && prevBlock != NULL && prevBlock->getParent() == currentFunction)
+			builder->SetInsertPoint(prevBlock);
+		else if (currentFunction != NULL)
 			builder->SetInsertPoint(&currentFunction->getBasicBlockList().back());
 
 		return AliasMgr.functions.getFunction(Proto->Name, argtypes);
@@ -1825,7 +3712,9 @@ namespace jimpilier
 			// dtypes[name] = Arg.getType();
 		}
 		llvm::Instruction *currentEntry = &BB->getIterator()->back();
+		FunctionScopeState outerScopes = enterFunctionScope();
 		llvm::Value *RetVal = Body == NULL ? NULL : Body->codegen();
+		exitFunctionScope(outerScopes);
 
 		if (RetVal != NULL && (!RetVal->getType()->isPointerTy() || !RetVal->getType()->getNonOpaquePointerElementType()->isFunctionTy()))
 		{
@@ -1913,7 +3802,9 @@ namespace jimpilier
 			// dtypes[name] = Arg.getType();
 		}
 		llvm::Instruction *currentEntry = &BB->getIterator()->back();
+		FunctionScopeState outerScopes = enterFunctionScope();
 		llvm::Value *RetVal = body == NULL ? NULL : body->codegen();
+		exitFunctionScope(outerScopes);
 
 		if (RetVal != NULL && (!RetVal->getType()->isPointerTy() || !RetVal->getType()->getNonOpaquePointerElementType()->isFunctionTy()))
 		{
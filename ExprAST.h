@@ -56,6 +56,7 @@ namespace jimpilier
 
 	public:
 		VariableExprAST(const std::string &Name) : Name(Name) {}
+		const std::string &getName() { return Name; }
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
 
@@ -68,10 +69,10 @@ namespace jimpilier
 		const std::string name;
 		std::unique_ptr<jimpilier::TypeExpr> type;
 		int size;
-		bool lateinit;
+		bool lateinit, atomic, constant;
 
 	public:
-		DeclareExprAST(const std::string Name, std::unique_ptr<jimpilier::TypeExpr> type, bool isLateInit = false, int ArrSize = 1) : name(Name), type(std::move(type)), size(ArrSize), lateinit(isLateInit) {}
+		DeclareExprAST(const std::string Name, std::unique_ptr<jimpilier::TypeExpr> type, bool isLateInit = false, int ArrSize = 1, bool isAtomic = false, bool isConst = false) : name(Name), type(std::move(type)), size(ArrSize), lateinit(isLateInit), atomic(isAtomic), constant(isConst) {}
 
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
@@ -142,6 +143,7 @@ namespace jimpilier
 	public:
 		IndexExprAST(std::unique_ptr<ExprAST> &base, std::unique_ptr<ExprAST> &offset) : bas(std::move(base)), offs(std::move(offset)) {};
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
+		llvm::Value *codegenMember(bool autoDeref, const std::string &member, bool &indexedMember);
 	};
 	class TypeCastExprAST : public ExprAST
 	{
@@ -194,6 +196,17 @@ namespace jimpilier
 			return cache[argNo][subArgNo];
 		}
 	public:
+		/**
+		 * @brief If this is a single `lhs < rhs` comparison, gets its two sides
+		 */
+		bool getLessThan(ExprAST *&lhs, ExprAST *&rhs)
+		{
+			if (operations.size() != 1 || operations[0] != LESS || items[0].size() != 1 || items[1].size() != 1)
+				return false;
+			lhs = items[0][0].get();
+			rhs = items[1][0].get();
+			return true;
+		}
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
 
@@ -256,9 +269,13 @@ namespace jimpilier
 	};
 	class HeapExprAST : public ExprAST
 	{
+		std::unique_ptr<ExprAST> arena;
 
 	public:
+		// Set by the constructor call being allocated when its type needs more than the usual heap alignment
+		uint64_t alignment = 0;
 		HeapExprAST() {}
+		HeapExprAST(std::unique_ptr<ExprAST> &arena) : arena(std::move(arena)) {}
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
 
@@ -270,6 +287,21 @@ namespace jimpilier
 		DeleteExprAST(std::unique_ptr<ExprAST> &deleteme) : val(std::move(deleteme)) {}
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
+	/**
+	 * @brief `await task`, or one of the await builtins (`await sleep(ms)`, `await readable(fd)`, `await writable(fd)`)
+	 * when no function with that name was declared
+	 */
+	class AwaitExprAST : public ExprAST
+	{
+		std::unique_ptr<ExprAST> task;
+		std::string builtin;
+		std::vector<std::unique_ptr<ExprAST>> args;
+
+	public:
+		AwaitExprAST(std::unique_ptr<ExprAST> &task) : task(std::move(task)) {}
+		AwaitExprAST(const std::string &builtin, std::vector<std::unique_ptr<ExprAST>> &args) : builtin(builtin), args(std::move(args)) {}
+		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
+	};
 	/**
 	 * @brief Represents a for loop in LLVM IR, currently does not support for each statements
 	 *
@@ -295,6 +327,28 @@ namespace jimpilier
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
 
+	/**
+	 * @brief A `parallel for` loop. The body is outlined into its own function (see Parallel.cpp), which gets the loop's locals by address,
+	 * and a private copy of each reduction variable that's combined back into the real one when it's done
+	 */
+	class ParallelForExprAST : public ExprAST
+	{
+		std::unique_ptr<TypeExpr> indexType;
+		std::string indexName;
+		std::unique_ptr<ExprAST> start, end, body;
+		bool inclusive;
+		/**
+		 * @brief (operator, variable) pairs; the operator is one of +, *, min or max
+		 */
+		std::vector<std::pair<std::string, std::string>> reductions;
+
+	public:
+		ParallelForExprAST(std::unique_ptr<TypeExpr> &indexType, const std::string &indexName, std::unique_ptr<ExprAST> &start, std::unique_ptr<ExprAST> &end, bool inclusive,
+						   std::vector<std::pair<std::string, std::string>> &reductions, std::unique_ptr<ExprAST> &body)
+			: indexType(std::move(indexType)), indexName(indexName), start(std::move(start)), end(std::move(end)), body(std::move(body)), inclusive(inclusive), reductions(reductions) {}
+		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
+	};
+
 	class RangeExprAST : public ExprAST
 	{
 		std::unique_ptr<ExprAST> start, end, step = NULL;
@@ -303,6 +357,7 @@ namespace jimpilier
 		RangeExprAST(std::unique_ptr<ExprAST> &st, std::unique_ptr<ExprAST> &fin) : start(std::move(st)), end(std::move(fin)) {}
 		RangeExprAST(std::unique_ptr<ExprAST> &st, std::unique_ptr<ExprAST> &fin, std::unique_ptr<ExprAST> &step) : start(std::move(st)), end(std::move(fin)), step(std::move(step)) {}
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
+		llvm::Value *codegenSlice(llvm::Value *base);
 	};
 
 	/**
@@ -345,10 +400,11 @@ namespace jimpilier
 	class AssignStmtAST : public ExprAST
 	{
 		std::unique_ptr<ExprAST> lhs, rhs;
+		bool add; // `lhs += rhs`
 
 	public:
-		AssignStmtAST(std::unique_ptr<ExprAST> &LHS, std::unique_ptr<ExprAST> &RHS)
-			: lhs(std::move(LHS)), rhs(std::move(RHS))
+		AssignStmtAST(std::unique_ptr<ExprAST> &LHS, std::unique_ptr<ExprAST> &RHS, bool add = false)
+			: lhs(std::move(LHS)), rhs(std::move(RHS)), add(add)
 		{}
 
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
@@ -447,7 +503,11 @@ namespace jimpilier
 	{
 	public:
 		std::vector<std::unique_ptr<ExprAST>> Contents;
-		CodeBlockAST(std::vector<std::unique_ptr<ExprAST>> &Args)
+		/**
+		 * @brief True for blocks written with curly braces; objects declared in them are destroyed at the closing brace
+		 */
+		bool isScope = false;
+		CodeBlockAST(std::vector<std::unique_ptr<ExprAST>> &Args, bool isScope = false) : isScope(isScope)
 		{
 			for (auto &x : Args)
 			{
@@ -466,6 +526,8 @@ namespace jimpilier
 
 	public:
 		MemberAccessExprAST(std::unique_ptr<ExprAST> &base, std::string offset, bool deref = false) : base(std::move(base)), member(offset), dereferenceParent(deref) {}
+		const std::string &getMember() { return member; }
+		ExprAST *getBase() { return dereferenceParent ? NULL : base.get(); }
 		// TODO: FIX ME
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
@@ -475,6 +537,14 @@ namespace jimpilier
 	{
 		std::string Callee;
 		std::vector<std::unique_ptr<ExprAST>> Args;
+		/**
+		 * @brief The SIMD builtins (shuffle, reduce_*, vload & vstore). Only used when no function with the same name was declared
+		 */
+		llvm::Value *vectorBuiltinCodegen();
+		/**
+		 * @brief The atomic builtins (atomic_load, atomic_store, atomic_swap, compare_exchange & fetch_*). Only used when no function with the same name was declared
+		 */
+		llvm::Value *atomicBuiltinCodegen();
 
 	public:
 		CallExprAST(const std::string callee, std::vector<std::unique_ptr<ExprAST>> &Arg) : Callee(callee), Args(std::move(Arg))
@@ -543,6 +613,24 @@ namespace jimpilier
 		llvm::Value *codegen(bool autoderef = false, llvm::Value *other = NULL); 
 	};
 
+	/**
+	 * @brief An object's destructor; called automatically when a local object goes out of scope, or when it's deleted
+	 */
+	class DestructorExprAST : public ExprAST
+	{
+		std::unique_ptr<ExprAST> bod;
+		std::string objName;
+
+	public:
+		DestructorExprAST(
+			std::unique_ptr<ExprAST> &body,
+			std::string objName) : bod(std::move(body)), objName(objName) {};
+		void replaceTemplate(std::string &name, std::unique_ptr<TypeExpr> *ty = NULL){
+			objName = name; 
+		}; 
+		llvm::Value *codegen(bool autoderef = false, llvm::Value *other = NULL); 
+	};
+
 	class ObjectHeaderExpr
 	{
 	public:
@@ -554,14 +642,31 @@ namespace jimpilier
 	/**
 	 * The class definition for an object (struct) in memory
 	 */
+	enum FieldHeat
+	{
+		hotField,
+		normalField,
+		coldField
+	};
+	/**
+	 * @brief How an object wants its fields laid out. By default fields stay in the order they were declared,
+	 * so objects mirroring C structs (like _IO_FILE) keep the same layout
+	 */
+	struct ObjectLayout
+	{
+		bool packed = false; // Sort fields by alignment & size so as little padding as possible is needed
+		unsigned align = 0; // Minimum alignment (and size multiple) of the object, 0 for its natural alignment
+		std::vector<FieldHeat> heat; // One per field; hot fields go first, cold fields go last
+	};
 	class ObjectExprAST : public ExprAST
 	{
 		ObjectHeaderExpr base;
 		std::vector<Variable> vars;
 		std::vector<std::unique_ptr<ExprAST>> functions, ops;
+		ObjectLayout layout;
 	public:
 		ObjectExprAST(ObjectHeaderExpr &name, std::vector<Variable>&varArg,
-					  std::vector<std::unique_ptr<ExprAST>> &funcList, std::vector<std::unique_ptr<ExprAST>> &oplist) : base(std::move(name)), vars(std::move(varArg)), functions(std::move(funcList)), ops(std::move(oplist)) {
+					  std::vector<std::unique_ptr<ExprAST>> &funcList, std::vector<std::unique_ptr<ExprAST>> &oplist, ObjectLayout layout = ObjectLayout()) : base(std::move(name)), vars(std::move(varArg)), functions(std::move(funcList)), ops(std::move(oplist)), layout(layout) {
 					  };
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL); 
 	};
@@ -576,6 +681,7 @@ namespace jimpilier
 		std::unique_ptr<TypeExpr> retType;
 		std::vector<Variable> Args;
 		std::vector<std::unique_ptr<TypeExpr>> throwableTypes;
+		bool isConst = false; // Calls with constant arguments are run at compile time
 
 		PrototypeAST() {};
 
@@ -608,6 +714,24 @@ namespace jimpilier
 		void replaceTemplate(std::string &name, std::unique_ptr<TypeExpr> *ty = NULL){
 			Proto->parent = name; 
 		}
+		PrototypeAST &getProto(){
+			return *Proto; 
+		}
+		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
+	};
+	/**
+	 * @brief A generic function (`T max<T>(T a, T b)`). Nothing is generated until it's called; each call generates
+	 * (or reuses) a copy for the types its arguments have
+	 */
+	class TemplateFunctionAST : public ExprAST
+	{
+		std::string name;
+		std::vector<std::string> templates;
+		std::unique_ptr<FunctionAST> function;
+
+	public:
+		TemplateFunctionAST(const std::string &name, std::vector<std::string> &templateNames, std::unique_ptr<FunctionAST> &function)
+			: name(name), templates(std::move(templateNames)), function(std::move(function)) {}
 		llvm::Value *codegen(bool autoDeref = true, llvm::Value *other = NULL);
 	};
 
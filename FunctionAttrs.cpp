@@ -0,0 +1,254 @@
+#pragma once
+#include <map>
+#include <set>
+#include <spdlog/spdlog.h>
+#include "llvm/IR/Argument.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "globals.cpp"
+#include "Allocator.cpp"
+namespace jimpilier
+{
+	/*
+	 * Function attribute inference. Runs over the finished module (after escape analysis), and marks functions with what the
+	 * optimizer can't always work out for itself across calls:
+	 * nounwind					= the function never lets an error escape; it either doesn't throw, or catches everything it throws
+	 * readnone/readonly		= the function doesn't touch memory outside of its own locals / only reads it
+	 * argmemonly				= the only outside memory the function touches is what its pointer & reference arguments point to
+	 * nocapture				= (on an argument) the function doesn't keep the pointer anywhere that outlives the call
+	 * noalias readonly			= (on an argument) the function doesn't write to any outside memory, so nothing can change what the argument points to
+	 * Everything is worked out from the generated IR rather than the `throws` declarations, since a function can throw without declaring it.
+	 */
+	enum MemoryEffect
+	{
+		readsArgs = 1,
+		writesArgs = 2,
+		readsOther = 4,
+		writesOther = 8,
+		anyMemoryEffect = readsArgs | writesArgs | readsOther | writesOther
+	};
+	/**
+	 * @brief Values getPointerOrigin() returns for pointers that don't come from an argument
+	 */
+	const int originLocal = -2, originUnknown = -1;
+
+	/**
+	 * @brief Works out where a pointer points: into one of the function's own locals, into what one of its arguments points to
+	 * (the argument's number is returned), or anywhere else.
+	 * Jimbo copies every argument into a local before using it, so loads from a local that only ever holds one argument are followed too.
+	 */
+	int getPointerOrigin(llvm::Value *ptr, int depth = 0)
+	{
+		while (true)
+		{
+			if (llvm::GEPOperator *gep = llvm::dyn_cast<llvm::GEPOperator>(ptr))
+				ptr = gep->getPointerOperand();
+			else if (llvm::BitCastOperator *cast = llvm::dyn_cast<llvm::BitCastOperator>(ptr))
+				ptr = cast->getOperand(0);
+			else
+				break;
+		}
+		if (llvm::isa<llvm::AllocaInst>(ptr))
+			return originLocal;
+		if (llvm::Argument *arg = llvm::dyn_cast<llvm::Argument>(ptr))
+			return arg->getArgNo();
+		llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(ptr);
+		llvm::AllocaInst *slot = load == NULL ? NULL : llvm::dyn_cast<llvm::AllocaInst>(load->getPointerOperand());
+		if (slot == NULL || depth >= 4)
+			return originUnknown;
+		int origin = originUnknown;
+		bool first = true;
+		for (llvm::User *user : slot->users())
+		{
+			if (llvm::isa<llvm::LoadInst>(user) || isLifetimeMarker(user))
+				continue;
+			llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(user);
+			// If the local's address is taken, anything could be written into it
+			if (store == NULL || store->getPointerOperand() != slot)
+				return originUnknown;
+			llvm::Value *stored = store->getValueOperand();
+			if (llvm::isa<llvm::Constant>(stored) && ((llvm::Constant *)stored)->isNullValue())
+				continue;
+			int storedOrigin = getPointerOrigin(stored, depth + 1);
+			if (!first && storedOrigin != origin)
+				return originUnknown;
+			origin = storedOrigin;
+			first = false;
+		}
+		return origin;
+	}
+
+	/**
+	 * @brief The memory effect of reading (or writing) through a pointer, given where it points
+	 */
+	int getAccessEffect(llvm::Value *ptr, bool write)
+	{
+		int origin = getPointerOrigin(ptr);
+		if (origin == originLocal)
+			return 0;
+		if (origin == originUnknown)
+			return write ? writesOther : readsOther;
+		return write ? writesArgs : readsArgs;
+	}
+
+	/**
+	 * @brief The memory effects of one call, given what we currently know about the function being called
+	 */
+	int getCallEffect(llvm::CallBase *call, std::map<llvm::Function *, int> &effects)
+	{
+		llvm::Function *callee = call->getCalledFunction();
+		if (callee == NULL)
+			return anyMemoryEffect;
+		switch (callee->getIntrinsicID())
+		{
+		case llvm::Intrinsic::lifetime_start:
+		case llvm::Intrinsic::lifetime_end:
+			return 0;
+		case llvm::Intrinsic::memset:
+			return getAccessEffect(call->getArgOperand(0), true);
+		case llvm::Intrinsic::memcpy:
+		case llvm::Intrinsic::memmove:
+			return getAccessEffect(call->getArgOperand(0), true) | getAccessEffect(call->getArgOperand(1), false);
+		default:
+			break;
+		}
+		int calleeEffect;
+		if (effects.count(callee))
+			calleeEffect = effects[callee];
+		else if (callee->doesNotAccessMemory())
+			calleeEffect = 0;
+		else if (callee->onlyReadsMemory())
+			calleeEffect = callee->onlyAccessesArgMemory() ? readsArgs : readsArgs | readsOther;
+		else
+			calleeEffect = callee->onlyAccessesArgMemory() ? readsArgs | writesArgs : anyMemoryEffect;
+		int effect = calleeEffect & (readsOther | writesOther);
+		if (calleeEffect & (readsArgs | writesArgs))
+			for (llvm::Value *arg : call->args())
+				if (arg->getType()->isPointerTy())
+				{
+					if (calleeEffect & readsArgs)
+						effect |= getAccessEffect(arg, false);
+					if (calleeEffect & writesArgs)
+						effect |= getAccessEffect(arg, true);
+				}
+		return effect;
+	}
+
+	int getInstructionEffect(llvm::Instruction &inst, std::map<llvm::Function *, int> &effects)
+	{
+		if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+			return load->isVolatile() ? anyMemoryEffect : getAccessEffect(load->getPointerOperand(), false);
+		if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+			return store->isVolatile() ? anyMemoryEffect : getAccessEffect(store->getPointerOperand(), true);
+		if (llvm::CallBase *call = llvm::dyn_cast<llvm::CallBase>(&inst))
+			return getCallEffect(call, effects);
+		return inst.mayReadOrWriteMemory() ? anyMemoryEffect : 0;
+	}
+
+	/**
+	 * @brief Whether a call can let an error escape, given what we currently know about which functions can
+	 */
+	bool callMayUnwind(llvm::CallInst *call, std::set<llvm::Function *> &unwinding)
+	{
+		if (call->isInlineAsm())
+			return false;
+		llvm::Function *callee = call->getCalledFunction();
+		if (callee == NULL)
+			return true;
+		if (callee->doesNotThrow())
+			return false;
+		// Besides the C++ runtime's throw functions, the only functions we declare without defining them come from the C standard library
+		if (callee->isDeclaration())
+			return callee->getName() == "__cxa_throw" || callee->getName() == "__cxa_rethrow" || callee->getName() == "_Unwind_Resume";
+		return unwinding.count(callee);
+	}
+
+	/**
+	 * @brief Infers nounwind, memory & argument attributes for every function defined in the module.
+	 * Starts out assuming the best about every function and works backwards until nothing changes, so recursive functions get attributes too.
+	 *
+	 * @return int - the number of functions that got at least one new attribute
+	 */
+	int inferFunctionAttributes(llvm::Module &module)
+	{
+		std::vector<llvm::Function *> funcs;
+		std::map<llvm::Function *, int> effects;
+		std::set<llvm::Function *> unwinding;
+		for (llvm::Function &func : module)
+			if (!func.isDeclaration())
+			{
+				funcs.push_back(&func);
+				effects[&func] = 0;
+			}
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			for (llvm::Function *func : funcs)
+			{
+				int effect = effects[func];
+				bool mayUnwind = unwinding.count(func);
+				for (llvm::BasicBlock &block : *func)
+					for (llvm::Instruction &inst : block)
+					{
+						effect |= getInstructionEffect(inst, effects);
+						if (llvm::isa<llvm::ResumeInst>(inst))
+							mayUnwind = true;
+						else if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst))
+							mayUnwind |= callMayUnwind(call, unwinding);
+					}
+				if (effect != effects[func] || mayUnwind != (bool)unwinding.count(func))
+					changed = true;
+				effects[func] = effect;
+				if (mayUnwind)
+					unwinding.insert(func);
+			}
+		}
+
+		int marked = 0;
+		for (llvm::Function *func : funcs)
+		{
+			int effect = effects[func];
+			bool writesOutside = effect & (writesArgs | writesOther);
+			bool isMarked = false;
+			if (!unwinding.count(func))
+			{
+				func->addFnAttr(llvm::Attribute::NoUnwind);
+				isMarked = true;
+			}
+			if (effect == 0)
+				func->addFnAttr(llvm::Attribute::ReadNone);
+			else if (!writesOutside)
+				func->addFnAttr(llvm::Attribute::ReadOnly);
+			if (effect != 0 && !(effect & (readsOther | writesOther)))
+				func->addFnAttr(llvm::Attribute::ArgMemOnly);
+			isMarked |= effect == 0 || !writesOutside || !(effect & (readsOther | writesOther));
+			for (llvm::Argument &arg : func->args())
+			{
+				if (!arg.getType()->isPointerTy())
+					continue;
+				bool returned = false;
+				if (argumentEscapes(func, arg.getArgNo(), returned, 0) || returned)
+					continue;
+				arg.addAttr(llvm::Attribute::NoCapture);
+				// If nothing outside the function gets written, nothing can change what the argument points to while it runs
+				if (!writesOutside)
+				{
+					arg.addAttr(llvm::Attribute::NoAlias);
+					arg.addAttr(llvm::Attribute::ReadOnly);
+				}
+				isMarked = true;
+			}
+			if (isMarked)
+			{
+				spdlog::debug("Inferred attributes for {}(): {}", func->getName().str(), func->getAttributes().getAsString(llvm::AttributeList::FunctionIndex));
+				marked++;
+			}
+		}
+		return marked;
+	}
+}
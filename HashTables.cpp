@@ -0,0 +1,707 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "globals.cpp"
+#include "TypeExpr.h"
+#include "Allocator.cpp"
+#include "Strings.cpp"
+namespace jimpilier
+{
+	/*
+	 * The built-in `map<K, V>` & `set<K>` objects: open addressing hash tables laid out like Abseil's SwissTable,
+	 * { i64 size, i64 capacity, i64 growthLeft, i8* control, K* keys[, V* values] }, generated for each key (& value) type the first time it's used.
+	 * Every slot has a control byte: -128 while it's empty, -2 once something's been removed from it, and the low 7 bits of its key's hash
+	 * while it's full. Slots come in groups of 16, and a lookup compares the hash bits against all 16 control bytes of a group at once
+	 * (one SIMD compare), so only keys whose bits match are ever compared; it stops at the first group with an empty slot in it.
+	 * Groups are probed 1, 2, 3... groups apart, which visits every group since there's always a power of two of them, and the table grows
+	 * before it's more than 7/8 full, so there's always an empty slot to stop at. A zeroed table is a valid, empty table that hasn't allocated anything.
+	 */
+	const int64_t hashGroupWidth = 16, hashTableMinCapacity = 16;
+	const int8_t hashCtrlEmpty = -128, hashCtrlDeleted = -2;
+	enum HashTableField
+	{
+		hashTableSize,
+		hashTableCapacity,
+		hashTableGrowthLeft,
+		hashTableControl,
+		hashTableKeys,
+		hashTableValues
+	};
+	/**
+	 * @brief The key & value (NULL for sets) types of each hash table type
+	 */
+	std::map<llvm::Type *, std::pair<llvm::Type *, llvm::Type *>> hashTableTypes;
+
+	/**
+	 * @brief Whether a type is a built-in `map<K, V>` or `set<K>`
+	 */
+	bool isHashTableType(llvm::Type *ty)
+	{
+		return ty != NULL && hashTableTypes.count(ty) != 0;
+	}
+	llvm::Type *getHashTableKeyType(llvm::Type *ty)
+	{
+		return hashTableTypes[ty].first;
+	}
+	llvm::Type *getHashTableValueType(llvm::Type *ty)
+	{
+		return hashTableTypes[ty].second;
+	}
+	llvm::Value *loadHashTableField(llvm::StructType *tableTy, llvm::Value *table, HashTableField field, const llvm::Twine &name)
+	{
+		return builder->CreateLoad(tableTy->getElementType(field), builder->CreateStructGEP(tableTy, table, field, name + "ptr"), name);
+	}
+	void storeHashTableField(llvm::StructType *tableTy, llvm::Value *table, HashTableField field, llvm::Value *val)
+	{
+		builder->CreateStore(val, builder->CreateStructGEP(tableTy, table, field, "fieldptr"));
+	}
+	/**
+	 * @brief Keys are passed around by pointer if they're strings (so they're never copied just to be looked up), and by value otherwise
+	 */
+	llvm::Type *getHashKeyArgType(llvm::Type *keyTy)
+	{
+		return isStringType(keyTy) ? keyTy->getPointerTo() : keyTy;
+	}
+	/**
+	 * @brief What a key in a slot is passed around as (see getHashKeyArgType)
+	 */
+	llvm::Value *loadHashKey(llvm::Type *keyTy, llvm::Value *slotPtr)
+	{
+		return isStringType(keyTy) ? slotPtr : builder->CreateLoad(keyTy, slotPtr, "key");
+	}
+	/**
+	 * @brief -0.0 and 0.0 are the same key, so floating point keys are hashed & compared after adding 0 (which turns -0.0 into 0.0)
+	 */
+	llvm::Value *createFloatKeyBits(llvm::Value *key)
+	{
+		llvm::Type *ty = key->getType();
+		llvm::Value *normalized = builder->CreateFAdd(key, llvm::ConstantFP::get(ty, 0.0), "normalizedkey");
+		return builder->CreateBitCast(normalized, builder->getIntNTy(ty->getPrimitiveSizeInBits()), "keybits");
+	}
+	/**
+	 * @brief The hash of a key, picked for its type when the table is generated: numbers & pointers hash their bits,
+	 * strings use (and cache) their own hash. Either way it's mixed with MurmurHash3's finalizer, so both the 7 bits
+	 * that go in the control bytes & the bits that pick the first group are worth using
+	 */
+	llvm::Value *createHashKey(llvm::Type *keyTy, llvm::Value *key)
+	{
+		llvm::Type *i64 = builder->getInt64Ty();
+		llvm::Value *bits;
+		if (isStringType(keyTy))
+			bits = builder->CreateCall(getStringFunction("hash"), {key}, "stringhash");
+		else if (keyTy->isPointerTy())
+			bits = builder->CreatePtrToInt(key, i64, "keybits");
+		else if (keyTy->isFloatingPointTy())
+			bits = builder->CreateZExt(createFloatKeyBits(key), i64, "keybits");
+		else
+			bits = builder->CreateZExt(key, i64, "keybits");
+		bits = builder->CreateXor(bits, builder->CreateLShr(bits, 33), "mix");
+		bits = builder->CreateMul(bits, builder->getInt64(0xff51afd7ed558ccdULL), "mix");
+		bits = builder->CreateXor(bits, builder->CreateLShr(bits, 33), "mix");
+		bits = builder->CreateMul(bits, builder->getInt64(0xc4ceb9fe1a85ec53ULL), "mix");
+		return builder->CreateXor(bits, builder->CreateLShr(bits, 33), "hash");
+	}
+	llvm::Value *createHashKeysEqual(llvm::Type *keyTy, llvm::Value *lhs, llvm::Value *rhs)
+	{
+		if (isStringType(keyTy))
+			return builder->CreateCall(getStringFunction("equals"), {lhs, rhs}, "samekey");
+		if (keyTy->isFloatingPointTy())
+			return builder->CreateICmpEQ(createFloatKeyBits(lhs), createFloatKeyBits(rhs), "samekey");
+		return builder->CreateICmpEQ(lhs, rhs, "samekey");
+	}
+	/**
+	 * @brief One group of 16 control bytes, starting at slot `base` (a multiple of 16, and malloc()ed buffers are 16 byte aligned)
+	 */
+	llvm::Value *loadHashGroup(llvm::Value *ctrl, llvm::Value *base)
+	{
+		llvm::Type *groupTy = llvm::FixedVectorType::get(builder->getInt8Ty(), hashGroupWidth);
+		llvm::Value *groupPtr = builder->CreateBitCast(builder->CreateInBoundsGEP(builder->getInt8Ty(), ctrl, base, "groupbytes"), groupTy->getPointerTo(), "groupptr");
+		return builder->CreateAlignedLoad(groupTy, groupPtr, llvm::MaybeAlign(hashGroupWidth), "group");
+	}
+	/**
+	 * @brief A bitmask of which control bytes in a group matched (bit i is slot i of the group); the equivalent of SSE2's pmovmskb
+	 */
+	llvm::Value *createGroupMask(llvm::Value *matches)
+	{
+		return builder->CreateZExt(builder->CreateBitCast(matches, builder->getIntNTy(hashGroupWidth), "matchbits"), builder->getInt64Ty(), "matchmask");
+	}
+	/**
+	 * @brief The smallest capacity (a power of two, at least 16) that holds `count` entries without being more than 7/8 full
+	 */
+	llvm::Value *createHashCapacityFor(llvm::Value *count)
+	{
+		llvm::Type *i64 = builder->getInt64Ty();
+		llvm::Value *slots = builder->CreateAdd(builder->CreateUDiv(builder->CreateMul(count, builder->getInt64(8), "count8"), builder->getInt64(7), "slots"), builder->getInt64(1), "slots");
+		llvm::Function *ctlz = llvm::Intrinsic::getDeclaration(GlobalVarsAndFunctions.get(), llvm::Intrinsic::ctlz, {i64});
+		llvm::Value *leadingZeros = builder->CreateCall(ctlz, {builder->CreateSub(slots, builder->getInt64(1), "slotsminus1"), builder->getFalse()}, "leadingzeros");
+		llvm::Value *pow2 = builder->CreateShl(builder->getInt64(1), builder->CreateSub(builder->getInt64(64), leadingZeros, "bits"), "pow2");
+		return builder->CreateSelect(builder->CreateICmpULT(pow2, builder->getInt64(hashTableMinCapacity), "toosmall"), builder->getInt64(hashTableMinCapacity), pow2, "capacity");
+	}
+	/**
+	 * @brief The number of entries a table of `capacity` slots can hold before it has to grow (7/8 of them)
+	 */
+	llvm::Value *createHashMaxLoad(llvm::Value *capacity)
+	{
+		return builder->CreateSub(capacity, builder->CreateLShr(capacity, 3, "eighth"), "maxload");
+	}
+
+	/**
+	 * @brief Generates everything a `map<K, V>` or `set<K>` can do (valueTy is NULL for sets): contains, remove, reserve, rehash, clear,
+	 * copy, the destructor, insert for sets & `[]` for maps (through `[map]::slot`, see createHashMapIndex). Keys & values are moved around
+	 * when the table grows, strings used as keys are copied in, and anything with a destructor is destroyed when it's removed
+	 */
+	void generateHashTableFunctions(llvm::StructType *tableTy, std::unique_ptr<TypeExpr> &keyExp, llvm::Type *keyTy, llvm::Type *valueTy)
+	{
+		std::string tableName = tableTy->getName().str();
+		spdlog::debug("Creating {} helper functions", tableName);
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *i64 = builder->getInt64Ty(), *i8 = builder->getInt8Ty(), *bytePtrTy = builder->getInt8PtrTy();
+		llvm::PointerType *tablePtrTy = tableTy->getPointerTo();
+		llvm::Type *keyArgTy = getHashKeyArgType(keyTy);
+		llvm::Type *groupTy = llvm::FixedVectorType::get(i8, hashGroupWidth);
+		llvm::Function *cttz = llvm::Intrinsic::getDeclaration(GlobalVarsAndFunctions.get(), llvm::Intrinsic::cttz, {i64});
+		llvm::Function *keyDtor = getObjectDestructor(keyTy), *valueDtor = valueTy == NULL ? NULL : getObjectDestructor(valueTy);
+		llvm::Function *keyCopier = getObjectCopier(keyTy), *valueCopier = valueTy == NULL ? NULL : getObjectCopier(valueTy);
+		auto createFunction = [&](llvm::Type *retTy, std::vector<llvm::Type *> args, const std::string &name, bool internal)
+		{
+			return llvm::Function::Create(llvm::FunctionType::get(retTy, args, false), internal ? llvm::Function::InternalLinkage : llvm::Function::ExternalLinkage, tableName + "::" + name, GlobalVarsAndFunctions.get());
+		};
+		// Runs `body` on every full slot of a table's buffers, then carries on in the block after the loop
+		auto forEachFullSlot = [&](llvm::Function *func, llvm::Value *ctrl, llvm::Value *capacity, std::function<void(llvm::Value *)> body)
+		{
+			llvm::BasicBlock *before = builder->GetInsertBlock(),
+							 *loop = llvm::BasicBlock::Create(*ctxt, "slotloop", func),
+							 *full = llvm::BasicBlock::Create(*ctxt, "fullslot", func),
+							 *next = llvm::BasicBlock::Create(*ctxt, "nextslot", func),
+							 *after = llvm::BasicBlock::Create(*ctxt, "slotsdone", func);
+			builder->CreateCondBr(builder->CreateICmpEQ(capacity, builder->getInt64(0), "isempty"), after, loop);
+			builder->SetInsertPoint(loop);
+			llvm::PHINode *index = builder->CreatePHI(i64, 2, "slot");
+			index->addIncoming(builder->getInt64(0), before);
+			llvm::Value *control = builder->CreateLoad(i8, builder->CreateInBoundsGEP(i8, ctrl, index, "controlptr"), "control");
+			builder->CreateCondBr(builder->CreateICmpSGE(control, builder->getInt8(0), "isfull"), full, next);
+			builder->SetInsertPoint(full);
+			body(index);
+			builder->CreateBr(next);
+			builder->SetInsertPoint(next);
+			llvm::Value *nextindex = builder->CreateAdd(index, builder->getInt64(1), "nextslot");
+			index->addIncoming(nextindex, next);
+			builder->CreateCondBr(builder->CreateICmpULT(nextindex, capacity, "cmptmp"), loop, after);
+			builder->SetInsertPoint(after);
+		};
+		// Destroys the key (& value) in a slot, if they have destructors
+		auto destroySlot = [&](llvm::Value *keys, llvm::Value *values, llvm::Value *slot)
+		{
+			if (keyDtor != NULL)
+				builder->CreateCall(keyDtor, {builder->CreateInBoundsGEP(keyTy, keys, slot, "keyptr")});
+			if (valueDtor != NULL)
+				builder->CreateCall(valueDtor, {builder->CreateInBoundsGEP(valueTy, values, slot, "valueptr")});
+		};
+
+		spdlog::debug("Implementing {} probing functions", tableName);
+		// findFree(i8* control, i64 capacity, i64 hash): the first empty (or removed) slot in the hash's probe sequence
+		llvm::Function *findFree = createFunction(i64, {bytePtrTy, i64, i64}, "findFree", true);
+		llvm::Value *ctrl = findFree->getArg(0), *capacity = findFree->getArg(1), *hash = findFree->getArg(2);
+		ctrl->setName("control");
+		capacity->setName("capacity");
+		hash->setName("hash");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", findFree),
+						 *probe = llvm::BasicBlock::Create(*ctxt, "probe", findFree),
+						 *found = llvm::BasicBlock::Create(*ctxt, "found", findFree),
+						 *nextgroup = llvm::BasicBlock::Create(*ctxt, "nextgroup", findFree);
+		builder->SetInsertPoint(entry);
+		llvm::Value *groupMask = builder->CreateSub(builder->CreateLShr(capacity, 4, "groups"), builder->getInt64(1), "groupmask");
+		llvm::Value *firstGroup = builder->CreateAnd(builder->CreateLShr(hash, 7, "h1"), groupMask, "firstgroup");
+		builder->CreateBr(probe);
+		builder->SetInsertPoint(probe);
+		llvm::PHINode *groupIndex = builder->CreatePHI(i64, 2, "groupindex"), *step = builder->CreatePHI(i64, 2, "step");
+		llvm::Value *base = builder->CreateShl(groupIndex, 4, "base");
+		llvm::Value *group = loadHashGroup(ctrl, base);
+		// Empty & removed slots are the ones with the top bit set
+		llvm::Value *freeMask = createGroupMask(builder->CreateICmpSLT(group, llvm::Constant::getNullValue(groupTy), "isfree"));
+		builder->CreateCondBr(builder->CreateICmpNE(freeMask, builder->getInt64(0), "hasfree"), found, nextgroup, llvm::MDBuilder(*ctxt).createBranchWeights(2000, 1));
+		builder->SetInsertPoint(found);
+		builder->CreateRet(builder->CreateAdd(base, builder->CreateCall(cttz, {freeMask, builder->getTrue()}, "offset"), "slot"));
+		builder->SetInsertPoint(nextgroup);
+		llvm::Value *nextstep = builder->CreateAdd(step, builder->getInt64(1), "nextstep");
+		groupIndex->addIncoming(firstGroup, entry);
+		groupIndex->addIncoming(builder->CreateAnd(builder->CreateAdd(groupIndex, nextstep, "nextgroup"), groupMask, "nextgroup"), nextgroup);
+		step->addIncoming(builder->getInt64(0), entry);
+		step->addIncoming(nextstep, nextgroup);
+		builder->CreateBr(probe);
+		llvm::verifyFunction(*findFree);
+
+		// find(table@, K key): the slot the key is in, or -1 if it isn't in the table
+		llvm::Function *find = createFunction(i64, {tablePtrTy, keyArgTy}, "find", true);
+		llvm::Value *tableptr = find->getArg(0), *key = find->getArg(1);
+		tableptr->setName("this");
+		key->setName("key");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", find);
+		llvm::BasicBlock *search = llvm::BasicBlock::Create(*ctxt, "search", find),
+						 *matchcheck = llvm::BasicBlock::Create(*ctxt, "matchcheck", find),
+						 *compare = llvm::BasicBlock::Create(*ctxt, "compare", find),
+						 *nomatch = llvm::BasicBlock::Create(*ctxt, "nomatch", find),
+						 *emptycheck = llvm::BasicBlock::Create(*ctxt, "emptycheck", find),
+						 *notfound = llvm::BasicBlock::Create(*ctxt, "notfound", find);
+		probe = llvm::BasicBlock::Create(*ctxt, "probe", find, matchcheck);
+		found = llvm::BasicBlock::Create(*ctxt, "found", find);
+		nextgroup = llvm::BasicBlock::Create(*ctxt, "nextgroup", find);
+		builder->SetInsertPoint(entry);
+		llvm::Value *size = loadHashTableField(tableTy, tableptr, hashTableSize, "size");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "isempty"), notfound, search);
+		builder->SetInsertPoint(search);
+		capacity = loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity");
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "control");
+		llvm::Value *keys = loadHashTableField(tableTy, tableptr, hashTableKeys, "keys");
+		hash = createHashKey(keyTy, key);
+		llvm::Value *h2 = builder->CreateVectorSplat(hashGroupWidth, builder->CreateTrunc(builder->CreateAnd(hash, builder->getInt64(127), "h2"), i8, "h2"), "h2s");
+		groupMask = builder->CreateSub(builder->CreateLShr(capacity, 4, "groups"), builder->getInt64(1), "groupmask");
+		firstGroup = builder->CreateAnd(builder->CreateLShr(hash, 7, "h1"), groupMask, "firstgroup");
+		builder->CreateBr(probe);
+
+		builder->SetInsertPoint(probe);
+		groupIndex = builder->CreatePHI(i64, 2, "groupindex");
+		step = builder->CreatePHI(i64, 2, "step");
+		base = builder->CreateShl(groupIndex, 4, "base");
+		group = loadHashGroup(ctrl, base);
+		llvm::Value *matchMask = createGroupMask(builder->CreateICmpEQ(group, h2, "matches"));
+		builder->CreateBr(matchcheck);
+
+		// Every slot whose control byte matched gets its key compared, lowest first
+		builder->SetInsertPoint(matchcheck);
+		llvm::PHINode *remaining = builder->CreatePHI(i64, 2, "remaining");
+		remaining->addIncoming(matchMask, probe);
+		builder->CreateCondBr(builder->CreateICmpEQ(remaining, builder->getInt64(0), "nomatches"), emptycheck, compare);
+		builder->SetInsertPoint(compare);
+		llvm::Value *slot = builder->CreateAdd(base, builder->CreateCall(cttz, {remaining, builder->getTrue()}, "offset"), "slot");
+		llvm::Value *stored = loadHashKey(keyTy, builder->CreateInBoundsGEP(keyTy, keys, slot, "keyptr"));
+		builder->CreateCondBr(createHashKeysEqual(keyTy, stored, key), found, nomatch, llvm::MDBuilder(*ctxt).createBranchWeights(2000, 1));
+		builder->SetInsertPoint(found);
+		builder->CreateRet(slot);
+		builder->SetInsertPoint(nomatch);
+		remaining->addIncoming(builder->CreateAnd(remaining, builder->CreateSub(remaining, builder->getInt64(1), "lowestbit"), "remaining"), nomatch);
+		builder->CreateBr(matchcheck);
+
+		// A group with an empty slot ends the search: the key would've gone there if it got this far
+		builder->SetInsertPoint(emptycheck);
+		llvm::Value *emptyMask = createGroupMask(builder->CreateICmpEQ(group, llvm::ConstantVector::getSplat(llvm::ElementCount::getFixed(hashGroupWidth), builder->getInt8(hashCtrlEmpty)), "isempty"));
+		builder->CreateCondBr(builder->CreateICmpNE(emptyMask, builder->getInt64(0), "hasempty"), notfound, nextgroup, llvm::MDBuilder(*ctxt).createBranchWeights(2000, 1));
+		builder->SetInsertPoint(nextgroup);
+		nextstep = builder->CreateAdd(step, builder->getInt64(1), "nextstep");
+		groupIndex->addIncoming(firstGroup, search);
+		groupIndex->addIncoming(builder->CreateAnd(builder->CreateAdd(groupIndex, nextstep, "nextgroup"), groupMask, "nextgroup"), nextgroup);
+		step->addIncoming(builder->getInt64(0), search);
+		step->addIncoming(nextstep, nextgroup);
+		builder->CreateBr(probe);
+		builder->SetInsertPoint(notfound);
+		builder->CreateRet(builder->getInt64(-1));
+		llvm::verifyFunction(*find);
+
+		spdlog::debug("Implementing {} capacity functions", tableName);
+		// resize(table@, i64 capacity): move every entry into new buffers of `capacity` slots, which also clears out removed slots
+		llvm::Function *resize = createFunction(builder->getVoidTy(), {tablePtrTy, i64}, "resize", true);
+		// Growing is the slow path of inserting; keep it out of line
+		resize->addFnAttr(llvm::Attribute::NoInline);
+		tableptr = resize->getArg(0);
+		llvm::Value *newcapacity = resize->getArg(1);
+		tableptr->setName("this");
+		newcapacity->setName("capacity");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", resize));
+		capacity = loadHashTableField(tableTy, tableptr, hashTableCapacity, "oldcapacity");
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "oldcontrol");
+		keys = loadHashTableField(tableTy, tableptr, hashTableKeys, "oldkeys");
+		llvm::Value *values = valueTy == NULL ? NULL : loadHashTableField(tableTy, tableptr, hashTableValues, "oldvalues");
+		llvm::Value *newctrl = builder->CreateCall(getMallocFunction(), {newcapacity}, "newcontrol");
+		builder->CreateMemSet(newctrl, builder->getInt8(hashCtrlEmpty), newcapacity, llvm::MaybeAlign(hashGroupWidth));
+		llvm::Value *newkeys = builder->CreateBitCast(builder->CreateCall(getMallocFunction(), {builder->CreateMul(newcapacity, builder->getInt64(DataLayout->getTypeAllocSize(keyTy)), "keybytes")}, "newkeybytes"), keyTy->getPointerTo(), "newkeys");
+		llvm::Value *newvalues = valueTy == NULL ? NULL : builder->CreateBitCast(builder->CreateCall(getMallocFunction(), {builder->CreateMul(newcapacity, builder->getInt64(DataLayout->getTypeAllocSize(valueTy)), "valuebytes")}, "newvaluebytes"), valueTy->getPointerTo(), "newvalues");
+		forEachFullSlot(resize, ctrl, capacity, [&](llvm::Value *oldslot)
+						{
+			llvm::Value *keyptr = builder->CreateInBoundsGEP(keyTy, keys, oldslot, "keyptr");
+			llvm::Value *newslot = builder->CreateCall(findFree, {newctrl, newcapacity, createHashKey(keyTy, loadHashKey(keyTy, keyptr))}, "newslot");
+			builder->CreateStore(builder->CreateLoad(i8, builder->CreateInBoundsGEP(i8, ctrl, oldslot, "controlptr"), "control"), builder->CreateInBoundsGEP(i8, newctrl, newslot, "newcontrolptr"));
+			builder->CreateStore(builder->CreateLoad(keyTy, keyptr, "moved"), builder->CreateInBoundsGEP(keyTy, newkeys, newslot, "newkeyptr"));
+			if (valueTy != NULL)
+				builder->CreateStore(builder->CreateLoad(valueTy, builder->CreateInBoundsGEP(valueTy, values, oldslot, "valueptr"), "moved"), builder->CreateInBoundsGEP(valueTy, newvalues, newslot, "newvalueptr")); });
+		builder->CreateCall(getFreeFunction(), {ctrl});
+		builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(keys, bytePtrTy, "keybytes")});
+		if (valueTy != NULL)
+			builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(values, bytePtrTy, "valuebytes")});
+		storeHashTableField(tableTy, tableptr, hashTableCapacity, newcapacity);
+		storeHashTableField(tableTy, tableptr, hashTableControl, newctrl);
+		storeHashTableField(tableTy, tableptr, hashTableKeys, newkeys);
+		if (valueTy != NULL)
+			storeHashTableField(tableTy, tableptr, hashTableValues, newvalues);
+		size = loadHashTableField(tableTy, tableptr, hashTableSize, "size");
+		storeHashTableField(tableTy, tableptr, hashTableGrowthLeft, builder->CreateSub(createHashMaxLoad(newcapacity), size, "growthleft"));
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*resize);
+
+		spdlog::debug("Implementing {} insertion function", tableName);
+		// slot(table@, K key): the slot the key is in, after adding it (with a zeroed value) if it wasn't there already
+		llvm::Function *insertSlot = createFunction(i64, {tablePtrTy, keyArgTy}, "slot", valueTy == NULL);
+		tableptr = insertSlot->getArg(0);
+		key = insertSlot->getArg(1);
+		tableptr->setName("this");
+		key->setName("key");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", insertSlot);
+		llvm::BasicBlock *insert = llvm::BasicBlock::Create(*ctxt, "insert", insertSlot),
+						 *growblock = llvm::BasicBlock::Create(*ctxt, "grow", insertSlot),
+						 *place = llvm::BasicBlock::Create(*ctxt, "place", insertSlot);
+		found = llvm::BasicBlock::Create(*ctxt, "found", insertSlot);
+		builder->SetInsertPoint(entry);
+		llvm::Value *existing = builder->CreateCall(find, {tableptr, key}, "existing");
+		builder->CreateCondBr(builder->CreateICmpSGE(existing, builder->getInt64(0), "exists"), found, insert);
+		builder->SetInsertPoint(found);
+		builder->CreateRet(existing);
+		builder->SetInsertPoint(insert);
+		builder->CreateCondBr(builder->CreateICmpEQ(loadHashTableField(tableTy, tableptr, hashTableGrowthLeft, "growthleft"), builder->getInt64(0), "isfull"), growblock, place, llvm::MDBuilder(*ctxt).createBranchWeights(1, 2000));
+		// A table that's full of removed slots rather than entries is rebuilt at the same size instead of doubling
+		builder->SetInsertPoint(growblock);
+		capacity = loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity");
+		size = loadHashTableField(tableTy, tableptr, hashTableSize, "size");
+		llvm::Value *mostlyRemoved = builder->CreateICmpULT(builder->CreateMul(size, builder->getInt64(2), "size2"), createHashMaxLoad(capacity), "mostlyremoved");
+		newcapacity = builder->CreateSelect(mostlyRemoved, capacity, builder->CreateShl(capacity, 1, "doubled"), "newcapacity");
+		newcapacity = builder->CreateSelect(builder->CreateICmpEQ(capacity, builder->getInt64(0), "isempty"), builder->getInt64(hashTableMinCapacity), newcapacity, "newcapacity");
+		builder->CreateCall(resize, {tableptr, newcapacity});
+		builder->CreateBr(place);
+		builder->SetInsertPoint(place);
+		hash = createHashKey(keyTy, key);
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "control");
+		slot = builder->CreateCall(findFree, {ctrl, loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity"), hash}, "slot");
+		llvm::Value *controlptr = builder->CreateInBoundsGEP(i8, ctrl, slot, "controlptr");
+		// Reusing a removed slot doesn't use up any more of the table
+		llvm::Value *wasEmpty = builder->CreateICmpEQ(builder->CreateLoad(i8, controlptr, "control"), builder->getInt8(hashCtrlEmpty), "wasempty");
+		llvm::Value *growthleftptr = builder->CreateStructGEP(tableTy, tableptr, hashTableGrowthLeft, "growthleftptr");
+		builder->CreateStore(builder->CreateSub(builder->CreateLoad(i64, growthleftptr, "growthleft"), builder->CreateZExt(wasEmpty, i64, "used"), "growthleft"), growthleftptr);
+		builder->CreateStore(builder->CreateTrunc(builder->CreateAnd(hash, builder->getInt64(127), "h2"), i8, "h2"), controlptr);
+		keys = loadHashTableField(tableTy, tableptr, hashTableKeys, "keys");
+		builder->CreateStore(isStringType(keyTy) ? copyString(key) : key, builder->CreateInBoundsGEP(keyTy, keys, slot, "keyptr"));
+		if (valueTy != NULL)
+		{
+			values = loadHashTableField(tableTy, tableptr, hashTableValues, "values");
+			builder->CreateStore(llvm::Constant::getNullValue(valueTy), builder->CreateInBoundsGEP(valueTy, values, slot, "valueptr"));
+		}
+		llvm::Value *sizeptr = builder->CreateStructGEP(tableTy, tableptr, hashTableSize, "sizeptr");
+		builder->CreateStore(builder->CreateAdd(builder->CreateLoad(i64, sizeptr, "size"), builder->getInt64(1), "newsize"), sizeptr);
+		builder->CreateRet(slot);
+		llvm::verifyFunction(*insertSlot);
+
+		spdlog::debug("Implementing {} lookup & removal functions", tableName);
+		// contains(table@, K key)
+		llvm::Function *contains = createFunction(builder->getInt1Ty(), {tablePtrTy, keyArgTy}, "contains", false);
+		contains->getArg(0)->setName("this");
+		contains->getArg(1)->setName("key");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", contains));
+		builder->CreateRet(builder->CreateICmpSGE(builder->CreateCall(find, {contains->getArg(0), contains->getArg(1)}, "slot"), builder->getInt64(0), "found"));
+		llvm::verifyFunction(*contains);
+
+		// remove(table@, K key): whether the key was there to remove
+		llvm::Function *remove = createFunction(builder->getInt1Ty(), {tablePtrTy, keyArgTy}, "remove", false);
+		tableptr = remove->getArg(0);
+		key = remove->getArg(1);
+		tableptr->setName("this");
+		key->setName("key");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", remove);
+		llvm::BasicBlock *removeblock = llvm::BasicBlock::Create(*ctxt, "remove", remove);
+		notfound = llvm::BasicBlock::Create(*ctxt, "notfound", remove);
+		builder->SetInsertPoint(entry);
+		slot = builder->CreateCall(find, {tableptr, key}, "slot");
+		builder->CreateCondBr(builder->CreateICmpSLT(slot, builder->getInt64(0), "missing"), notfound, removeblock);
+		builder->SetInsertPoint(notfound);
+		builder->CreateRet(builder->getFalse());
+		builder->SetInsertPoint(removeblock);
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "control");
+		destroySlot(loadHashTableField(tableTy, tableptr, hashTableKeys, "keys"), valueTy == NULL ? NULL : loadHashTableField(tableTy, tableptr, hashTableValues, "values"), slot);
+		// If the slot's group has an empty slot, no search ever went past it, so the slot can be empty again too.
+		// Otherwise searches for keys further along have to keep going past it, so it's only marked as removed
+		group = loadHashGroup(ctrl, builder->CreateAnd(slot, builder->getInt64(-hashGroupWidth), "base"));
+		emptyMask = createGroupMask(builder->CreateICmpEQ(group, llvm::ConstantVector::getSplat(llvm::ElementCount::getFixed(hashGroupWidth), builder->getInt8(hashCtrlEmpty)), "isempty"));
+		llvm::Value *hasEmpty = builder->CreateICmpNE(emptyMask, builder->getInt64(0), "hasempty");
+		builder->CreateStore(builder->CreateSelect(hasEmpty, builder->getInt8(hashCtrlEmpty), builder->getInt8(hashCtrlDeleted), "control"), builder->CreateInBoundsGEP(i8, ctrl, slot, "controlptr"));
+		growthleftptr = builder->CreateStructGEP(tableTy, tableptr, hashTableGrowthLeft, "growthleftptr");
+		builder->CreateStore(builder->CreateAdd(builder->CreateLoad(i64, growthleftptr, "growthleft"), builder->CreateZExt(hasEmpty, i64, "freed"), "growthleft"), growthleftptr);
+		sizeptr = builder->CreateStructGEP(tableTy, tableptr, hashTableSize, "sizeptr");
+		builder->CreateStore(builder->CreateSub(builder->CreateLoad(i64, sizeptr, "size"), builder->getInt64(1), "newsize"), sizeptr);
+		builder->CreateRet(builder->getTrue());
+		llvm::verifyFunction(*remove);
+
+		spdlog::debug("Implementing {} reserve & rehash functions", tableName);
+		// reserve(table@, i64 count): make room for `count` entries, so adding that many never has to grow the table
+		llvm::Function *reserve = createFunction(builder->getVoidTy(), {tablePtrTy, i64}, "reserve", false);
+		tableptr = reserve->getArg(0);
+		llvm::Value *count = reserve->getArg(1);
+		tableptr->setName("this");
+		count->setName("count");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", reserve);
+		growblock = llvm::BasicBlock::Create(*ctxt, "grow", reserve);
+		llvm::BasicBlock *done = llvm::BasicBlock::Create(*ctxt, "done", reserve);
+		builder->SetInsertPoint(entry);
+		capacity = loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity");
+		builder->CreateCondBr(builder->CreateICmpSGT(count, createHashMaxLoad(capacity), "cmptmp"), growblock, done);
+		builder->SetInsertPoint(growblock);
+		builder->CreateCall(resize, {tableptr, createHashCapacityFor(count)});
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*reserve);
+
+		// destructor(table@): destroy every entry & free the buffers, leaving an empty table behind
+		llvm::Function *dtor = createFunction(builder->getVoidTy(), {tablePtrTy}, "destructor", false);
+		tableptr = dtor->getArg(0);
+		tableptr->setName("this");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", dtor));
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "control");
+		keys = loadHashTableField(tableTy, tableptr, hashTableKeys, "keys");
+		values = valueTy == NULL ? NULL : loadHashTableField(tableTy, tableptr, hashTableValues, "values");
+		if (keyDtor != NULL || valueDtor != NULL)
+			forEachFullSlot(dtor, ctrl, loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity"), [&](llvm::Value *slot)
+							{ destroySlot(keys, values, slot); });
+		builder->CreateCall(getFreeFunction(), {ctrl});
+		builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(keys, bytePtrTy, "keybytes")});
+		if (valueTy != NULL)
+			builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(values, bytePtrTy, "valuebytes")});
+		builder->CreateStore(llvm::Constant::getNullValue(tableTy), tableptr);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*dtor);
+
+		// copy(table@): a copy with buffers of its own, the same size as the original's so every entry stays in the same slot.
+		// Keys & values that own memory are copied too
+		llvm::Function *copy = createFunction(tableTy, {tablePtrTy}, "copy", true);
+		tableptr = copy->getArg(0);
+		tableptr->setName("source");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", copy);
+		llvm::BasicBlock *emptyblock = llvm::BasicBlock::Create(*ctxt, "empty", copy),
+						 *copyblock = llvm::BasicBlock::Create(*ctxt, "copy", copy);
+		builder->SetInsertPoint(entry);
+		capacity = loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity");
+		builder->CreateCondBr(builder->CreateICmpEQ(capacity, builder->getInt64(0), "isempty"), emptyblock, copyblock);
+		builder->SetInsertPoint(emptyblock);
+		builder->CreateRet(llvm::Constant::getNullValue(tableTy));
+		builder->SetInsertPoint(copyblock);
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "control");
+		keys = loadHashTableField(tableTy, tableptr, hashTableKeys, "keys");
+		values = valueTy == NULL ? NULL : loadHashTableField(tableTy, tableptr, hashTableValues, "values");
+		newctrl = builder->CreateCall(getMallocFunction(), {capacity}, "newcontrol");
+		builder->CreateMemCpy(newctrl, llvm::MaybeAlign(hashGroupWidth), ctrl, llvm::MaybeAlign(hashGroupWidth), capacity);
+		llvm::Value *keybytes = builder->CreateMul(capacity, builder->getInt64(DataLayout->getTypeAllocSize(keyTy)), "keybytes");
+		newkeys = builder->CreateBitCast(builder->CreateCall(getMallocFunction(), {keybytes}, "newkeybytes"), keyTy->getPointerTo(), "newkeys");
+		builder->CreateMemCpy(newkeys, llvm::MaybeAlign(), keys, llvm::MaybeAlign(), keybytes);
+		if (valueTy != NULL)
+		{
+			llvm::Value *valuebytes = builder->CreateMul(capacity, builder->getInt64(DataLayout->getTypeAllocSize(valueTy)), "valuebytes");
+			newvalues = builder->CreateBitCast(builder->CreateCall(getMallocFunction(), {valuebytes}, "newvaluebytes"), valueTy->getPointerTo(), "newvalues");
+			builder->CreateMemCpy(newvalues, llvm::MaybeAlign(), values, llvm::MaybeAlign(), valuebytes);
+		}
+		if (keyCopier != NULL || valueCopier != NULL)
+			forEachFullSlot(copy, ctrl, capacity, [&](llvm::Value *slot)
+							{
+				if (keyCopier != NULL)
+					builder->CreateStore(builder->CreateCall(keyCopier, {builder->CreateInBoundsGEP(keyTy, keys, slot, "keyptr")}, "keycopy"), builder->CreateInBoundsGEP(keyTy, newkeys, slot, "newkeyptr"));
+				if (valueCopier != NULL)
+					builder->CreateStore(builder->CreateCall(valueCopier, {builder->CreateInBoundsGEP(valueTy, values, slot, "valueptr")}, "valuecopy"), builder->CreateInBoundsGEP(valueTy, newvalues, slot, "newvalueptr")); });
+		llvm::Value *result = builder->CreateLoad(tableTy, tableptr, "copyval");
+		result = builder->CreateInsertValue(result, newctrl, {hashTableControl}, "copyval");
+		result = builder->CreateInsertValue(result, newkeys, {hashTableKeys}, "copyval");
+		if (valueTy != NULL)
+			result = builder->CreateInsertValue(result, newvalues, {hashTableValues}, "copyval");
+		builder->CreateRet(result);
+		llvm::verifyFunction(*copy);
+
+		// rehash(table@, i64 count): rebuild the table with room for `count` entries (or however many it has, if that's more),
+		// clearing out removed slots. rehash(0) shrinks it as far as it'll go, and frees everything if it's empty
+		llvm::Function *rehash = createFunction(builder->getVoidTy(), {tablePtrTy, i64}, "rehash", false);
+		tableptr = rehash->getArg(0);
+		count = rehash->getArg(1);
+		tableptr->setName("this");
+		count->setName("count");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", rehash);
+		llvm::BasicBlock *freeblock = llvm::BasicBlock::Create(*ctxt, "free", rehash),
+						 *rebuild = llvm::BasicBlock::Create(*ctxt, "rebuild", rehash);
+		builder->SetInsertPoint(entry);
+		size = loadHashTableField(tableTy, tableptr, hashTableSize, "size");
+		count = builder->CreateSelect(builder->CreateICmpSGT(count, size, "cmptmp"), count, size, "count");
+		builder->CreateCondBr(builder->CreateICmpEQ(count, builder->getInt64(0), "isempty"), freeblock, rebuild);
+		builder->SetInsertPoint(freeblock);
+		builder->CreateCall(dtor, {tableptr});
+		builder->CreateRetVoid();
+		builder->SetInsertPoint(rebuild);
+		builder->CreateCall(resize, {tableptr, createHashCapacityFor(count)});
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*rehash);
+
+		// clear(table@): destroy every entry, but keep the buffers for whatever's added next
+		llvm::Function *clear = createFunction(builder->getVoidTy(), {tablePtrTy}, "clear", false);
+		tableptr = clear->getArg(0);
+		tableptr->setName("this");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", clear));
+		ctrl = loadHashTableField(tableTy, tableptr, hashTableControl, "control");
+		capacity = loadHashTableField(tableTy, tableptr, hashTableCapacity, "capacity");
+		if (keyDtor != NULL || valueDtor != NULL)
+		{
+			keys = loadHashTableField(tableTy, tableptr, hashTableKeys, "keys");
+			values = valueTy == NULL ? NULL : loadHashTableField(tableTy, tableptr, hashTableValues, "values");
+			forEachFullSlot(clear, ctrl, capacity, [&](llvm::Value *slot)
+							{ destroySlot(keys, values, slot); });
+		}
+		builder->CreateMemSet(ctrl, builder->getInt8(hashCtrlEmpty), capacity, llvm::MaybeAlign(hashGroupWidth));
+		storeHashTableField(tableTy, tableptr, hashTableSize, builder->getInt64(0));
+		storeHashTableField(tableTy, tableptr, hashTableGrowthLeft, createHashMaxLoad(capacity));
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*clear);
+
+		llvm::Function *setInsert = NULL;
+		if (valueTy == NULL)
+		{
+			// insert(set@, K key): whether the key was added (false if it was already there)
+			setInsert = createFunction(builder->getInt1Ty(), {tablePtrTy, keyArgTy}, "insert", false);
+			tableptr = setInsert->getArg(0);
+			tableptr->setName("this");
+			setInsert->getArg(1)->setName("key");
+			builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", setInsert));
+			llvm::Value *oldsize = loadHashTableField(tableTy, tableptr, hashTableSize, "oldsize");
+			builder->CreateCall(insertSlot, {tableptr, setInsert->getArg(1)});
+			builder->CreateRet(builder->CreateICmpNE(loadHashTableField(tableTy, tableptr, hashTableSize, "size"), oldsize, "added"));
+			llvm::verifyFunction(*setInsert);
+		}
+
+		std::vector<Variable> args;
+		std::unique_ptr<TypeExpr> t2 = std::make_unique<StructTypeExpr>(tableName);
+		t2 = std::make_unique<ReferenceToTypeExpr>(t2);
+		args.push_back(Variable("this", t2));
+		AliasMgr.functions.addFunction("clear", clear, args, false);
+		operators[NULL]["DELETE"][tableTy] = FunctionHeader(args, dtor, false);
+		// A local table frees its entries when it goes out of scope, so copying one copies them too.
+		// Values that can't be copied (see isCopyable) make a map that can't be either
+		AliasMgr.objects.addDestructor(tableTy, dtor);
+		if (valueTy == NULL || isCopyable(valueTy))
+			AliasMgr.objects.addCopier(tableTy, copy);
+		t2 = std::make_unique<LongTypeExpr>();
+		args.push_back(Variable("count", t2));
+		AliasMgr.functions.addFunction("reserve", reserve, args, false);
+		AliasMgr.functions.addFunction("rehash", rehash, args, false);
+		args.pop_back();
+		// String keys can be given as a char* (literals included) too, like anything else that takes a string (see convertToString)
+		for (bool cstrArg : {false, true})
+		{
+			if (cstrArg && !isStringType(keyTy))
+				break;
+			if (cstrArg)
+			{
+				t2 = std::make_unique<ByteTypeExpr>();
+				t2 = std::make_unique<PointerToTypeExpr>(t2);
+			}
+			else
+			{
+				t2 = keyExp->clone();
+				if (isStringType(keyTy))
+					t2 = std::make_unique<ReferenceToTypeExpr>(t2);
+			}
+			args.push_back(Variable("key", t2));
+			AliasMgr.functions.addFunction("contains", contains, args, false);
+			AliasMgr.functions.addFunction("remove", remove, args, false);
+			if (setInsert != NULL)
+				AliasMgr.functions.addFunction("insert", setInsert, args, false);
+			args.pop_back();
+		}
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		spdlog::debug("Completed implementation of {} functions", tableName);
+	}
+	/**
+	 * @brief Get (creating it & its methods the first time) the built-in `map<K, V>` or `set<K>` type, for programs that haven't
+	 * declared a `map` or `set` object template of their own
+	 */
+	llvm::Type *getHashTableType(const std::string &name, std::vector<std::unique_ptr<TypeExpr>> &types)
+	{
+		bool isMap = name == "map";
+		if (types.size() != (isMap ? 2 : 1))
+		{
+			logError(isMap ? "map<K, V> takes a key type and a value type" : "set<K> takes a key type");
+			return NULL;
+		}
+		std::string typenames = name + '<' + types[0]->getName() + (isMap ? ',' + types[1]->getName() : "") + '>';
+		if (AliasMgr(typenames))
+			return AliasMgr(typenames);
+		llvm::Type *keyTy = types[0]->codegen(), *valueTy = isMap ? types[1]->codegen() : NULL;
+		if (keyTy == NULL || (isMap && valueTy == NULL))
+			return NULL;
+		if (!keyTy->isIntegerTy() && !keyTy->isFloatingPointTy() && !keyTy->isPointerTy() && !isStringType(keyTy))
+		{
+			logError("Only numbers, pointers & strings can be the keys of a " + name + ", not a(n) " + types[0]->getName());
+			return NULL;
+		}
+		spdlog::debug("Creating hash table {}", typenames);
+		llvm::Type *i64 = builder->getInt64Ty();
+		std::vector<llvm::Type *> fields = {i64, i64, i64, builder->getInt8PtrTy(), keyTy->getPointerTo()};
+		if (isMap)
+			fields.push_back(valueTy->getPointerTo());
+		llvm::StructType *ret = llvm::StructType::create(*ctxt, fields, typenames, false);
+		std::vector<llvm::Type *> memberTypes = {i64};
+		std::vector<std::string> memberNames = {"size"};
+		AliasMgr.objects.addObject(typenames, ret);
+		AliasMgr.objects.addObjectMembers(typenames, memberTypes, memberNames);
+		hashTableTypes[ret] = {keyTy, valueTy};
+		generateHashTableFunctions(ret, types[0], keyTy, valueTy);
+		return ret;
+	}
+	/**
+	 * @brief `map[key]`: the value stored under the key, after adding a zeroed one if the key wasn't in the map yet
+	 *
+	 * @param map - the map (loaded from wherever it's stored, since it may be changed)
+	 * @param key - the key, which must be the map's key type (numbers of other sizes & C strings are converted)
+	 */
+	llvm::Value *createHashMapIndex(llvm::Value *map, llvm::Value *key, bool autoDeref)
+	{
+		llvm::Type *mapTy = map->getType(), *keyTy = getHashTableKeyType(mapTy), *valueTy = getHashTableValueType(mapTy);
+		if (valueTy == NULL)
+		{
+			logError("Sets can't be indexed; use contains() to check whether something's in one");
+			return NULL;
+		}
+		llvm::Value *mapptr;
+		if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(map))
+			mapptr = load->getPointerOperand();
+		else
+		{
+			mapptr = createEntryBlockAlloca(mapTy, NULL, "mapTmp");
+			builder->CreateStore(map, mapptr);
+		}
+		bool convertedKey = false;
+		if (isStringType(keyTy) && key->getType() == builder->getInt8PtrTy())
+		{
+			key = convertToString(key);
+			convertedKey = !llvm::isa<llvm::Constant>(key);
+		}
+		else if (keyTy->isIntegerTy() && key->getType()->isIntegerTy() && key->getType() != keyTy)
+			key = builder->CreateSExtOrTrunc(key, keyTy, "keytmp");
+		else if (keyTy->isFloatingPointTy() && key->getType()->isFloatingPointTy() && key->getType() != keyTy)
+			key = builder->CreateFPCast(key, keyTy, "keytmp");
+		if (key->getType() != keyTy)
+		{
+			logError("A " + AliasMgr.getTypeName(mapTy) + " can't be indexed with a(n) " + AliasMgr.getTypeName(key->getType()));
+			return NULL;
+		}
+		llvm::Value *keyArg = isStringType(keyTy) ? getStringPointer(key) : key;
+		llvm::Value *slot = builder->CreateCall(GlobalVarsAndFunctions->getFunction(mapTy->getStructName().str() + "::slot"), {mapptr, keyArg}, "slot");
+		if (convertedKey)
+			builder->CreateCall(getStringFunction("destructor"), {keyArg});
+		llvm::StructType *tableTy = (llvm::StructType *)mapTy;
+		llvm::Value *valuePtr = builder->CreateInBoundsGEP(valueTy, loadHashTableField(tableTy, mapptr, hashTableValues, "values"), slot, "valueptr");
+		if (autoDeref)
+			return builder->CreateLoad(valueTy, valuePtr, "loadtmp");
+		return valuePtr;
+	}
+}
@@ -0,0 +1,452 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "globals.cpp"
+#include "Allocator.cpp"
+namespace jimpilier
+{
+	/*
+	 * The runtime behind `parallel for`. The loop body is outlined into `i1 body(i8* captures, i64 begin, i64 end)`, which runs
+	 * iterations [begin, end) and returns true if one of them hit `break`.
+	 * parallel.for() splits the loop's range evenly between a pool of worker threads (started the first time it's needed, one per core,
+	 * or $JIMBO_THREADS) plus the calling thread. Each worker takes small chunks off the front of its own range; once that runs out,
+	 * it steals the back half of another worker's range, so a worker with slow iterations doesn't hold everyone else up.
+	 * A `break` stops workers from starting new chunks; chunks that already started still finish.
+	 * Only one parallel loop runs on the pool at a time; a `parallel for` inside another one (or on another thread) just runs sequentially.
+	 * The pool is shut down (and its threads joined) by a global destructor when the program exits.
+	 */
+	const int parallelMaxWorkers = 64;
+	/**
+	 * @brief Roughly how many chunks each worker's share of the range is cut into; more chunks = finer grained stealing & cancelling, but more locking
+	 */
+	const int parallelChunksPerWorker = 8;
+	/**
+	 * @brief `_SC_NPROCESSORS_ONLN` on Linux
+	 */
+	const int parallelSysconfCores = 84;
+
+	llvm::FunctionType *getParallelBodyType()
+	{
+		return llvm::FunctionType::get(builder->getInt1Ty(), {builder->getInt8PtrTy(), builder->getInt64Ty(), builder->getInt64Ty()}, false);
+	}
+	/**
+	 * @brief One worker's share of the loop: { i32 lock, i64 next, i64 end }, padded out to its own cache line
+	 */
+	llvm::StructType *getParallelRangeType()
+	{
+		llvm::StructType *rangeTy = llvm::StructType::getTypeByName(*ctxt, "parallel.range");
+		if (rangeTy == NULL)
+			rangeTy = llvm::StructType::create(*ctxt, {builder->getInt32Ty(), builder->getInt64Ty(), builder->getInt64Ty(), llvm::ArrayType::get(builder->getInt8Ty(), 40)}, "parallel.range");
+		return rangeTy;
+	}
+	/**
+	 * @brief A pthread mutex or condition variable; glibc's are ready to use when zeroed
+	 */
+	llvm::GlobalVariable *getParallelSyncGlobal(const std::string &name, unsigned size)
+	{
+		llvm::GlobalVariable *global = getInternalGlobal(name, llvm::ArrayType::get(builder->getInt8Ty(), size));
+		global->setAlignment(llvm::Align(16));
+		return global;
+	}
+	llvm::Value *getParallelSyncPtr(const std::string &name, unsigned size)
+	{
+		return builder->CreateBitCast(getParallelSyncGlobal(name, size), builder->getInt8PtrTy(), name + ".ptr");
+	}
+	llvm::FunctionCallee getPthreadFunction(const std::string &name, unsigned args)
+	{
+		std::vector<llvm::Type *> argTys(args, builder->getInt8PtrTy());
+		return GlobalVarsAndFunctions->getOrInsertFunction(name, llvm::FunctionType::get(builder->getInt32Ty(), argTys, false));
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void parallel.lock(i32*)`, a spin lock for the worker ranges; they're only ever held for a few instructions
+	 */
+	llvm::Function *getParallelLockFunction()
+	{
+		llvm::Function *lockfunc = GlobalVarsAndFunctions->getFunction("parallel.lock");
+		if (lockfunc != NULL)
+			return lockfunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		lockfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt32Ty()->getPointerTo()}, false), llvm::Function::InternalLinkage, "parallel.lock", GlobalVarsAndFunctions.get());
+		llvm::Value *lock = lockfunc->getArg(0);
+		lock->setName("lock");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", lockfunc),
+						 *spin = llvm::BasicBlock::Create(*ctxt, "spin", lockfunc),
+						 *acquired = llvm::BasicBlock::Create(*ctxt, "acquired", lockfunc);
+		builder->SetInsertPoint(entry);
+		builder->CreateBr(spin);
+		builder->SetInsertPoint(spin);
+		llvm::Value *wasLocked = builder->CreateAtomicRMW(llvm::AtomicRMWInst::Xchg, lock, builder->getInt32(1), llvm::MaybeAlign(4), llvm::AtomicOrdering::Acquire);
+		wasLocked->setName("waslocked");
+		builder->CreateCondBr(builder->CreateICmpEQ(wasLocked, builder->getInt32(0), "gotlock"), acquired, spin);
+		builder->SetInsertPoint(acquired);
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return lockfunc;
+	}
+	void createParallelUnlock(llvm::Value *lock)
+	{
+		builder->CreateAlignedStore(builder->getInt32(0), lock, llvm::MaybeAlign(4))->setAtomic(llvm::AtomicOrdering::Release);
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void parallel.work(i32 worker)`: runs chunks of this worker's range, then steals from the others,
+	 * until there's nothing left anywhere or the loop was cancelled
+	 */
+	llvm::Function *getParallelWorkFunction()
+	{
+		llvm::Function *workfunc = GlobalVarsAndFunctions->getFunction("parallel.work");
+		if (workfunc != NULL)
+			return workfunc;
+		spdlog::debug("Creating parallel for scheduler");
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::StructType *rangeTy = getParallelRangeType();
+		llvm::Type *rangesTy = llvm::ArrayType::get(rangeTy, parallelMaxWorkers);
+		llvm::GlobalVariable *ranges = getInternalGlobal("parallel.ranges", rangesTy),
+							 *bodyGlobal = getInternalGlobal("parallel.body", getParallelBodyType()->getPointerTo()),
+							 *captures = getInternalGlobal("parallel.captures", builder->getInt8PtrTy()),
+							 *chunkGlobal = getInternalGlobal("parallel.chunk", builder->getInt64Ty()),
+							 *cancelled = getInternalGlobal("parallel.cancelled", builder->getInt32Ty()),
+							 *workers = getInternalGlobal("parallel.workers", builder->getInt32Ty());
+		ranges->setAlignment(llvm::Align(64));
+		llvm::Function *lockfunc = getParallelLockFunction();
+		workfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt32Ty()}, false), llvm::Function::InternalLinkage, "parallel.work", GlobalVarsAndFunctions.get());
+		llvm::Value *id = workfunc->getArg(0);
+		id->setName("worker");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", workfunc),
+						 *claim = llvm::BasicBlock::Create(*ctxt, "claim", workfunc),
+						 *takeChunk = llvm::BasicBlock::Create(*ctxt, "takechunk", workfunc),
+						 *run = llvm::BasicBlock::Create(*ctxt, "run", workfunc),
+						 *cancel = llvm::BasicBlock::Create(*ctxt, "cancel", workfunc),
+						 *steal = llvm::BasicBlock::Create(*ctxt, "steal", workfunc),
+						 *tryVictim = llvm::BasicBlock::Create(*ctxt, "tryvictim", workfunc),
+						 *stealHalf = llvm::BasicBlock::Create(*ctxt, "stealhalf", workfunc),
+						 *nextVictim = llvm::BasicBlock::Create(*ctxt, "nextvictim", workfunc),
+						 *done = llvm::BasicBlock::Create(*ctxt, "done", workfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *workerCount = builder->CreateLoad(builder->getInt32Ty(), workers, "workercount");
+		llvm::Value *body = builder->CreateLoad(getParallelBodyType()->getPointerTo(), bodyGlobal, "body");
+		llvm::Value *context = builder->CreateLoad(builder->getInt8PtrTy(), captures, "captures");
+		llvm::Value *chunk = builder->CreateLoad(builder->getInt64Ty(), chunkGlobal, "chunk");
+		llvm::Value *own = builder->CreateInBoundsGEP(rangesTy, ranges, {builder->getInt32(0), id}, "ownrange");
+		llvm::Value *ownLock = builder->CreateStructGEP(rangeTy, own, 0, "ownlock"),
+					*ownNext = builder->CreateStructGEP(rangeTy, own, 1, "ownnext"),
+					*ownEnd = builder->CreateStructGEP(rangeTy, own, 2, "ownend");
+		builder->CreateBr(claim);
+
+		// Take the next chunk off the front of our own range
+		builder->SetInsertPoint(claim);
+		llvm::LoadInst *isCancelled = builder->CreateAlignedLoad(builder->getInt32Ty(), cancelled, llvm::MaybeAlign(4), "iscancelled");
+		isCancelled->setAtomic(llvm::AtomicOrdering::Monotonic);
+		builder->CreateCondBr(builder->CreateICmpNE(isCancelled, builder->getInt32(0), "stop"), done, takeChunk);
+		builder->SetInsertPoint(takeChunk);
+		builder->CreateCall(lockfunc, {ownLock});
+		llvm::Value *first = builder->CreateLoad(builder->getInt64Ty(), ownNext, "first");
+		llvm::Value *available = builder->CreateSub(builder->CreateLoad(builder->getInt64Ty(), ownEnd, "end"), first, "available");
+		llvm::Value *taken = builder->CreateSelect(builder->CreateICmpSLT(available, chunk, "lastchunk"), available, chunk, "taken");
+		llvm::Value *last = builder->CreateAdd(first, taken, "last");
+		builder->CreateStore(last, ownNext);
+		createParallelUnlock(ownLock);
+		builder->CreateCondBr(builder->CreateICmpSGT(taken, builder->getInt64(0), "gotwork"), run, steal);
+		builder->SetInsertPoint(run);
+		llvm::Value *broke = builder->CreateCall(getParallelBodyType(), body, {context, first, last}, "broke");
+		builder->CreateCondBr(broke, cancel, claim);
+		builder->SetInsertPoint(cancel);
+		builder->CreateAlignedStore(builder->getInt32(1), cancelled, llvm::MaybeAlign(4))->setAtomic(llvm::AtomicOrdering::Monotonic);
+		builder->CreateBr(done);
+
+		// Our range is empty: look through the other workers for one with at least 2 iterations left, and take the back half of what's left
+		builder->SetInsertPoint(steal);
+		builder->CreateBr(tryVictim);
+		builder->SetInsertPoint(tryVictim);
+		llvm::PHINode *offset = builder->CreatePHI(builder->getInt32Ty(), 2, "victimoffset");
+		offset->addIncoming(builder->getInt32(1), steal);
+		llvm::Value *victimId = builder->CreateURem(builder->CreateAdd(id, offset, "victimsum"), workerCount, "victim");
+		llvm::Value *victim = builder->CreateInBoundsGEP(rangesTy, ranges, {builder->getInt32(0), victimId}, "victimrange");
+		llvm::Value *victimLock = builder->CreateStructGEP(rangeTy, victim, 0, "victimlock"),
+					*victimNext = builder->CreateStructGEP(rangeTy, victim, 1, "victimnext"),
+					*victimEnd = builder->CreateStructGEP(rangeTy, victim, 2, "victimend");
+		builder->CreateCall(lockfunc, {victimLock});
+		llvm::Value *victimFirst = builder->CreateLoad(builder->getInt64Ty(), victimNext, "victimfirst");
+		llvm::Value *victimLast = builder->CreateLoad(builder->getInt64Ty(), victimEnd, "victimlast");
+		llvm::Value *remaining = builder->CreateSub(victimLast, victimFirst, "remaining");
+		builder->CreateCondBr(builder->CreateICmpSGE(remaining, builder->getInt64(2), "cansteal"), stealHalf, nextVictim);
+		builder->SetInsertPoint(stealHalf);
+		llvm::Value *middle = builder->CreateAdd(victimFirst, builder->CreateSDiv(remaining, builder->getInt64(2), "half"), "middle");
+		builder->CreateStore(middle, victimEnd);
+		createParallelUnlock(victimLock);
+		builder->CreateCall(lockfunc, {ownLock});
+		builder->CreateStore(middle, ownNext);
+		builder->CreateStore(victimLast, ownEnd);
+		createParallelUnlock(ownLock);
+		builder->CreateBr(claim);
+		builder->SetInsertPoint(nextVictim);
+		createParallelUnlock(victimLock);
+		llvm::Value *nextOffset = builder->CreateAdd(offset, builder->getInt32(1), "nextoffset");
+		offset->addIncoming(nextOffset, nextVictim);
+		builder->CreateCondBr(builder->CreateICmpULT(nextOffset, workerCount, "morevictims"), tryVictim, done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return workfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `i8* parallel.thread(i8* worker)`, the main loop of a pool thread.
+	 * Sleeps until parallel.for() bumps the job generation, works on the job, and wakes parallel.for() up once the last worker is done.
+	 * Returns once parallel.shutdown() sets parallel.stopping
+	 */
+	llvm::Function *getParallelThreadFunction()
+	{
+		llvm::Function *threadfunc = GlobalVarsAndFunctions->getFunction("parallel.thread");
+		if (threadfunc != NULL)
+			return threadfunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Function *workfunc = getParallelWorkFunction();
+		llvm::GlobalVariable *generation = getInternalGlobal("parallel.generation", builder->getInt64Ty()),
+							 *active = getInternalGlobal("parallel.active", builder->getInt32Ty()),
+							 *stopping = getInternalGlobal("parallel.stopping", builder->getInt32Ty());
+		threadfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt8PtrTy()}, false), llvm::Function::InternalLinkage, "parallel.thread", GlobalVarsAndFunctions.get());
+		llvm::Value *arg = threadfunc->getArg(0);
+		arg->setName("worker");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", threadfunc),
+						 *check = llvm::BasicBlock::Create(*ctxt, "check", threadfunc),
+						 *checkJob = llvm::BasicBlock::Create(*ctxt, "checkjob", threadfunc),
+						 *quit = llvm::BasicBlock::Create(*ctxt, "quit", threadfunc),
+						 *sleep = llvm::BasicBlock::Create(*ctxt, "sleep", threadfunc),
+						 *work = llvm::BasicBlock::Create(*ctxt, "work", threadfunc),
+						 *wakeCaller = llvm::BasicBlock::Create(*ctxt, "wakecaller", threadfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *id = builder->CreateTrunc(builder->CreatePtrToInt(arg, builder->getInt64Ty(), "workerid"), builder->getInt32Ty(), "worker");
+		llvm::Value *seen = builder->CreateAlloca(builder->getInt64Ty(), NULL, "seen");
+		builder->CreateStore(builder->getInt64(0), seen);
+		llvm::Value *mutex = getParallelSyncPtr("parallel.mutex", 40), *wakeWorkers = getParallelSyncPtr("parallel.wake", 48), *wakeDone = getParallelSyncPtr("parallel.done", 48);
+		builder->CreateCall(getPthreadFunction("pthread_mutex_lock", 1), {mutex});
+		builder->CreateBr(check);
+		// The mutex is held everywhere but while working, so once parallel.for() sees the last worker finish, every worker is asleep
+		builder->SetInsertPoint(check);
+		llvm::Value *stop = builder->CreateLoad(builder->getInt32Ty(), stopping, "stopping");
+		builder->CreateCondBr(builder->CreateICmpNE(stop, builder->getInt32(0), "shuttingdown"), quit, checkJob);
+		builder->SetInsertPoint(quit);
+		builder->CreateCall(getPthreadFunction("pthread_mutex_unlock", 1), {mutex});
+		builder->CreateRet(llvm::ConstantPointerNull::get(builder->getInt8PtrTy()));
+		builder->SetInsertPoint(checkJob);
+		llvm::Value *current = builder->CreateLoad(builder->getInt64Ty(), generation, "generation");
+		llvm::Value *lastSeen = builder->CreateLoad(builder->getInt64Ty(), seen, "lastseen");
+		builder->CreateCondBr(builder->CreateICmpEQ(current, lastSeen, "nonewjob"), sleep, work);
+		builder->SetInsertPoint(sleep);
+		builder->CreateCall(getPthreadFunction("pthread_cond_wait", 2), {wakeWorkers, mutex});
+		builder->CreateBr(check);
+		builder->SetInsertPoint(work);
+		builder->CreateStore(current, seen);
+		builder->CreateCall(getPthreadFunction("pthread_mutex_unlock", 1), {mutex});
+		builder->CreateCall(workfunc, {id});
+		builder->CreateCall(getPthreadFunction("pthread_mutex_lock", 1), {mutex});
+		llvm::Value *stillActive = builder->CreateSub(builder->CreateLoad(builder->getInt32Ty(), active, "active"), builder->getInt32(1), "stillactive");
+		builder->CreateStore(stillActive, active);
+		builder->CreateCondBr(builder->CreateICmpEQ(stillActive, builder->getInt32(0), "lastworker"), wakeCaller, check);
+		builder->SetInsertPoint(wakeCaller);
+		builder->CreateCall(getPthreadFunction("pthread_cond_broadcast", 1), {wakeDone});
+		builder->CreateBr(check);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return threadfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void parallel.shutdown()`, which wakes every pool thread up, tells it to return, and joins it
+	 */
+	llvm::Function *getParallelShutdownFunction()
+	{
+		llvm::Function *shutdownfunc = GlobalVarsAndFunctions->getFunction("parallel.shutdown");
+		if (shutdownfunc != NULL)
+			return shutdownfunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::GlobalVariable *workers = getInternalGlobal("parallel.workers", builder->getInt32Ty()),
+							 *stopping = getInternalGlobal("parallel.stopping", builder->getInt32Ty()),
+							 *threads = getInternalGlobal("parallel.threads", llvm::ArrayType::get(builder->getInt64Ty(), parallelMaxWorkers));
+		shutdownfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), false), llvm::Function::InternalLinkage, "parallel.shutdown", GlobalVarsAndFunctions.get());
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", shutdownfunc),
+						 *stop = llvm::BasicBlock::Create(*ctxt, "stop", shutdownfunc),
+						 *join = llvm::BasicBlock::Create(*ctxt, "join", shutdownfunc),
+						 *exit = llvm::BasicBlock::Create(*ctxt, "exit", shutdownfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *workerCount = builder->CreateLoad(builder->getInt32Ty(), workers, "workercount");
+		builder->CreateCondBr(builder->CreateICmpSGT(workerCount, builder->getInt32(1), "havethreads"), stop, exit);
+		builder->SetInsertPoint(stop);
+		llvm::Value *mutex = getParallelSyncPtr("parallel.mutex", 40), *wakeWorkers = getParallelSyncPtr("parallel.wake", 48);
+		builder->CreateCall(getPthreadFunction("pthread_mutex_lock", 1), {mutex});
+		builder->CreateStore(builder->getInt32(1), stopping);
+		builder->CreateCall(getPthreadFunction("pthread_cond_broadcast", 1), {wakeWorkers});
+		builder->CreateCall(getPthreadFunction("pthread_mutex_unlock", 1), {mutex});
+		builder->CreateBr(join);
+		builder->SetInsertPoint(join);
+		llvm::PHINode *worker = builder->CreatePHI(builder->getInt32Ty(), 2, "worker");
+		worker->addIncoming(builder->getInt32(1), stop);
+		llvm::Value *thread = builder->CreateLoad(builder->getInt64Ty(), builder->CreateInBoundsGEP(threads->getValueType(), threads, {builder->getInt32(0), worker}, "threadptr"), "thread");
+		builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("pthread_join", llvm::FunctionType::get(builder->getInt32Ty(), {builder->getInt64Ty(), builder->getInt8PtrTy()->getPointerTo()}, false)),
+							{thread, llvm::ConstantPointerNull::get(builder->getInt8PtrTy()->getPointerTo())}, "joined");
+		llvm::Value *nextWorker = builder->CreateAdd(worker, builder->getInt32(1), "nextworker");
+		worker->addIncoming(nextWorker, join);
+		builder->CreateCondBr(builder->CreateICmpSLT(nextWorker, workerCount, "morethreads"), join, exit);
+		builder->SetInsertPoint(exit);
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return shutdownfunc;
+	}
+
+	/**
+	 * @brief Get (generating it the first time) `void parallel.for(body, i8* captures, i64 begin, i64 end)`, which runs `body` over [begin, end)
+	 * on the thread pool and returns once every iteration is done (or the loop was cancelled)
+	 */
+	llvm::Function *getParallelForFunction()
+	{
+		llvm::Function *forfunc = GlobalVarsAndFunctions->getFunction("parallel.for");
+		if (forfunc != NULL)
+			return forfunc;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Function *workfunc = getParallelWorkFunction(), *threadfunc = getParallelThreadFunction();
+		llvm::StructType *rangeTy = getParallelRangeType();
+		llvm::Type *rangesTy = llvm::ArrayType::get(rangeTy, parallelMaxWorkers);
+		llvm::GlobalVariable *ranges = getInternalGlobal("parallel.ranges", rangesTy),
+							 *bodyGlobal = getInternalGlobal("parallel.body", getParallelBodyType()->getPointerTo()),
+							 *captures = getInternalGlobal("parallel.captures", builder->getInt8PtrTy()),
+							 *chunkGlobal = getInternalGlobal("parallel.chunk", builder->getInt64Ty()),
+							 *cancelled = getInternalGlobal("parallel.cancelled", builder->getInt32Ty()),
+							 *workers = getInternalGlobal("parallel.workers", builder->getInt32Ty()),
+							 *busy = getInternalGlobal("parallel.busy", builder->getInt32Ty()),
+							 *generation = getInternalGlobal("parallel.generation", builder->getInt64Ty()),
+							 *active = getInternalGlobal("parallel.active", builder->getInt32Ty()),
+							 *threads = getInternalGlobal("parallel.threads", llvm::ArrayType::get(builder->getInt64Ty(), parallelMaxWorkers));
+		llvm::appendToGlobalDtors(*GlobalVarsAndFunctions, getParallelShutdownFunction(), 0);
+		forfunc = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {getParallelBodyType()->getPointerTo(), builder->getInt8PtrTy(), builder->getInt64Ty(), builder->getInt64Ty()}, false),
+										 llvm::Function::InternalLinkage, "parallel.for", GlobalVarsAndFunctions.get());
+		llvm::Value *body = forfunc->getArg(0), *context = forfunc->getArg(1), *begin = forfunc->getArg(2), *end = forfunc->getArg(3);
+		body->setName("body");
+		context->setName("captures");
+		begin->setName("begin");
+		end->setName("end");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", forfunc),
+						 *tryPool = llvm::BasicBlock::Create(*ctxt, "trypool", forfunc),
+						 *startPool = llvm::BasicBlock::Create(*ctxt, "startpool", forfunc),
+						 *spawn = llvm::BasicBlock::Create(*ctxt, "spawn", forfunc),
+						 *havePool = llvm::BasicBlock::Create(*ctxt, "havepool", forfunc),
+						 *split = llvm::BasicBlock::Create(*ctxt, "split", forfunc),
+						 *splitDone = llvm::BasicBlock::Create(*ctxt, "splitdone", forfunc),
+						 *waitDone = llvm::BasicBlock::Create(*ctxt, "waitdone", forfunc),
+						 *sleep = llvm::BasicBlock::Create(*ctxt, "sleep", forfunc),
+						 *finished = llvm::BasicBlock::Create(*ctxt, "finished", forfunc),
+						 *alone = llvm::BasicBlock::Create(*ctxt, "alone", forfunc),
+						 *sequential = llvm::BasicBlock::Create(*ctxt, "sequential", forfunc),
+						 *exit = llvm::BasicBlock::Create(*ctxt, "exit", forfunc);
+		builder->SetInsertPoint(entry);
+		llvm::Value *total = builder->CreateSub(end, begin, "total");
+		builder->CreateCondBr(builder->CreateICmpSLE(total, builder->getInt64(0), "empty"), exit, tryPool);
+
+		// Only one loop gets the pool at a time; anyone else runs their loop themselves
+		builder->SetInsertPoint(tryPool);
+		llvm::Value *claimed = builder->CreateAtomicCmpXchg(busy, builder->getInt32(0), builder->getInt32(1), llvm::MaybeAlign(4), llvm::AtomicOrdering::Acquire, llvm::AtomicOrdering::Monotonic);
+		claimed = builder->CreateExtractValue(claimed, {1u}, "claimed");
+		llvm::Value *poolSize = builder->CreateLoad(builder->getInt32Ty(), workers, "poolsize");
+		llvm::BasicBlock *checkPool = llvm::BasicBlock::Create(*ctxt, "checkpool", forfunc, startPool);
+		builder->CreateCondBr(claimed, checkPool, sequential);
+		builder->SetInsertPoint(checkPool);
+		builder->CreateCondBr(builder->CreateICmpEQ(poolSize, builder->getInt32(0), "nopool"), startPool, havePool);
+
+		// Start the pool: one thread per core (or $JIMBO_THREADS), counting the thread that runs parallel.for() itself
+		builder->SetInsertPoint(startPool);
+		llvm::Value *env = builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("getenv", llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt8PtrTy()}, false)),
+											   {builder->CreateGlobalStringPtr("JIMBO_THREADS", "parallel.threadsenv", 0, GlobalVarsAndFunctions.get())}, "threadsenv");
+		llvm::Value *requested = builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("atoi", llvm::FunctionType::get(builder->getInt32Ty(), {builder->getInt8PtrTy()}, false)),
+													 {builder->CreateSelect(builder->CreateIsNull(env, "noenv"), builder->CreateGlobalStringPtr("0", "parallel.zero", 0, GlobalVarsAndFunctions.get()), env, "threadsstr")}, "requested");
+		llvm::Value *cores = builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("sysconf", llvm::FunctionType::get(builder->getInt64Ty(), {builder->getInt32Ty()}, false)), {builder->getInt32(parallelSysconfCores)}, "cores");
+		cores = builder->CreateTrunc(cores, builder->getInt32Ty(), "corecount");
+		llvm::Value *count = builder->CreateSelect(builder->CreateICmpSGT(requested, builder->getInt32(0), "hasrequest"), requested, cores, "count");
+		count = builder->CreateSelect(builder->CreateICmpSLT(count, builder->getInt32(1), "toofew"), builder->getInt32(1), count, "atleastone");
+		count = builder->CreateSelect(builder->CreateICmpSGT(count, builder->getInt32(parallelMaxWorkers), "toomany"), builder->getInt32(parallelMaxWorkers), count, "poolcount");
+		builder->CreateStore(count, workers);
+		builder->CreateCondBr(builder->CreateICmpSGT(count, builder->getInt32(1), "needthreads"), spawn, havePool);
+		builder->SetInsertPoint(spawn);
+		llvm::PHINode *spawned = builder->CreatePHI(builder->getInt32Ty(), 2, "spawned");
+		spawned->addIncoming(builder->getInt32(1), startPool);
+		llvm::FunctionCallee create = GlobalVarsAndFunctions->getOrInsertFunction("pthread_create", llvm::FunctionType::get(builder->getInt32Ty(), {builder->getInt64Ty()->getPointerTo(), builder->getInt8PtrTy(), threadfunc->getType(), builder->getInt8PtrTy()}, false));
+		llvm::Value *threadId = builder->CreateInBoundsGEP(threads->getValueType(), threads, {builder->getInt32(0), spawned}, "threadid");
+		builder->CreateCall(create, {threadId, llvm::ConstantPointerNull::get(builder->getInt8PtrTy()), threadfunc, builder->CreateIntToPtr(builder->CreateZExt(spawned, builder->getInt64Ty(), "workerid"), builder->getInt8PtrTy(), "workerarg")}, "created");
+		llvm::Value *nextSpawn = builder->CreateAdd(spawned, builder->getInt32(1), "nextspawn");
+		spawned->addIncoming(nextSpawn, spawn);
+		builder->CreateCondBr(builder->CreateICmpSLT(nextSpawn, count, "morethreads"), spawn, havePool);
+
+		builder->SetInsertPoint(havePool);
+		llvm::Value *workerCount = builder->CreateLoad(builder->getInt32Ty(), workers, "workercount");
+		llvm::BasicBlock *setup = llvm::BasicBlock::Create(*ctxt, "setup", forfunc, split);
+		builder->CreateCondBr(builder->CreateICmpSLE(workerCount, builder->getInt32(1), "onlyus"), alone, setup);
+
+		// Publish the job & split the range evenly, then wake the pool up and pitch in as worker 0
+		builder->SetInsertPoint(setup);
+		llvm::Value *workerCount64 = builder->CreateZExt(workerCount, builder->getInt64Ty(), "workercount64");
+		llvm::Value *share = builder->CreateSDiv(total, workerCount64, "share");
+		llvm::Value *chunk = builder->CreateSDiv(share, builder->getInt64(parallelChunksPerWorker), "chunksize");
+		chunk = builder->CreateSelect(builder->CreateICmpSLT(chunk, builder->getInt64(1), "tinychunk"), builder->getInt64(1), chunk, "chunk");
+		builder->CreateStore(body, bodyGlobal);
+		builder->CreateStore(context, captures);
+		builder->CreateStore(chunk, chunkGlobal);
+		builder->CreateStore(builder->getInt32(0), cancelled);
+		builder->CreateBr(split);
+		builder->SetInsertPoint(split);
+		llvm::PHINode *worker = builder->CreatePHI(builder->getInt32Ty(), 2, "worker");
+		worker->addIncoming(builder->getInt32(0), setup);
+		llvm::Value *range = builder->CreateInBoundsGEP(rangesTy, ranges, {builder->getInt32(0), worker}, "range");
+		llvm::Value *first = builder->CreateAdd(begin, builder->CreateMul(share, builder->CreateZExt(worker, builder->getInt64Ty(), "worker64"), "offset"), "first");
+		llvm::Value *nextWorker = builder->CreateAdd(worker, builder->getInt32(1), "nextworker");
+		llvm::Value *isLast = builder->CreateICmpEQ(nextWorker, workerCount, "islast");
+		builder->CreateStore(builder->getInt32(0), builder->CreateStructGEP(rangeTy, range, 0, "lock"));
+		builder->CreateStore(first, builder->CreateStructGEP(rangeTy, range, 1, "next"));
+		builder->CreateStore(builder->CreateSelect(isLast, end, builder->CreateAdd(first, share, "shareend"), "last"), builder->CreateStructGEP(rangeTy, range, 2, "end"));
+		worker->addIncoming(nextWorker, split);
+		builder->CreateCondBr(isLast, splitDone, split);
+		builder->SetInsertPoint(splitDone);
+		llvm::Value *mutex = getParallelSyncPtr("parallel.mutex", 40), *wakeWorkers = getParallelSyncPtr("parallel.wake", 48), *wakeDone = getParallelSyncPtr("parallel.done", 48);
+		builder->CreateCall(getPthreadFunction("pthread_mutex_lock", 1), {mutex});
+		builder->CreateStore(builder->CreateSub(workerCount, builder->getInt32(1), "helpers"), active);
+		builder->CreateStore(builder->CreateAdd(builder->CreateLoad(builder->getInt64Ty(), generation, "generation"), builder->getInt64(1), "nextgeneration"), generation);
+		builder->CreateCall(getPthreadFunction("pthread_cond_broadcast", 1), {wakeWorkers});
+		builder->CreateCall(getPthreadFunction("pthread_mutex_unlock", 1), {mutex});
+		builder->CreateCall(workfunc, {builder->getInt32(0)});
+		builder->CreateCall(getPthreadFunction("pthread_mutex_lock", 1), {mutex});
+		builder->CreateBr(waitDone);
+		builder->SetInsertPoint(waitDone);
+		llvm::Value *stillActive = builder->CreateLoad(builder->getInt32Ty(), active, "stillactive");
+		builder->CreateCondBr(builder->CreateICmpEQ(stillActive, builder->getInt32(0), "alldone"), finished, sleep);
+		builder->SetInsertPoint(sleep);
+		builder->CreateCall(getPthreadFunction("pthread_cond_wait", 2), {wakeDone, mutex});
+		builder->CreateBr(waitDone);
+		builder->SetInsertPoint(finished);
+		builder->CreateCall(getPthreadFunction("pthread_mutex_unlock", 1), {mutex});
+		builder->CreateAlignedStore(builder->getInt32(0), busy, llvm::MaybeAlign(4))->setAtomic(llvm::AtomicOrdering::Release);
+		builder->CreateBr(exit);
+
+		// A single core: no point splitting anything up
+		builder->SetInsertPoint(alone);
+		builder->CreateCall(getParallelBodyType(), body, {context, begin, end}, "broke");
+		builder->CreateAlignedStore(builder->getInt32(0), busy, llvm::MaybeAlign(4))->setAtomic(llvm::AtomicOrdering::Release);
+		builder->CreateBr(exit);
+		builder->SetInsertPoint(sequential);
+		builder->CreateCall(getParallelBodyType(), body, {context, begin, end}, "broke");
+		builder->CreateBr(exit);
+		builder->SetInsertPoint(exit);
+		builder->CreateRetVoid();
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return forfunc;
+	}
+}
@@ -0,0 +1,489 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "globals.cpp"
+#include "TypeExpr.h"
+#include "Allocator.cpp"
+namespace jimpilier
+{
+	/*
+	 * The built-in `string` object: { i64 size, i64 capacity, i64 hash, i8* heap, [16 x i8] inline }, generated the first time it's used.
+	 * Its characters are always NUL terminated, and where they live depends on the capacity:
+	 *   0  - in `inline`, which fits up to 15 of them, so short strings never touch the heap. A zeroed string is a valid, empty string
+	 *   >0 - in a malloc()ed buffer of capacity + 1 bytes that the string owns
+	 *   -1 - in a string literal, which is constant, shared and never freed (literals that fit inline go inline instead)
+	 * The hash is worked out the first time something needs it, then cached until the characters change; 0 means it hasn't been yet.
+	 *
+	 * Strings are values: assigning one string variable to another copies it (only heap strings actually have characters to copy),
+	 * and every string variable frees its own buffer when it goes out of scope. C functions (declared without a body) still take char*s.
+	 */
+	const uint64_t stringInlineCapacity = 15;
+	const uint64_t stringHashOffset = 14695981039346656037ULL, stringHashPrime = 1099511628211ULL;
+	enum StringField
+	{
+		stringSize,
+		stringCapacity,
+		stringHash,
+		stringHeap,
+		stringInline
+	};
+
+	/**
+	 * @brief Whether a type is the built-in `string` object
+	 */
+	bool isStringType(llvm::Type *ty)
+	{
+		return ty != NULL && ty->isStructTy() && !((llvm::StructType *)ty)->isLiteral() && ty->getStructName() == "string";
+	}
+	/**
+	 * @brief The FNV-1a hash of a string's characters, the same one `string::hash` works out at runtime
+	 */
+	uint64_t hashStringBytes(llvm::StringRef chars)
+	{
+		uint64_t hash = stringHashOffset;
+		for (char c : chars)
+			hash = (hash ^ (unsigned char)c) * stringHashPrime;
+		// 0 means "not hashed yet"
+		return hash == 0 ? 1 : hash;
+	}
+	llvm::Value *loadStringField(llvm::Value *str, StringField field, const llvm::Twine &name)
+	{
+		llvm::StructType *stringTy = (llvm::StructType *)str->getType()->getNonOpaquePointerElementType();
+		return builder->CreateLoad(stringTy->getElementType(field), builder->CreateStructGEP(stringTy, str, field, name + "ptr"), name);
+	}
+	void storeStringField(llvm::Value *str, StringField field, llvm::Value *val)
+	{
+		llvm::StructType *stringTy = (llvm::StructType *)str->getType()->getNonOpaquePointerElementType();
+		builder->CreateStore(val, builder->CreateStructGEP(stringTy, str, field, "fieldptr"));
+	}
+	/**
+	 * @brief A pointer to a string's (NUL terminated) characters, wherever they happen to be
+	 *
+	 * @param str - a string*
+	 */
+	llvm::Value *createStringData(llvm::Value *str)
+	{
+		llvm::StructType *stringTy = (llvm::StructType *)str->getType()->getNonOpaquePointerElementType();
+		llvm::Value *capacity = loadStringField(str, stringCapacity, "capacity");
+		llvm::Value *inlineChars = builder->CreateConstInBoundsGEP2_32(stringTy->getElementType(stringInline), builder->CreateStructGEP(stringTy, str, stringInline, "inlineptr"), 0, 0, "inlinechars");
+		llvm::Value *heapChars = loadStringField(str, stringHeap, "heap");
+		return builder->CreateSelect(builder->CreateICmpEQ(capacity, builder->getInt64(0), "isinline"), inlineChars, heapChars, "chars");
+	}
+
+	/**
+	 * @brief Generates the `string` object the first time it's referenced, along with everything it can do: append (amortized O(1),
+	 * the capacity doubles whenever it runs out), reserve, hash, c_str, `+` (which reserves the whole result up front), `==` & `!=`
+	 * (which compare lengths, then cached hashes, before they look at any characters), copying, and the destructor
+	 */
+	llvm::StructType *generateStringObject()
+	{
+		spdlog::debug("Creating built-in string object");
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		llvm::Type *i64 = builder->getInt64Ty(), *bytePtrTy = builder->getInt8PtrTy();
+		std::vector<llvm::Type *> memberTypes = {i64, i64, i64, bytePtrTy, llvm::ArrayType::get(builder->getInt8Ty(), stringInlineCapacity + 1)};
+		std::vector<std::string> memberNames = {"size", ".capacity", ".hash", ".heap", ".inline"};
+		llvm::StructType *stringTy = llvm::StructType::create(*ctxt, memberTypes, "string", false);
+		llvm::PointerType *stringPtrTy = stringTy->getPointerTo();
+		AliasMgr.objects.addObject("string", stringTy);
+		AliasMgr.objects.addObjectMembers("string", memberTypes, memberNames);
+		llvm::FunctionCallee memcpy = GlobalVarsAndFunctions->getOrInsertFunction("memcpy", llvm::FunctionType::get(bytePtrTy, {bytePtrTy, bytePtrTy, i64}, false));
+		llvm::FunctionCallee memcmp = GlobalVarsAndFunctions->getOrInsertFunction("memcmp", llvm::FunctionType::get(builder->getInt32Ty(), {bytePtrTy, bytePtrTy, i64}, false));
+		llvm::FunctionCallee strlen = GlobalVarsAndFunctions->getOrInsertFunction("strlen", llvm::FunctionType::get(i64, {bytePtrTy}, false));
+
+		spdlog::debug("Implementing string capacity functions");
+		// grow(string*, i64 capacity): move the characters into a buffer of their own, with room for `capacity` of them (at least the size)
+		llvm::Function *grow = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {stringPtrTy, i64}, false), llvm::Function::InternalLinkage, "string::grow", GlobalVarsAndFunctions.get());
+		// Growing is the slow path of append; keep it out of line so append stays small enough to inline
+		grow->addFnAttr(llvm::Attribute::NoInline);
+		llvm::Value *strptr = grow->getArg(0), *capacity = grow->getArg(1);
+		strptr->setName("this");
+		capacity->setName("capacity");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", grow));
+		llvm::Value *chars = createStringData(strptr);
+		llvm::Value *size = loadStringField(strptr, stringSize, "size");
+		llvm::Value *oldcapacity = loadStringField(strptr, stringCapacity, "oldcapacity");
+		llvm::Value *buffer = builder->CreateCall(getMallocFunction(), {builder->CreateAdd(capacity, builder->getInt64(1), "bytes")}, "buffer");
+		builder->CreateCall(memcpy, {buffer, chars, builder->CreateAdd(size, builder->getInt64(1), "withnul")});
+		// Only heap buffers the string owns get freed (free(NULL) does nothing)
+		llvm::Value *owned = builder->CreateICmpSGT(oldcapacity, builder->getInt64(0), "owned");
+		builder->CreateCall(getFreeFunction(), {builder->CreateSelect(owned, loadStringField(strptr, stringHeap, "oldheap"), llvm::Constant::getNullValue(bytePtrTy), "freed")});
+		storeStringField(strptr, stringHeap, buffer);
+		storeStringField(strptr, stringCapacity, capacity);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*grow);
+
+		// reserve(string@, i64 count): make room for at least `count` characters, so the next appends don't have to grow the string
+		llvm::Function *reserve = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {stringPtrTy, i64}, false), llvm::Function::ExternalLinkage, "string::reserve", GlobalVarsAndFunctions.get());
+		strptr = reserve->getArg(0);
+		llvm::Value *count = reserve->getArg(1);
+		strptr->setName("this");
+		count->setName("count");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", reserve),
+						 *growblock = llvm::BasicBlock::Create(*ctxt, "grow", reserve),
+						 *done = llvm::BasicBlock::Create(*ctxt, "done", reserve);
+		builder->SetInsertPoint(entry);
+		size = loadStringField(strptr, stringSize, "size");
+		capacity = loadStringField(strptr, stringCapacity, "capacity");
+		count = builder->CreateSelect(builder->CreateICmpSGT(count, size, "cmptmp"), count, size, "needed");
+		llvm::Value *fitsInline = builder->CreateAnd(builder->CreateICmpEQ(capacity, builder->getInt64(0), "isinline"), builder->CreateICmpULE(count, builder->getInt64(stringInlineCapacity), "cmptmp"), "fitsinline");
+		llvm::Value *fitsHeap = builder->CreateAnd(builder->CreateICmpSGT(capacity, builder->getInt64(0), "owned"), builder->CreateICmpSLE(count, capacity, "cmptmp"), "fitsheap");
+		builder->CreateCondBr(builder->CreateOr(fitsInline, fitsHeap, "fits"), done, growblock);
+		builder->SetInsertPoint(growblock);
+		builder->CreateCall(grow, {strptr, count});
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*reserve);
+
+		spdlog::debug("Implementing string append function");
+		// append(string@, string@ other): grow the string if it's full (to double its capacity, or however much it needs), then copy other onto the end.
+		// s.append(s) works, since other's size is read before anything moves
+		llvm::Function *append = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {stringPtrTy, stringPtrTy}, false), llvm::Function::ExternalLinkage, "string::append", GlobalVarsAndFunctions.get());
+		strptr = append->getArg(0);
+		llvm::Value *otherptr = append->getArg(1);
+		strptr->setName("this");
+		otherptr->setName("other");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", append);
+		growblock = llvm::BasicBlock::Create(*ctxt, "grow", append);
+		llvm::BasicBlock *copyblock = llvm::BasicBlock::Create(*ctxt, "copy", append);
+		builder->SetInsertPoint(entry);
+		size = loadStringField(strptr, stringSize, "size");
+		llvm::Value *othersize = loadStringField(otherptr, stringSize, "othersize");
+		llvm::Value *newsize = builder->CreateAdd(size, othersize, "newsize");
+		capacity = loadStringField(strptr, stringCapacity, "capacity");
+		// Literals (capacity -1) have no room at all, since they can't be written to
+		llvm::Value *room = builder->CreateSelect(builder->CreateICmpEQ(capacity, builder->getInt64(0), "isinline"), builder->getInt64(stringInlineCapacity), capacity, "room");
+		builder->CreateCondBr(builder->CreateICmpSGT(newsize, room, "full"), growblock, copyblock, llvm::MDBuilder(*ctxt).createBranchWeights(1, 2000));
+
+		builder->SetInsertPoint(growblock);
+		llvm::Value *doubled = builder->CreateShl(capacity, builder->getInt64(1), "doubled");
+		builder->CreateCall(grow, {strptr, builder->CreateSelect(builder->CreateICmpSGT(doubled, newsize, "cmptmp"), doubled, newsize, "newcapacity")});
+		builder->CreateBr(copyblock);
+
+		builder->SetInsertPoint(copyblock);
+		llvm::Value *end = builder->CreateInBoundsGEP(builder->getInt8Ty(), createStringData(strptr), size, "end");
+		builder->CreateCall(memcpy, {end, createStringData(otherptr), othersize});
+		builder->CreateStore(builder->getInt8(0), builder->CreateInBoundsGEP(builder->getInt8Ty(), end, othersize, "nulptr"));
+		storeStringField(strptr, stringSize, newsize);
+		storeStringField(strptr, stringHash, builder->getInt64(0));
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*append);
+
+		// concat(string@ a, string@ b): a + b, with room for all of it reserved before anything's copied
+		llvm::Function *concat = llvm::Function::Create(llvm::FunctionType::get(stringTy, {stringPtrTy, stringPtrTy}, false), llvm::Function::ExternalLinkage, "string::concat", GlobalVarsAndFunctions.get());
+		llvm::Value *lhs = concat->getArg(0), *rhs = concat->getArg(1);
+		lhs->setName("lhs");
+		rhs->setName("rhs");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", concat));
+		llvm::Value *result = builder->CreateAlloca(stringTy, NULL, "result");
+		builder->CreateStore(llvm::Constant::getNullValue(stringTy), result);
+		builder->CreateCall(reserve, {result, builder->CreateAdd(loadStringField(lhs, stringSize, "lhssize"), loadStringField(rhs, stringSize, "rhssize"), "totalsize")});
+		builder->CreateCall(append, {result, lhs});
+		builder->CreateCall(append, {result, rhs});
+		builder->CreateRet(builder->CreateLoad(stringTy, result, "concatval"));
+		llvm::verifyFunction(*concat);
+
+		spdlog::debug("Implementing string comparison & hash functions");
+		// hash(string@): the FNV-1a hash of the characters, cached in the string
+		llvm::Function *hash = llvm::Function::Create(llvm::FunctionType::get(i64, {stringPtrTy}, false), llvm::Function::ExternalLinkage, "string::hash", GlobalVarsAndFunctions.get());
+		strptr = hash->getArg(0);
+		strptr->setName("this");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", hash);
+		llvm::BasicBlock *cachedblock = llvm::BasicBlock::Create(*ctxt, "cached", hash),
+						 *computeblock = llvm::BasicBlock::Create(*ctxt, "compute", hash),
+						 *loopblock = llvm::BasicBlock::Create(*ctxt, "loop", hash);
+		done = llvm::BasicBlock::Create(*ctxt, "done", hash);
+		builder->SetInsertPoint(entry);
+		llvm::Value *cached = loadStringField(strptr, stringHash, "cachedhash");
+		builder->CreateCondBr(builder->CreateICmpNE(cached, builder->getInt64(0), "ishashed"), cachedblock, computeblock);
+		builder->SetInsertPoint(cachedblock);
+		builder->CreateRet(cached);
+
+		builder->SetInsertPoint(computeblock);
+		size = loadStringField(strptr, stringSize, "size");
+		chars = createStringData(strptr);
+		builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "isempty"), done, loopblock);
+		builder->SetInsertPoint(loopblock);
+		llvm::PHINode *index = builder->CreatePHI(i64, 2, "index"), *partial = builder->CreatePHI(i64, 2, "partialhash");
+		llvm::Value *c = builder->CreateZExt(builder->CreateLoad(builder->getInt8Ty(), builder->CreateInBoundsGEP(builder->getInt8Ty(), chars, index, "charptr"), "char"), i64, "charbits");
+		llvm::Value *next = builder->CreateMul(builder->CreateXor(partial, c, "mixed"), builder->getInt64(stringHashPrime), "nexthash");
+		llvm::Value *nextindex = builder->CreateAdd(index, builder->getInt64(1), "nextindex");
+		index->addIncoming(builder->getInt64(0), computeblock);
+		index->addIncoming(nextindex, loopblock);
+		partial->addIncoming(builder->getInt64(stringHashOffset), computeblock);
+		partial->addIncoming(next, loopblock);
+		builder->CreateCondBr(builder->CreateICmpULT(nextindex, size, "cmptmp"), loopblock, done);
+		builder->SetInsertPoint(done);
+		llvm::PHINode *full = builder->CreatePHI(i64, 2, "fullhash");
+		full->addIncoming(builder->getInt64(stringHashOffset), computeblock);
+		full->addIncoming(next, loopblock);
+		// 0 means "not hashed yet"
+		llvm::Value *hashval = builder->CreateSelect(builder->CreateICmpEQ(full, builder->getInt64(0), "iszero"), builder->getInt64(1), full, "hashval");
+		storeStringField(strptr, stringHash, hashval);
+		builder->CreateRet(hashval);
+		llvm::verifyFunction(*hash);
+
+		// equals(string@ a, string@ b): different lengths or different cached hashes settle it without looking at a single character
+		llvm::Function *equals = llvm::Function::Create(llvm::FunctionType::get(builder->getInt1Ty(), {stringPtrTy, stringPtrTy}, false), llvm::Function::ExternalLinkage, "string::equals", GlobalVarsAndFunctions.get());
+		lhs = equals->getArg(0);
+		rhs = equals->getArg(1);
+		lhs->setName("lhs");
+		rhs->setName("rhs");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", equals);
+		llvm::BasicBlock *hashblock = llvm::BasicBlock::Create(*ctxt, "checkhash", equals),
+						 *compareblock = llvm::BasicBlock::Create(*ctxt, "compare", equals),
+						 *differentblock = llvm::BasicBlock::Create(*ctxt, "different", equals);
+		builder->SetInsertPoint(entry);
+		size = loadStringField(lhs, stringSize, "lhssize");
+		builder->CreateCondBr(builder->CreateICmpNE(size, loadStringField(rhs, stringSize, "rhssize"), "cmptmp"), differentblock, hashblock);
+		builder->SetInsertPoint(hashblock);
+		llvm::Value *lhshash = loadStringField(lhs, stringHash, "lhshash"), *rhshash = loadStringField(rhs, stringHash, "rhshash");
+		llvm::Value *bothHashed = builder->CreateAnd(builder->CreateICmpNE(lhshash, builder->getInt64(0), "cmptmp"), builder->CreateICmpNE(rhshash, builder->getInt64(0), "cmptmp"), "bothhashed");
+		builder->CreateCondBr(builder->CreateAnd(bothHashed, builder->CreateICmpNE(lhshash, rhshash, "cmptmp"), "hashesdiffer"), differentblock, compareblock);
+		builder->SetInsertPoint(compareblock);
+		llvm::Value *cmp = builder->CreateCall(memcmp, {createStringData(lhs), createStringData(rhs), size}, "memcmptmp");
+		builder->CreateRet(builder->CreateICmpEQ(cmp, builder->getInt32(0), "cmptmp"));
+		builder->SetInsertPoint(differentblock);
+		builder->CreateRet(builder->getFalse());
+		llvm::verifyFunction(*equals);
+
+		llvm::Function *notEquals = llvm::Function::Create(equals->getFunctionType(), llvm::Function::ExternalLinkage, "string::notEquals", GlobalVarsAndFunctions.get());
+		notEquals->getArg(0)->setName("lhs");
+		notEquals->getArg(1)->setName("rhs");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", notEquals));
+		builder->CreateRet(builder->CreateNot(builder->CreateCall(equals, {notEquals->getArg(0), notEquals->getArg(1)}, "equaltmp"), "cmptmp"));
+		llvm::verifyFunction(*notEquals);
+
+		spdlog::debug("Implementing string conversion, copy & destructor functions");
+		// fromCString(char*): a string with a copy of a C string's characters (an empty one for NULL)
+		llvm::Function *fromCString = llvm::Function::Create(llvm::FunctionType::get(stringTy, {bytePtrTy}, false), llvm::Function::InternalLinkage, "string::fromCString", GlobalVarsAndFunctions.get());
+		llvm::Value *cstr = fromCString->getArg(0);
+		cstr->setName("chars");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", fromCString);
+		copyblock = llvm::BasicBlock::Create(*ctxt, "copy", fromCString);
+		done = llvm::BasicBlock::Create(*ctxt, "done", fromCString);
+		builder->SetInsertPoint(entry);
+		result = builder->CreateAlloca(stringTy, NULL, "result");
+		builder->CreateStore(llvm::Constant::getNullValue(stringTy), result);
+		builder->CreateCondBr(builder->CreateIsNull(cstr, "isnull"), done, copyblock);
+		builder->SetInsertPoint(copyblock);
+		size = builder->CreateCall(strlen, {cstr}, "size");
+		builder->CreateCall(reserve, {result, size});
+		builder->CreateCall(memcpy, {createStringData(result), cstr, builder->CreateAdd(size, builder->getInt64(1), "withnul")});
+		storeStringField(result, stringSize, size);
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRet(builder->CreateLoad(stringTy, result, "stringval"));
+		llvm::verifyFunction(*fromCString);
+
+		// copy(string@): a copy that owns its own characters. Inline strings & literals don't own anything, so they're copied as they are
+		llvm::Function *copy = llvm::Function::Create(llvm::FunctionType::get(stringTy, {stringPtrTy}, false), llvm::Function::InternalLinkage, "string::copy", GlobalVarsAndFunctions.get());
+		strptr = copy->getArg(0);
+		strptr->setName("source");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", copy);
+		llvm::BasicBlock *sharedblock = llvm::BasicBlock::Create(*ctxt, "shared", copy);
+		copyblock = llvm::BasicBlock::Create(*ctxt, "copy", copy);
+		builder->SetInsertPoint(entry);
+		llvm::Value *source = builder->CreateLoad(stringTy, strptr, "sourceval");
+		builder->CreateCondBr(builder->CreateICmpSGT(builder->CreateExtractValue(source, {(unsigned)stringCapacity}, "capacity"), builder->getInt64(0), "owned"), copyblock, sharedblock);
+		builder->SetInsertPoint(sharedblock);
+		builder->CreateRet(source);
+		builder->SetInsertPoint(copyblock);
+		result = builder->CreateAlloca(stringTy, NULL, "result");
+		builder->CreateStore(llvm::Constant::getNullValue(stringTy), result);
+		size = builder->CreateExtractValue(source, {(unsigned)stringSize}, "size");
+		builder->CreateCall(reserve, {result, size});
+		builder->CreateCall(memcpy, {createStringData(result), builder->CreateExtractValue(source, {(unsigned)stringHeap}, "heap"), builder->CreateAdd(size, builder->getInt64(1), "withnul")});
+		storeStringField(result, stringSize, size);
+		storeStringField(result, stringHash, builder->CreateExtractValue(source, {(unsigned)stringHash}, "hash"));
+		builder->CreateRet(builder->CreateLoad(stringTy, result, "copyval"));
+		llvm::verifyFunction(*copy);
+
+		// destructor(string@): free the characters if the string owns them, leaving an empty string behind
+		llvm::Function *dtor = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {stringPtrTy}, false), llvm::Function::ExternalLinkage, "string::destructor", GlobalVarsAndFunctions.get());
+		strptr = dtor->getArg(0);
+		strptr->setName("this");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", dtor));
+		llvm::Value *isOwned = builder->CreateICmpSGT(loadStringField(strptr, stringCapacity, "capacity"), builder->getInt64(0), "owned");
+		builder->CreateCall(getFreeFunction(), {builder->CreateSelect(isOwned, loadStringField(strptr, stringHeap, "heap"), llvm::Constant::getNullValue(bytePtrTy), "freed")});
+		builder->CreateStore(llvm::Constant::getNullValue(stringTy), strptr);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*dtor);
+
+		// c_str(string@): the characters, for handing to C functions. Only valid until the string changes
+		llvm::Function *cstrfunc = llvm::Function::Create(llvm::FunctionType::get(bytePtrTy, {stringPtrTy}, false), llvm::Function::ExternalLinkage, "string::c_str", GlobalVarsAndFunctions.get());
+		strptr = cstrfunc->getArg(0);
+		strptr->setName("this");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", cstrfunc));
+		builder->CreateRet(createStringData(strptr));
+		llvm::verifyFunction(*cstrfunc);
+
+		std::vector<Variable> args;
+		std::unique_ptr<TypeExpr> t = std::make_unique<StructTypeExpr>("string");
+		t = std::make_unique<ReferenceToTypeExpr>(t);
+		args.push_back(Variable("this", t));
+		AliasMgr.functions.addFunction("hash", hash, args, false);
+		AliasMgr.functions.addFunction("c_str", cstrfunc, args, false);
+		// A local string frees its characters when it goes out of scope
+		AliasMgr.objects.addDestructor(stringTy, dtor);
+		AliasMgr.objects.addCopier(stringTy, copy);
+		t = std::make_unique<LongTypeExpr>();
+		args.push_back(Variable("count", t));
+		AliasMgr.functions.addFunction("reserve", reserve, args, false);
+		args.pop_back();
+		// Anything that takes a string also takes a char* (literals included), which is turned into a string on the way in (see convertToString)
+		for (bool cstrArg : {false, true})
+		{
+			if (cstrArg)
+			{
+				t = std::make_unique<ByteTypeExpr>();
+				t = std::make_unique<PointerToTypeExpr>(t);
+			}
+			else
+			{
+				t = std::make_unique<StructTypeExpr>("string");
+				t = std::make_unique<ReferenceToTypeExpr>(t);
+			}
+			args.push_back(Variable("other", t));
+			AliasMgr.functions.addFunction("append", append, args, false);
+			llvm::Type *otherTy = cstrArg ? bytePtrTy : (llvm::Type *)stringTy;
+			operators[stringTy]["+"][otherTy] = FunctionHeader(args, concat, false);
+			operators[stringTy]["=="][otherTy] = FunctionHeader(args, equals, false);
+			operators[stringTy]["!="][otherTy] = FunctionHeader(args, notEquals, false);
+			args.pop_back();
+		}
+		args.clear();
+		t = std::make_unique<ByteTypeExpr>();
+		t = std::make_unique<PointerToTypeExpr>(t);
+		args.push_back(Variable("lhs", t));
+		t = std::make_unique<StructTypeExpr>("string");
+		t = std::make_unique<ReferenceToTypeExpr>(t);
+		args.push_back(Variable("rhs", t));
+		operators[bytePtrTy]["+"][stringTy] = FunctionHeader(args, concat, false);
+		operators[bytePtrTy]["=="][stringTy] = FunctionHeader(args, equals, false);
+		operators[bytePtrTy]["!="][stringTy] = FunctionHeader(args, notEquals, false);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		spdlog::debug("Completed implementation of string object");
+		return stringTy;
+	}
+	llvm::StructType *getStringType()
+	{
+		llvm::Type *ty = AliasMgr("string");
+		return ty != NULL ? (llvm::StructType *)ty : generateStringObject();
+	}
+	llvm::Function *getStringFunction(const std::string &name)
+	{
+		getStringType();
+		return GlobalVarsAndFunctions->getFunction("string::" + name);
+	}
+
+	/**
+	 * @brief Turn a char* into a string. String literals become constant string objects, with their length & hash worked out
+	 * at compile time (short ones are stored inline, long ones point straight at the literal); anything else is copied at runtime
+	 */
+	llvm::Value *convertToString(llvm::Value *chars)
+	{
+		llvm::StructType *stringTy = getStringType();
+		llvm::StringRef literal;
+		if (!llvm::isa<llvm::Constant>(chars) || !llvm::getConstantStringInfo(chars, literal))
+			return builder->CreateCall(getStringFunction("fromCString"), {chars}, "stringtmp");
+		llvm::ArrayType *inlineTy = (llvm::ArrayType *)stringTy->getElementType(stringInline);
+		bool fitsInline = literal.size() <= stringInlineCapacity;
+		std::string inlineChars = fitsInline ? literal.str() : "";
+		inlineChars.resize(stringInlineCapacity + 1, '\0');
+		return llvm::ConstantStruct::get(stringTy, {builder->getInt64(literal.size()),
+													 builder->getInt64(fitsInline ? 0 : -1),
+													 builder->getInt64(hashStringBytes(literal)),
+													 fitsInline ? llvm::Constant::getNullValue(builder->getInt8PtrTy()) : (llvm::Constant *)chars,
+													 fitsInline ? llvm::ConstantDataArray::getString(*ctxt, inlineChars, false) : llvm::ConstantAggregateZero::get(inlineTy)});
+	}
+	/**
+	 * @brief Somewhere a string value can be pointed to: where it was just loaded from, or a temporary
+	 */
+	llvm::Value *getStringPointer(llvm::Value *str)
+	{
+		if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(str))
+			return load->getPointerOperand();
+		llvm::AllocaInst *tmp = createEntryBlockAlloca(str->getType(), NULL, "stringTmp");
+		builder->CreateStore(str, tmp);
+		return tmp;
+	}
+	/**
+	 * @brief A copy of the string `str` points to, that owns its own characters
+	 */
+	llvm::Value *copyString(llvm::Value *str)
+	{
+		return builder->CreateCall(getStringFunction("copy"), {str}, "stringcopy");
+	}
+	/**
+	 * @brief Finishes a switch over a string. `dispatch` switches on the string's hash, which is worked out once & cached, so picking
+	 * a case costs the same as an integer switch; each hash then checks the size and memcmp()s the characters once before jumping to
+	 * its case (cases whose hashes collide are checked one after the other). Strings that match nothing go to the default.
+	 *
+	 * @param str - the string* being switched on
+	 * @param cases - each case's characters & where to go when they match
+	 * @param temporary - whether the string was only made for the switch, so it's destroyed on the way out of the dispatch
+	 */
+	void createStringSwitchDispatch(llvm::SwitchInst *dispatch, llvm::Value *str, std::map<std::string, llvm::BasicBlock *> &cases, bool temporary)
+	{
+		llvm::Function *func = dispatch->getFunction();
+		llvm::Type *bytePtrTy = builder->getInt8PtrTy(), *i64 = builder->getInt64Ty();
+		llvm::FunctionCallee memcmp = GlobalVarsAndFunctions->getOrInsertFunction("memcmp", llvm::FunctionType::get(builder->getInt32Ty(), {bytePtrTy, bytePtrTy, i64}, false));
+		builder->SetInsertPoint(dispatch);
+		llvm::Value *size = loadStringField(str, stringSize, "size");
+		llvm::Value *chars = createStringData(str);
+		// Every way out of the dispatch goes through its own block, so a temporary is destroyed exactly once
+		auto exitTo = [&](llvm::BasicBlock *target)
+		{
+			if (!temporary)
+				return target;
+			llvm::BasicBlock *exit = llvm::BasicBlock::Create(*ctxt, "switchexit", func, target);
+			builder->SetInsertPoint(exit);
+			builder->CreateCall(getStringFunction("destructor"), {str});
+			builder->CreateBr(target);
+			return exit;
+		};
+		llvm::BasicBlock *noMatch = exitTo(dispatch->getDefaultDest());
+		dispatch->setDefaultDest(noMatch);
+
+		std::map<uint64_t, std::vector<std::pair<std::string, llvm::BasicBlock *>>> byHash;
+		for (auto &c : cases)
+			byHash[hashStringBytes(c.first)].push_back(c);
+		for (auto &bucket : byHash)
+		{
+			// Built back to front, so each check can fall through to the next one
+			llvm::BasicBlock *next = noMatch;
+			for (auto c = bucket.second.rbegin(); c != bucket.second.rend(); c++)
+			{
+				llvm::BasicBlock *target = exitTo(c->second),
+								 *sizeCheck = llvm::BasicBlock::Create(*ctxt, "stringcase", func, noMatch);
+				builder->SetInsertPoint(sizeCheck);
+				llvm::Value *sameSize = builder->CreateICmpEQ(size, builder->getInt64(c->first.size()), "samesize");
+				if (c->first.empty())
+					builder->CreateCondBr(sameSize, target, next);
+				else
+				{
+					llvm::BasicBlock *charCheck = llvm::BasicBlock::Create(*ctxt, "stringcasechars", func, noMatch);
+					builder->CreateCondBr(sameSize, charCheck, next);
+					builder->SetInsertPoint(charCheck);
+					llvm::Value *cmp = builder->CreateCall(memcmp, {chars, builder->CreateGlobalStringPtr(c->first), builder->getInt64(c->first.size())}, "cmp");
+					builder->CreateCondBr(builder->CreateICmpEQ(cmp, builder->getInt32(0), "samechars"), target, next);
+				}
+				next = sizeCheck;
+			}
+			dispatch->addCase(builder->getInt64(bucket.first), next);
+		}
+	}
+}
\ No newline at end of file
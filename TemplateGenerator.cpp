@@ -31,6 +31,17 @@ namespace jimpilier{
 				return -1; 
 			}
 		};
+		/**
+		 * @brief A generic free function (`T max<T>(T a, T b)`), & the name of the copy generated for each tuple of types it's been called with
+		 */
+		class TemplateFunction{
+			public:
+			std::vector<std::string> templates;
+			std::unique_ptr<FunctionAST> function;
+			std::map<std::vector<llvm::Type*>, std::string> instances;
+
+			TemplateFunction(std::vector<std::string> &templateNames, std::unique_ptr<FunctionAST> &function) : templates(templateNames), function(std::move(function)){}
+		};
 		std::map<std::string, std::map<std::vector<llvm::Type*>, llvm::Type*>> generatedObjects; 
 		/**
 		 * @brief a map correlating each templateObject to its name & number of template typenames (number of identifiers enclosed in gt/lt symbols, "<" & ">"). 
@@ -44,7 +55,13 @@ namespace jimpilier{
 		 * @example "map<x, Y>" and "map<Y, Z>" are, as far as we are concerned, the exact same object; therefore declaring the 2nd map would throw a redefinition error. 
 		 */
 		std::map<std::string, std::map<int, TemplateObject>> templates; 
+		std::map<std::string, std::vector<TemplateFunction>> templateFunctions; 
 		public: 
+		/**
+		 * @brief What each typename of the template being generated right now stands for, spelled the way it would be written (`T` -> `int`).
+		 * Types built from a typename (`T[]`, `pair<T, T>`) are named after what it stands for, so each generated copy gets its own
+		 */
+		std::map<std::string, std::string> boundTypeNames; 
 		TemplateGenerator(){
 			std::vector<std::unique_ptr<TypeExpr>> templates;
 			std::vector<Variable> members;
@@ -83,6 +100,20 @@ namespace jimpilier{
 		bool hasTemplate(std::string x){
 			return !templates[x].empty(); 
 		}
+		void insertTemplateFunction(std::string name, std::vector<std::string> &templateNames, std::unique_ptr<FunctionAST> &function){
+			spdlog::debug("TemplateGenerator Inserting template function named: {}", name);
+			templateFunctions[name].push_back(TemplateFunction(templateNames, function)); 
+		}
+		/**
+		 * @brief Every generic function with the given name; generic functions can be overloaded like any other function
+		 */
+		std::vector<TemplateFunction> &getTemplateFunctions(const std::string &name){
+			return templateFunctions[name]; 
+		}
+		bool hasTemplateFunction(const std::string &name){
+			auto found = templateFunctions.find(name); 
+			return found != templateFunctions.end() && !found->second.empty(); 
+		}
 	};
 
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <set>
 #include <spdlog/spdlog.h>
 #include "llvm/Support/Casting.h"
 #include "llvm/ADT/APFloat.h"
@@ -10,6 +13,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
@@ -17,6 +21,10 @@
 #include "llvm/FileCheck/FileCheck.h"
 #include "globals.cpp"
 #include "TypeExpr.h"
+#include "Allocator.cpp"
+#include "Async.cpp"
+#include "Strings.cpp"
+#include "HashTables.cpp"
 namespace jimpilier
 {
 
@@ -78,6 +86,9 @@ namespace jimpilier
 	llvm::Type *TemplateObjectExpr::codegen(bool testforval)
 	{
 		auto &templ = TemplateMgr.getTemplate(name, types);
+		// Programs can declare their own map & set templates; otherwise they're the built-in hash tables
+		if (!templ.isValid() && (name == "map" || name == "set"))
+			return getHashTableType(name, types);
 		// Check that the object doesn't already exist; if it does, return it
 		std::string typenames;
 		for (auto &x : types)
@@ -92,13 +103,23 @@ namespace jimpilier
 		// Object doesn't already exist, create it.
 		std::vector<llvm::Type *> generatedTypes;
 		// Manditory to generate types early, in their own loop, to avoid bugs with recursive template types
+		std::vector<std::string> typeSpellings;
 		for (auto &x : types)
+		{
 			generatedTypes.push_back(x->codegen());
-
+			typeSpellings.push_back(x->getName());
+		}
+		// Only this template's own typenames mean anything inside it; whatever the template it's used in called T is put back afterwards
+		std::map<std::string, std::string> outerNames = std::move(TemplateMgr.boundTypeNames);
+		TemplateMgr.boundTypeNames.clear();
+		std::vector<std::string> templateNames;
+		std::vector<llvm::Type *> outerTypes;
 		for (int i = 0; i < templ.templates.size(); i++)
 		{
-			auto &x = templ.templates[i];
-			AliasMgr.objects.replaceObject(x->getName(), generatedTypes[i]);
+			templateNames.push_back(templ.templates[i]->getName());
+			outerTypes.push_back(AliasMgr(templateNames[i]));
+			AliasMgr.objects.replaceObject(templateNames[i], generatedTypes[i]);
+			TemplateMgr.boundTypeNames[templateNames[i]] = typeSpellings[i];
 		}
 
 		std::vector<llvm::Type *> objectTypes;
@@ -119,11 +140,14 @@ namespace jimpilier
 			x->codegen();
 		}
 
-		for (int i = 0; i < templ.templates.size(); i++)
+		for (int i = 0; i < templateNames.size(); i++)
 		{
-			auto &x = templ.templates[i];
-			AliasMgr.objects.removeObject(x->getName());
+			if (outerTypes[i] != NULL)
+				AliasMgr.objects.replaceObject(templateNames[i], outerTypes[i]);
+			else
+				AliasMgr.objects.removeObject(templateNames[i]);
 		}
+		TemplateMgr.boundTypeNames = std::move(outerNames);
 		return ret;
 	}
 	std::string TemplateObjectExpr::getName()
@@ -146,6 +170,11 @@ namespace jimpilier
 	llvm::Type *StructTypeExpr::codegen(bool testforval)
 	{
 		llvm::Type *ty = AliasMgr(name);
+		// Built-in objects are only generated once something actually uses them
+		if (ty == NULL && name == "arena")
+			ty = generateArenaObject();
+		if (ty == NULL && name == "string")
+			ty = generateStringObject();
 		if (!testforval && ty == NULL)
 		{
 			logError("Unknown object of name: " + name);
@@ -154,7 +183,12 @@ namespace jimpilier
 		spdlog::debug("Retrieving struct type expression: {}", name);
 		return ty;
 	}
-	std::string StructTypeExpr::getName() { return name; }
+	std::string StructTypeExpr::getName()
+	{
+		// Inside a template, a typename is named after whatever it stands for right now
+		auto bound = TemplateMgr.boundTypeNames.find(name);
+		return bound == TemplateMgr.boundTypeNames.end() ? name : bound->second;
+	}
 	std::unique_ptr<TypeExpr> StructTypeExpr::clone()
 	{
 		return std::unique_ptr<TypeExpr>(new StructTypeExpr(name));
@@ -166,158 +200,633 @@ namespace jimpilier
 		spdlog::debug("Retrieving pointer to type: {}", AliasMgr.getTypeName(t));
 		return t == NULL ? NULL : t->getPointerTo();
 	}
+	/**
+	 * @brief Every array function that can change an array without making it smaller (append, reserve, shrink_to_fit).
+	 * Loops use this to tell whether an index that was in bounds at the top of the loop is still in bounds further down
+	 */
+	std::set<llvm::Function *> arrayFunctionsThatNeverShrink;
+	/**
+	 * @brief Whether a type is a built-in `T[]` array, i.e. { T* data, i64 size, i64 capacity }
+	 */
+	bool isArrayType(llvm::Type *ty)
+	{
+		return ty != NULL && ty->isStructTy() && !((llvm::StructType *)ty)->isLiteral() && ty->getStructName().startswith(".array<");
+	}
+	/**
+	 * @brief Whether a type is a `T[...]` slice, i.e. { T* data, i64 size }
+	 */
+	bool isSliceType(llvm::Type *ty)
+	{
+		return ty != NULL && ty->isStructTy() && !((llvm::StructType *)ty)->isLiteral() && ty->getStructName().startswith(".slice<");
+	}
+	/**
+	 * @brief Whether a type is a `T[soa]` array, i.e. { i64 size, i64 capacity, M0* member0, M1* member1, ... },
+	 * with one pointer per field of T (in the order T stores them)
+	 */
+	bool isSoaArrayType(llvm::Type *ty)
+	{
+		return ty != NULL && ty->isStructTy() && !((llvm::StructType *)ty)->isLiteral() && ty->getStructName().startswith(".soa<");
+	}
+	/**
+	 * @brief How a type is written in Jimbo (`int`, `float*`, `string[]`, `pair<int,long>`), the same way TypeExpr::getName() spells it
+	 */
+	std::string getTypeSpelling(llvm::Type *ty)
+	{
+		if (ty->isIntegerTy())
+		{
+			switch (ty->getIntegerBitWidth())
+			{
+			case 1:
+				return "bool";
+			case 8:
+				return "byte";
+			case 16:
+				return "short";
+			case 32:
+				return "int";
+			case 64:
+				return "long";
+			}
+		}
+		if (ty->isFloatTy())
+			return "float";
+		if (ty->isDoubleTy())
+			return "double";
+		if (ty->isVoidTy())
+			return "void";
+		if (ty->isPointerTy())
+			return getTypeSpelling(ty->getNonOpaquePointerElementType()) + '*';
+		if (ty->isVectorTy())
+			return getTypeSpelling(((llvm::VectorType *)ty)->getElementType()) + " x" + std::to_string(((llvm::FixedVectorType *)ty)->getNumElements());
+		if (ty->isStructTy() && !((llvm::StructType *)ty)->isLiteral())
+		{
+			llvm::StringRef name = ty->getStructName();
+			// `.array<T>`, `.soa<T>` & `.slice<T>` are how `T[]`, `T[soa]` & `T[...]` are named internally
+			if (name.startswith(".array<") && name.endswith(">"))
+				return name.substr(7, name.size() - 8).str() + "[]";
+			if (name.startswith(".soa<") && name.endswith(">"))
+				return name.substr(5, name.size() - 6).str() + "[soa]";
+			if (name.startswith(".slice<") && name.endswith(">"))
+				return name.substr(7, name.size() - 8).str() + "[...]";
+			return name.str();
+		}
+		return AliasMgr.getTypeName(ty);
+	}
+	/**
+	 * @brief The object type stored in each `T[soa]` array type
+	 */
+	std::map<llvm::Type *, llvm::StructType *> soaElementTypes;
+	llvm::StructType *getSoaElementType(llvm::Type *soaArrayTy)
+	{
+		return soaElementTypes[soaArrayTy];
+	}
+	/**
+	 * @brief The function failed bounds checks call: prints the bad index and exits
+	 */
+	llvm::Function *getArrayIndexErrorFunction()
+	{
+		llvm::Function *func = GlobalVarsAndFunctions->getFunction("array.indexError");
+		if (func != NULL)
+			return func;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		func = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt64Ty(), builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, "array.indexError", GlobalVarsAndFunctions.get());
+		func->addFnAttr(llvm::Attribute::NoReturn);
+		func->addFnAttr(llvm::Attribute::Cold);
+		func->addFnAttr(llvm::Attribute::NoInline);
+		func->getArg(0)->setName("index");
+		func->getArg(1)->setName("size");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", func));
+		llvm::FunctionCallee printfunc = GlobalVarsAndFunctions->getOrInsertFunction("printf",
+																					 llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*ctxt), llvm::PointerType::get(llvm::Type::getInt8Ty(*ctxt), false), true));
+		llvm::Constant *message = builder->CreateGlobalStringPtr("Index %ld is out of bounds for an array of size %ld\n", "indexErrorMsg");
+		builder->CreateCall(printfunc, {message, func->getArg(0), func->getArg(1)}, "printftemp");
+		builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("exit", llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt32Ty()}, false)), {builder->getInt32(1)});
+		builder->CreateUnreachable();
+		llvm::verifyFunction(*func);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return func;
+	}
+	llvm::Function *getSliceBoundsErrorFunction()
+	{
+		llvm::Function *func = GlobalVarsAndFunctions->getFunction("slice.boundsError");
+		if (func != NULL)
+			return func;
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		func = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt64Ty(), builder->getInt64Ty(), builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, "slice.boundsError", GlobalVarsAndFunctions.get());
+		func->addFnAttr(llvm::Attribute::NoReturn);
+		func->addFnAttr(llvm::Attribute::Cold);
+		func->addFnAttr(llvm::Attribute::NoInline);
+		func->getArg(0)->setName("begin");
+		func->getArg(1)->setName("end");
+		func->getArg(2)->setName("size");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", func));
+		llvm::FunctionCallee printfunc = GlobalVarsAndFunctions->getOrInsertFunction("printf",
+																					 llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*ctxt), llvm::PointerType::get(llvm::Type::getInt8Ty(*ctxt), false), true));
+		llvm::Constant *message = builder->CreateGlobalStringPtr("Slice %ld ... %ld is out of bounds for an array of size %ld\n", "sliceErrorMsg");
+		builder->CreateCall(printfunc, {message, func->getArg(0), func->getArg(1), func->getArg(2)}, "printftemp");
+		builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("exit", llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt32Ty()}, false)), {builder->getInt32(1)});
+		builder->CreateUnreachable();
+		llvm::verifyFunction(*func);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return func;
+	}
+	/**
+	 * @brief Generates the methods of a `T[]` array: append (amortized O(1); the capacity doubles whenever it runs out),
+	 * reserve, shrink_to_fit, copy, and the destructor that frees the elements. Indexing isn't a function; it's generated inline (see IndexExprAST)
+	 *
+	 * @param arrayTy - { T* data, i64 size, i64 capacity }. A zeroed array is a valid, empty array
+	 * @param typeExp - T
+	 */
 	void generateArrayFunctions(llvm::StructType *arrayTy, std::unique_ptr<TypeExpr> &typeExp)
 	{
 		spdlog::debug("Creating array[{}] helper functions", typeExp->getName());
 		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
 		llvm::Type *elementTy = typeExp->codegen();
-		llvm::FunctionType *operatorType = llvm::FunctionType::get(
-			elementTy->getPointerTo(), {arrayTy->getPointerTo(), builder->getInt32Ty()}, false);
-		llvm::Function *indexOperator = llvm::Function::Create(
-			operatorType, llvm::Function::ExternalLinkage,
-			"operator_[_" + arrayTy->getName().str() + "_", GlobalVarsAndFunctions.get());
-
-		// Destructor: Free allocated memory
-		llvm::FunctionType *dtorType = llvm::FunctionType::get(
-			builder->getVoidTy(), {arrayTy->getPointerTo()}, false);
-		llvm::Function *dtor = llvm::Function::Create(
-			dtorType, llvm::Function::ExternalLinkage,
-			arrayTy->getName().str() + "::destructor", GlobalVarsAndFunctions.get());
+		llvm::Type *dataTy = elementTy->getPointerTo();
+		std::string arrayName = arrayTy->getName().str();
+		// Elements that own memory (strings, arrays, objects holding them) are copied in & out, and destroyed with the array
+		llvm::Function *elementCopier = getObjectCopier(elementTy), *elementDtor = elementCopier == NULL ? NULL : getObjectDestructor(elementTy);
+		llvm::FunctionCallee realloc = GlobalVarsAndFunctions->getOrInsertFunction("realloc", llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt8PtrTy(), builder->getInt64Ty()}, false));
+
+		spdlog::debug("Implementing array capacity function");
+		// setCapacity(array*, i64 capacity): move the elements into a buffer of exactly `capacity` elements (freeing it if that's 0)
+		llvm::Function *setCapacity = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo(), builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, arrayName + "::setCapacity", GlobalVarsAndFunctions.get());
+		// Growing is the slow path of append; keep it out of line so append stays small enough to inline
+		setCapacity->addFnAttr(llvm::Attribute::NoInline);
+		llvm::Value *arrayptr = setCapacity->getArg(0), *capacity = setCapacity->getArg(1);
+		arrayptr->setName("this");
+		capacity->setName("capacity");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", setCapacity),
+						 *freeblock = llvm::BasicBlock::Create(*ctxt, "free", setCapacity),
+						 *reallocblock = llvm::BasicBlock::Create(*ctxt, "realloc", setCapacity),
+						 *done = llvm::BasicBlock::Create(*ctxt, "done", setCapacity);
+		builder->SetInsertPoint(entry);
+		llvm::Value *dataptr = builder->CreateStructGEP(arrayTy, arrayptr, 0, "dataptr");
+		llvm::Value *olddata = builder->CreateBitCast(builder->CreateLoad(dataTy, dataptr, "olddata"), builder->getInt8PtrTy(), "oldbytes");
+		builder->CreateCondBr(builder->CreateICmpEQ(capacity, builder->getInt64(0), "cmptmp"), freeblock, reallocblock);
+
+		builder->SetInsertPoint(freeblock);
+		builder->CreateCall(getFreeFunction(), {olddata});
+		builder->CreateBr(done);
+
+		builder->SetInsertPoint(reallocblock);
+		llvm::Value *bytes = builder->CreateMul(capacity, builder->getInt64(DataLayout->getTypeAllocSize(elementTy)), "bytes");
+		llvm::Value *newbytes = builder->CreateCall(realloc, {olddata, bytes}, "newbytes");
+		builder->CreateBr(done);
+
+		builder->SetInsertPoint(done);
+		llvm::PHINode *newdata = builder->CreatePHI(builder->getInt8PtrTy(), 2, "newdata");
+		newdata->addIncoming(llvm::Constant::getNullValue(builder->getInt8PtrTy()), freeblock);
+		newdata->addIncoming(newbytes, reallocblock);
+		builder->CreateStore(builder->CreateBitCast(newdata, dataTy), dataptr);
+		builder->CreateStore(capacity, builder->CreateStructGEP(arrayTy, arrayptr, 2, "capacityptr"));
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*setCapacity);
 
 		spdlog::debug("Implementing array append function");
-		// Push_back with reallocation logic
-		std::vector<llvm::Type *> pushBackParams = {arrayTy->getPointerTo(), elementTy};
-		llvm::FunctionType *pushBackType = llvm::FunctionType::get(
-			builder->getVoidTy(), pushBackParams, false);
-		llvm::Function *pushBack = llvm::Function::Create(
-			pushBackType, llvm::Function::ExternalLinkage,
-			arrayTy->getName().str() + "::push_back", GlobalVarsAndFunctions.get());
-
-		// Push_Back: Create basic blocks
-		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", pushBack);
-		llvm::BasicBlock *reallocBB = llvm::BasicBlock::Create(*ctxt, "realloc", pushBack);
-		llvm::BasicBlock *storeBB = llvm::BasicBlock::Create(*ctxt, "store", pushBack);
-
+		// push_back(array@, T value): double the capacity when it's full (starting at 8), then store the element at the end
+		llvm::Function *pushBack = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo(), elementTy}, false), llvm::Function::ExternalLinkage, arrayName + "::push_back", GlobalVarsAndFunctions.get());
+		arrayptr = pushBack->getArg(0);
+		llvm::Value *element = pushBack->getArg(1);
+		arrayptr->setName("this");
+		element->setName("value");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", pushBack);
+		llvm::BasicBlock *growblock = llvm::BasicBlock::Create(*ctxt, "grow", pushBack),
+						 *storeblock = llvm::BasicBlock::Create(*ctxt, "store", pushBack);
 		builder->SetInsertPoint(entry);
-
-		// Push_Back: Get vector pointer and element value
-		llvm::Value *vecPtr = pushBack->arg_begin();
-		llvm::Value *element = pushBack->arg_begin() + 1;
-
-		// Push_Back: Load current size and capacity
-		llvm::Value *sizePtr = builder->CreateStructGEP(arrayTy, vecPtr, 1);
-		llvm::Value *size = builder->CreateLoad(builder->getInt64Ty(), sizePtr);
-
-		llvm::Value *capPtr = builder->CreateStructGEP(arrayTy, vecPtr, 2);
-		llvm::Value *capacity = builder->CreateLoad(builder->getInt64Ty(), capPtr);
-
-		// Push_Back: Check size == capacity
-		llvm::Value *needsRealloc = builder->CreateICmpEQ(size, capacity);
-		builder->CreateCondBr(needsRealloc, reallocBB, storeBB);
-
-		// Push_Back: Reallocation block
-		builder->SetInsertPoint(reallocBB);
+		// Elements that own memory are copied in, so the array owns its own (see the destructor)
+		llvm::Value *elementTmp = NULL;
+		if (elementCopier != NULL)
 		{
-			// Push_Back: Double capacity
-			llvm::Value *newCapacity = builder->CreateAdd(capacity, builder->getInt64(10));
-
-			// Push_Back: Get element size using DataLayout
-			uint64_t elemSize = DataLayout->getTypeAllocSize(elementTy);
-			llvm::Value *elemSizeVal = builder->getInt64(elemSize);
-
-			// Push_Back: Calculate new byte size
-			llvm::Value *totalBytes = builder->CreateMul(newCapacity, elemSizeVal);
-
-			// Push_Back: Allocate new memory
-			llvm::Value *dataPtr = builder->CreateStructGEP(arrayTy, vecPtr, 0);
-			llvm::Value *oldData = builder->CreateLoad(elementTy->getPointerTo(), dataPtr);
-
-			llvm::Value *newDataRaw = builder->CreateCall(
-				GlobalVarsAndFunctions->getOrInsertFunction("realloc", llvm::FunctionType::get(llvm::Type::getInt8Ty(*ctxt)->getPointerTo(), {builder->getInt8Ty()->getPointerTo(), builder->getInt32Ty()}, false)),
-				{builder->CreateBitCast(oldData, llvm::Type::getInt8Ty(*ctxt)->getPointerTo()), builder->CreateTrunc(totalBytes, llvm::Type::getInt32Ty(*ctxt))});
-			// Push_Back: Cast to element type pointer
-			llvm::Value *newData = builder->CreateBitCast(newDataRaw, elementTy->getPointerTo());
-
-			// Push_Back: Update vector fields
-			builder->CreateStore(newData, dataPtr);
-			builder->CreateStore(newCapacity, capPtr);
-
-			builder->CreateBr(storeBB);
+			elementTmp = builder->CreateAlloca(elementTy, NULL, "elementTmp");
+			builder->CreateStore(element, elementTmp);
 		}
+		llvm::Value *sizeptr = builder->CreateStructGEP(arrayTy, arrayptr, 1, "sizeptr");
+		llvm::Value *size = builder->CreateLoad(builder->getInt64Ty(), sizeptr, "size");
+		capacity = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 2, "capacityptr"), "capacity");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, capacity, "full"), growblock, storeblock, llvm::MDBuilder(*ctxt).createBranchWeights(1, 2000));
+
+		builder->SetInsertPoint(growblock);
+		llvm::Value *doubled = builder->CreateShl(capacity, builder->getInt64(1), "doubled");
+		llvm::Value *newcapacity = builder->CreateSelect(builder->CreateICmpEQ(capacity, builder->getInt64(0), "cmptmp"), builder->getInt64(8), doubled, "newcapacity");
+		builder->CreateCall(setCapacity, {arrayptr, newcapacity});
+		builder->CreateBr(storeblock);
+
+		builder->SetInsertPoint(storeblock);
+		if (elementTmp != NULL)
+			element = builder->CreateCall(elementCopier, {elementTmp}, "elementcopy");
+		llvm::Value *data = builder->CreateLoad(dataTy, builder->CreateStructGEP(arrayTy, arrayptr, 0, "dataptr"), "data");
+		builder->CreateStore(element, builder->CreateInBoundsGEP(elementTy, data, size, "elementptr"));
+		builder->CreateStore(builder->CreateAdd(size, builder->getInt64(1), "newsize"), sizeptr);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*pushBack);
 
-		// Push_Back: Store element block
-		builder->SetInsertPoint(storeBB);
+		spdlog::debug("Implementing array reserve & shrink_to_fit functions");
+		// reserve(array@, i64 count): make room for at least `count` elements, so the next appends don't have to grow the array
+		llvm::Function *reserve = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo(), builder->getInt64Ty()}, false), llvm::Function::ExternalLinkage, arrayName + "::reserve", GlobalVarsAndFunctions.get());
+		arrayptr = reserve->getArg(0);
+		llvm::Value *count = reserve->getArg(1);
+		arrayptr->setName("this");
+		count->setName("count");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", reserve);
+		growblock = llvm::BasicBlock::Create(*ctxt, "grow", reserve);
+		done = llvm::BasicBlock::Create(*ctxt, "done", reserve);
+		builder->SetInsertPoint(entry);
+		capacity = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 2, "capacityptr"), "capacity");
+		builder->CreateCondBr(builder->CreateICmpUGT(count, capacity, "cmptmp"), growblock, done);
+		builder->SetInsertPoint(growblock);
+		builder->CreateCall(setCapacity, {arrayptr, count});
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*reserve);
+
+		// shrink_to_fit(array@): give back whatever capacity isn't being used
+		llvm::Function *shrink = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo()}, false), llvm::Function::ExternalLinkage, arrayName + "::shrink_to_fit", GlobalVarsAndFunctions.get());
+		arrayptr = shrink->getArg(0);
+		arrayptr->setName("this");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", shrink);
+		llvm::BasicBlock *shrinkblock = llvm::BasicBlock::Create(*ctxt, "shrink", shrink);
+		done = llvm::BasicBlock::Create(*ctxt, "done", shrink);
+		builder->SetInsertPoint(entry);
+		size = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 1, "sizeptr"), "size");
+		capacity = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 2, "capacityptr"), "capacity");
+		builder->CreateCondBr(builder->CreateICmpULT(size, capacity, "cmptmp"), shrinkblock, done);
+		builder->SetInsertPoint(shrinkblock);
+		builder->CreateCall(setCapacity, {arrayptr, size});
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*shrink);
+
+		spdlog::debug("Implementing array copy function");
+		// copy(array@): a copy with its own buffer, just big enough for the elements (each of them copied too, if they own memory)
+		llvm::Function *copy = llvm::Function::Create(llvm::FunctionType::get(arrayTy, {arrayTy->getPointerTo()}, false), llvm::Function::InternalLinkage, arrayName + "::copy", GlobalVarsAndFunctions.get());
+		arrayptr = copy->getArg(0);
+		arrayptr->setName("source");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", copy);
+		llvm::BasicBlock *emptyblock = llvm::BasicBlock::Create(*ctxt, "empty", copy),
+						 *copyblock = llvm::BasicBlock::Create(*ctxt, "copy", copy),
+						 *finishblock = llvm::BasicBlock::Create(*ctxt, "finish", copy);
+		builder->SetInsertPoint(entry);
+		size = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 1, "sizeptr"), "size");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "isempty"), emptyblock, copyblock);
+		builder->SetInsertPoint(emptyblock);
+		builder->CreateRet(llvm::Constant::getNullValue(arrayTy));
+
+		builder->SetInsertPoint(copyblock);
+		llvm::Value *sourcedata = builder->CreateLoad(dataTy, builder->CreateStructGEP(arrayTy, arrayptr, 0, "dataptr"), "sourcedata");
+		llvm::Value *copybytes = builder->CreateMul(size, builder->getInt64(DataLayout->getTypeAllocSize(elementTy)), "bytes");
+		llvm::Value *copydata = builder->CreateBitCast(builder->CreateCall(getMallocFunction(), {copybytes}, "newbytes"), dataTy, "newdata");
+		if (elementCopier == NULL)
 		{
-			// Push_Back: Get data pointer
-			llvm::Value *dataPtr = builder->CreateStructGEP(arrayTy, vecPtr, 0);
-			llvm::Value *data = builder->CreateLoad(elementTy->getPointerTo(), dataPtr);
-
-			// Push_Back: Calculate element position
-			llvm::Value *elemPtr = builder->CreateGEP(elementTy, data, size);
-			builder->CreateStore(element, elemPtr);
-
-			// Push_Back: Increment size
-			llvm::Value *newSize = builder->CreateAdd(size, builder->getInt64(1));
-			builder->CreateStore(newSize, sizePtr);
-
-			builder->CreateRetVoid();
+			builder->CreateMemCpy(copydata, llvm::MaybeAlign(), sourcedata, llvm::MaybeAlign(), copybytes);
+			builder->CreateBr(finishblock);
+		}
+		else
+		{
+			llvm::BasicBlock *elementblock = llvm::BasicBlock::Create(*ctxt, "copyelement", copy, finishblock);
+			builder->CreateBr(elementblock);
+			builder->SetInsertPoint(elementblock);
+			llvm::PHINode *index = builder->CreatePHI(builder->getInt64Ty(), 2, "index");
+			llvm::Value *elementCopy = builder->CreateCall(elementCopier, {builder->CreateInBoundsGEP(elementTy, sourcedata, index, "sourceptr")}, "elementcopy");
+			builder->CreateStore(elementCopy, builder->CreateInBoundsGEP(elementTy, copydata, index, "elementptr"));
+			llvm::Value *next = builder->CreateAdd(index, builder->getInt64(1), "nextindex");
+			index->addIncoming(builder->getInt64(0), copyblock);
+			index->addIncoming(next, elementblock);
+			builder->CreateCondBr(builder->CreateICmpULT(next, size, "cmptmp"), elementblock, finishblock);
 		}
-		spdlog::debug("Creating array indexing operator");
-		// Index Operator Implementation
-		llvm::BasicBlock *indexBlock = llvm::BasicBlock::Create(*ctxt, "entry", indexOperator);
-		builder->SetInsertPoint(indexBlock);
-		llvm::Value *gep = builder->CreateStructGEP(arrayTy, indexOperator->getArg(0), 0, "indextmp");
-		// gep = builder->CreateStructGEP(elementTy->getPointerTo(), gep, 0, "indextmp");
-		gep = builder->CreateGEP(elementTy->getPointerTo(), gep, {builder->getInt32(0)}, "indextmp");
-		gep = builder->CreateLoad(elementTy->getPointerTo(), gep);
-		builder->CreateGEP(elementTy, gep, indexOperator->getArg(1), "indextmp");
-		builder->CreateRet(gep);
+		builder->SetInsertPoint(finishblock);
+		llvm::Value *result = builder->CreateInsertValue(llvm::UndefValue::get(arrayTy), copydata, {0}, "copyval");
+		result = builder->CreateInsertValue(result, size, {1}, "copyval");
+		builder->CreateRet(builder->CreateInsertValue(result, size, {2}, "copyval"));
+		llvm::verifyFunction(*copy);
 
 		spdlog::debug("Implementing array destructor");
-		// Destructor implementation
+		// destructor(array@): free the elements (destroying them first if they own memory), leaving an empty array behind
+		llvm::Function *dtor = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo()}, false), llvm::Function::ExternalLinkage, arrayName + "::destructor", GlobalVarsAndFunctions.get());
+		arrayptr = dtor->getArg(0);
+		arrayptr->setName("this");
 		entry = llvm::BasicBlock::Create(*ctxt, "entry", dtor);
 		builder->SetInsertPoint(entry);
-		gep = builder->CreateGEP(arrayTy, dtor->getArg(0), {builder->getInt32(0), builder->getInt32(0)}, "loadtmp");
-		gep = builder->CreateBitCast(gep, builder->getInt8Ty()->getPointerTo());
-		builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("free", llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt8Ty()->getPointerTo()}, false)), {gep});
-		// gep = builder->CreateBitCast(dtor->getArg(0), builder->getInt8Ty()->getPointerTo());
-		// builder->CreateCall(GlobalVarsAndFunctions->getOrInsertFunction("free", llvm::FunctionType::get(builder->getVoidTy(), {builder->getInt8Ty()->getPointerTo()}, false)), {gep});
+		data = builder->CreateLoad(dataTy, builder->CreateStructGEP(arrayTy, arrayptr, 0, "dataptr"), "data");
+		if (elementDtor != NULL)
+		{
+			llvm::BasicBlock *destroyblock = llvm::BasicBlock::Create(*ctxt, "destroy", dtor),
+							 *freeblock = llvm::BasicBlock::Create(*ctxt, "free", dtor);
+			size = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 1, "sizeptr"), "size");
+			builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "isempty"), freeblock, destroyblock);
+			builder->SetInsertPoint(destroyblock);
+			llvm::PHINode *index = builder->CreatePHI(builder->getInt64Ty(), 2, "index");
+			builder->CreateCall(elementDtor, {builder->CreateInBoundsGEP(elementTy, data, index, "elementptr")});
+			llvm::Value *next = builder->CreateAdd(index, builder->getInt64(1), "nextindex");
+			index->addIncoming(builder->getInt64(0), entry);
+			index->addIncoming(next, destroyblock);
+			builder->CreateCondBr(builder->CreateICmpULT(next, size, "cmptmp"), destroyblock, freeblock);
+			builder->SetInsertPoint(freeblock);
+		}
+		builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(data, builder->getInt8PtrTy(), "bytes")});
+		builder->CreateStore(llvm::Constant::getNullValue(arrayTy), arrayptr);
 		builder->CreateRetVoid();
-
-		spdlog::debug("Verifying array functions");
-		// Verify functions
 		llvm::verifyFunction(*dtor);
-		llvm::verifyFunction(*pushBack);
-		llvm::verifyFunction(*indexOperator);
 
+		arrayFunctionsThatNeverShrink.insert({setCapacity, pushBack, reserve, shrink, copy});
 		std::vector<Variable> args;
-		std::unique_ptr<TypeExpr> t2 = std::make_unique<StructTypeExpr>(arrayTy->getName().str());
+		std::unique_ptr<TypeExpr> t2 = std::make_unique<StructTypeExpr>(arrayName);
 		t2 = std::make_unique<ReferenceToTypeExpr>(t2);
 		args.push_back(Variable("this", t2));
-		t2 = std::make_unique<IntTypeExpr>();
+		AliasMgr.functions.addFunction("shrink_to_fit", shrink, args, false);
+		operators[NULL]["DELETE"][arrayTy] = FunctionHeader(args, dtor, false);
+		// A local array frees its elements when it goes out of scope, so copying one copies them too
+		AliasMgr.objects.addDestructor(arrayTy, dtor);
+		AliasMgr.objects.addCopier(arrayTy, copy);
+		t2 = typeExp->clone();
 		args.push_back(Variable("value", t2));
 		AliasMgr.functions.addFunction("append", pushBack, args, false);
-		// t2 = std::make_unique<IntTypeExpr>();
-		// args.push_back(Variable("count", t2));
-		// AliasMgr.objects.addConstructor(arrayTy, ctor, args);
-		t2 = std::make_unique<StructTypeExpr>(arrayTy->getName().str());
+		args.pop_back();
+		t2 = std::make_unique<LongTypeExpr>();
+		args.push_back(Variable("count", t2));
+		AliasMgr.functions.addFunction("reserve", reserve, args, false);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		spdlog::debug("Completed implementation of array functions");
+	}
+
+	/**
+	 * @brief Generates the methods of a `T[soa]` array. They work like a `T[]`'s (see generateArrayFunctions), except every member of T
+	 * has its own buffer, so each of them is resized, and append() stores each member of the new element into its own buffer.
+	 * Members that own memory (strings, arrays...) are copied in & out, and destroyed with the array, the same as a `T[]`'s elements
+	 *
+	 * @param arrayTy - { i64 size, i64 capacity, M0* member0, ... }. A zeroed array is a valid, empty array
+	 * @param elementTy - T
+	 */
+	void generateSoaArrayFunctions(llvm::StructType *arrayTy, llvm::StructType *elementTy, std::unique_ptr<TypeExpr> &typeExp)
+	{
+		spdlog::debug("Creating soa array[{}] helper functions", typeExp->getName());
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		std::string arrayName = arrayTy->getName().str();
+		unsigned members = elementTy->getNumElements();
+		llvm::FunctionCallee realloc = GlobalVarsAndFunctions->getOrInsertFunction("realloc", llvm::FunctionType::get(builder->getInt8PtrTy(), {builder->getInt8PtrTy(), builder->getInt64Ty()}, false));
+		std::vector<llvm::Function *> memberCopiers, memberDtors;
+		for (llvm::Type *memberTy : elementTy->elements())
+		{
+			memberCopiers.push_back(getObjectCopier(memberTy));
+			memberDtors.push_back(memberCopiers.back() == NULL ? NULL : getObjectDestructor(memberTy));
+		}
+		bool ownsMembers = std::any_of(memberCopiers.begin(), memberCopiers.end(), [](llvm::Function *copier)
+									   { return copier != NULL; });
+		// Runs `body` on every index below `size` (which mustn't be 0), then carries on in the block after the loop
+		auto forEachIndex = [&](llvm::Function *func, llvm::Value *size, std::function<void(llvm::Value *)> body)
+		{
+			llvm::BasicBlock *before = builder->GetInsertBlock(),
+							 *loop = llvm::BasicBlock::Create(*ctxt, "elementloop", func),
+							 *after = llvm::BasicBlock::Create(*ctxt, "elementsdone", func);
+			builder->CreateBr(loop);
+			builder->SetInsertPoint(loop);
+			llvm::PHINode *index = builder->CreatePHI(builder->getInt64Ty(), 2, "index");
+			index->addIncoming(builder->getInt64(0), before);
+			body(index);
+			llvm::Value *next = builder->CreateAdd(index, builder->getInt64(1), "nextindex");
+			index->addIncoming(next, builder->GetInsertBlock());
+			builder->CreateCondBr(builder->CreateICmpULT(next, size, "cmptmp"), loop, after);
+			builder->SetInsertPoint(after);
+		};
+
+		// setCapacity(array*, i64 capacity): move every member's buffer to one of exactly `capacity` elements (freeing them if that's 0)
+		llvm::Function *setCapacity = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo(), builder->getInt64Ty()}, false), llvm::Function::InternalLinkage, arrayName + "::setCapacity", GlobalVarsAndFunctions.get());
+		setCapacity->addFnAttr(llvm::Attribute::NoInline);
+		llvm::Value *arrayptr = setCapacity->getArg(0), *capacity = setCapacity->getArg(1);
+		arrayptr->setName("this");
+		capacity->setName("capacity");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", setCapacity));
+		llvm::Value *empty = builder->CreateICmpEQ(capacity, builder->getInt64(0), "cmptmp");
+		for (unsigned i = 0; i < members; i++)
+		{
+			llvm::Type *memberTy = elementTy->getElementType(i);
+			llvm::Value *columnptr = builder->CreateStructGEP(arrayTy, arrayptr, i + 2, "columnptr");
+			llvm::Value *olddata = builder->CreateBitCast(builder->CreateLoad(memberTy->getPointerTo(), columnptr, "olddata"), builder->getInt8PtrTy(), "oldbytes");
+			llvm::BasicBlock *freeblock = llvm::BasicBlock::Create(*ctxt, "free", setCapacity),
+							 *reallocblock = llvm::BasicBlock::Create(*ctxt, "realloc", setCapacity),
+							 *done = llvm::BasicBlock::Create(*ctxt, "done", setCapacity);
+			builder->CreateCondBr(empty, freeblock, reallocblock);
+
+			builder->SetInsertPoint(freeblock);
+			builder->CreateCall(getFreeFunction(), {olddata});
+			builder->CreateBr(done);
+
+			builder->SetInsertPoint(reallocblock);
+			llvm::Value *bytes = builder->CreateMul(capacity, builder->getInt64(DataLayout->getTypeAllocSize(memberTy)), "bytes");
+			llvm::Value *newbytes = builder->CreateCall(realloc, {olddata, bytes}, "newbytes");
+			builder->CreateBr(done);
+
+			builder->SetInsertPoint(done);
+			llvm::PHINode *newdata = builder->CreatePHI(builder->getInt8PtrTy(), 2, "newdata");
+			newdata->addIncoming(llvm::Constant::getNullValue(builder->getInt8PtrTy()), freeblock);
+			newdata->addIncoming(newbytes, reallocblock);
+			builder->CreateStore(builder->CreateBitCast(newdata, memberTy->getPointerTo()), columnptr);
+		}
+		builder->CreateStore(capacity, builder->CreateStructGEP(arrayTy, arrayptr, 1, "capacityptr"));
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*setCapacity);
+
+		// push_back(array@, T value): double the capacity when it's full (starting at 8), then store each member at the end of its buffer
+		llvm::Function *pushBack = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo(), elementTy}, false), llvm::Function::ExternalLinkage, arrayName + "::push_back", GlobalVarsAndFunctions.get());
+		arrayptr = pushBack->getArg(0);
+		llvm::Value *element = pushBack->getArg(1);
+		arrayptr->setName("this");
+		element->setName("value");
+		llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", pushBack),
+						 *growblock = llvm::BasicBlock::Create(*ctxt, "grow", pushBack),
+						 *storeblock = llvm::BasicBlock::Create(*ctxt, "store", pushBack);
+		builder->SetInsertPoint(entry);
+		// Members that own memory are copied in, so the array owns its own (see the destructor)
+		llvm::Value *elementTmp = NULL;
+		if (ownsMembers)
+		{
+			elementTmp = builder->CreateAlloca(elementTy, NULL, "elementTmp");
+			builder->CreateStore(element, elementTmp);
+		}
+		llvm::Value *sizeptr = builder->CreateStructGEP(arrayTy, arrayptr, 0, "sizeptr");
+		llvm::Value *size = builder->CreateLoad(builder->getInt64Ty(), sizeptr, "size");
+		capacity = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 1, "capacityptr"), "capacity");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, capacity, "full"), growblock, storeblock, llvm::MDBuilder(*ctxt).createBranchWeights(1, 2000));
+
+		builder->SetInsertPoint(growblock);
+		llvm::Value *doubled = builder->CreateShl(capacity, builder->getInt64(1), "doubled");
+		llvm::Value *newcapacity = builder->CreateSelect(builder->CreateICmpEQ(capacity, builder->getInt64(0), "cmptmp"), builder->getInt64(8), doubled, "newcapacity");
+		builder->CreateCall(setCapacity, {arrayptr, newcapacity});
+		builder->CreateBr(storeblock);
+
+		builder->SetInsertPoint(storeblock);
+		for (unsigned i = 0; i < members; i++)
+		{
+			llvm::Type *memberTy = elementTy->getElementType(i);
+			llvm::Value *column = builder->CreateLoad(memberTy->getPointerTo(), builder->CreateStructGEP(arrayTy, arrayptr, i + 2, "columnptr"), "column");
+			llvm::Value *memberval = memberCopiers[i] == NULL ? builder->CreateExtractValue(element, {i}, "member") : builder->CreateCall(memberCopiers[i], {builder->CreateStructGEP(elementTy, elementTmp, i, "memberptr")}, "membercopy");
+			builder->CreateStore(memberval, builder->CreateInBoundsGEP(memberTy, column, size, "elementptr"));
+		}
+		builder->CreateStore(builder->CreateAdd(size, builder->getInt64(1), "newsize"), sizeptr);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*pushBack);
+
+		// reserve(array@, i64 count): make room for at least `count` elements
+		llvm::Function *reserve = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo(), builder->getInt64Ty()}, false), llvm::Function::ExternalLinkage, arrayName + "::reserve", GlobalVarsAndFunctions.get());
+		arrayptr = reserve->getArg(0);
+		llvm::Value *count = reserve->getArg(1);
+		arrayptr->setName("this");
+		count->setName("count");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", reserve);
+		growblock = llvm::BasicBlock::Create(*ctxt, "grow", reserve);
+		llvm::BasicBlock *done = llvm::BasicBlock::Create(*ctxt, "done", reserve);
+		builder->SetInsertPoint(entry);
+		capacity = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 1, "capacityptr"), "capacity");
+		builder->CreateCondBr(builder->CreateICmpUGT(count, capacity, "cmptmp"), growblock, done);
+		builder->SetInsertPoint(growblock);
+		builder->CreateCall(setCapacity, {arrayptr, count});
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*reserve);
+
+		// shrink_to_fit(array@): give back whatever capacity isn't being used
+		llvm::Function *shrink = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo()}, false), llvm::Function::ExternalLinkage, arrayName + "::shrink_to_fit", GlobalVarsAndFunctions.get());
+		arrayptr = shrink->getArg(0);
+		arrayptr->setName("this");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", shrink);
+		llvm::BasicBlock *shrinkblock = llvm::BasicBlock::Create(*ctxt, "shrink", shrink);
+		done = llvm::BasicBlock::Create(*ctxt, "done", shrink);
+		builder->SetInsertPoint(entry);
+		size = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 0, "sizeptr"), "size");
+		capacity = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 1, "capacityptr"), "capacity");
+		builder->CreateCondBr(builder->CreateICmpULT(size, capacity, "cmptmp"), shrinkblock, done);
+		builder->SetInsertPoint(shrinkblock);
+		builder->CreateCall(setCapacity, {arrayptr, size});
+		builder->CreateBr(done);
+		builder->SetInsertPoint(done);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*shrink);
+
+		// copy(array@): a copy with buffers of its own, just big enough for the elements (with their members copied too, if they own memory)
+		llvm::Function *copy = llvm::Function::Create(llvm::FunctionType::get(arrayTy, {arrayTy->getPointerTo()}, false), llvm::Function::InternalLinkage, arrayName + "::copy", GlobalVarsAndFunctions.get());
+		arrayptr = copy->getArg(0);
+		arrayptr->setName("source");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", copy);
+		llvm::BasicBlock *emptyblock = llvm::BasicBlock::Create(*ctxt, "empty", copy),
+						 *copyblock = llvm::BasicBlock::Create(*ctxt, "copy", copy);
+		builder->SetInsertPoint(entry);
+		size = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 0, "sizeptr"), "size");
+		builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "isempty"), emptyblock, copyblock);
+		builder->SetInsertPoint(emptyblock);
+		builder->CreateRet(llvm::Constant::getNullValue(arrayTy));
+		builder->SetInsertPoint(copyblock);
+		llvm::Value *result = builder->CreateInsertValue(llvm::UndefValue::get(arrayTy), size, {0}, "copyval");
+		result = builder->CreateInsertValue(result, size, {1}, "copyval");
+		for (unsigned i = 0; i < members; i++)
+		{
+			llvm::Type *memberTy = elementTy->getElementType(i);
+			llvm::Value *column = builder->CreateLoad(memberTy->getPointerTo(), builder->CreateStructGEP(arrayTy, arrayptr, i + 2, "columnptr"), "column");
+			llvm::Value *bytes = builder->CreateMul(size, builder->getInt64(DataLayout->getTypeAllocSize(memberTy)), "bytes");
+			llvm::Value *newcolumn = builder->CreateCall(getMallocFunction(), {bytes}, "newbytes");
+			llvm::Value *newdata = builder->CreateBitCast(newcolumn, memberTy->getPointerTo(), "newdata");
+			if (memberCopiers[i] == NULL)
+				builder->CreateMemCpy(newcolumn, llvm::MaybeAlign(), column, llvm::MaybeAlign(), bytes);
+			else
+				forEachIndex(copy, size, [&](llvm::Value *index)
+							 { builder->CreateStore(builder->CreateCall(memberCopiers[i], {builder->CreateInBoundsGEP(memberTy, column, index, "sourceptr")}, "membercopy"), builder->CreateInBoundsGEP(memberTy, newdata, index, "elementptr")); });
+			result = builder->CreateInsertValue(result, newdata, {i + 2}, "copyval");
+		}
+		builder->CreateRet(result);
+		llvm::verifyFunction(*copy);
+
+		// destructor(array@): free every member's buffer (destroying the members in it first if they own memory), leaving an empty array behind
+		llvm::Function *dtor = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {arrayTy->getPointerTo()}, false), llvm::Function::ExternalLinkage, arrayName + "::destructor", GlobalVarsAndFunctions.get());
+		arrayptr = dtor->getArg(0);
+		arrayptr->setName("this");
+		entry = llvm::BasicBlock::Create(*ctxt, "entry", dtor);
+		builder->SetInsertPoint(entry);
+		size = builder->CreateLoad(builder->getInt64Ty(), builder->CreateStructGEP(arrayTy, arrayptr, 0, "sizeptr"), "size");
+		if (ownsMembers)
+		{
+			llvm::BasicBlock *destroyblock = llvm::BasicBlock::Create(*ctxt, "destroy", dtor),
+							 *freeblock = llvm::BasicBlock::Create(*ctxt, "free", dtor);
+			builder->CreateCondBr(builder->CreateICmpEQ(size, builder->getInt64(0), "isempty"), freeblock, destroyblock);
+			builder->SetInsertPoint(destroyblock);
+			for (unsigned i = 0; i < members; i++)
+			{
+				llvm::Type *memberTy = elementTy->getElementType(i);
+				if (memberDtors[i] == NULL)
+					continue;
+				llvm::Value *column = builder->CreateLoad(memberTy->getPointerTo(), builder->CreateStructGEP(arrayTy, arrayptr, i + 2, "columnptr"), "column");
+				forEachIndex(dtor, size, [&](llvm::Value *index)
+							 { builder->CreateCall(memberDtors[i], {builder->CreateInBoundsGEP(memberTy, column, index, "elementptr")}); });
+			}
+			builder->CreateBr(freeblock);
+			builder->SetInsertPoint(freeblock);
+		}
+		for (unsigned i = 0; i < members; i++)
+		{
+			llvm::Value *column = builder->CreateLoad(elementTy->getElementType(i)->getPointerTo(), builder->CreateStructGEP(arrayTy, arrayptr, i + 2, "columnptr"), "column");
+			builder->CreateCall(getFreeFunction(), {builder->CreateBitCast(column, builder->getInt8PtrTy(), "bytes")});
+		}
+		builder->CreateStore(llvm::Constant::getNullValue(arrayTy), arrayptr);
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*dtor);
+
+		arrayFunctionsThatNeverShrink.insert({setCapacity, pushBack, reserve, shrink, copy});
+		std::vector<Variable> args;
+		std::unique_ptr<TypeExpr> t2 = std::make_unique<StructTypeExpr>(arrayName);
 		t2 = std::make_unique<ReferenceToTypeExpr>(t2);
 		args.push_back(Variable("this", t2));
+		AliasMgr.functions.addFunction("shrink_to_fit", shrink, args, false);
 		operators[NULL]["DELETE"][arrayTy] = FunctionHeader(args, dtor, false);
-		t2 = std::make_unique<StructTypeExpr>(arrayTy->getName().str());
-		t2 = std::make_unique<ReferenceToTypeExpr>(t2);
-		args.push_back(Variable("this", t2));
-		t2 = std::make_unique<IntTypeExpr>();
-		args.push_back(Variable("offset", t2));
-		operators[arrayTy]["["][builder->getInt32Ty()] = FunctionHeader(args, indexOperator, true);
-		builder->SetInsertPoint(lastInsertPoint);
-		spdlog::debug("Completed implementation of array functions");
+		AliasMgr.objects.addDestructor(arrayTy, dtor);
+		AliasMgr.objects.addCopier(arrayTy, copy);
+		t2 = typeExp->clone();
+		args.push_back(Variable("value", t2));
+		AliasMgr.functions.addFunction("append", pushBack, args, false);
+		args.pop_back();
+		t2 = std::make_unique<LongTypeExpr>();
+		args.push_back(Variable("count", t2));
+		AliasMgr.functions.addFunction("reserve", reserve, args, false);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+	}
+	/**
+	 * @brief Get (creating it & its methods the first time) the `T[soa]` array type for an object type T
+	 */
+	llvm::Type *getSoaArrayType(std::unique_ptr<TypeExpr> &typeExp)
+	{
+		std::string typenames = ".soa<" + typeExp->getName() + '>';
+		if (AliasMgr(typenames))
+			return AliasMgr(typenames);
+		llvm::StructType *elementTy = llvm::dyn_cast_or_null<llvm::StructType>(typeExp->codegen());
+		if (elementTy == NULL || elementTy->isOpaque() || isArrayType(elementTy) || isSoaArrayType(elementTy))
+		{
+			logError("Only arrays of objects can be stored as soa arrays, not arrays of " + typeExp->getName());
+			return NULL;
+		}
+		spdlog::debug("Creating soa array[{}]", typenames);
+		std::vector<llvm::Type *> fields = {builder->getInt64Ty(), builder->getInt64Ty()};
+		for (llvm::Type *member : elementTy->elements())
+			fields.push_back(member->getPointerTo());
+		llvm::StructType *ret = llvm::StructType::create(*ctxt, fields, typenames, false);
+		std::vector<llvm::Type *> memberTypes = {builder->getInt64Ty(), builder->getInt64Ty()};
+		std::vector<std::string> memberNames = {"size", "capacity"};
+		AliasMgr.objects.addObject(typenames, ret);
+		AliasMgr.objects.addObjectMembers(typenames, memberTypes, memberNames);
+		soaElementTypes[ret] = elementTy;
+		generateSoaArrayFunctions(ret, elementTy, typeExp);
+		return ret;
 	}
 
 	llvm::Type *ArrayOfTypeExpr::codegen(bool testforval)
 	{
+		if (soa)
+			return getSoaArrayType(ty);
 		std::vector<std::unique_ptr<TypeExpr>> tyarr;
-		tyarr.push_back(std::move(ty));
+		tyarr.push_back(ty->clone());
 		std::string name(".array");
 		auto &templ = TemplateMgr.getTemplate(name, tyarr);
 		// Check that the object doesn't already exist; if it does, return it
@@ -370,7 +879,81 @@ namespace jimpilier
 	std::unique_ptr<TypeExpr> ArrayOfTypeExpr::clone()
 	{
 		std::unique_ptr<TypeExpr> encasedType = std::move(ty->clone());
-		return std::make_unique<ArrayOfTypeExpr>(encasedType);
+		return std::make_unique<ArrayOfTypeExpr>(encasedType, soa);
+	}
+
+	/**
+	 * @brief Get (creating it the first time) the `T[...]` slice type for an element type. Slices have no methods or destructor;
+	 * they don't own what they point to
+	 */
+	llvm::Type *getSliceType(llvm::Type *elementTy)
+	{
+		std::string typenames = ".slice<" + getTypeSpelling(elementTy) + '>';
+		if (AliasMgr(typenames))
+			return AliasMgr(typenames);
+		spdlog::debug("Creating slice[{}]", typenames);
+		std::vector<llvm::Type *> memberTypes = {elementTy->getPointerTo(), builder->getInt64Ty()};
+		std::vector<std::string> memberNames = {"data", "size"};
+		llvm::StructType *ret = llvm::StructType::create(*ctxt, memberTypes, typenames, false);
+		AliasMgr.objects.addObject(typenames, ret);
+		AliasMgr.objects.addObjectMembers(typenames, memberTypes, memberNames);
+		return ret;
+	}
+	/**
+	 * @brief A slice of a whole `T[]` array (or pointer to one), for passing arrays where slices are expected. Anything else is returned as is
+	 */
+	llvm::Value *convertToSlice(llvm::Value *array, llvm::Type *sliceTy)
+	{
+		if (array->getType()->isPointerTy() && isArrayType(array->getType()->getNonOpaquePointerElementType()))
+			array = builder->CreateLoad(array->getType()->getNonOpaquePointerElementType(), array, "arraytmp");
+		if (!isArrayType(array->getType()) || array->getType()->getStructElementType(0) != sliceTy->getStructElementType(0))
+			return array;
+		llvm::Value *slice = builder->CreateInsertValue(llvm::UndefValue::get(sliceTy), builder->CreateExtractValue(array, {0u}, "arraydata"), {0u}, "slicetmp");
+		return builder->CreateInsertValue(slice, builder->CreateExtractValue(array, {1u}, "arraysize"), {1u}, "slicetmp");
+	}
+
+	llvm::Type *SliceOfTypeExpr::codegen(bool testforval)
+	{
+		llvm::Type *elementTy = ty->codegen();
+		return elementTy == NULL ? NULL : getSliceType(elementTy);
+	}
+
+	std::unique_ptr<TypeExpr> SliceOfTypeExpr::clone()
+	{
+		std::unique_ptr<TypeExpr> encasedType = std::move(ty->clone());
+		return std::make_unique<SliceOfTypeExpr>(encasedType);
+	}
+
+	llvm::Type *VectorTypeExpr::codegen(bool testforval)
+	{
+		llvm::Type *t = ty->codegen();
+		if (t == NULL)
+			return NULL;
+		if (!t->isIntegerTy() && !t->isFloatingPointTy())
+		{
+			spdlog::error("Vectors can only hold integers and floating point numbers, not a(n) {}", AliasMgr.getTypeName(t, true));
+			return NULL;
+		}
+		spdlog::debug("Retrieving vector of {} {}s", width, AliasMgr.getTypeName(t));
+		return llvm::FixedVectorType::get(t, width);
+	}
+	std::unique_ptr<TypeExpr> VectorTypeExpr::clone()
+	{
+		std::unique_ptr<TypeExpr> encasedType = std::move(ty->clone());
+		return std::make_unique<VectorTypeExpr>(encasedType, width);
+	}
+
+	llvm::Type *AsyncTypeExpr::codegen(bool testforval)
+	{
+		llvm::Type *t = ty->codegen();
+		if (t == NULL)
+			return NULL;
+		return getAsyncPromiseType(t)->getPointerTo();
+	}
+	std::unique_ptr<TypeExpr> AsyncTypeExpr::clone()
+	{
+		std::unique_ptr<TypeExpr> encasedType = std::move(ty->clone());
+		return std::make_unique<AsyncTypeExpr>(encasedType);
 	}
 
 	llvm::Type *ReferenceToTypeExpr::codegen(bool testforval)
@@ -16,6 +16,10 @@ namespace jimpilier
 		{
 			return false;
 		}
+		virtual bool isAsync()
+		{
+			return false;
+		}
 	};
 
 	class DoubleTypeExpr : public TypeExpr
@@ -135,14 +139,62 @@ namespace jimpilier
 
 	class ArrayOfTypeExpr : public TypeExpr {
 		std::unique_ptr<TypeExpr> ty; 
+		bool soa; // `T[soa]`: every member of the object gets its own array
 
 		public: 
-		ArrayOfTypeExpr(std::unique_ptr<TypeExpr> &ty) : ty(std::move(ty)) {}
+		ArrayOfTypeExpr(std::unique_ptr<TypeExpr> &ty, bool soa = false) : ty(std::move(ty)), soa(soa) {}
 		llvm::Type *codegen(bool testforval = false);
-		std::string getName() { return ty->getName()+"[]"; }
+		std::string getName() { return ty->getName() + (soa ? "[soa]" : "[]"); }
 		std::unique_ptr<TypeExpr> clone();
 	}; 
 
+	/**
+	 * @brief A view of part of an array (`T[...]`), i.e. { T* data, i64 size }, that shares the array's storage instead of copying it
+	 */
+	class SliceOfTypeExpr : public TypeExpr {
+		std::unique_ptr<TypeExpr> ty; 
+
+		public: 
+		SliceOfTypeExpr(std::unique_ptr<TypeExpr> &ty) : ty(std::move(ty)) {}
+		llvm::Type *codegen(bool testforval = false);
+		std::string getName() { return ty->getName() + "[...]"; }
+		std::unique_ptr<TypeExpr> clone();
+	}; 
+
+	/**
+	 * @brief A fixed width SIMD vector of a scalar type (`float x4`, `int x8`), i.e. an LLVM <N x T>
+	 */
+	class VectorTypeExpr : public TypeExpr
+	{
+		std::unique_ptr<TypeExpr> ty;
+		unsigned width;
+
+	public:
+		VectorTypeExpr(std::unique_ptr<TypeExpr> &type, unsigned width) : ty(std::move(type)), width(width) {}
+		llvm::Type *codegen(bool testforval = false);
+		std::string getName() { return ty->getName() + " x" + std::to_string(width); }
+		std::unique_ptr<TypeExpr> clone();
+	};
+
+	/**
+	 * @brief The task an async function returns (`async int`): a pointer to the promise its result ends up in
+	 */
+	class AsyncTypeExpr : public TypeExpr
+	{
+		std::unique_ptr<TypeExpr> ty;
+
+	public:
+		AsyncTypeExpr(std::unique_ptr<TypeExpr> &type) : ty(std::move(type)) {}
+		llvm::Type *codegen(bool testforval = false);
+		std::string getName() { return "async " + ty->getName(); }
+		std::unique_ptr<TypeExpr> clone();
+
+		bool isAsync()
+		{
+			return true;
+		}
+	};
+
 	class ReferenceToTypeExpr : public TypeExpr
 	{
 		std::unique_ptr<TypeExpr> ty;
@@ -1,12 +1,16 @@
+#include <algorithm>
 #include <iomanip>
+#include <set>
 #include <stack>
 #include <spdlog/spdlog.h>
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/IR/Verifier.h"
 #ifndef globals
 #define globals
 #include "tokenizer.cpp"
@@ -42,8 +46,92 @@ namespace jimpilier
 	 */
 	std::stack<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>> escapeBlock;
 	std::map<llvm::Type *, std::map<std::string, std::map<llvm::Type *, FunctionHeader>>> operators;
+	/**
+	 * @brief The `_error@` type info for every type that gets thrown or caught, and the number each type's catches are dispatched on
+	 */
 	std::map<llvm::Type *, llvm::Value *> classInfoVals;
+	std::map<llvm::Type *, int> errorTypeIDs;
+	/**
+	 * @brief Every variable declared `atomic`: its alloca or global, plus the pointers to it that parallel for bodies capture.
+	 * Reads, assignments, `++` and `--` on these are single sequentially consistent atomic instructions
+	 */
+	std::set<llvm::Value *> atomicSlots;
+	/**
+	 * @brief The temporaries whole `T[soa]` elements are gathered into. They share what they own with the array, so returning one copies it
+	 */
+	std::set<llvm::Value *> gatheredElements;
+	/**
+	 * @brief A local variable that needs cleaning up when it goes out of scope: its lifetime ends, and objects get their destructor called.
+	 * `destructor` is NULL for anything that doesn't need destroying.
+	 * `liveFlag` is only set for objects declared inside a try block; it's an i1 that's true while the object is alive,
+	 * so the try's landing pad knows which objects to destroy when an exception unwinds through them.
+	 */
+	struct ScopedLocal
+	{
+		llvm::AllocaInst *slot;
+		llvm::Function *destructor;
+		llvm::Value *liveFlag;
+	};
+	/**
+	 * @brief The locals to clean up on the way out of each scope in the current function, innermost scope last
+	 */
+	std::vector<std::vector<ScopedLocal>> localScopes;
+	/**
+	 * @brief The number of localScopes that were open when each loop/switch in `escapeBlock` started, so `break` and `continue` only clean up what they leave
+	 */
+	std::stack<size_t> escapeScopeDepth;
+	/**
+	 * @brief The objects declared inside each enclosing try block of the current function, which its landing pad has to destroy
+	 */
+	std::vector<std::vector<ScopedLocal>> tryCleanups;
+	/**
+	 * @brief An array bounds check that an enclosing loop might be able to prove always passes (see ForExprAST).
+	 * `indexSlot` & `arraySlot` are the variables the index & the array were read from
+	 */
+	struct BoundsCheck
+	{
+		llvm::BranchInst *check;
+		llvm::AllocaInst *indexSlot, *arraySlot;
+	};
+	/**
+	 * @brief Bounds checks generated inside the loops we're currently generating, that no loop has proven yet
+	 */
+	std::vector<BoundsCheck> pendingBoundsChecks;
+	/**
+	 * @brief Bounds checks a loop has proven, that are removed once the outermost loop is done (when we know the index & array can't be changed behind the loop's back)
+	 */
+	std::vector<BoundsCheck> provenBoundsChecks;
+	int loopDepth = 0;
+	/**
+	 * @brief The functions `parallel for` loop bodies were outlined into; `return` can't be used in them
+	 */
+	std::set<llvm::Function *> parallelBodies;
+	/**
+	 * @brief The destructors generated for objects that only need their members destroyed, as opposed to ones written with `destructor`
+	 */
+	std::set<llvm::Function *> memberwiseDestructors;
 	std::string currentFile;
+	/**
+	 * @brief Set by `--release` (or `-DNDEBUG`). When true the debug print operator is compiled out entirely, so `expr!` is just `expr`,
+	 * and array indexes aren't bounds checked
+	 *
+	 */
+	bool releaseMode = false;
+	/**
+	 * @brief Set by `--debug-print=<file>`. When empty, debug prints go to stdout; otherwise they're written to this file through a buffered FILE*
+	 *
+	 */
+	std::string debugPrintFile;
+	/**
+	 * @brief Set by `--error-codes`. When true, errors thrown by `throws` functions are passed back through the error slot
+	 * (see getErrorTagSlot()) and checked for after each call, rather than unwinding the stack with the C++ runtime
+	 *
+	 */
+	bool errorCodeMode = false;
+	/**
+	 * @brief Every function declared with a `throws` clause. With error codes these may return with an error pending
+	 */
+	std::set<llvm::Function *> throwingFunctions;
 
 	// <-- BEGINNING OF UTILITY FUNCTIONS -->
 
@@ -57,6 +145,68 @@ namespace jimpilier
 		spdlog::error(s);
 		assert(false);
 	}
+	/**
+	 * @brief The biggest object a function returns in registers, in bytes (two registers' worth, like the C ABI)
+	 */
+	const uint64_t maxRegisterReturnSize = 16;
+	/**
+	 * @brief Whether a function returning this type returns it through a slot the caller passes in (`sret`) instead of in registers.
+	 * The function constructs the object straight into the slot, and the caller usually points the slot at the variable being declared
+	 */
+	bool returnsInMemory(llvm::Type *ty)
+	{
+		return ty->isStructTy() && !llvm::cast<llvm::StructType>(ty)->isOpaque() && DataLayout->getTypeAllocSize(ty) > maxRegisterReturnSize;
+	}
+	/**
+	 * @brief The `sret` slot a function returns its object through, or NULL if it returns normally
+	 */
+	llvm::Argument *getReturnSlot(llvm::Function *func)
+	{
+		return func != NULL && func->hasStructRetAttr() ? func->getArg(0) : NULL;
+	}
+	void emitErrorCheck();
+	/**
+	 * @brief Whether an error can be thrown (or a `throws` function called) here. The body of a parallel for loop runs on worker
+	 * threads, so anything thrown in it has to be caught inside it
+	 */
+	bool canThrowFromHere()
+	{
+		if (currentUnwindBlock == NULL && parallelBodies.count(currentFunction))
+		{
+			logError("Errors can't be thrown out of a parallel for loop; catch them inside the loop body");
+			return false;
+		}
+		return true;
+	}
+	llvm::AllocaInst *createEntryBlockAlloca(llvm::Type *ty, llvm::Value *arraySize, const llvm::Twine &name);
+	bool isStringType(llvm::Type *ty);
+	bool isCopyable(llvm::Type *ty);
+	llvm::Value *convertToString(llvm::Value *chars);
+	bool isSliceType(llvm::Type *ty);
+	llvm::Value *convertToSlice(llvm::Value *array, llvm::Type *sliceTy);
+	/**
+	 * @brief Emits the call itself once the arguments are ready: a plain call, or one that checks for (or unwinds with) an error if the function can throw
+	 */
+	llvm::Value *createCall(std::vector<llvm::Value *> &args, FunctionHeader &CalleeF)
+	{
+		if (!CalleeF.canThrow())
+			return CalleeF.func->getReturnType() == llvm::Type::getVoidTy(*ctxt) ? builder->CreateCall(CalleeF.func, args) : builder->CreateCall(CalleeF.func, args, "calltmp");
+		spdlog::debug("Function can throw; making checks for unwind blocks...");
+		if (!canThrowFromHere())
+			return NULL;
+		if (errorCodeMode)
+		{
+			llvm::Value *retval = CalleeF.func->getReturnType() == llvm::Type::getVoidTy(*ctxt) ? builder->CreateCall(CalleeF.func, args) : builder->CreateCall(CalleeF.func, args, "calltmp");
+			emitErrorCheck();
+			return retval;
+		}
+		assert(currentUnwindBlock != NULL && "Attempted to call a function that throws errors with no way to catch the error!");
+		llvm::BasicBlock *normalUnwindBlock = llvm::BasicBlock::Create(*ctxt, "NormalExecBlock", currentFunction);
+		llvm::Value *retval = CalleeF.func->getReturnType() == llvm::Type::getVoidTy(*ctxt) ? builder->CreateInvoke(CalleeF.func, normalUnwindBlock, currentUnwindBlock, args) : builder->CreateInvoke(CalleeF.func, normalUnwindBlock, currentUnwindBlock, args, "calltmp");
+		builder->SetInsertPoint(normalUnwindBlock);
+		spdlog::debug("Unwind blocks found!");
+		return retval;
+	}
 	/**
 	 * @brief Makes a call to a function (defined in `CalleeF`) using a std::vector<> containing pointers to each of the args.
 	 * Dereferences each arg as necessary to ensure that non-references are passed correctly, while references may be passed as 
@@ -64,30 +214,69 @@ namespace jimpilier
 	 * 
 	 * @param ptrsToArgs - The arguments passed to this object, ideally via their `codegen(false)` method
 	 * @param CalleeF - The function header to call
-	 * @return llvm::Value* - The result of the call
+	 * @param returnSlot - Where a function that returns through an `sret` slot should put its result. If it's NULL (or of the wrong type),
+	 * a temporary is used and its value returned
+	 * @return llvm::Value* - The result of the call, or NULL if it was written into `returnSlot`
 	 */
-	llvm::Value *makeCallWithReferences(std::vector<llvm::Value *> &ptrsToArgs, FunctionHeader &CalleeF, bool hasParent = false)
+	llvm::Value *makeCallWithReferences(std::vector<llvm::Value *> &ptrsToArgs, FunctionHeader &CalleeF, bool hasParent = false, llvm::Value *returnSlot = NULL)
 	{
 		spdlog::debug("Making call with references. {0}() -> {1} (Has parent: {2})", CalleeF.func->getName().str(), AliasMgr.getTypeName(CalleeF.func->getReturnType()), (hasParent ? "true" : "false"));
+		llvm::Argument *calleeSlot = getReturnSlot(CalleeF.func);
 		for (unsigned i = hasParent; i < ptrsToArgs.size(); ++i)
 		{
-			if (!CalleeF.args[i-hasParent].isRef && ptrsToArgs[i]->getType() == CalleeF.args[i-hasParent].ty->getPointerTo())
+			unsigned paramNo = i + (calleeSlot != NULL);
+			llvm::Argument *param = paramNo < CalleeF.func->arg_size() ? CalleeF.func->getArg(paramNo) : NULL;
+			llvm::Type *paramTy = param != NULL ? param->getType() : NULL;
+			if (i < CalleeF.args.size() && !CalleeF.args[i].isRef && !isCopyable(CalleeF.args[i].ty))
+			{
+				logError("Objects of type " + AliasMgr.getTypeName(CalleeF.args[i].ty) + " can't be copied, so " + CalleeF.func->getName().str() + "() has to take them by reference");
+				return NULL;
+			}
+			// C strings (literals included) passed as strings are turned into string objects
+			if (paramTy != NULL && ptrsToArgs[i] != NULL && ptrsToArgs[i]->getType() == llvm::Type::getInt8PtrTy(*ctxt) &&
+				(isStringType(paramTy) || (paramTy->isPointerTy() && isStringType(paramTy->getNonOpaquePointerElementType()))))
+				ptrsToArgs[i] = convertToString(ptrsToArgs[i]);
+			// Arrays passed as slices are viewed whole rather than copied
+			if (paramTy != NULL && ptrsToArgs[i] != NULL && isSliceType(paramTy))
+				ptrsToArgs[i] = convertToSlice(ptrsToArgs[i], paramTy);
+			// Big objects are passed by pointer, and the copy is made by the call itself. Values get somewhere to live first
+			if (param != NULL && param->hasByValAttr() && ptrsToArgs[i] != NULL)
+			{
+				if (ptrsToArgs[i]->getType() != param->getType())
+				{
+					llvm::AllocaInst *tmp = createEntryBlockAlloca(ptrsToArgs[i]->getType(), NULL, "byvalTmp");
+					builder->CreateStore(ptrsToArgs[i], tmp);
+					ptrsToArgs[i] = tmp;
+				}
+				continue;
+			}
+			if (!CalleeF.args[i].isRef && ptrsToArgs[i]->getType() == CalleeF.args[i].ty->getPointerTo())
 				ptrsToArgs[i] = builder->CreateLoad(ptrsToArgs[i]->getType()->getNonOpaquePointerElementType(), ptrsToArgs[i], "dereftmp");
+			// A value passed by pointer (a temporary, like the result of a call) needs somewhere to live first
+			if (paramTy != NULL && ptrsToArgs[i] != NULL && paramTy->isPointerTy() && paramTy->getNonOpaquePointerElementType() == ptrsToArgs[i]->getType())
+			{
+				llvm::AllocaInst *tmp = createEntryBlockAlloca(ptrsToArgs[i]->getType(), NULL, "refTmp");
+				builder->CreateStore(ptrsToArgs[i], tmp);
+				ptrsToArgs[i] = tmp;
+			}
+			// Integers of a different size are converted the same way assignments convert them
+			if (paramTy != NULL && ptrsToArgs[i] != NULL && ptrsToArgs[i]->getType()->isIntegerTy() && paramTy->isIntegerTy() && ptrsToArgs[i]->getType() != paramTy && ptrsToArgs[i]->getType()->getIntegerBitWidth() > 1)
+				ptrsToArgs[i] = builder->CreateSExtOrTrunc(ptrsToArgs[i], paramTy, "signExtendTmp");
 			if (!ptrsToArgs[i])
 			{
 				spdlog::error("Error saving function args. Arg number {0}/{1} is null!", i,ptrsToArgs.size()); 
 				assert(false && "Error saving function args");
 			}
 		}
-		if (!CalleeF.canThrow())
-			return CalleeF.func->getReturnType() == llvm::Type::getVoidTy(*ctxt) ? builder->CreateCall(CalleeF.func, ptrsToArgs) : builder->CreateCall(CalleeF.func, ptrsToArgs, "calltmp");
-		spdlog::debug("Function can throw; making checks for unwind blocks...");
-		assert(currentUnwindBlock != NULL && "Attempted to call a function that throws errors with no way to catch the error!");
-		llvm::BasicBlock *normalUnwindBlock = llvm::BasicBlock::Create(*ctxt, "NormalExecBlock", currentFunction);
-		llvm::Value *retval = CalleeF.func->getReturnType() == llvm::Type::getVoidTy(*ctxt) ? builder->CreateInvoke(CalleeF.func, normalUnwindBlock, currentUnwindBlock, ptrsToArgs) : builder->CreateInvoke(CalleeF.func, normalUnwindBlock, currentUnwindBlock, ptrsToArgs, "calltmp");
-		builder->SetInsertPoint(normalUnwindBlock);
-		spdlog::debug("Unwind blocks found!");
-		return retval;
+		if (calleeSlot == NULL)
+			return createCall(ptrsToArgs, CalleeF);
+		// Without anywhere to construct the result, it goes in a temporary that's moved out of as soon as the call returns
+		bool intoSlot = returnSlot != NULL && returnSlot->getType() == calleeSlot->getType();
+		if (!intoSlot)
+			returnSlot = createEntryBlockAlloca(calleeSlot->getType()->getNonOpaquePointerElementType(), NULL, "sretTmp");
+		ptrsToArgs.insert(ptrsToArgs.begin(), returnSlot);
+		createCall(ptrsToArgs, CalleeF);
+		return intoSlot ? NULL : builder->CreateLoad(calleeSlot->getType()->getNonOpaquePointerElementType(), returnSlot, "sretval");
 	}
 
 	/**
@@ -129,6 +318,445 @@ namespace jimpilier
 		llvm::Type *t1 = arg1 == NULL ? (llvm::Type*)NULL : (llvm::Type*)arg1->getType(), *t2 = arg2 == NULL ? (llvm::Type*) NULL : (llvm::Type*)arg2->getType(); 
 		return getOperatorFromTypes(t1, opStr, t2); 
 	}
+	/**
+	 * @brief Get the struct indices of an object's fields in the order they were declared, which isn't the order they're stored in
+	 * for objects with a `packed` or hot/cold layout. Types without registered members (& padding) just go in struct order.
+	 */
+	std::vector<unsigned> getFieldDeclarationOrder(llvm::StructType *structTy)
+	{
+		std::vector<unsigned> order;
+		for (ObjectMember &member : AliasMgr.objects.getObject(structTy).members)
+			order.push_back(member.index);
+		if (order.size() != structTy->getNumElements())
+			for (unsigned i = 0; i < structTy->getNumElements(); i++)
+				if (std::find(order.begin(), order.end(), i) == order.end())
+					order.push_back(i);
+		return order;
+	}
+	/**
+	 * @brief Get the destructor for an object type, or NULL if destroying it is a no-op.
+	 * Objects without a destructor of their own still get one generated if any of their members need destroying.
+	 */
+	llvm::Function *getObjectDestructor(llvm::Type *ty)
+	{
+		llvm::StructType *structTy = llvm::dyn_cast<llvm::StructType>(ty);
+		if (structTy == NULL || structTy->isOpaque())
+			return NULL;
+		llvm::Function *dtor = AliasMgr.objects.getDestructor(ty);
+		if (dtor != NULL)
+			return dtor;
+		std::vector<std::pair<unsigned, llvm::Function *>> memberDtors;
+		for (unsigned i : getFieldDeclarationOrder(structTy))
+			if (llvm::Function *memberDtor = getObjectDestructor(structTy->getElementType(i)))
+				memberDtors.push_back({i, memberDtor});
+		if (memberDtors.empty())
+			return NULL;
+		spdlog::debug("Generating member-wise destructor for {}", AliasMgr.getTypeName(ty));
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		dtor = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), {ty->getPointerTo()}, false), llvm::Function::ExternalLinkage, AliasMgr.objects.getObjectName(ty) + ".destructor", GlobalVarsAndFunctions.get());
+		dtor->getArg(0)->setName("this");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", dtor));
+		// Members are destroyed in the reverse order they were declared in, like C++
+		for (auto member = memberDtors.rbegin(); member != memberDtors.rend(); member++)
+			builder->CreateCall(member->second, {builder->CreateStructGEP(ty, dtor->getArg(0), member->first, "memberaccess")});
+		builder->CreateRetVoid();
+		llvm::verifyFunction(*dtor);
+		AliasMgr.objects.addDestructor(ty, dtor);
+		memberwiseDestructors.insert(dtor);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return dtor;
+	}
+	/**
+	 * @brief Get `T copy(T*)` for a type that owns memory (strings, arrays...), which makes a copy with its own, or NULL if copying
+	 * the bytes is enough (or if it can't be copied at all; see isCopyable()). Objects get one generated if any of their members need copying;
+	 * the rest of their members are copied as they are.
+	 */
+	llvm::Function *getObjectCopier(llvm::Type *ty)
+	{
+		llvm::StructType *structTy = llvm::dyn_cast<llvm::StructType>(ty);
+		if (structTy == NULL || structTy->isOpaque())
+			return NULL;
+		llvm::Function *copier = AliasMgr.objects.getCopier(ty);
+		if (copier != NULL)
+			return copier;
+		// A destructor of the object's own looks after things a copy can't know about (files, memory from malloc...)
+		llvm::Function *dtor = AliasMgr.objects.getDestructor(ty);
+		if (dtor != NULL && !memberwiseDestructors.count(dtor))
+			return NULL;
+		std::vector<std::pair<unsigned, llvm::Function *>> memberCopiers;
+		for (unsigned i = 0; i < structTy->getNumElements(); i++)
+		{
+			llvm::Type *memberTy = structTy->getElementType(i);
+			if (llvm::Function *memberCopier = getObjectCopier(memberTy))
+				memberCopiers.push_back({i, memberCopier});
+			else if (getObjectDestructor(memberTy) != NULL)
+				return NULL;
+		}
+		if (memberCopiers.empty())
+			return NULL;
+		spdlog::debug("Generating member-wise copy for {}", AliasMgr.getTypeName(ty));
+		llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+		copier = llvm::Function::Create(llvm::FunctionType::get(ty, {ty->getPointerTo()}, false), llvm::Function::InternalLinkage, AliasMgr.objects.getObjectName(ty) + ".copy", GlobalVarsAndFunctions.get());
+		llvm::Value *source = copier->getArg(0);
+		source->setName("source");
+		builder->SetInsertPoint(llvm::BasicBlock::Create(*ctxt, "entry", copier));
+		llvm::Value *result = builder->CreateLoad(ty, source, "copyval");
+		for (auto &member : memberCopiers)
+		{
+			llvm::Value *memberCopy = builder->CreateCall(member.second, {builder->CreateStructGEP(ty, source, member.first, "memberaccess")}, "membercopy");
+			result = builder->CreateInsertValue(result, memberCopy, {member.first}, "copyval");
+		}
+		builder->CreateRet(result);
+		llvm::verifyFunction(*copier);
+		AliasMgr.objects.addCopier(ty, copier);
+		if (lastInsertPoint != NULL)
+			builder->SetInsertPoint(lastInsertPoint);
+		return copier;
+	}
+
+	/**
+	 * @brief Whether a value of this type can be copied: it either doesn't need destroying, or has a copier that gives the copy its own
+	 * of everything it owns. Anything else (objects with a destructor of their own, arenas...) would be destroyed once per copy
+	 */
+	bool isCopyable(llvm::Type *ty)
+	{
+		return getObjectDestructor(ty) == NULL || getObjectCopier(ty) != NULL;
+	}
+	/**
+	 * @brief Allocate a fixed-size local in the current function's entry block, wherever we happen to be generating code.
+	 * Keeps loops from growing the stack every iteration, and lets mem2reg/SROA promote the local to a register.
+	 */
+	llvm::AllocaInst *createEntryBlockAlloca(llvm::Type *ty, llvm::Value *arraySize = NULL, const llvm::Twine &name = "")
+	{
+		llvm::BasicBlock &entry = currentFunction->getEntryBlock();
+		llvm::BasicBlock::iterator insertPoint = entry.begin();
+		// Keep the allocas together (and in the order they were declared) at the top of the block
+		while (insertPoint != entry.end() && llvm::isa<llvm::AllocaInst>(insertPoint))
+			insertPoint++;
+		llvm::IRBuilder<> entryBuilder(&entry, insertPoint);
+		return entryBuilder.CreateAlloca(ty, arraySize, name);
+	}
+	/**
+	 * @brief Whether atomic instructions work on this type: integers (bools are widened to a byte), floating point numbers & pointers
+	 */
+	bool isAtomicType(llvm::Type *ty)
+	{
+		return ty->isIntegerTy() || ty->isFloatingPointTy() || ty->isPointerTy();
+	}
+	/**
+	 * @brief Atomic instructions have to be naturally aligned, which every Jimbo variable already is
+	 */
+	llvm::Align getAtomicAlign(llvm::Type *ty)
+	{
+		return llvm::Align(DataLayout->getTypeStoreSize(ty).getFixedSize());
+	}
+	/**
+	 * @brief The pointer atomic instructions use for a slot: bools are read & written as a whole byte, since atomics can't be 1 bit wide
+	 */
+	llvm::Value *getAtomicPointer(llvm::Value *ptr)
+	{
+		if (ptr->getType()->getNonOpaquePointerElementType()->isIntegerTy(1))
+			return builder->CreateBitCast(ptr, builder->getInt8PtrTy(), "atomicbyteptr");
+		return ptr;
+	}
+	llvm::Value *createAtomicLoad(llvm::Value *ptr, llvm::AtomicOrdering order = llvm::AtomicOrdering::SequentiallyConsistent)
+	{
+		llvm::Type *ty = ptr->getType()->getNonOpaquePointerElementType();
+		llvm::Value *atomicPtr = getAtomicPointer(ptr);
+		llvm::Type *atomicTy = atomicPtr->getType()->getNonOpaquePointerElementType();
+		llvm::LoadInst *load = builder->CreateAlignedLoad(atomicTy, atomicPtr, getAtomicAlign(atomicTy), "atomicload");
+		load->setAtomic(order);
+		return atomicTy == ty ? (llvm::Value *)load : builder->CreateTrunc(load, ty, "atomicbool");
+	}
+	void createAtomicStore(llvm::Value *val, llvm::Value *ptr, llvm::AtomicOrdering order = llvm::AtomicOrdering::SequentiallyConsistent)
+	{
+		llvm::Value *atomicPtr = getAtomicPointer(ptr);
+		llvm::Type *atomicTy = atomicPtr->getType()->getNonOpaquePointerElementType();
+		if (atomicTy != val->getType())
+			val = builder->CreateZExt(val, atomicTy, "atomicbyte");
+		builder->CreateAlignedStore(val, atomicPtr, getAtomicAlign(atomicTy))->setAtomic(order);
+	}
+	/**
+	 * @brief `compare_exchange(x, expected, desired)`: if `x` holds `expected`, replaces it with `desired`. Returns whether it did.
+	 * When `expected` is a variable (a pointer to what `ptr` holds) rather than a value, a failed exchange stores what `x` actually held in it,
+	 * ready for the next try of a compare & swap loop
+	 */
+	llvm::Value *createCompareExchange(llvm::Value *ptr, llvm::Value *expected, llvm::Value *desired, llvm::AtomicOrdering success, llvm::AtomicOrdering failure)
+	{
+		llvm::Type *ty = ptr->getType()->getNonOpaquePointerElementType();
+		llvm::Value *expectedSlot = expected->getType() == ty->getPointerTo() ? expected : NULL;
+		if (expectedSlot != NULL)
+			expected = builder->CreateLoad(ty, expectedSlot, "expected");
+		if (expected->getType() != ty || desired->getType() != ty)
+		{
+			logError("compare_exchange() was given a(n) " + AliasMgr.getTypeName(expected->getType()) + " and a(n) " + AliasMgr.getTypeName(desired->getType()) + " for a variable that holds a(n) " + AliasMgr.getTypeName(ty));
+			return NULL;
+		}
+		// cmpxchg only works on integers & pointers, so anything else is compared as an integer of the same size
+		llvm::Type *cmpTy = ty->isPointerTy() ? ty : builder->getIntNTy(std::max<uint64_t>(8, DataLayout->getTypeSizeInBits(ty).getFixedSize()));
+		llvm::Value *cmpPtr = cmpTy == ty ? ptr : builder->CreateBitCast(ptr, cmpTy->getPointerTo(), "atomicbitsptr");
+		auto toBits = [&](llvm::Value *val)
+		{
+			if (cmpTy == ty)
+				return val;
+			return ty->isIntegerTy() ? builder->CreateZExt(val, cmpTy, "atomicbyte") : builder->CreateBitCast(val, cmpTy, "atomicbits");
+		};
+		llvm::Value *swap = builder->CreateAtomicCmpXchg(cmpPtr, toBits(expected), toBits(desired), getAtomicAlign(cmpTy), success, failure);
+		swap->setName("swap");
+		llvm::Value *swapped = builder->CreateExtractValue(swap, {1u}, "swapped");
+		if (expectedSlot != NULL)
+		{
+			llvm::Value *seen = builder->CreateExtractValue(swap, {0u}, "seen");
+			if (cmpTy != ty)
+				seen = ty->isIntegerTy() ? builder->CreateTrunc(seen, ty, "seen") : builder->CreateBitCast(seen, ty, "seen");
+			// Storing it even when the exchange worked (it's the value it was already) saves a branch
+			builder->CreateStore(seen, expectedSlot);
+		}
+		return swapped;
+	}
+	/**
+	 * @brief The size of a fixed-size local in bytes, as the i64 that lifetime markers take
+	 */
+	llvm::ConstantInt *getLocalSize(llvm::AllocaInst *slot)
+	{
+		uint64_t count = ((llvm::ConstantInt *)slot->getArraySize())->getZExtValue();
+		return builder->getInt64(DataLayout->getTypeAllocSize(slot->getAllocatedType()) * count);
+	}
+	/**
+	 * @brief Clean up every local in one scope, last declared first. `except` isn't destroyed (used when it's being returned by value)
+	 */
+	void emitScopeExit(std::vector<ScopedLocal> &scope, llvm::Value *except = NULL)
+	{
+		for (auto obj = scope.rbegin(); obj != scope.rend(); obj++)
+		{
+			if (obj->destructor != NULL && obj->slot != except)
+			{
+				builder->CreateCall(obj->destructor, {obj->slot});
+				if (obj->liveFlag != NULL)
+					builder->CreateStore(builder->getFalse(), obj->liveFlag);
+			}
+			builder->CreateLifetimeEnd(builder->CreateBitCast(obj->slot, builder->getInt8PtrTy(), "lifetimeptr"), getLocalSize(obj->slot));
+		}
+	}
+	/**
+	 * @brief Clean up the locals in every scope from `depth` inwards, without closing those scopes. Used by return, break & continue
+	 */
+	void emitScopeExitsFrom(size_t depth, llvm::Value *except = NULL)
+	{
+		for (size_t i = localScopes.size(); i > depth; i--)
+			emitScopeExit(localScopes[i - 1], except);
+	}
+	void pushLocalScope()
+	{
+		localScopes.push_back({});
+	}
+	/**
+	 * @brief Close the innermost scope, cleaning up its locals unless the block already ended (return, break, etc. handle that themselves)
+	 */
+	void popLocalScope()
+	{
+		if (builder->GetInsertBlock() != NULL && builder->GetInsertBlock()->getTerminator() == NULL)
+			emitScopeExit(localScopes.back());
+		localScopes.pop_back();
+	}
+	/**
+	 * @brief Register a freshly declared local (an alloca from createEntryBlockAlloca) with the current scope: its lifetime starts here
+	 * and ends when the scope does, when it's also destroyed if `dtor` isn't NULL. Does nothing outside of a function body.
+	 */
+	void trackLocal(llvm::AllocaInst *slot, llvm::Function *dtor = NULL)
+	{
+		if (localScopes.empty())
+			return;
+		builder->CreateLifetimeStart(builder->CreateBitCast(slot, builder->getInt8PtrTy(), "lifetimeptr"), getLocalSize(slot));
+		ScopedLocal obj = {slot, dtor, NULL};
+		if (dtor != NULL && !tryCleanups.empty())
+		{
+			obj.liveFlag = createEntryBlockAlloca(builder->getInt1Ty(), NULL, slot->getName() + ".alive");
+			builder->CreateStore(builder->getTrue(), obj.liveFlag);
+			tryCleanups.back().push_back(obj);
+		}
+		localScopes.back().push_back(obj);
+	}
+	/**
+	 * @brief In -edu/-rp mode, variables declared in top-level code are locals of the static function, so they optimize like any other local.
+	 * The first time another function uses one, it's moved into a global variable they can both see.
+	 *
+	 * @return llvm::Value* - where the variable lives now
+	 */
+	llvm::Value *shareStaticLocal(CompileTimeVariable &var)
+	{
+		llvm::AllocaInst *slot = llvm::dyn_cast_or_null<llvm::AllocaInst>(var.val);
+		if (slot == NULL || STATIC == NULL || currentFunction == STATIC || slot->getFunction() != STATIC)
+			return var.val;
+		spdlog::debug("Sharing top-level variable {} with {}", slot->getName().str(), currentFunction == NULL ? "global code" : currentFunction->getName().str());
+		llvm::Type *ty = slot->getAllocatedType();
+		if (slot->isArrayAllocation())
+			ty = llvm::ArrayType::get(ty, llvm::cast<llvm::ConstantInt>(slot->getArraySize())->getZExtValue());
+		llvm::GlobalVariable *global = new llvm::GlobalVariable(*GlobalVarsAndFunctions, ty, false, llvm::GlobalValue::ExternalLinkage, llvm::Constant::getNullValue(ty), slot->getName());
+		llvm::Constant *shared = llvm::ConstantExpr::getPointerBitCastOrAddrSpaceCast(global, slot->getType());
+		// The slot is left behind unused (scopes may still refer to it), but bounds checks proven on it no longer hold
+		slot->replaceAllUsesWith(shared);
+		auto provenOn = [slot](BoundsCheck &bc)
+		{ return bc.indexSlot == slot || bc.arraySlot == slot; };
+		pendingBoundsChecks.erase(std::remove_if(pendingBoundsChecks.begin(), pendingBoundsChecks.end(), provenOn), pendingBoundsChecks.end());
+		provenBoundsChecks.erase(std::remove_if(provenBoundsChecks.begin(), provenBoundsChecks.end(), provenOn), provenBoundsChecks.end());
+		if (atomicSlots.erase(slot))
+			atomicSlots.insert(shared);
+		var.val = shared;
+		return shared;
+	}
+	/**
+	 * @brief The scope bookkeeping of the function we were in before starting a new one
+	 */
+	struct FunctionScopeState
+	{
+		std::vector<std::vector<ScopedLocal>> scopes, tryCleanups;
+		std::stack<size_t> escapeDepths;
+	};
+	/**
+	 * @brief Start tracking locals for a new function body (functions can be generated while we're in the middle of another one)
+	 */
+	FunctionScopeState enterFunctionScope()
+	{
+		FunctionScopeState outer = {std::move(localScopes), std::move(tryCleanups), std::move(escapeScopeDepth)};
+		localScopes.clear();
+		tryCleanups.clear();
+		escapeScopeDepth = std::stack<size_t>();
+		return outer;
+	}
+	/**
+	 * @brief Clean up whatever's left at the end of a function body (if it falls off the end), and go back to the enclosing function's bookkeeping
+	 */
+	void exitFunctionScope(FunctionScopeState &outer)
+	{
+		while (!localScopes.empty())
+			popLocalScope();
+		localScopes = std::move(outer.scopes);
+		tryCleanups = std::move(outer.tryCleanups);
+		escapeScopeDepth = std::move(outer.escapeDepths);
+	}
+	/**
+	 * @brief The error slot used in error code mode. Holds the tag of the pending error (a pointer to its type's `_error@` info),
+	 * or null if there isn't one. The thrown object itself is in getErrorPayloadSlot(). Both are thread local, so threads can't see each other's errors
+	 */
+	llvm::GlobalVariable *getErrorTagSlot()
+	{
+		llvm::GlobalVariable *slot = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal("error.tag", builder->getInt8PtrTy());
+		if (!slot->hasInitializer())
+		{
+			slot->setLinkage(llvm::GlobalValue::InternalLinkage);
+			slot->setThreadLocal(true);
+			slot->setInitializer(llvm::Constant::getNullValue(builder->getInt8PtrTy()));
+		}
+		return slot;
+	}
+	/**
+	 * @brief A heap copy of the object that was thrown, while an error is pending in error code mode
+	 */
+	llvm::GlobalVariable *getErrorPayloadSlot()
+	{
+		llvm::GlobalVariable *slot = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal("error.payload", builder->getInt8PtrTy());
+		if (!slot->hasInitializer())
+		{
+			slot->setLinkage(llvm::GlobalValue::InternalLinkage);
+			slot->setThreadLocal(true);
+			slot->setInitializer(llvm::Constant::getNullValue(builder->getInt8PtrTy()));
+		}
+		return slot;
+	}
+	/**
+	 * @brief Return from the current function with an error pending, cleaning up its locals on the way out.
+	 * The return value is a placeholder; callers check the error slot before using it
+	 */
+	void emitErrorReturn()
+	{
+		emitScopeExitsFrom(0);
+		if (currentFunction->getReturnType()->isVoidTy())
+			builder->CreateRetVoid();
+		else
+			builder->CreateRet(llvm::Constant::getNullValue(currentFunction->getReturnType()));
+	}
+	/**
+	 * @brief Check the error slot after calling a `throws` function. If an error is pending, jump to the enclosing try block's handler,
+	 * or pass it on to our own caller if there isn't one
+	 */
+	void emitErrorCheck()
+	{
+		llvm::BasicBlock *noError = llvm::BasicBlock::Create(*ctxt, "noerror", currentFunction), *onError = currentUnwindBlock;
+		if (onError == NULL)
+		{
+			assert(throwingFunctions.count(currentFunction) && "Attempted to call a function that throws errors with no way to catch the error!");
+			onError = llvm::BasicBlock::Create(*ctxt, "passerror", currentFunction);
+		}
+		llvm::Value *tag = builder->CreateLoad(builder->getInt8PtrTy(), getErrorTagSlot(), "errortag");
+		// Errors are the rare case; keep the normal path as the fall-through
+		builder->CreateCondBr(builder->CreateIsNotNull(tag, "haserror"), onError, noError, llvm::MDBuilder(*ctxt).createBranchWeights(1, 2000));
+		if (currentUnwindBlock == NULL)
+		{
+			builder->SetInsertPoint(onError);
+			emitErrorReturn();
+		}
+		builder->SetInsertPoint(noError);
+	}
+	/**
+	 * @brief Get the FILE* that debug prints are written to when `--debug-print=<file>` is used.
+	 * The first call generates a small helper function that opens the file (with a 64KB buffer) the first time it runs, and caches it in a global.
+	 * If the file can't be opened, the helper falls back to stderr.
+	 *
+	 * @return llvm::Value* - a call to the helper, returning the FILE* as an i8*
+	 */
+	llvm::Value *getDebugPrintSink(){
+		llvm::Function *sinkfunc = GlobalVarsAndFunctions->getFunction("debugprint.sink");
+		if (sinkfunc == NULL)
+		{
+			spdlog::debug("Creating debug print sink for file: {}", debugPrintFile);
+			llvm::BasicBlock *lastInsertPoint = builder->GetInsertBlock();
+			llvm::Type *fileptrty = builder->getInt8PtrTy();
+			llvm::GlobalVariable *cachedfile = (llvm::GlobalVariable *)GlobalVarsAndFunctions->getOrInsertGlobal("debugprint.file", fileptrty);
+			cachedfile->setLinkage(llvm::GlobalValue::InternalLinkage);
+			cachedfile->setInitializer(llvm::ConstantPointerNull::get((llvm::PointerType *)fileptrty));
+			llvm::FunctionCallee fopenfunc = GlobalVarsAndFunctions->getOrInsertFunction("fopen", llvm::FunctionType::get(fileptrty, {fileptrty, fileptrty}, false));
+			llvm::FunctionCallee fdopenfunc = GlobalVarsAndFunctions->getOrInsertFunction("fdopen", llvm::FunctionType::get(fileptrty, {builder->getInt32Ty(), fileptrty}, false));
+			llvm::FunctionCallee setvbuffunc = GlobalVarsAndFunctions->getOrInsertFunction("setvbuf", llvm::FunctionType::get(builder->getInt32Ty(), {fileptrty, fileptrty, builder->getInt32Ty(), builder->getInt64Ty()}, false));
+
+			sinkfunc = llvm::Function::Create(llvm::FunctionType::get(fileptrty, false), llvm::Function::InternalLinkage, "debugprint.sink", GlobalVarsAndFunctions.get());
+			llvm::BasicBlock *entry = llvm::BasicBlock::Create(*ctxt, "entry", sinkfunc),
+							 *openblock = llvm::BasicBlock::Create(*ctxt, "openfile", sinkfunc),
+							 *fallbackblock = llvm::BasicBlock::Create(*ctxt, "fallback", sinkfunc),
+							 *bufferblock = llvm::BasicBlock::Create(*ctxt, "setbuffer", sinkfunc),
+							 *done = llvm::BasicBlock::Create(*ctxt, "done", sinkfunc);
+			builder->SetInsertPoint(entry);
+			llvm::Value *file = builder->CreateLoad(fileptrty, cachedfile, "filetmp");
+			builder->CreateCondBr(builder->CreateIsNull(file, "cmptmp"), openblock, done);
+
+			builder->SetInsertPoint(openblock);
+			llvm::Value *opened = builder->CreateCall(fopenfunc, {builder->CreateGlobalStringPtr(debugPrintFile), builder->CreateGlobalStringPtr("w")}, "fopentmp");
+			builder->CreateCondBr(builder->CreateIsNull(opened, "cmptmp"), fallbackblock, bufferblock);
+
+			builder->SetInsertPoint(fallbackblock);
+			llvm::Value *stderrfile = builder->CreateCall(fdopenfunc, {builder->getInt32(2), builder->CreateGlobalStringPtr("w")}, "stderrtmp");
+			builder->CreateBr(bufferblock);
+
+			builder->SetInsertPoint(bufferblock);
+			llvm::PHINode *newfile = builder->CreatePHI(fileptrty, 2, "newfile");
+			newfile->addIncoming(opened, openblock);
+			newfile->addIncoming(stderrfile, fallbackblock);
+			// _IOFBF == 0; let stdio allocate the buffer itself
+			builder->CreateCall(setvbuffunc, {newfile, llvm::ConstantPointerNull::get((llvm::PointerType *)fileptrty), builder->getInt32(0), builder->getInt64(1 << 16)});
+			builder->CreateStore(newfile, cachedfile);
+			builder->CreateBr(done);
+
+			builder->SetInsertPoint(done);
+			llvm::PHINode *ret = builder->CreatePHI(fileptrty, 2, "sinktmp");
+			ret->addIncoming(file, entry);
+			ret->addIncoming(newfile, bufferblock);
+			builder->CreateRet(ret);
+			llvm::verifyFunction(*sinkfunc);
+			builder->SetInsertPoint(lastInsertPoint);
+		}
+		return builder->CreateCall(sinkfunc, {}, "debugsinktmp");
+	}
 }
 
 #endif
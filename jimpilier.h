@@ -17,6 +17,13 @@
 #define jimbo
 #include "globals.cpp"
 #include "TypeExpr.cpp"
+#include "Allocator.cpp"
+#include "Parallel.cpp"
+#include "Async.cpp"
+#include "Strings.cpp"
+#include "HashTables.cpp"
+#include "FunctionAttrs.cpp"
+#include "ConstEval.cpp"
 #include "AliasManager.cpp"
 #include "ExprAST.cpp"
 #include "tokenizer.cpp"
@@ -28,7 +35,7 @@ namespace jimpilier
 
 	std::vector<Variable> functionArgList(Stack<Token> &tokens);
 	std::map<KeyToken, bool> variableModStmt(Stack<Token> &tokens);
-	std::unique_ptr<FunctionAST> functionDecl(Stack<Token> &tokens, std::unique_ptr<TypeExpr> &dtype, std::string name, std::string objBase = "");
+	std::unique_ptr<FunctionAST> functionDecl(Stack<Token> &tokens, std::unique_ptr<TypeExpr> &dtype, std::string name, std::string objBase = "", bool isConst = false);
 	std::unique_ptr<ExprAST> analyzeFile(string fileDir);
 	std::unique_ptr<ExprAST> getValidStmt(Stack<Token> &tokens);
 	std::unique_ptr<ExprAST> debugPrintStmt(Stack<Token> &tokens);
@@ -36,7 +43,7 @@ namespace jimpilier
 	std::unique_ptr<ExprAST> mathExpr(Stack<Token> &tokens);
 	std::unique_ptr<ExprAST> listExpr(Stack<Token> &tokens);
 	std::unique_ptr<ExprAST> assignStmt(Stack<Token> &tokens, std::unique_ptr<ExprAST> LHS = NULL);
-	std::unique_ptr<TypeExpr> variableTypeStmt(Stack<Token> &tokens);
+	std::unique_ptr<TypeExpr> variableTypeStmt(Stack<Token> &tokens, bool castContext = false);
 	void functionArg(Stack<Token> &tokens, Variable &out);
 
 	// TODO: Move this function into driver code maybe ???
@@ -147,6 +154,9 @@ namespace jimpilier
 		case (TRU):
 		case (FALS):
 			return std::make_unique<NumberExprAST>(tokens.next() == TRU);
+		default:
+			// Every other token (keywords like parallel/async/await/atomic, operators...) can't start a term
+			break;
 		}
 		logError("Invalid term:", tokens.peek());
 		return NULL;
@@ -276,11 +286,47 @@ namespace jimpilier
 		return std::make_unique<NotExprAST>(std::move(val));
 	}
 
+	/**
+	 * @brief Parses `await <task>`, or an await builtin: `await sleep(ms)`, `await readable(fd)` or `await writable(fd)`
+	 */
+	std::unique_ptr<ExprAST> awaitExpr(Stack<Token> &tokens)
+	{
+		if (tokens.peek() != AWAIT)
+			return std::move(notExpr(tokens));
+		tokens.next();
+		Token name = tokens.peek();
+		if (name == IDENT && (name.lex == "sleep" || name.lex == "readable" || name.lex == "writable") && tokens.scry(1) == LPAREN)
+		{
+			tokens.next();
+			tokens.next();
+			std::vector<std::unique_ptr<ExprAST>> args;
+			if (tokens.peek() != RPAREN)
+				do
+				{
+					std::unique_ptr<ExprAST> arg = std::move(assignStmt(tokens));
+					if (arg == NULL)
+					{
+						logError("Invalid parameter passed to await " + name.lex, name);
+						return NULL;
+					}
+					args.push_back(std::move(arg));
+				} while ((tokens.peek() == COMMA && tokens.next() == COMMA));
+			if (tokens.next() != RPAREN)
+			{
+				logError("Expected a closing parethesis '(' here:", tokens.currentToken());
+				return NULL;
+			}
+			return std::make_unique<AwaitExprAST>(name.lex, args);
+		}
+		std::unique_ptr<ExprAST> task = std::move(notExpr(tokens));
+		return std::make_unique<AwaitExprAST>(task);
+	}
+
 	std::unique_ptr<ExprAST> deleteStmt(Stack<Token> &tokens)
 	{
 		if (tokens.peek() != DEL)
 		{
-			return std::move(notExpr(tokens));
+			return std::move(awaitExpr(tokens));
 		}
 		tokens.next();
 		std::unique_ptr<ExprAST> delme = std::move(assignStmt(tokens));
@@ -333,6 +379,18 @@ namespace jimpilier
 		}
 		tokens.next();
 		std::unique_ptr<ExprAST> retval = std::make_unique<HeapExprAST>();
+		// heap(someArena) T(...) allocates out of an arena instead
+		if (tokens.peek() == LPAREN)
+		{
+			tokens.next();
+			std::unique_ptr<ExprAST> arena = std::move(assignStmt(tokens));
+			if (arena == NULL || tokens.next() != RPAREN)
+			{
+				logError("Expected an arena followed by a closing parenthesis ')' here:", tokens.currentToken());
+				return NULL;
+			}
+			retval = std::make_unique<HeapExprAST>(arena);
+		}
 		return ConstructorCallStmt(tokens, std::move(retval));
 	}
 
@@ -343,7 +401,7 @@ namespace jimpilier
 		if (tokens.peek() != SIZEOF)
 			return std::move(heapStmt(tokens));
 		tokens.next();
-		tyval = std::move(variableTypeStmt(tokens));
+		tyval = std::move(variableTypeStmt(tokens, true));
 		if (tyval == NULL)
 		{
 			convertee = std::move(heapStmt(tokens));
@@ -360,7 +418,7 @@ namespace jimpilier
 			return convertee;
 		}
 		tokens.next();
-		std::unique_ptr<TypeExpr> toconv = std::move(variableTypeStmt(tokens));
+		std::unique_ptr<TypeExpr> toconv = std::move(variableTypeStmt(tokens, true));
 		return std::make_unique<TypeCastExprAST>(convertee, toconv);
 	}
 
@@ -659,7 +717,7 @@ namespace jimpilier
 			return NULL;
 		}
 		tokens.next();
-		return std::move(std::make_unique<CodeBlockAST>(contents)); //*/
+		return std::move(std::make_unique<CodeBlockAST>(contents, true)); //*/
 	}
 
 	/**
@@ -696,6 +754,35 @@ namespace jimpilier
 		return std::make_unique<ConstructorExprAST>((args), body, obj);
 	}
 
+	/**
+	 * @brief Parses an object's destructor. Destructors take no arguments, so the parentheses are optional
+	 *
+	 * @param tokens
+	 * @return std::unique_ptr<ExprAST>
+	 */
+	std::unique_ptr<ExprAST> destruct(Stack<Token> &tokens, std::string obj)
+	{
+		Token t = tokens.next();
+		if (t != DESTRUCTOR)
+		{
+			logError("Expected a destructor token here:", t);
+			return NULL;
+		}
+		if (tokens.peek() == LPAREN)
+		{
+			tokens.next();
+			t = tokens.next();
+			if (t != RPAREN)
+			{
+				tokens.go_back(1);
+				logError("Destructors can't take arguments. Expecting a right parenthesis at this token:", t);
+				return NULL;
+			}
+		}
+		std::unique_ptr<ExprAST> body = std::move(codeBlockExpr(tokens));
+		return std::make_unique<DestructorExprAST>(body, obj);
+	}
+
 	void thisOrFunctionArg(Stack<Token> &tokens, Variable &out, std::string parentTy = "")
 	{
 		if (tokens.peek() == IDENT && tokens.peek().lex == "this")
@@ -851,11 +938,21 @@ namespace jimpilier
 		while (tokens.peek() == MULT || tokens.peek() == POINTER || tokens.peek() == OPENSQUARE)
 		{
 			if(tokens.peek() == OPENSQUARE && tokens.next() == OPENSQUARE){
+				// `T[...]` is a view of part of an array
+				if(tokens.peek() == RANGE && tokens.next() == RANGE){
+					if(tokens.peek() != CLOSESQUARE)
+						logError("Expected a closing square bracket here ", tokens.next());
+					tokens.next(); 
+					type = std::make_unique<SliceOfTypeExpr>(type); 
+					continue; 
+				}
+				// `T[soa]` stores each member of T in its own array
+				bool soa = tokens.peek() == IDENT && tokens.peek().lex == "soa" && tokens.next() == IDENT;
 				if(tokens.peek() != CLOSESQUARE){// assert(tokens.next() == CLOSESQUARE)
 					logError("Expected a closing square bracket here ", tokens.next());
 				}
 				tokens.next(); 
-				type = std::make_unique<ArrayOfTypeExpr>(type);  
+				type = std::make_unique<ArrayOfTypeExpr>(type, soa);  
 				continue; 
 			}
 				tokens.next();
@@ -886,6 +983,26 @@ namespace jimpilier
 		std::vector<std::unique_ptr<TypeExpr>> templates = std::move(templateObjNames(tokens));
 
 		ObjectHeaderExpr objName(name, templates);
+		ObjectLayout layout;
+		// `packed` and `align N` are only keywords between the object's name and its body
+		while (tokens.peek() == IDENT && (tokens.peek().lex == "packed" || tokens.peek().lex == "align"))
+		{
+			if (tokens.next().lex == "packed")
+			{
+				layout.packed = true;
+				continue;
+			}
+			Token alignment = tokens.next();
+			// Anything longer than 4 digits is too big anyway, and might not even fit in a long
+			bool digits = alignment == NUMCONST && alignment.lex.find_first_not_of("0123456789") == std::string::npos;
+			unsigned long bytes = digits && alignment.lex.size() <= 4 ? std::stoul(alignment.lex) : 0;
+			if (bytes == 0 || bytes > 4096 || (bytes & (bytes - 1)) != 0)
+			{
+				logError("Object alignments must be a power of two no bigger than 4096:", alignment);
+				return NULL;
+			}
+			layout.align = bytes;
+		}
 		if (tokens.next() != OPENCURL)
 		{
 			logError("Curly braces are required for object declarations. Please put a brace before this token:", tokens.currentToken());
@@ -899,6 +1016,17 @@ namespace jimpilier
 				objFunctions.push_back(std::move(constructorast));
 				continue;
 			}
+			if (tokens.peek() == DESTRUCTOR)
+			{
+				std::unique_ptr<ExprAST> destructorast = std::move(destruct(tokens, objName.name));
+				objFunctions.push_back(std::move(destructorast));
+				continue;
+			}
+
+			// `hot`/`cold` mark a field, unless there's an object with that name for them to be the type of
+			FieldHeat heat = normalField;
+			if (tokens.peek() == IDENT && (tokens.peek().lex == "hot" || tokens.peek().lex == "cold") && !AliasMgr.objects.hasObject(tokens.peek().lex))
+				heat = tokens.next().lex == "hot" ? hotField : coldField;
 
 			std::unique_ptr<TypeExpr> ty = std::move(variableTypeStmt(tokens));
 			if (ty == NULL)
@@ -928,12 +1056,37 @@ namespace jimpilier
 			if (tokens.peek() == SEMICOL)
 				tokens.next();
 			objVars.push_back(Variable(name.lex, ty));
+			layout.heat.push_back(heat);
 		}
 		tokens.next();
 		for(auto &x : objName.templates) AliasMgr.objects.removeObject(x->getName()); 
-		return std::make_unique<ObjectExprAST>(objName, objVars, objFunctions, overloadedOperators);
+		return std::make_unique<ObjectExprAST>(objName, objVars, objFunctions, overloadedOperators, layout);
 	}
-	std::unique_ptr<TypeExpr> variableTypeStmt(Stack<Token> &tokens)
+	/**
+	 * @brief Parses the width of a vector type (the `x4` in `float x4`), if there is one.
+	 * Since `float x4` could just as well declare a float named x4, the width only counts when a name (or `*`/`[]`) follows it,
+	 * or when nothing could be declared anyway (after `as`)
+	 */
+	std::unique_ptr<TypeExpr> &vectorTypeStmt(Stack<Token> &tokens, std::unique_ptr<TypeExpr> &type, bool castContext)
+	{
+		Token t = tokens.peek();
+		if (t != IDENT || t.lex.size() < 2 || t.lex[0] != 'x' || t.lex.find_first_not_of("0123456789", 1) != std::string::npos)
+			return type;
+		Token after = tokens.scry(1);
+		if (!castContext && after != IDENT && after != MULT && after != OPENSQUARE)
+			return type;
+		// Anything longer than 2 digits is too wide anyway, and might not even fit in a long
+		unsigned width = t.lex.size() <= 3 ? std::stoul(t.lex.substr(1)) : 0;
+		if (width < 2 || width > 64 || (width & (width - 1)) != 0)
+		{
+			logError("Vector widths must be a power of two between 2 and 64:", t);
+			return type;
+		}
+		tokens.next();
+		type = std::make_unique<VectorTypeExpr>(type, width);
+		return type;
+	}
+	std::unique_ptr<TypeExpr> variableTypeStmt(Stack<Token> &tokens, bool castContext)
 	{
 		Token t = tokens.next();
 		std::unique_ptr<TypeExpr> type = NULL;
@@ -955,8 +1108,7 @@ namespace jimpilier
 			type = std::make_unique<DoubleTypeExpr>();
 			break;
 		case STRING:
-			type = std::make_unique<ByteTypeExpr>();
-			type = std::make_unique<PointerToTypeExpr>(type);
+			type = std::make_unique<StructTypeExpr>("string");
 			break;
 		case BOOL:
 			type = std::make_unique<BoolTypeExpr>();
@@ -967,7 +1119,8 @@ namespace jimpilier
 			break;
 		case IDENT:
 			type = std::make_unique<StructTypeExpr>(t.lex);
-			if (type->codegen(true) == NULL)
+			// The built-in map<K, V> & set<K> (see HashTables.cpp) only exist as templates
+			if (type->codegen(true) == NULL && !((t.lex == "map" || t.lex == "set") && tokens.peek() == LESS))
 			{
 				tokens.go_back();
 				return NULL;
@@ -976,6 +1129,14 @@ namespace jimpilier
 		case VOID:
 			type = std::make_unique<VoidTypeExpr>();
 			break;
+		case ASYNC:
+			type = variableTypeStmt(tokens);
+			if (type == NULL)
+			{
+				logError("Expected the type an async function returns after 'async':", tokens.peek());
+				return NULL;
+			}
+			return std::make_unique<AsyncTypeExpr>(type);
 		default:
 			tokens.go_back();
 			return NULL;
@@ -988,6 +1149,8 @@ namespace jimpilier
 			assert(tokens.peek() == GREATER && tokens.next() == GREATER && "Expected a closing '>' in a template type"); 
 			type = std::make_unique<TemplateObjectExpr>(t.lex, types); 
 		}
+		if (t != IDENT && t != VOID && t != STRING)
+			vectorTypeStmt(tokens, type, castContext);
 		return std::move(parseTypeModifiers(tokens, type)); 
 	}
 	/**
@@ -1010,6 +1173,7 @@ namespace jimpilier
 				{CONST, false},
 				{SINGULAR, false},
 				{VOLATILE, false},
+				{ATOMIC, false},
 				{PUBLIC, false},
 				{PRIVATE, false},
 				{PROTECTED, false},
@@ -1039,7 +1203,8 @@ namespace jimpilier
 		if (LHS == NULL)
 			LHS = std::move(debugPrintStmt(tokens));
 		std::unique_ptr<ExprAST> RHS = NULL;
-		if (tokens.peek() == EQUALS)
+		bool add = tokens.peek() == PLUSEQUALS;
+		if (tokens.peek() == EQUALS || add)
 		{
 			tokens.next();
 			RHS = std::move(assignStmt(tokens));
@@ -1047,12 +1212,67 @@ namespace jimpilier
 		else
 			return LHS;
 
-		return std::make_unique<AssignStmtAST>(LHS, RHS);
+		return std::make_unique<AssignStmtAST>(LHS, RHS, add);
+	}
+
+	/**
+	 * @brief If the tokens ahead declare a generic function (`T max<T>(T a, T b)`), the typenames it declares.
+	 * They have to be known before the return type is parsed, since that's usually one of them
+	 */
+	std::vector<std::string> templateFunctionNames(Stack<Token> &tokens)
+	{
+		std::vector<std::string> names;
+		// The return type comes first, so the function's name is at least one token in
+		for (int i = 1; i < 64; i++)
+		{
+			Token t = tokens.scry(i);
+			if (t == LPAREN || t == OPENCURL || t == CLOSECURL || t == EQUALS || t == SEMICOL || t == ERR || tokens.index + i >= tokens.size)
+				return names;
+			if (t != IDENT || tokens.scry(i + 1) != LESS)
+				continue;
+			int j = i + 2;
+			while (tokens.scry(j) == IDENT && tokens.scry(j + 1) == COMMA)
+			{
+				names.push_back(tokens.scry(j).lex);
+				j += 2;
+			}
+			if (tokens.scry(j) == IDENT && tokens.scry(j + 1) == GREATER && tokens.scry(j + 2) == LPAREN)
+			{
+				names.push_back(tokens.scry(j).lex);
+				return names;
+			}
+			names.clear();
+		}
+		return names;
+	}
+
+	/**
+	 * @brief Parses a generic function, i.e. a function with typenames after its name: `T max<T>(T a, T b) { ... }`
+	 */
+	std::unique_ptr<ExprAST> templateFunctionDecl(Stack<Token> &tokens, std::vector<std::string> &templateNames, bool isConst)
+	{
+		for (auto &x : templateNames)
+			AliasMgr.objects.addObject(x, llvm::Type::getVoidTy(*ctxt));
+		std::unique_ptr<TypeExpr> dtype = std::move(variableTypeStmt(tokens));
+		Token name = tokens.next();
+		if (dtype == NULL || name != IDENT)
+		{
+			logError("Expected the return type & name of a generic function here:", name);
+			return NULL;
+		}
+		std::vector<std::unique_ptr<TypeExpr>> templates = std::move(templateObjNames(tokens));
+		std::unique_ptr<FunctionAST> func = std::move(functionDecl(tokens, dtype, name.lex, "", isConst));
+		for (auto &x : templateNames)
+			AliasMgr.objects.removeObject(x);
+		return std::make_unique<TemplateFunctionAST>(name.lex, templateNames, func);
 	}
 
 	std::unique_ptr<ExprAST> declareStmt(Stack<Token> &tokens)
 	{
 		std::map<KeyToken, bool> mods = variableModStmt(tokens);
+		std::vector<std::string> templateNames = templateFunctionNames(tokens);
+		if (!templateNames.empty())
+			return templateFunctionDecl(tokens, templateNames, mods[CONST]);
 		std::unique_ptr<TypeExpr> dtype = std::move(variableTypeStmt(tokens));
 		if (dtype == NULL)
 		{
@@ -1074,9 +1294,9 @@ namespace jimpilier
 			tokens.next();
 			if (tokens.peek() == LPAREN)
 			{
-				return std::move(functionDecl(tokens, dtype, name.lex));
+				return std::move(functionDecl(tokens, dtype, name.lex, "", mods[CONST]));
 			}
-			std::unique_ptr<ExprAST> declval = std::make_unique<DeclareExprAST>(name.lex, std::move(dtype->clone()), false);
+			std::unique_ptr<ExprAST> declval = std::make_unique<DeclareExprAST>(name.lex, std::move(dtype->clone()), false, 1, mods[ATOMIC], mods[CONST]);
 			declval = std::move(assignStmt(tokens, std::move(declval)));
 			vars.push_back(std::move(declval));
 		} while (tokens.peek() == COMMA && tokens.next() == COMMA);
@@ -1130,7 +1350,7 @@ namespace jimpilier
 	 * @param tokens
 	 * @return std::unique_ptr<FunctionAST>
 	 */
-	std::unique_ptr<FunctionAST> functionDecl(Stack<Token> &tokens, std::unique_ptr<TypeExpr> &dtype, std::string name, std::string objBase)
+	std::unique_ptr<FunctionAST> functionDecl(Stack<Token> &tokens, std::unique_ptr<TypeExpr> &dtype, std::string name, std::string objBase, bool isConst)
 	{
 
 		std::vector<Variable> args;
@@ -1147,8 +1367,20 @@ namespace jimpilier
 				throwables.push_back(std::move(ty));
 			} while (tokens.peek() == COMMA && tokens.next() == COMMA);
 		}
-		std::unique_ptr<PrototypeAST> proto = std::make_unique<PrototypeAST>(name, args, throwables, dtype, objBase);
 		std::unique_ptr<ExprAST> body = std::move(codeBlockExpr(tokens));
+		// Functions without a body are C functions, which take & return C strings rather than string objects
+		if (body == NULL)
+		{
+			std::unique_ptr<TypeExpr> chars = std::make_unique<ByteTypeExpr>();
+			std::unique_ptr<TypeExpr> cstring = std::make_unique<PointerToTypeExpr>(chars);
+			for (auto &arg : args)
+				if (arg.ty != nullptr && arg.ty->getName() == "string")
+					arg.ty = cstring->clone();
+			if (dtype != nullptr && dtype->getName() == "string")
+				dtype = cstring->clone();
+		}
+		std::unique_ptr<PrototypeAST> proto = std::make_unique<PrototypeAST>(name, args, throwables, dtype, objBase);
+		proto->isConst = isConst;
 		std::unique_ptr<FunctionAST> func = std::make_unique<FunctionAST>(std::move(proto), std::move(body));
 		return func;
 	}
@@ -1269,6 +1501,81 @@ namespace jimpilier
 		return std::make_unique<ForExprAST>(beginStmts, std::move(condition), std::move(body), endStmts);
 	}
 
+	/**
+	 * @brief Parses a `parallel for` loop. The header is more restricted than a regular for loop's, since the iterations get split up between threads:
+	 * `parallel for (long i = start; i < end; i++) reduce(+ total, max best) { ... }` (the reduce clause is optional)
+	 * @param tokens
+	 * @return std::unique_ptr<ExprAST>
+	 */
+	std::unique_ptr<ExprAST> parallelForStmt(Stack<Token> &tokens)
+	{
+		std::vector<std::pair<std::string, std::string>> reductions;
+		tokens.next();
+		if (tokens.next() != FOR)
+		{
+			logError("Expected a for loop after 'parallel':", tokens.currentToken());
+			return NULL;
+		}
+		bool hasparen = false;
+		if (tokens.peek() == LPAREN && tokens.next() == LPAREN)
+			hasparen = true;
+		std::unique_ptr<TypeExpr> indexType = std::move(variableTypeStmt(tokens));
+		Token index = tokens.next();
+		if (indexType == NULL || index != IDENT || tokens.next() != EQUALS)
+		{
+			logError("A parallel for loop has to declare its counter, like 'parallel for (long i = 0; i < n; i++)':", tokens.currentToken());
+			return NULL;
+		}
+		std::unique_ptr<ExprAST> start = std::move(mathExpr(tokens));
+		if (tokens.peek() == SEMICOL)
+			tokens.next();
+		Token cmp;
+		if (tokens.next().lex != index.lex || ((cmp = tokens.next()) != LESS && cmp != LESSEQUALS))
+		{
+			logError("The condition of a parallel for loop has to compare its counter to the end of the range ('i < end' or 'i <= end'):", tokens.currentToken());
+			return NULL;
+		}
+		std::unique_ptr<ExprAST> end = std::move(mathExpr(tokens));
+		if (tokens.peek() == SEMICOL)
+			tokens.next();
+		if (tokens.next().lex != index.lex || tokens.next() != INCREMENT)
+		{
+			logError("A parallel for loop has to count up by one ('i++'):", tokens.currentToken());
+			return NULL;
+		}
+		if (hasparen && tokens.next() != RPAREN)
+		{
+			logError("Unclosed parenthesis surrounding parallel for statement after this token:", tokens.currentToken());
+			return NULL;
+		}
+		if (tokens.peek() == IDENT && tokens.peek().lex == "reduce")
+		{
+			tokens.next();
+			if (tokens.next() != LPAREN)
+			{
+				logError("Expected a '(' after 'reduce':", tokens.currentToken());
+				return NULL;
+			}
+			do
+			{
+				Token op = tokens.next(), var = tokens.next();
+				if ((op != PLUS && op != MULT && op.lex != "min" && op.lex != "max") || var != IDENT)
+				{
+					logError("Each reduction is an operator (+, *, min or max) followed by a variable, like 'reduce(+ total)':", op);
+					return NULL;
+				}
+				reductions.push_back({op.lex, var.lex});
+			} while (tokens.peek() == COMMA && tokens.next() == COMMA);
+			if (tokens.next() != RPAREN)
+			{
+				logError("Expected a ')' to close the reduce clause:", tokens.currentToken());
+				return NULL;
+			}
+		}
+		std::unique_ptr<ExprAST> body = std::move(jimpilier::codeBlockExpr(tokens));
+		return std::make_unique<ParallelForExprAST>(indexType, index.lex, start, end, cmp == LESSEQUALS, reductions, body);
+	}
+
 	/**
 	 * @brief Parses an if/else statement header and it's associated body
 	 * @param tokens
@@ -1496,6 +1803,8 @@ namespace jimpilier
 			return NULL;
 		case FOR:
 			return std::move(jimpilier::forStmt(tokens));
+		case PARALLEL:
+			return std::move(jimpilier::parallelForStmt(tokens));
 		case DO:
 			return std::move(jimpilier::doWhileStmt(tokens));
 		case WHILE:
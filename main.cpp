@@ -91,7 +91,8 @@ int main(int argc, char **args)
     jimpilier::builder = std::make_unique<llvm::IRBuilder<>>(*jimpilier::ctxt);
     jimpilier::DataLayout = std::make_unique<llvm::DataLayout>(jimpilier::GlobalVarsAndFunctions.get());
     jimpilier::currentFunction = NULL;
-    if (argc > 2)
+    // Every arg before the file name is a compiler flag
+    while (all_args.size() > 1 && all_args[0][0] == '-')
     {
         std::string arg1 = all_args[0];
         if (arg1 == "-edu" || arg1 == "-rp")
@@ -100,8 +101,25 @@ int main(int argc, char **args)
             jimpilier::STATIC = jimpilier::currentFunction;
             llvm::BasicBlock *staticentry = llvm::BasicBlock::Create(*jimpilier::ctxt, "entry", jimpilier::currentFunction);
             jimpilier::builder->SetInsertPoint(staticentry);
-            all_args.erase(all_args.begin());
         }
+        else if (arg1 == "--release" || arg1 == "-DNDEBUG")
+        {
+            jimpilier::releaseMode = true;
+        }
+        else if (arg1 == "--error-codes")
+        {
+            jimpilier::errorCodeMode = true;
+        }
+        else if (arg1.rfind("--debug-print=", 0) == 0)
+        {
+            jimpilier::debugPrintFile = arg1.substr(std::string("--debug-print=").size());
+        }
+        else
+        {
+            spdlog::error("Error: Unknown compiler flag: {}", arg1);
+            return 1;
+        }
+        all_args.erase(all_args.begin());
     }
     time_t now = time(nullptr);
     Stack<Token> tokens = jimpilier::loadTokens(all_args[0]);
@@ -113,6 +131,13 @@ int main(int argc, char **args)
         if (x != NULL)
             x->codegen();
     }
+    // Falling off the end of the top-level code exits the program successfully
+    if (jimpilier::STATIC != NULL && jimpilier::builder->GetInsertBlock() != NULL && jimpilier::builder->GetInsertBlock()->getParent() == jimpilier::STATIC && jimpilier::builder->GetInsertBlock()->getTerminator() == NULL)
+        jimpilier::builder->CreateRet(jimpilier::builder->getInt32(0));
+    for (llvm::Function &func : *jimpilier::GlobalVarsAndFunctions)
+        jimpilier::promoteNonEscapingHeapObjects(func);
+    jimpilier::lowerCoroutines(*jimpilier::GlobalVarsAndFunctions);
+    jimpilier::inferFunctionAttributes(*jimpilier::GlobalVarsAndFunctions);
     if (jimpilier::GlobalVarsAndFunctions->getFunction("main") == NULL && jimpilier::STATIC != NULL)
         jimpilier::STATIC->setName("main");
     else if (jimpilier::STATIC != NULL)
@@ -187,5 +187,613 @@ TEST(TestCompiledCode, TestDebugOperator)
 		x++;
 	}
 
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestDebugOperatorRelease)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb --release testData/debugOperatorModes.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestDebugOperatorRelease<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"5 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	if(out == "./testData/out.txt")	EXPECT_EQ(actual, expected[0]); 
+	std::getline(input, actual);
+	if(out == "./testData/out.txt")	EXPECT_TRUE(input.eof());
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestDebugOperatorFileSink)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb --debug-print=testData/debug.txt testData/debugOperatorModes.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestDebugOperatorFileSink<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// stdout only gets the regular print, the debug values go to the sink file
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	if(out == "./testData/out.txt")	EXPECT_EQ(actual, "5 ");
+	std::vector<std::string> expected = {"Debug value (Line 4): 5", "Debug value (Line 6): 2"};
+	std::ifstream sink("./testData/debug.txt");
+	std::getline(sink, actual);
+	int x = 0;
+	while (!sink.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(sink, actual); // Get the x-th line
+		x++;
+	}
+	system("rm -rf ./testData/out.txt ./testData/debug.txt;");
+}
+
+TEST(TestCompiledCode, TestPowOperator)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/powOperator.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestPowOperator<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"1024 1594323 1 ", "-8 0 1 ", "8192.000000 2.000000 8.000000 ", "1 3 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestHeapAllocators)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/heapAllocators.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestHeapAllocators<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"4 8 7 0 ", "999000 ", "19999 0 ", "9 0 ", "0 5050 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestEscapeAnalysis)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/escapeAnalysis.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestEscapeAnalysis<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"15 ", "18 21 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestDestructors)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/destructors.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestDestructors<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"bye 3 ", "end of scopes ", "bye 2 ", "bye 1 ", "bye 10 ", "bye 11 ", "bye 130 ", "kept 30 ", "bye 50 ", "bye 20 ", "after try ", "bye 41 ", "bye 40 ", "bye 30 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestFunctionAttributes)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/functionAttributes.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestFunctionAttributes<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"98 10 88 ", "2 -7 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestErrorCodes)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb --error-codes testData/errorCodes.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestErrorCodes<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"8150 ", "relayed 8 ", "guard 4 ", "9 ", "guard 42 ", "bad int 42 ", "0 ", "guard -1 ", "caught negative "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestCatchDispatch)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/catchDispatch.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestCatchDispatch<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"int 7 ", "string seven ", "catching float ", "float 7.500000 ", "picked 3 ", "catching float "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestCatchDispatchErrorCodes)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb --error-codes testData/catchDispatch.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestCatchDispatchErrorCodes<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"int 7 ", "string seven ", "catching float ", "float 7.500000 ", "picked 3 ", "catching float "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestArrays)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/arrays.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestArrays<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	// The last index is out of bounds on purpose, so the program exits with an error
+	EXPECT_NE(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"25 32 ", "100 576 ", "4996 ", "1000 ", "25 ", "27 76 ", "2 2.500000 ", "Index 30 is out of bounds for an array of size 27"};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestSimdVectors)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/simdVectors.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestSimdVectors<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	// The last vload reads past the end of the array on purpose, so the program exits with an error
+	EXPECT_NE(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"<5.500000, 7.000000, 10.000000, 13.000000> ", "<2.500000, 3.000000, 4.000000, 5.000000> <0.750000, 1.000000, 1.500000, 2.000000> ",
+										 "<12, 15, 21, 27> 7 ", "<1, 1, 0, 0> ", "all smaller ", "<4.000000, 3.000000, 2.000000, 1.500000> ", "<1.500000, 4.000000, 2.000000, 5.000000> ",
+										 "10.500000 9 4.000000 ", "<4.000000, 6.000000, 8.000000, 10.000000> ", "1.000000 40.000000 100.000000 6.000000 ", "56 32 ",
+										 "Index 9 is out of bounds for an array of size 8"};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestParallelFor)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/parallelFor.jmb 2>&1 | JIMBO_THREADS=4 lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestParallelFor<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"704982704 0 99999 ", "332833500 ", "1 ", "1024.000000 ", "234000 ", "20 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestAsyncAwait)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/asyncAwait.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestAsyncAwait<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"2 0 ", "2 1 ", "1 0 ", "1 1 ", "20 10 ", "12 ", "a long string that lives on the heap for sure! ", "12 ", "2 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestAtomics)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/atomics.jmb 2>&1 | JIMBO_THREADS=4 lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestAtomics<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"10000 49995000 10000 ", "4998 ", "42 ", "1 0 ", "0 1 7 ", "1000 499500 ", "1000 1000 1000 1000 7 15 14 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestConstEval)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/constEval.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestConstEval<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"6765 9 541 338350 ", "1024 1048576 ", "55 144 34 ", "1 0 ", "3 4 5 6 ", "9 8 ", "2.500000 ", "4 4 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestImplicitMain)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb -edu testData/implicitMain.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestImplicitMain<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"45 ", "18 2 ", "55 6 ", "5 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestObjectLayout)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/objectLayout.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestObjectLayout<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"24 32 1 300 2 123456789 ", "4 5 6 7 ", "0 4 8 ", "64 0 0 9 ", "wide 8 ", "small 3 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestSoaArrays)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/soaArrays.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestSoaArrays<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"10 3.500000 10 9.500000 ", "50.000000 ", "10 ", "an item name long enough to be on the heap! 1 replaced an item name long enough to be on the heap! ", "an item name long enough to be on the heap! changed in the copy an item name long enough to be on the heap! "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestCopyElision)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/copyElision.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestCopyElision<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"5 6 ", "6 31 ", "7 108 ", "8 0 0 ", "6 3 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestStrings)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/strings.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestStrings<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"short 5 ", "a literal that is too long to fit inline 40 ", "short and a literal that is too long to fit inline 50 ", "short and a literal that is too long to fit inline ", "short and a literal that is too long to fit inline (copy) ", "Hello, world ", "short! ", "short ", "45 ", "equal ", "not equal ", "same ", "s t ", "abababababababababababababababababababab 40 ", "1 ", "1 ", "reset 40 ", "short! plain ", "42 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestStringSwitch)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/stringSwitch.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestStringSwitch<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"1 1 2 0 0 ", "3 4 0 ", "2 ", "pux ", "falls through "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestHashMap)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/hashMap.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestHashMap<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"3 1 1 3 ", "1 0 3 ", "1 0 2 ", "7 ", "500 166666500 0 1 ", "500 998001 ", "1 0 1 2 ", "0 0 ", "one! two 0 3 ", "10 20 3 2 ", "a definition long enough to be stored on the heap changed ", "1 0 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestGenericFunctions)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/genericFunctions.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestGenericFunctions<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"7 1.500000 10 10 3 ", "42 2.500000 2 1.500000 ", "0 1 ", "1 0 210 0 210 ", "48 -1 94 ", "20896 1 ", "210 0 ", "0.500000 2.500000 4.500000 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestSlices)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/slices.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestSlices<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"3 4 16 29 ", "285 0 ", "9 16 36 81 ", "49 0 0 ", "9 3 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+TEST(TestCompiledCode, TestFileIO)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/fileIO.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestFileIO<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"1 1 ", "1 100002 527812 50000 ", "1 627813 100001 n s ", "0 0 0 0 ", "39 - 8 7 ", "0 0 "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
+	system("rm -rf ./testData/out.txt;");
+}
+
+TEST(TestCompiledCode, TestValueCopies)
+{
+	std::string out = getOutputEnv();
+	std::string cmd ="./jmb testData/valueCopies.jmb 2>&1 | lli-14 >>" + out;
+	if(out != "./testData/out.txt") cmd= "echo \"TestValueCopies<<\0\" >" + out + " ; " + cmd + "echo \"\0\" >> " + out ;
+	int result = system(cmd.c_str());
+	EXPECT_EQ(result, EXIT_SUCCESS);
+	// Read the output file and compare with expected content
+	std::vector<std::string> expected = {"1 2 3 2 1 ", "1 2 7 ", "the first word, which is long enough to allocate x ",
+										 "a person whose name is long enough for the heap someone else a brand new name that is quite long ",
+										 "a person whose name is long enough for the heap a temporary person with a long name changed 2 a team title that goes on the heap too "};
+	std::string actual;
+	std::ifstream input(out);
+	std::getline(input, actual);
+	int x = 0;
+	while (!input.eof() && x < expected.size())
+	{
+		EXPECT_EQ(actual, expected[x]);
+		std::getline(input, actual); // Get the x-th line
+		x++;
+	}
+
 	system("rm -rf ./testData/out.txt;");
 }
\ No newline at end of file
@@ -44,4 +44,133 @@ TEST(TestSyntax, TestEdgecaseSwitchStmts){
 TEST(TestSyntax, TestNestedTryCatch){
 	int result = system("./jmb testData/nestedTryCatch.jmb 2> /dev/null");
     EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestDebugPrintReleaseMode){
+	int result = system("./jmb --release testData/debugOperatorModes.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestDebugPrintFileMode){
+	int result = system("./jmb --debug-print=testData/debug.txt testData/debugOperatorModes.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestPowOperator){
+	int result = system("./jmb testData/powOperator.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestHeapAllocators){
+	int result = system("./jmb testData/heapAllocators.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestEscapeAnalysis){
+	int result = system("./jmb testData/escapeAnalysis.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestDestructors){
+	int result = system("./jmb testData/destructors.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestFunctionAttributes){
+	int result = system("./jmb testData/functionAttributes.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestErrorCodes){
+	int result = system("./jmb --error-codes testData/errorCodes.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestCatchDispatch){
+	int result = system("./jmb testData/catchDispatch.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestArrays){
+	int result = system("./jmb testData/arrays.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestSimdVectors){
+	int result = system("./jmb testData/simdVectors.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestParallelFor){
+	int result = system("./jmb testData/parallelFor.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestAsyncAwait){
+	int result = system("./jmb testData/asyncAwait.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestAtomics){
+	int result = system("./jmb testData/atomics.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestConstEval){
+	int result = system("./jmb testData/constEval.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestImplicitMain){
+	int result = system("./jmb -edu testData/implicitMain.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestObjectLayout){
+	int result = system("./jmb testData/objectLayout.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestSoaArrays){
+	int result = system("./jmb testData/soaArrays.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestCopyElision){
+	int result = system("./jmb testData/copyElision.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestStrings){
+	int result = system("./jmb testData/strings.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestStringSwitch){
+	int result = system("./jmb testData/stringSwitch.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestHashMap){
+	int result = system("./jmb testData/hashMap.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestGenericFunctions){
+	int result = system("./jmb testData/genericFunctions.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestSlices){
+	int result = system("./jmb testData/slices.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestFileIO){
+	int result = system("./jmb testData/fileIO.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestGenericMissingOperator){
+	// Compiling this has to fail: string has no < for sort to use
+	int result = system("./jmb testData/genericMissingOperator.jmb > /dev/null 2> /dev/null");
+    EXPECT_NE(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestValueCopies){
+	int result = system("./jmb testData/valueCopies.jmb 2> /dev/null");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestParallelForThrow){
+	// Compiling this has to fail: the try block can't catch an error thrown on a worker thread
+	int result = system("./jmb testData/parallelForThrow.jmb > /dev/null 2> /dev/null");
+    EXPECT_NE(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestDestructorCopy){
+	// Compiling this has to fail: both copies of the object would be destroyed
+	int result = system("./jmb testData/destructorCopy.jmb > /dev/null 2> /dev/null");
+    EXPECT_NE(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestHugeAlignment){
+	// Compiling this has to fail with the usual alignment error, rather than an uncaught exception
+	int result = system("./jmb testData/hugeAlignment.jmb 2>&1 | grep -q 'power of two no bigger than 4096'");
+    EXPECT_EQ(result, EXIT_SUCCESS);
+}
+TEST(TestSyntax, TestHugeVectorWidth){
+	// Compiling this has to fail with the usual vector width error, rather than an uncaught exception
+	int result = system("./jmb testData/hugeVectorWidth.jmb 2>&1 | grep -q 'power of two between 2 and 64'");
+    EXPECT_EQ(result, EXIT_SUCCESS);
 }
\ No newline at end of file
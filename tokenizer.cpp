@@ -10,12 +10,12 @@ using namespace std;
 
 enum KeyToken{
     IDENT, ERR, IN, AND, OR, TRU, FALS, NOT, IMPORT, //Done
-    EQUALCMP, EQUALS, NOTEQUAL, GREATER, GREATEREQUALS, LESS, LESSEQUALS, INSERTION, REMOVAL, INCREMENT, DECREMENT, //Done
+    EQUALCMP, EQUALS, NOTEQUAL, GREATER, GREATEREQUALS, LESS, LESSEQUALS, INSERTION, REMOVAL, INCREMENT, DECREMENT, PLUSEQUALS, //Done
     OPENCURL, CLOSECURL, OPENSQUARE, CLOSESQUARE, LPAREN, RPAREN, COMMA, BAR, //Done
     PLUS, MINUS, MULT, DIV, LEFTOVER, POWERTO, POINTERTO, REFRENCETO, AS, SIZEOF, HEAP, DEL, RANGE, //Done
-    IF, ELSE, FOR, DO, WHILE, CASE, SWITCH, BREAK, CONTINUE, DEFAULT, RET, PRINT, PRINTLN, ASSERT, TRY, CATCH, ASSEMBLY,//Done
+    IF, ELSE, FOR, DO, WHILE, CASE, SWITCH, BREAK, CONTINUE, DEFAULT, RET, PRINT, PRINTLN, ASSERT, TRY, CATCH, ASSEMBLY, PARALLEL, ASYNC, AWAIT,//Done
     OBJECT, CONSTRUCTOR, DESTRUCTOR, SEMICOL, COLON, PERIOD,//Done
-    CONST, SINGULAR, VOLATILE, PUBLIC, PRIVATE, PROTECTED, OPERATOR, THROW, THROWS,//Done
+    CONST, SINGULAR, VOLATILE, ATOMIC, PUBLIC, PRIVATE, PROTECTED, OPERATOR, THROW, THROWS,//Done
     SCONST, NUMCONST, //Done
     INT, SHORT, LONG, POINTER, FLOAT, DOUBLE, STRING, BOOL, CHAR, BYTE, VOID, AUTO //Done 
 };
@@ -24,18 +24,18 @@ map<string, KeyToken> keywords = {
     {"", IDENT}, {"in", IN}, {"and",AND}, {"or",OR}, {"true", TRU}, {"false", FALS}, {"not", NOT},{"import", IMPORT},
     {"if", IF}, {"else", ELSE}, {"for", FOR}, {"do", DO},{"while", WHILE}, {"case", CASE}, {"switch", SWITCH}, {"break", BREAK}, {"continue", CONTINUE}, {"default", DEFAULT}, {"return", RET}, {"print",PRINT}, {"println", PRINTLN}, {"assert", ASSERT}, {"try", TRY}, {"catch", CATCH}, 
     {"object", OBJECT}, {"constructor", CONSTRUCTOR}, {"destructor", DESTRUCTOR}, {"as", AS}, {"sizeof", SIZEOF}, {"heap", HEAP}, {"delete", DEL}, 
-    {"const", CONST}, {"singular", SINGULAR}, {"volatile", VOLATILE}, {"public", PUBLIC}, {"private", PRIVATE}, {"protected", PROTECTED}, {"operator", OPERATOR}, {"throw", THROW}, {"throws", THROWS}, {"assembly", ASSEMBLY},
+    {"const", CONST}, {"singular", SINGULAR}, {"volatile", VOLATILE}, {"atomic", ATOMIC}, {"public", PUBLIC}, {"private", PRIVATE}, {"protected", PROTECTED}, {"operator", OPERATOR}, {"throw", THROW}, {"throws", THROWS}, {"assembly", ASSEMBLY}, {"parallel", PARALLEL}, {"async", ASYNC}, {"await", AWAIT},
     {"int", INT}, {"short", SHORT}, {"long", LONG}, {"pointer", POINTER}, {"ptr", POINTER}, {"float", FLOAT}, {"double", DOUBLE}, {"string", STRING}, {"bool", BOOL}, {"char", CHAR}, {"byte", BYTE}, {"void", VOID}, {"auto", AUTO}
 };
 
 string keytokens[]{
     "IDENT", "ERR", "IN", "AND", "OR", "TRU", "FALS", "NOT", "IMPORT",
-    "EQUALCMP", "EQUALS", "NOTEQUAL", "GREATER", "GREATEREQUALS", "LESS", "LESSEQUALS", "INSERTION", "REMOVAL", "INCREMENT", "DECREMENT",
+    "EQUALCMP", "EQUALS", "NOTEQUAL", "GREATER", "GREATEREQUALS", "LESS", "LESSEQUALS", "INSERTION", "REMOVAL", "INCREMENT", "DECREMENT", "PLUSEQUALS",
     "OPENCURL", "CLOSECURL", "OPENSQUARE", "CLOSESQUARE", "LPAREN", "RPAREN", "COMMA", "BAR",
     "PLUS", "MINUS", "MULT", "DIV", "LEFTOVER", "POWERTO", "POINTERTO", "REFRENCETO", "AS", "SIZEOF", "HEAP", "DELETE", "RANGE",
-    "IF", "ELSE", "FOR", "DO", "WHILE", "CASE", "SWITCH", "BREAK", "CONTINUE", "DEFAULT", "RET", "PRINT", "PRINTLN", "ASSERT", "TRY", "CATCH", "ASSEMBLY", 
+    "IF", "ELSE", "FOR", "DO", "WHILE", "CASE", "SWITCH", "BREAK", "CONTINUE", "DEFAULT", "RET", "PRINT", "PRINTLN", "ASSERT", "TRY", "CATCH", "ASSEMBLY", "PARALLEL", "ASYNC", "AWAIT",
     "OBJECT", "CONSTRUCTOR", "DESTRUCTOR", "SEMICOL", "COLON", "PERIOD",
-    "CONST", "SINGULAR", "VOLATILE", "PUBLIC", "PRIVATE", "PROTECTED", "OPERATOR", "THROW", "THROWS",
+    "CONST", "SINGULAR", "VOLATILE", "ATOMIC", "PUBLIC", "PRIVATE", "PROTECTED", "OPERATOR", "THROW", "THROWS",
     "SCONST", "NUMCONST",
     "INT","SHORT","LONG","POINTER","FLOAT","DOUBLE","STRING","BOOL","CHAR","BYTE","VOID", "AUTO"
 }; 
@@ -251,6 +251,11 @@ Token getNextToken(istream &s, int &line)
                 s.get();
                 return Token(INCREMENT, "++", line);
             }
+            else if (ch == '+' && nextchar == '=')
+            {
+                s.get();
+                return Token(PLUSEQUALS, "+=", line);
+            }
             else if (ch == '+')
                 return Token(PLUS, "+", line);
             // Removal operator vs. Less Than